@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <net/ethernet.h>
+
+#include "distinct.h"
+
+enum {
+	DISTINCT_FLOWS,
+	DISTINCT_SOURCES,
+	DISTINCT_DESTINATIONS,
+	DISTINCT_DPORTS,
+	DISTINCT_KINDS
+};
+
+/* HyperLogLog (Flajolet et al.): the top bits of a key's hash pick a
+ * register, which keeps the longest run of leading zeros (plus one) seen in
+ * the rest of the hashes that picked it. All the intervals of a kind are
+ * updated together, as the flow counters are. */
+static uint8_t registers[DISTINCT_KINDS][INTERVAL_COUNT][TT_DISTINCT_REGISTERS];
+
+/* the bits of the hash that are left once the register index is taken */
+#define RANK_BITS (32 - TT_DISTINCT_BITS)
+
+/* 64 bit finaliser (splitmix64), for the keys that aren't hashed yet */
+static inline uint32_t mix64(uint64_t h)
+{
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	return (uint32_t)((h ^ (h >> 31)) >> 32);
+}
+
+/* 32 bit finaliser (murmur3), to spread the flow table's hash, which is
+ * only meant to pick a bucket, over all the bits */
+static inline uint32_t mix32(uint32_t h)
+{
+	h = (h ^ (h >> 16)) * 0x85ebca6bU;
+	h = (h ^ (h >> 13)) * 0xc2b2ae35U;
+	return h ^ (h >> 16);
+}
+
+static uint32_t addr_hash(uint16_t ethertype, const void *addr)
+{
+	uint64_t w[2];
+
+	if (ETHERTYPE_IPV6 == ethertype) {
+		memcpy(w, addr, sizeof(struct in6_addr));
+		return mix64(w[0] ^ (w[1] * 0x9e3779b97f4a7c15ULL));
+	}
+	w[0] = 0;
+	memcpy(w, addr, sizeof(struct in_addr));
+	return mix64(w[0]);
+}
+
+static inline void add_hash(int kind, uint32_t hash)
+{
+	uint32_t index = hash >> RANK_BITS;
+	uint32_t rest = hash << TT_DISTINCT_BITS;
+	uint8_t rank = rest ? __builtin_clz(rest) + 1 : RANK_BITS + 1;
+
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		uint8_t *r = &registers[kind][i][index];
+		*r = (*r < rank) ? rank : *r;
+	}
+}
+
+void tt_distinct_add(const struct flow *f, uint32_t flow_hash)
+{
+	add_hash(DISTINCT_FLOWS, mix32(flow_hash));
+
+	if (ETHERTYPE_IP == f->ethertype) {
+		add_hash(DISTINCT_SOURCES, addr_hash(f->ethertype, &f->src_ip));
+		add_hash(DISTINCT_DESTINATIONS,
+		         addr_hash(f->ethertype, &f->dst_ip));
+	} else if (ETHERTYPE_IPV6 == f->ethertype) {
+		add_hash(DISTINCT_SOURCES,
+		         addr_hash(f->ethertype, &f->src_ip6));
+		add_hash(DISTINCT_DESTINATIONS,
+		         addr_hash(f->ethertype, &f->dst_ip6));
+	}
+	add_hash(DISTINCT_DPORTS, mix64(f->dport));
+}
+
+/* the raw estimate, with the usual corrections for few keys (linear
+ * counting) and for hash collisions near the 32 bit limit */
+static int64_t estimate(const uint8_t reg[TT_DISTINCT_REGISTERS])
+{
+	const double m = TT_DISTINCT_REGISTERS;
+	const double two32 = 4294967296.0;
+	double alpha = 0.7213 / (1.0 + 1.079 / m);
+	double sum = 0;
+	int zeros = 0;
+	double e;
+
+	for (int j = 0; j < TT_DISTINCT_REGISTERS; j++) {
+		sum += ldexp(1.0, -reg[j]);
+		zeros += (0 == reg[j]);
+	}
+	e = alpha * m * m / sum;
+
+	if (e <= 2.5 * m && zeros) {
+		e = m * log(m / zeros);
+	} else if (e > two32 / 30) {
+		e = -two32 * log(1.0 - e / two32);
+	}
+	return (int64_t)(e + 0.5);
+}
+
+void tt_distinct_publish(int interval, struct tt_distinct *out)
+{
+	out->flows = estimate(registers[DISTINCT_FLOWS][interval]);
+	out->sources = estimate(registers[DISTINCT_SOURCES][interval]);
+	out->destinations =
+	    estimate(registers[DISTINCT_DESTINATIONS][interval]);
+	out->dports = estimate(registers[DISTINCT_DPORTS][interval]);
+
+	for (int k = 0; k < DISTINCT_KINDS; k++) {
+		memset(registers[k][interval], 0, TT_DISTINCT_REGISTERS);
+	}
+}
+
+void tt_distinct_clear(void)
+{
+	memset(registers, 0, sizeof(registers));
+}
@@ -0,0 +1,40 @@
+#ifndef DISTINCT_H
+#define DISTINCT_H
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "flow.h"
+
+/* Distinct counts: estimates of the number of flows, source and
+ * destination addresses and destination ports seen in each interval, for
+ * spotting scans and for capacity planning.
+ *
+ * Each is a HyperLogLog sketch of TT_DISTINCT_REGISTERS registers per
+ * interval, so the memory is fixed however many keys there are, and the
+ * standard error of the estimates is about 1.04 / sqrt(registers).
+ */
+
+/* 2^10 registers: ~3% standard error, 1 KiB per count per interval */
+#define TT_DISTINCT_BITS 10
+#define TT_DISTINCT_REGISTERS (1 << TT_DISTINCT_BITS)
+
+struct tt_distinct {
+	int64_t flows;
+	int64_t sources;
+	int64_t destinations;
+	int64_t dports;
+};
+
+/* Count the packet's flow in every interval. flow_hash is the hash of the
+ * flow that the flow table has already computed. */
+void tt_distinct_add(const struct flow *f, uint32_t flow_hash);
+
+/* The interval has ended: estimate its distinct counts into out and start
+ * counting afresh. */
+void tt_distinct_publish(int interval, struct tt_distinct *out);
+
+void tt_distinct_clear(void);
+
+#endif
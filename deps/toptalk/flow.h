@@ -25,6 +25,14 @@ struct flow_record {
 	int64_t packets;
 };
 
+/* a flow's addresses as text, as inet_ntop() writes them */
+#define FLOW_ADDR_STRLEN 46 /* INET6_ADDRSTRLEN */
+
+struct flow_addr_str {
+	char src[FLOW_ADDR_STRLEN];
+	char dst[FLOW_ADDR_STRLEN];
+};
+
 struct flow_pkt {
 	struct flow_record flow_rec;
 	struct timeval timestamp;
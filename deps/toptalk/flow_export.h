@@ -0,0 +1,45 @@
+#ifndef FLOW_EXPORT_H
+#define FLOW_EXPORT_H
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "flow.h"
+
+/* Flow records for export (eg. as IPFIX): what a flow did since it was
+ * first seen, or since its last record.
+ *
+ * A record is made when the flow is removed from the flow table, after it
+ * has been idle for the reference window and the longest interval, and
+ * also whenever a flow that has been active for longer than the active
+ * timeout sees another packet.
+ */
+
+/* why the record was made; the values are IPFIX flowEndReason codes */
+enum tt_flow_end {
+	TT_FLOW_END_IDLE = 1,
+	TT_FLOW_END_ACTIVE = 2,
+	TT_FLOW_END_FORCED = 4
+};
+
+struct tt_flow_export {
+	struct flow flow;
+	struct timeval first; /* capture timestamps of the first and last */
+	struct timeval last;  /* packets of the record */
+	int64_t bytes;
+	int64_t packets;
+	/* the gaps between consecutive packets of the flow, in us */
+	int64_t gap_min;
+	int64_t gap_max;
+	int64_t gap_mean;
+	int64_t jitter; /* the mean change from one gap to the next */
+	enum tt_flow_end end;
+};
+
+/* Called from the toptalk thread, so it should be quick: queue the record
+ * and return. */
+typedef void (*tt_flow_export_fn)(const struct tt_flow_export *r,
+                                  void *data);
+
+#endif
@@ -1,11 +1,15 @@
 #define _GNU_SOURCE
 #include <time.h>
+#include <stdlib.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
 #include <net/ethernet.h>
 #include <arpa/inet.h>
 #include <sched.h>
 #include <pcap.h>
+#include <pcap/sll.h>
+#include <ifaddrs.h>
+#include <netpacket/packet.h>
 #include <pthread.h>
 #include <poll.h>
 #include <errno.h>
@@ -18,13 +22,65 @@
 #include "timeywimey.h"
 
 #include "intervals.h"
+#include "rollup.h"
+#include "distinct.h"
+#include "pgaps.h"
+#include "psizes.h"
+
+/* Per-interval counters, one array element per interval, so that a packet
+ * is added to all of them in one (vectorisable) loop. */
+struct flow_counters {
+	int64_t bytes[INTERVAL_COUNT];
+	int64_t packets[INTERVAL_COUNT];
+};
+
+/* What the flow did since its last export record, for flow export. */
+struct flow_acct {
+	struct timeval first;
+	struct timeval last; /* kept across records, for the next gap */
+	int64_t bytes;
+	int64_t packets;
+	int64_t gap_min; /* us */
+	int64_t gap_max;
+	int64_t gap_sum;
+	int64_t gap_count;
+	int64_t prev_gap; /* kept across records; -1 until there is one */
+	int64_t jitter_sum;
+	int64_t jitter_count;
+};
 
+/*
+ * One entry per flow, for the reference window and all the intervals.
+ *
+ * The interval counters are rotated lazily: cur counts the interval that
+ * was current in epoch[i], done the one before it. When an interval ends,
+ * only interval_epoch[] changes; each entry catches up the next time it is
+ * touched (see roll_flow()).
+ */
 struct flow_hash {
-	struct flow_record f;
-	union {
-		UT_hash_handle r_hh;  /* sliding window reference table */
-		UT_hash_handle ts_hh; /* time series tables */
-	};
+	struct flow_record f; /* counts over the sliding reference window */
+	struct flow_counters cur;
+	struct flow_counters done;
+	/* the packet lengths counted in cur, see psizes.h */
+	uint32_t sizes[INTERVAL_COUNT][TT_PSIZE_BUCKETS];
+	uint32_t epoch[INTERVAL_COUNT];
+	int16_t top_slot[INTERVAL_COUNT]; /* in interval_top[], or -1 */
+	uint32_t rotation; /* value of rotations when last rolled */
+	struct flow_acct acct;
+	struct flow_addr_str addr; /* formatted when first published */
+	UT_hash_handle r_hh;
+};
+
+/*
+ * The top flows of the current epoch of an interval, by descending bytes.
+ *
+ * Within an epoch the counts only grow, one flow at a time, so the set is
+ * kept exact by checking each updated flow against the smallest member.
+ * Members are always up to date with the epoch.
+ */
+struct interval_top {
+	int count;
+	struct flow_hash *flow[MAX_FLOW_COUNT];
 };
 
 struct flow_pkt_list {
@@ -41,6 +97,10 @@ typedef int (*pcap_decoder)(const struct pcap_pkthdr *h,
 /* userdata for callback used in pcap_dispatch */
 struct pcap_handler_user {
 	pcap_decoder decoder; /* callback / function pointer */
+	int dlt;
+	int nano; /* the timestamps are in ns, not us */
+	int have_mac;
+	uint8_t mac[ADDR_LEN_ETHER]; /* of the interface, for the direction */
 	struct {
 		int err;
 		char errstr[DECODE_ERRBUF_SIZE];
@@ -57,15 +117,28 @@ struct tt_thread_private {
 	struct pcap_info pi;
 };
 
-/* long, continuous sliding window tracking top flows */
+/* all flows: those in the sliding reference window, and those that have
+ * left it but still have counts in a current or complete interval */
 static struct flow_hash *flow_ref_table = NULL;
 
+/* flows with packets in the reference window */
+static int ref_flow_count = 0;
+
 /* packet list enables removing expired packets from flow table */
 static struct flow_pkt_list *pkt_list_ref_head = NULL;
 
-/* flows recorded as period-on-period intervals */
-static struct flow_hash *incomplete_flow_tables[INTERVAL_COUNT] = { NULL };
-static struct flow_hash *complete_flow_tables[INTERVAL_COUNT] = { NULL };
+/* flows are recorded as period-on-period intervals, numbered by epoch */
+static uint32_t interval_epoch[INTERVAL_COUNT] = { 0 };
+
+static struct interval_top interval_top[INTERVAL_COUNT];
+
+/* bumped whenever any interval ends, so that up-to-date flows are cheap to
+ * recognise */
+static uint32_t rotations = 0;
+
+/* the longest interval; flows that have left the reference window are
+ * swept out when it ends */
+static int longest_interval = 0;
 
 static struct timeval interval_end[INTERVAL_COUNT] = { 0 };
 static struct timeval interval_start[INTERVAL_COUNT] = { 0 };
@@ -77,41 +150,133 @@ static struct {
 	int64_t packets;
 } totals;
 
-static void clear_table(int table_idx)
+/* flow export, if any; see tt_set_flow_export() */
+static tt_flow_export_fn flow_export = NULL;
+static void *flow_export_data = NULL;
+static struct timeval flow_active_timeout;
+
+static int64_t tv_to_us(struct timeval t)
 {
-	struct flow_hash *table, *iter, *tmp;
+	return t.tv_sec * 1000000LL + t.tv_usec;
+}
 
-	/* clear the complete table */
-	table = complete_flow_tables[table_idx];
-	HASH_ITER(ts_hh, table, iter, tmp)
-	{
-		HASH_DELETE(ts_hh, table, iter);
-		free(iter);
+/* count the packet in the flow's export record */
+static void acct_add(struct flow_hash *fte, struct flow_pkt *pkt)
+{
+	struct flow_acct *a = &fte->acct;
+
+	if (a->last.tv_sec || a->last.tv_usec) {
+		int64_t gap =
+		    tv_to_us(pkt->timestamp) - tv_to_us(a->last);
+
+		if (0 == a->gap_count || gap < a->gap_min) {
+			a->gap_min = gap;
+		}
+		if (0 == a->gap_count || gap > a->gap_max) {
+			a->gap_max = gap;
+		}
+		a->gap_sum += gap;
+		a->gap_count++;
+		if (a->prev_gap >= 0) {
+			a->jitter_sum += llabs(gap - a->prev_gap);
+			a->jitter_count++;
+		}
+		a->prev_gap = gap;
+	}
+	if (0 == a->packets) {
+		a->first = pkt->timestamp;
 	}
-	assert(0 == HASH_CNT(ts_hh, table));
-	complete_flow_tables[table_idx] = NULL;
+	a->last = pkt->timestamp;
+	a->bytes += pkt->flow_rec.bytes;
+	a->packets += pkt->flow_rec.packets;
+}
 
-	/* copy incomplete to complete */
-	HASH_ITER(ts_hh, incomplete_flow_tables[table_idx], iter, tmp)
-	{
-		/* TODO: copy and insert */
-		struct flow_hash *n = malloc(sizeof(struct flow_hash));
-		memcpy(n, iter, sizeof(struct flow_hash));
-		HASH_ADD(ts_hh, complete_flow_tables[table_idx], f.flow,
-		         sizeof(struct flow), n);
-	}
-	assert(HASH_CNT(ts_hh, complete_flow_tables[table_idx])
-	       == HASH_CNT(ts_hh, incomplete_flow_tables[table_idx]));
-
-	/* clear the incomplete table */
-	table = incomplete_flow_tables[table_idx];
-	HASH_ITER(ts_hh, table, iter, tmp)
+/* hand the flow's record to the exporter and start a new one */
+static void export_flow(struct flow_hash *fte, enum tt_flow_end end)
+{
+	struct flow_acct *a = &fte->acct;
+	struct tt_flow_export r;
+
+	if (!flow_export || !a->packets) {
+		return;
+	}
+
+	r.flow = fte->f.flow;
+	r.first = a->first;
+	r.last = a->last;
+	r.bytes = a->bytes;
+	r.packets = a->packets;
+	r.gap_min = a->gap_min;
+	r.gap_max = a->gap_max;
+	r.gap_mean = a->gap_count ? a->gap_sum / a->gap_count : 0;
+	r.jitter = a->jitter_count ? a->jitter_sum / a->jitter_count : 0;
+	r.end = end;
+	flow_export(&r, flow_export_data);
+
+	a->bytes = 0;
+	a->packets = 0;
+	a->gap_min = 0;
+	a->gap_max = 0;
+	a->gap_sum = 0;
+	a->gap_count = 0;
+	a->jitter_sum = 0;
+	a->jitter_count = 0;
+}
+
+/* bring the interval counters of the flow up to the current epochs */
+static void roll_flow(struct flow_hash *fte)
+{
+	if (fte->rotation == rotations) {
+		return;
+	}
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		uint32_t behind = interval_epoch[i] - fte->epoch[i];
+		if (0 == behind) {
+			continue;
+		}
+		/* the current interval is complete, unless it ended even
+		 * longer ago and there have been empty intervals since */
+		fte->done.bytes[i] = (1 == behind) ? fte->cur.bytes[i] : 0;
+		fte->done.packets[i] = (1 == behind) ? fte->cur.packets[i] : 0;
+		fte->cur.bytes[i] = 0;
+		fte->cur.packets[i] = 0;
+		memset(fte->sizes[i], 0, sizeof(fte->sizes[i]));
+		fte->epoch[i] = interval_epoch[i];
+		fte->top_slot[i] = -1;
+	}
+	fte->rotation = rotations;
+}
+
+/* has the flow got anything left to report? */
+static int flow_is_empty(struct flow_hash *fte)
+{
+	int64_t sum = fte->f.bytes;
+
+	roll_flow(fte);
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		sum |= fte->cur.bytes[i] | fte->done.bytes[i];
+	}
+	return (0 == sum);
+}
+
+static void delete_flow(struct flow_hash *fte, enum tt_flow_end end)
+{
+	export_flow(fte, end);
+	HASH_DELETE(r_hh, flow_ref_table, fte);
+	free(fte);
+}
+
+/* remove the flows that have left the reference window and the intervals */
+static void sweep_flows(void)
+{
+	struct flow_hash *iter, *tmp;
+
+	HASH_ITER(r_hh, flow_ref_table, iter, tmp)
 	{
-		HASH_DELETE(ts_hh, table, iter);
-		free(iter);
+		if (flow_is_empty(iter)) {
+			delete_flow(iter, TT_FLOW_END_IDLE);
+		}
 	}
-	assert(0 == HASH_CNT(ts_hh, table));
-	incomplete_flow_tables[table_idx] = NULL;
 }
 
 /* initialise interval start and end times */
@@ -120,23 +285,159 @@ static void init_intervals(struct timeval now)
 	for (int i = 0; i < INTERVAL_COUNT; i++) {
 		interval_start[i] = now;
 		interval_end[i] = tv_add(interval_start[i], tt_intervals[i]);
+		if (0 < tv_cmp(tt_intervals[i], tt_intervals[longest_interval])) {
+			longest_interval = i;
+		}
 	}
 }
 
-static void expire_old_interval_tables(struct timeval now)
+static inline unsigned int rate_calc(struct timeval interval, int bytes)
+{
+	double dt = interval.tv_sec + interval.tv_usec * 1E-6;
+	return (unsigned int)((float)bytes / dt);
+}
+
+/* the flow's interval counts have grown, update the interval rankings */
+static void update_interval_tops(struct flow_hash *fte)
 {
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		struct interval_top *t = &interval_top[i];
+		int slot = fte->top_slot[i];
+
+		if (slot < 0) {
+			if (t->count < MAX_FLOW_COUNT) {
+				slot = t->count++;
+			} else if (fte->cur.bytes[i] >
+			           t->flow[MAX_FLOW_COUNT - 1]->cur.bytes[i]) {
+				/* replaces the smallest */
+				slot = MAX_FLOW_COUNT - 1;
+				t->flow[slot]->top_slot[i] = -1;
+			} else {
+				continue;
+			}
+		}
+
+		/* move it up past the flows it has overtaken */
+		while (slot > 0 &&
+		       t->flow[slot - 1]->cur.bytes[i] < fte->cur.bytes[i]) {
+			t->flow[slot] = t->flow[slot - 1];
+			t->flow[slot]->top_slot[i] = slot;
+			slot--;
+		}
+		t->flow[slot] = fte;
+		fte->top_slot[i] = slot;
+	}
+}
+
+/*
+ * The flow's addresses as text. They are only formatted once the flow makes
+ * it into a top list, and are then kept for as long as the flow is in the
+ * table, so a flow that stays on top costs nothing per interval.
+ */
+static const struct flow_addr_str *flow_addr_str(struct flow_hash *fte)
+{
+	struct flow_addr_str *a = &fte->addr;
+	const struct flow *f = &fte->f.flow;
+	int af;
+	const void *src, *dst;
+
+	if (a->src[0]) {
+		return a;
+	}
+
+	if (ETHERTYPE_IPV6 == f->ethertype) {
+		af = AF_INET6;
+		src = &f->src_ip6;
+		dst = &f->dst_ip6;
+	} else {
+		af = AF_INET;
+		src = &f->src_ip;
+		dst = &f->dst_ip;
+	}
+
+	if (!inet_ntop(af, src, a->src, sizeof(a->src)) ||
+	    !inet_ntop(af, dst, a->dst, sizeof(a->dst))) {
+		snprintf(a->src, sizeof(a->src), "?");
+		snprintf(a->dst, sizeof(a->dst), "?");
+	}
+	return a;
+}
+
+/*
+ * The interval has ended: publish its top flows, then the top flows of the
+ * reference window that weren't counted in it, up to MAX_FLOW_COUNT, and
+ * its distinct counts. Must be called before the interval's epoch is
+ * bumped, while the members still hold its counts.
+ */
+static void publish_interval_top(int i, struct tt_top_flows *t5)
+{
+	struct interval_top *t = &interval_top[i];
+	struct flow_record *out = t5->top[i];
+	struct flow_hash *rfti;
+	int n;
+
+	for (n = 0; n < t->count; n++) {
+		struct flow_hash *fte = t->flow[n];
+		out[n].flow = fte->f.flow;
+		t5->top_addr[i][n] = *flow_addr_str(fte);
+		out[n].bytes = rate_calc(tt_intervals[i], fte->cur.bytes[i]);
+		out[n].packets =
+		    rate_calc(tt_intervals[i], fte->cur.packets[i]);
+		memcpy(t5->top_sizes[i][n], fte->sizes[i],
+		       sizeof(fte->sizes[i]));
+	}
+
+	/* If the ranking isn't full, every flow seen in the interval is in
+	 * it. Otherwise this adds nothing. The reference table is sorted. */
+	for (rfti = flow_ref_table; rfti && n < MAX_FLOW_COUNT;
+	     rfti = rfti->r_hh.next) {
+		if (!rfti->f.bytes || (rfti->epoch[i] == interval_epoch[i] &&
+		                       rfti->top_slot[i] >= 0)) {
+			continue;
+		}
+		out[n].flow = rfti->f.flow;
+		t5->top_addr[i][n] = *flow_addr_str(rfti);
+		out[n].bytes = 0;
+		out[n].packets = 0;
+		memset(t5->top_sizes[i][n], 0, sizeof(t5->top_sizes[i][n]));
+		n++;
+	}
+	t5->top_count[i] = n;
+	t->count = 0;
+
+	tt_distinct_publish(i, &t5->distinct[i]);
+	tt_pgaps_publish(i, t5->pgaps[i]);
+	tt_psizes_publish(i, t5->psizes[i]);
+}
+
+static void expire_old_interval_tables(struct timeval now,
+                                       struct tt_top_flows *t5)
+{
+	int rotated = 0, sweep = 0;
+
 	for (int i = 0; i < INTERVAL_COUNT; i++) {
 		struct timeval interval = tt_intervals[i];
 
 		/* interval elapsed? */
 		if (0 < tv_cmp(now, interval_end[i])) {
 
-			/* clear the hash table */
-			clear_table(i);
+			/* start a new epoch; flows catch up lazily */
+			publish_interval_top(i, t5);
+			interval_epoch[i]++;
+			rotated = 1;
+			sweep |= (i == longest_interval);
 			interval_start[i] = interval_end[i];
 			interval_end[i] = tv_add(interval_end[i], interval);
 		}
 	}
+
+	if (rotated) {
+		rotations++;
+	}
+	if (sweep) {
+		sweep_flows();
+		tt_rollup_publish(t5->rollup, tt_intervals[longest_interval]);
+	}
 }
 
 static int bytes_cmp(struct flow_hash *f1, struct flow_hash *f2)
@@ -168,8 +469,12 @@ static void delete_pkt_from_ref_table(struct flow_record *fr)
 	assert(fte->f.packets >= 0);
 
 	if (0 == fte->f.bytes) {
-		HASH_DELETE(r_hh, flow_ref_table, fte);
-		free(fte);
+		/* it may still be counted in the intervals; if so, it is
+		 * swept out later */
+		ref_flow_count--;
+		if (flow_is_empty(fte)) {
+			delete_flow(fte, TT_FLOW_END_IDLE);
+		}
 	}
 }
 
@@ -230,24 +535,42 @@ static void clear_ref_table(void)
  */
 void clear_all_tables(void)
 {
+	struct flow_hash *iter, *tmp;
+
 	/* clear ref table */
 	clear_ref_table();
+	assert(0 == ref_flow_count);
 
-	/* clear interval tables */
-	for (int i = 0; i < INTERVAL_COUNT; i++)
-		clear_table(i);
+	/* and the interval counts of the flows that remain */
+	HASH_ITER(r_hh, flow_ref_table, iter, tmp)
+	{
+		delete_flow(iter, TT_FLOW_END_FORCED);
+	}
+	assert(0 == HASH_CNT(r_hh, flow_ref_table));
+
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		interval_top[i].count = 0;
+	}
+	tt_rollup_clear();
+	tt_distinct_clear();
+	tt_pgaps_clear();
+	tt_psizes_clear();
 }
 
 /*
- * add the packet to the flow reference table.
+ * add the packet to the flow table: the sliding window reference counts and
+ * the period-on-period counts of every interval, with a single lookup.
  *
- * The reference table stores all the flows observed in a sliding window that
- * is as long as the longest of the period-on-period-type intervals.
+ * The reference window is (normally) as long as the longest of the
+ * period-on-period-type intervals.
  */
-static void add_flow_to_ref_table(struct flow_pkt *pkt)
+static void add_flow(struct flow_pkt *pkt)
 {
 	struct flow_hash *fte;
 	struct flow_pkt_list *ple;
+	int64_t bytes = pkt->flow_rec.bytes;
+	int64_t packets = pkt->flow_rec.packets;
+	int size_bucket;
 
 	/* keep a list of packets, used for sliding window byte counts */
 	ple = malloc(sizeof(struct flow_pkt_list));
@@ -261,75 +584,65 @@ static void add_flow_to_ref_table(struct flow_pkt *pkt)
 	if (!fte) {
 		fte = (struct flow_hash *)malloc(sizeof(struct flow_hash));
 		memset(fte, 0, sizeof(struct flow_hash));
-		memcpy(&(fte->f), &(pkt->flow_rec), sizeof(struct flow_record));
+		memcpy(&(fte->f.flow), &(pkt->flow_rec.flow),
+		       sizeof(struct flow));
+		memcpy(fte->epoch, interval_epoch, sizeof(fte->epoch));
+		for (int i = 0; i < INTERVAL_COUNT; i++) {
+			fte->top_slot[i] = -1;
+		}
+		fte->rotation = rotations;
+		fte->acct.prev_gap = -1;
 		HASH_ADD(r_hh, flow_ref_table, f.flow, sizeof(struct flow),
 		         fte);
 	} else {
-		fte->f.bytes += pkt->flow_rec.bytes;
-		fte->f.packets += pkt->flow_rec.packets;
+		roll_flow(fte);
 	}
 
-	totals.bytes += pkt->flow_rec.bytes;
-	assert(totals.bytes >= 0);
-	totals.packets += pkt->flow_rec.packets;
-	assert(totals.packets >= 0);
-}
-
-/*
- * add the packet to the period-on-period interval table for the selected
- * time series / interval.
- */
-static void add_flow_to_interval(struct flow_pkt *pkt, int time_series)
-{
-	struct flow_hash *fte;
+	if (0 == fte->f.bytes) {
+		ref_flow_count++;
+	}
+	fte->f.bytes += bytes;
+	fte->f.packets += packets;
 
-	/* Update the flow accounting table */
-	/* id already in the hash? */
-	HASH_FIND(ts_hh, incomplete_flow_tables[time_series],
-	          &(pkt->flow_rec.flow), sizeof(struct flow), fte);
-	if (!fte) {
-		fte = (struct flow_hash *)malloc(sizeof(struct flow_hash));
-		memset(fte, 0, sizeof(struct flow_hash));
-		memcpy(&(fte->f), &(pkt->flow_rec), sizeof(struct flow_record));
-		HASH_ADD(ts_hh, incomplete_flow_tables[time_series], f.flow,
-		         sizeof(struct flow), fte);
-	} else {
-		fte->f.bytes += pkt->flow_rec.bytes;
-		fte->f.packets += pkt->flow_rec.packets;
+	size_bucket = tt_psize_bucket(bytes);
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		fte->cur.bytes[i] += bytes;
+		fte->cur.packets[i] += packets;
+		fte->sizes[i][size_bucket] += packets;
+	}
+	update_interval_tops(fte);
+
+	if (flow_export) {
+		/* long-lived flows are reported every active timeout */
+		if (fte->acct.packets &&
+		    0 <= tv_cmp(tv_absdiff(pkt->timestamp, fte->acct.first),
+		                flow_active_timeout)) {
+			export_flow(fte, TT_FLOW_END_ACTIVE);
+		}
+		acct_add(fte, pkt);
 	}
-}
 
-static inline unsigned int rate_calc(struct timeval interval, int bytes)
-{
-	double dt = interval.tv_sec + interval.tv_usec * 1E-6;
-	return (unsigned int)((float)bytes / dt);
+	/* reuse the flow table's hash of the flow */
+	tt_distinct_add(&fte->f.flow, fte->r_hh.hashv);
+
+	totals.bytes += bytes;
+	assert(totals.bytes >= 0);
+	totals.packets += packets;
+	assert(totals.packets >= 0);
 }
 
 static void fill_short_int_flows(struct flow_record st_flows[INTERVAL_COUNT],
-                                 const struct flow_hash *ref_flow)
+                                 struct flow_hash *ref_flow)
 {
-	struct flow_hash *fti; /* flow table iter (short-interval tables */
-	struct flow_hash *te;  /* flow table entry */
+	roll_flow(ref_flow);
 
-	/* for each table in all time intervals.... */
+	/* for each of the complete time intervals.... */
 	for (int i = INTERVAL_COUNT - 1; i >= 0; i--) {
-		fti = complete_flow_tables[i];
 		memcpy(&st_flows[i], &(ref_flow->f),
 		       sizeof(struct flow_record));
 
-		if (!fti) {
-			/* table doesn't have anything in it yet */
-			st_flows[i].bytes = 0;
-			st_flows[i].packets = 0;
-			continue;
-		}
-
-		/* try to find the reference flow in the short flow table */
-		HASH_FIND(ts_hh, fti, &(ref_flow->f.flow),
-		          sizeof(struct flow), te);
-
-		st_flows[i].bytes = te ? te->f.bytes : 0;
-		st_flows[i].packets = te ? te->f.packets : 0;
+		st_flows[i].bytes = ref_flow->done.bytes[i];
+		st_flows[i].packets = ref_flow->done.packets[i];
 
 		/* convert to bytes per second */
 		st_flows[i].bytes =
@@ -348,11 +661,8 @@ static void update_stats_tables(struct flow_pkt *pkt)
 	 */
 	expire_old_packets(pkt->timestamp);
 
-	add_flow_to_ref_table(pkt);
-
-	for (int i = 0; i < INTERVAL_COUNT; i++) {
-		add_flow_to_interval(pkt, i);
-	}
+	add_flow(pkt);
+	tt_rollup_add(pkt);
 }
 
 #define DEBUG 1
@@ -380,17 +690,19 @@ static void tt_get_top5(struct tt_top_flows *t5, struct timeval deadline)
 	expire_old_packets(deadline);
 
 	/* check if the interval is complete and then rotate tables */
-	expire_old_interval_tables(deadline);
+	expire_old_interval_tables(deadline, t5);
 
 	/* for each of the top 5 flow in the reference table,
-	 * fill the counts from the short-interval flow tables */
+	 * fill the counts from the short-interval counters. Skip the flows
+	 * that have left the reference window. */
 	rfti = flow_ref_table;
 
-	for (int i = 0; i < MAX_FLOW_COUNT && rfti; i++) {
-		fill_short_int_flows(t5->flow[i], rfti);
-		rfti = rfti->r_hh.next;
+	for (int i = 0; i < MAX_FLOW_COUNT && rfti; rfti = rfti->r_hh.next) {
+		if (rfti->f.bytes) {
+			fill_short_int_flows(t5->flow[i++], rfti);
+		}
 	}
-	t5->flow_count = HASH_CNT(r_hh, flow_ref_table);
+	t5->flow_count = ref_flow_count;
 
 	t5->total_bytes = rate_calc(ref_window_size, totals.bytes);
 	t5->total_packets = rate_calc(ref_window_size, totals.packets);
@@ -416,7 +728,7 @@ static void tt_get_top5(struct tt_top_flows *t5, struct timeval deadline)
 
 int tt_get_flow_count(void)
 {
-	return HASH_CNT(r_hh, flow_ref_table);
+	return ref_flow_count;
 }
 
 void tt_update_ref_window_size(struct tt_thread_info *ti, struct timeval t)
@@ -426,12 +738,58 @@ void tt_update_ref_window_size(struct tt_thread_info *ti, struct timeval t)
 	pthread_mutex_unlock(&ti->t5_mutex);
 }
 
+void tt_set_flow_export(struct tt_thread_info *ti, tt_flow_export_fn fn,
+                        void *data, struct timeval active_timeout)
+{
+	pthread_mutex_lock(&ti->t5_mutex);
+	flow_export = fn;
+	flow_export_data = data;
+	flow_active_timeout = active_timeout;
+	pthread_mutex_unlock(&ti->t5_mutex);
+}
+
+/* Outgoing frames are marked as such in Linux cooked captures, and
+ * otherwise come from the interface's own address. So frames that a bridge
+ * forwards out of the interface count as incoming. */
+static enum tt_dir packet_dir(const struct pcap_handler_user *cbdata,
+                              const struct pcap_pkthdr *h,
+                              const uint8_t *wirebits)
+{
+	if (DLT_LINUX_SLL == cbdata->dlt) {
+		const struct sll_header *sll = (const struct sll_header *)wirebits;
+
+		return (h->caplen >= SLL_HDR_LEN
+		        && LINUX_SLL_OUTGOING == ntohs(sll->sll_pkttype))
+		           ? TT_DIR_TX
+		           : TT_DIR_RX;
+	}
+	if (cbdata->have_mac && h->caplen >= HDR_LEN_ETHER
+	    && 0 == memcmp(((const struct hdr_ethernet *)wirebits)->shost,
+	                   cbdata->mac, ADDR_LEN_ETHER)) {
+		return TT_DIR_TX;
+	}
+	return TT_DIR_RX;
+}
+
 static void handle_packet(uint8_t *user, const struct pcap_pkthdr *pcap_hdr,
                           const uint8_t *wirebits)
 {
 	struct pcap_handler_user *cbdata = (struct pcap_handler_user *)user;
 	char errstr[DECODE_ERRBUF_SIZE];
 	struct flow_pkt pkt = { 0 };
+	struct pcap_pkthdr us_hdr;
+	enum tt_dir dir = packet_dir(cbdata, pcap_hdr, wirebits);
+
+	tt_pgaps_add(dir, pcap_hdr->ts.tv_sec * 1000000000LL +
+	                      pcap_hdr->ts.tv_usec * (cbdata->nano ? 1 : 1000));
+	tt_psizes_add(dir, pcap_hdr->len);
+
+	if (cbdata->nano) {
+		/* the decoders and flow tables work in us */
+		us_hdr = *pcap_hdr;
+		us_hdr.ts.tv_usec /= 1000;
+		pcap_hdr = &us_hdr;
+	}
 
 	if (0 == cbdata->decoder(pcap_hdr, wirebits, &pkt, errstr)) {
 		update_stats_tables(&pkt);
@@ -442,14 +800,40 @@ static void handle_packet(uint8_t *user, const struct pcap_pkthdr *pcap_hdr,
 	}
 }
 
+/* the interface's hardware address, to tell outgoing frames apart */
+static int get_mac(const char *dev, uint8_t mac[ADDR_LEN_ETHER])
+{
+	struct ifaddrs *ifap, *ifa;
+	int err = -1;
+
+	if (getifaddrs(&ifap)) {
+		return -1;
+	}
+	for (ifa = ifap; ifa; ifa = ifa->ifa_next) {
+		struct sockaddr_ll *sll = (struct sockaddr_ll *)ifa->ifa_addr;
+
+		if (!sll || AF_PACKET != sll->sll_family
+		    || ADDR_LEN_ETHER != sll->sll_halen
+		    || strcmp(ifa->ifa_name, dev)) {
+			continue;
+		}
+		memcpy(mac, sll->sll_addr, ADDR_LEN_ETHER);
+		err = 0;
+		break;
+	}
+	freeifaddrs(ifap);
+	return err;
+}
+
 static int init_pcap(char **dev, struct pcap_info *pi)
 {
 	char errbuf[PCAP_ERRBUF_SIZE];
 	int dlt; /* pcap data link type */
+	int err;
 	pcap_if_t *alldevs;
 
 	if (!*dev) {
-		int err = pcap_findalldevs(&alldevs, errbuf);
+		err = pcap_findalldevs(&alldevs, errbuf);
 		if (err) {
 			fprintf(stderr, "Couldn't list devices: %s\n", errbuf);
 			return 1;
@@ -470,13 +854,31 @@ static int init_pcap(char **dev, struct pcap_info *pi)
 		return 1;
 	}
 
-	pi->handle = pcap_open_live(*dev, BUFSIZ, 1, 3, errbuf);
+	pi->handle = pcap_create(*dev, errbuf);
 	if (pi->handle == NULL) {
 		fprintf(stderr, "Couldn't open device %s\n", errbuf);
 		return 1;
 	}
+	pcap_set_snaplen(pi->handle, BUFSIZ);
+	pcap_set_promisc(pi->handle, 1);
+	pcap_set_timeout(pi->handle, 3);
+	/* for the packet gaps; not every device can, and us will do */
+	pcap_set_tstamp_precision(pi->handle, PCAP_TSTAMP_PRECISION_NANO);
+
+	err = pcap_activate(pi->handle);
+	if (err < 0) {
+		fprintf(stderr, "Couldn't open device %s: %s\n", *dev,
+		        pcap_geterr(pi->handle));
+		pcap_close(pi->handle);
+		return 1;
+	}
+	pi->decoder_cbdata.nano = (PCAP_TSTAMP_PRECISION_NANO ==
+	                           pcap_get_tstamp_precision(pi->handle));
+	pi->decoder_cbdata.have_mac =
+	    (0 == get_mac(*dev, pi->decoder_cbdata.mac));
 
 	dlt = pcap_datalink(pi->handle);
+	pi->decoder_cbdata.dlt = dlt;
 	switch (dlt) {
 	case DLT_EN10MB:
 		pi->decoder_cbdata.decoder = decode_ethernet;
@@ -635,6 +1037,10 @@ int tt_intervals_init(struct tt_thread_info *ti)
 	ref_window_size = (struct timeval){.tv_sec = 3, .tv_usec = 0 };
 	flow_ref_table = NULL;
 	pkt_list_ref_head = NULL;
+	tt_rollup_clear();
+	tt_distinct_clear();
+	tt_pgaps_clear();
+	tt_psizes_clear();
 
 	ti->t5 = calloc(1, sizeof(struct tt_top_flows));
 	if (!ti->t5) { return 1; }
@@ -5,6 +5,11 @@
 #include "utlist.h"
 #include "uthash.h"
 #include "decode.h"
+#include "rollup.h"
+#include "distinct.h"
+#include "pgaps.h"
+#include "psizes.h"
+#include "flow_export.h"
 
 
 /* ================================= NOTE: ===================================
@@ -20,7 +25,28 @@ struct tt_top_flows {
 	int64_t flow_count;
 	int64_t total_bytes;
 	int64_t total_packets;
+	/* the top flows of the reference window, with their rates in each
+	 * interval */
 	struct flow_record flow[MAX_FLOW_COUNT][INTERVAL_COUNT];
+	/* each interval's own top flows, by their rate in the last complete
+	 * interval, followed by other flows of the reference window */
+	int64_t top_count[INTERVAL_COUNT];
+	struct flow_record top[INTERVAL_COUNT][MAX_FLOW_COUNT];
+	/* and their packet lengths, see psizes.h */
+	uint32_t top_sizes[INTERVAL_COUNT][MAX_FLOW_COUNT][TT_PSIZE_BUCKETS];
+	/* the addresses of the top flows, formatted */
+	struct flow_addr_str top_addr[INTERVAL_COUNT][MAX_FLOW_COUNT];
+	/* the estimated distinct counts of each interval's last complete
+	 * interval */
+	struct tt_distinct distinct[INTERVAL_COUNT];
+	/* the interface's packet gaps in each interval's last complete
+	 * interval, by direction */
+	struct tt_pgaps pgaps[INTERVAL_COUNT][TT_DIRS];
+	/* and packet lengths */
+	uint32_t psizes[INTERVAL_COUNT][TT_DIRS][TT_PSIZE_BUCKETS];
+	/* the top keys of each rollup, over the last complete window of the
+	 * longest interval */
+	struct tt_rollup_top rollup[TT_ROLLUP_MAX];
 };
 
 /* forward declaration; definition and use is internal to tt thread */
@@ -40,6 +66,11 @@ struct tt_thread_info {
 };
 
 void tt_update_ref_window_size(struct tt_thread_info *ti, struct timeval t);
+
+/* Hand flow records to fn, or stop if fn is NULL (see flow_export.h).
+ * Flows active for longer than active_timeout are reported periodically. */
+void tt_set_flow_export(struct tt_thread_info *ti, tt_flow_export_fn fn,
+                        void *data, struct timeval active_timeout);
 int tt_get_flow_count(void);
 void *tt_intervals_run(void *p);
 int tt_intervals_init(struct tt_thread_info *ti);
@@ -1,5 +1,7 @@
 #include <sys/time.h>
 
+#include "rollup.h"
+
 struct timeval const tt_intervals[INTERVAL_COUNT] = {
         { .tv_sec = 0,  .tv_usec = 1E5 },
         { .tv_sec = 0,  .tv_usec = 2E5 },
@@ -11,3 +13,15 @@ struct timeval const tt_intervals[INTERVAL_COUNT] = {
         { .tv_sec = 60, .tv_usec = 0 }
 };
 
+struct tt_rollup const tt_rollups[] = {
+        { .name = "src/16",  .field = TT_ROLLUP_SRC, .prefix4 = 16, .prefix6 = 48 },
+        { .name = "src/24",  .field = TT_ROLLUP_SRC, .prefix4 = 24, .prefix6 = 64 },
+        { .name = "dst/16",  .field = TT_ROLLUP_DST, .prefix4 = 16, .prefix6 = 48 },
+        { .name = "dst/24",  .field = TT_ROLLUP_DST, .prefix4 = 24, .prefix6 = 64 },
+        { .name = "sport",   .field = TT_ROLLUP_SPORT },
+        { .name = "dport",   .field = TT_ROLLUP_DPORT },
+        { .name = "proto",   .field = TT_ROLLUP_PROTO },
+        { .name = "tclass",  .field = TT_ROLLUP_TCLASS }
+};
+
+int const tt_rollup_count = sizeof(tt_rollups) / sizeof(tt_rollups[0]);
@@ -0,0 +1,80 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "pgaps.h"
+
+struct pgaps_acc {
+	int64_t count;
+	int64_t min_ns;
+	int64_t max_ns;
+	int64_t sum_ns;
+	uint32_t hist[TT_PGAP_BUCKETS];
+};
+
+/* All the intervals are updated together, as the flow counters are. */
+static struct pgaps_acc acc[TT_DIRS][INTERVAL_COUNT];
+
+/* the previous frame in each direction, or 0 for none yet */
+static int64_t last_ns[TT_DIRS];
+
+static inline int bucket(int64_t gap_ns)
+{
+	uint64_t us = gap_ns / 1000;
+	int b;
+
+	if (!us) {
+		return 0;
+	}
+	/* the first bucket whose bound of 2^b us is more than us */
+	b = 64 - __builtin_clzll(us);
+	return (b < TT_PGAP_BUCKETS) ? b : TT_PGAP_BUCKETS - 1;
+}
+
+void tt_pgaps_add(enum tt_dir dir, int64_t ts_ns)
+{
+	int64_t gap;
+	int b;
+
+	if (!last_ns[dir]) {
+		last_ns[dir] = ts_ns;
+		return;
+	}
+	/* the timestamps of different CPUs can be a little out of order */
+	gap = (ts_ns > last_ns[dir]) ? ts_ns - last_ns[dir] : 0;
+	last_ns[dir] = ts_ns;
+	b = bucket(gap);
+
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		struct pgaps_acc *a = &acc[dir][i];
+
+		if (!a->count || gap < a->min_ns) {
+			a->min_ns = gap;
+		}
+		if (gap > a->max_ns) {
+			a->max_ns = gap;
+		}
+		a->sum_ns += gap;
+		a->count++;
+		a->hist[b]++;
+	}
+}
+
+void tt_pgaps_publish(int interval, struct tt_pgaps out[TT_DIRS])
+{
+	for (int d = 0; d < TT_DIRS; d++) {
+		struct pgaps_acc *a = &acc[d][interval];
+
+		out[d].count = a->count;
+		out[d].min_ns = a->min_ns;
+		out[d].max_ns = a->max_ns;
+		out[d].mean_ns = a->count ? a->sum_ns / a->count : 0;
+		memcpy(out[d].hist, a->hist, sizeof(out[d].hist));
+		memset(a, 0, sizeof(*a));
+	}
+}
+
+void tt_pgaps_clear(void)
+{
+	memset(acc, 0, sizeof(acc));
+	memset(last_ns, 0, sizeof(last_ns));
+}
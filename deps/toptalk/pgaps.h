@@ -0,0 +1,40 @@
+#ifndef PGAPS_H
+#define PGAPS_H
+
+#include <stdint.h>
+
+/* Inter-packet gaps at the interface, in each direction, from the capture
+ * timestamps of every frame, whether or not it could be decoded. Unlike
+ * the gaps that the stats infer from empty sample periods, these aren't
+ * quantised to the sample period, so gaps much shorter than it show up.
+ *
+ * A gap is counted in the interval in which the packet that ends it
+ * arrives. */
+
+enum tt_dir {
+	TT_DIR_RX,
+	TT_DIR_TX,
+	TT_DIRS
+};
+
+/* Bucket n counts the gaps of less than 2^n microseconds that didn't fit
+ * the bucket before it; the last one counts everything longer. */
+#define TT_PGAP_BUCKETS 24
+
+struct tt_pgaps {
+	int64_t count;
+	int64_t min_ns;
+	int64_t max_ns;
+	int64_t mean_ns;
+	uint32_t hist[TT_PGAP_BUCKETS];
+};
+
+/* A frame was captured at ts_ns, going in direction dir. */
+void tt_pgaps_add(enum tt_dir dir, int64_t ts_ns);
+
+/* The interval has ended: write its gaps into out and start afresh. */
+void tt_pgaps_publish(int interval, struct tt_pgaps out[TT_DIRS]);
+
+void tt_pgaps_clear(void);
+
+#endif
@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "psizes.h"
+
+/* All the intervals are updated together, as the flow counters are. */
+static uint32_t counts[INTERVAL_COUNT][TT_DIRS][TT_PSIZE_BUCKETS];
+
+void tt_psizes_add(enum tt_dir dir, int64_t len)
+{
+	int b = tt_psize_bucket(len);
+
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		counts[i][dir][b]++;
+	}
+}
+
+void tt_psizes_publish(int interval,
+                       uint32_t out[TT_DIRS][TT_PSIZE_BUCKETS])
+{
+	memcpy(out, counts[interval], sizeof(counts[interval]));
+	memset(counts[interval], 0, sizeof(counts[interval]));
+}
+
+void tt_psizes_clear(void)
+{
+	memset(counts, 0, sizeof(counts));
+}
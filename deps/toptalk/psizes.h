@@ -0,0 +1,38 @@
+#ifndef PSIZES_H
+#define PSIZES_H
+
+#include <stdint.h>
+
+#include "pgaps.h"
+
+/* Packet length distributions at the interface, in each direction, over
+ * each interval, to tell changes in packet size (a codec, an MTU problem)
+ * apart from changes in packet rate. The top flows have their own, kept
+ * with their counters.
+ *
+ * The lengths are on the wire, as captured, in log2 bins: bucket n counts
+ * the packets shorter than 2^(n + TT_PSIZE_SHIFT) bytes that didn't fit
+ * the bucket before it, and the last one counts everything longer. */
+
+#define TT_PSIZE_SHIFT 6
+#define TT_PSIZE_BUCKETS 11
+
+static inline int tt_psize_bucket(int64_t len)
+{
+	uint64_t l = (uint64_t)len >> TT_PSIZE_SHIFT;
+	int b = l ? 64 - __builtin_clzll(l) : 0;
+
+	return (b < TT_PSIZE_BUCKETS) ? b : TT_PSIZE_BUCKETS - 1;
+}
+
+/* A frame of len bytes was captured, going in direction dir. */
+void tt_psizes_add(enum tt_dir dir, int64_t len);
+
+/* The interval has ended: write its distributions into out and start
+ * afresh. */
+void tt_psizes_publish(int interval,
+                       uint32_t out[TT_DIRS][TT_PSIZE_BUCKETS]);
+
+void tt_psizes_clear(void);
+
+#endif
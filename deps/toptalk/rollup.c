@@ -0,0 +1,341 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <net/ethernet.h>
+
+#include "rollup.h"
+
+#define INDEX_SIZE (2 * TT_ROLLUP_SKETCH_SIZE)
+#define INDEX_MASK (INDEX_SIZE - 1)
+#define INDEX_EMPTY -1
+
+/* a key being counted */
+struct counter {
+	struct tt_rollup_key key;
+	uint32_t hash;
+	int16_t slot; /* in the index */
+	int64_t bytes;
+	int64_t packets;
+	int64_t error;
+};
+
+/* the bytes of the counter when it was last placed in the heap */
+struct heap_node {
+	int64_t bytes;
+	int16_t id;
+};
+
+/*
+ * A space-saving sketch (Metwally et al.) over one window: a key that
+ * isn't counted yet takes over the counter with the fewest bytes, and
+ * inherits its count as the error.
+ *
+ * The counters stay put and an open addressing index finds them by key.
+ * A min-heap finds the smallest, but is only updated lazily: counts only
+ * grow, so a node that is out of date can only be too low, and is fixed
+ * when it reaches the top. Counting a key that is already counted is then
+ * just a hash lookup.
+ *
+ * Every rollup has a sketch to itself, including each prefix length of an
+ * address; see rollup.h for what that costs against a hierarchical sketch.
+ */
+struct sketch {
+	int count;
+	int64_t total_bytes;
+	int64_t total_packets;
+	struct counter counter[TT_ROLLUP_SKETCH_SIZE];
+	struct heap_node heap[TT_ROLLUP_SKETCH_SIZE];
+	int16_t index[INDEX_SIZE];
+};
+
+static struct sketch sketches[TT_ROLLUP_MAX];
+
+/* multiplicative hashing of the key, a word at a time */
+static uint32_t key_hash(const struct tt_rollup_key *key)
+{
+	uint64_t w[3] = { 0 };
+	uint64_t h;
+
+	memcpy(w, key, sizeof(*key));
+	h = w[0] * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (h >> 29) ^ w[1]) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 31) ^ w[2]) * 0x94d049bb133111ebULL;
+	return (uint32_t)(h >> 32);
+}
+
+static void mask_addr(uint8_t *addr, int len, int plen)
+{
+	for (int i = 0; i < len; i++) {
+		int keep = plen - 8 * i;
+		if (keep <= 0) {
+			addr[i] = 0;
+		} else if (keep < 8) {
+			addr[i] &= (uint8_t)(0xff << (8 - keep));
+		}
+	}
+}
+
+static void make_key(const struct tt_rollup *r, const struct flow *f,
+                     struct tt_rollup_key *key)
+{
+	const void *addr;
+
+	memset(key, 0, sizeof(*key));
+	key->ethertype = f->ethertype;
+
+	switch (r->field) {
+	case TT_ROLLUP_SRC:
+	case TT_ROLLUP_DST:
+		if (ETHERTYPE_IP == f->ethertype) {
+			addr = (TT_ROLLUP_SRC == r->field) ? (const void *)&f->src_ip
+			                                   : (const void *)&f->dst_ip;
+			memcpy(key->addr, addr, sizeof(struct in_addr));
+			key->plen = r->prefix4;
+			mask_addr(key->addr, sizeof(struct in_addr), key->plen);
+		} else if (ETHERTYPE_IPV6 == f->ethertype) {
+			addr = (TT_ROLLUP_SRC == r->field) ? (const void *)&f->src_ip6
+			                                   : (const void *)&f->dst_ip6;
+			memcpy(key->addr, addr, sizeof(struct in6_addr));
+			key->plen = r->prefix6;
+			mask_addr(key->addr, sizeof(struct in6_addr), key->plen);
+		}
+		break;
+	case TT_ROLLUP_SPORT:
+		key->value = f->sport;
+		break;
+	case TT_ROLLUP_DPORT:
+		key->value = f->dport;
+		break;
+	case TT_ROLLUP_PROTO:
+		key->value = f->proto;
+		break;
+	case TT_ROLLUP_TCLASS:
+		key->value = f->tclass;
+		break;
+	}
+}
+
+static void sift_up(struct sketch *s, int pos)
+{
+	struct heap_node n = s->heap[pos];
+
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+		if (s->heap[parent].bytes <= n.bytes) {
+			break;
+		}
+		s->heap[pos] = s->heap[parent];
+		pos = parent;
+	}
+	s->heap[pos] = n;
+}
+
+static void sift_down(struct sketch *s, int pos)
+{
+	struct heap_node n = s->heap[pos];
+
+	for (;;) {
+		int child = 2 * pos + 1;
+		if (child >= s->count) {
+			break;
+		}
+		if (child + 1 < s->count &&
+		    s->heap[child + 1].bytes < s->heap[child].bytes) {
+			child++;
+		}
+		if (n.bytes <= s->heap[child].bytes) {
+			break;
+		}
+		s->heap[pos] = s->heap[child];
+		pos = child;
+	}
+	s->heap[pos] = n;
+}
+
+/* Returns the counter with the fewest bytes, bringing the top of the heap
+ * up to date on the way. */
+static struct counter *heap_min(struct sketch *s)
+{
+	for (;;) {
+		struct counter *c = &s->counter[s->heap[0].id];
+		if (s->heap[0].bytes == c->bytes) {
+			return c;
+		}
+		s->heap[0].bytes = c->bytes;
+		sift_down(s, 0);
+	}
+}
+
+/* Returns the index slot of the key, or the empty slot where it belongs. */
+static int index_find(const struct sketch *s, const struct tt_rollup_key *key,
+                      uint32_t hash)
+{
+	int slot = hash & INDEX_MASK;
+
+	while (INDEX_EMPTY != s->index[slot]) {
+		const struct counter *c = &s->counter[s->index[slot]];
+		if (c->hash == hash && 0 == memcmp(&c->key, key, sizeof(*key))) {
+			break;
+		}
+		slot = (slot + 1) & INDEX_MASK;
+	}
+	return slot;
+}
+
+/* Empty the slot, moving later entries of the probe sequence back into it
+ * so that lookups needn't skip over deleted slots. */
+static void index_delete(struct sketch *s, int slot)
+{
+	int next = slot;
+
+	s->index[slot] = INDEX_EMPTY;
+	for (;;) {
+		int home;
+
+		next = (next + 1) & INDEX_MASK;
+		if (INDEX_EMPTY == s->index[next]) {
+			return;
+		}
+		home = s->counter[s->index[next]].hash & INDEX_MASK;
+
+		/* stays, if its home is cyclically in (slot, next] */
+		if ((slot <= next) ? (slot < home && home <= next)
+		                   : (slot < home || home <= next)) {
+			continue;
+		}
+		s->index[slot] = s->index[next];
+		s->counter[s->index[slot]].slot = slot;
+		s->index[next] = INDEX_EMPTY;
+		slot = next;
+	}
+}
+
+static void sketch_add(struct sketch *s, const struct tt_rollup_key *key,
+                       int64_t bytes, int64_t packets)
+{
+	uint32_t hash = key_hash(key);
+	int slot = index_find(s, key, hash);
+	struct counter *c;
+	int16_t id;
+
+	s->total_bytes += bytes;
+	s->total_packets += packets;
+
+	if (INDEX_EMPTY != s->index[slot]) {
+		/* counted already; its heap node is now out of date */
+		c = &s->counter[s->index[slot]];
+		c->bytes += bytes;
+		c->packets += packets;
+		return;
+	}
+
+	if (s->count < TT_ROLLUP_SKETCH_SIZE) {
+		id = s->count++;
+		c = &s->counter[id];
+		c->key = *key;
+		c->hash = hash;
+		c->slot = slot;
+		c->bytes = bytes;
+		c->packets = packets;
+		c->error = 0;
+		s->index[slot] = id;
+		s->heap[id].bytes = bytes;
+		s->heap[id].id = id;
+		sift_up(s, id);
+		return;
+	}
+
+	/* take over the smallest counter */
+	c = heap_min(s);
+	id = s->heap[0].id;
+	index_delete(s, c->slot);
+	slot = index_find(s, key, hash);
+	c->key = *key;
+	c->hash = hash;
+	c->slot = slot;
+	c->error = c->bytes;
+	c->bytes += bytes;
+	c->packets += packets;
+	s->index[slot] = id;
+	s->heap[0].bytes = c->bytes;
+	sift_down(s, 0);
+}
+
+static void sketch_clear(struct sketch *s)
+{
+	s->count = 0;
+	s->total_bytes = 0;
+	s->total_packets = 0;
+	memset(s->index, 0xff, sizeof(s->index)); /* INDEX_EMPTY */
+}
+
+static int bytes_desc(const void *a, const void *b)
+{
+	const struct counter *c1 = a;
+	const struct counter *c2 = b;
+
+	return (c1->bytes < c2->bytes) - (c1->bytes > c2->bytes);
+}
+
+static inline int64_t per_second(struct timeval window, int64_t count)
+{
+	double dt = window.tv_sec + window.tv_usec * 1E-6;
+	return (int64_t)(count / dt);
+}
+
+int tt_rollup_find(const char *name)
+{
+	for (int r = 0; r < tt_rollup_count; r++) {
+		if (0 == strncmp(tt_rollups[r].name, name, TT_ROLLUP_NAME_LEN)) {
+			return r;
+		}
+	}
+	return -1;
+}
+
+void tt_rollup_add(const struct flow_pkt *pkt)
+{
+	struct tt_rollup_key key;
+
+	for (int r = 0; r < tt_rollup_count; r++) {
+		make_key(&tt_rollups[r], &pkt->flow_rec.flow, &key);
+		sketch_add(&sketches[r], &key, pkt->flow_rec.bytes,
+		           pkt->flow_rec.packets);
+	}
+}
+
+void tt_rollup_publish(struct tt_rollup_top top[TT_ROLLUP_MAX],
+                       struct timeval window)
+{
+	static struct counter sorted[TT_ROLLUP_SKETCH_SIZE];
+
+	assert(tt_rollup_count <= TT_ROLLUP_MAX);
+
+	for (int r = 0; r < tt_rollup_count; r++) {
+		struct sketch *s = &sketches[r];
+		struct tt_rollup_top *t = &top[r];
+
+		memcpy(sorted, s->counter, s->count * sizeof(struct counter));
+		qsort(sorted, s->count, sizeof(struct counter), bytes_desc);
+
+		t->count = (s->count < TT_ROLLUP_TOP) ? s->count : TT_ROLLUP_TOP;
+		t->total_bytes = per_second(window, s->total_bytes);
+		t->total_packets = per_second(window, s->total_packets);
+		for (int i = 0; i < t->count; i++) {
+			t->entry[i].key = sorted[i].key;
+			t->entry[i].bytes = per_second(window, sorted[i].bytes);
+			t->entry[i].packets =
+			    per_second(window, sorted[i].packets);
+			t->entry[i].error = per_second(window, sorted[i].error);
+		}
+		sketch_clear(s);
+	}
+}
+
+void tt_rollup_clear(void)
+{
+	for (int r = 0; r < TT_ROLLUP_MAX; r++) {
+		sketch_clear(&sketches[r]);
+	}
+}
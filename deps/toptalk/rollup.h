@@ -0,0 +1,95 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "flow.h"
+
+/* Rollups: traffic aggregated by a coarser key than the flow, like the
+ * source /24 or the destination port, so that many small flows add up to
+ * something visible. Each rollup is counted in a space-saving sketch of
+ * bounded size, so the memory doesn't depend on the number of keys; the
+ * counts of the keys it reports are over-estimated by at most their error.
+ *
+ * Address rollups at several prefix lengths (eg. /16 and /24) can be
+ * drilled into without a second capture, but they are not a hierarchical
+ * heavy-hitter sketch: each prefix length is a flat sketch of its own.
+ * Only the configured lengths are found, each with its own error bound,
+ * and the levels are not reconciled: the /24s under a reported /16 needn't
+ * add up to it, and one of them can be missing from the /24 top even
+ * though the /16 is there. A /16 is also reported for the traffic of a
+ * heavy /24 under it, rather than for what it carries besides.
+ *
+ * tt_rollups[] must be defined in intervals_user.c
+ */
+
+#define TT_ROLLUP_MAX 16
+#define TT_ROLLUP_NAME_LEN 16
+
+/* keys counted per rollup; a key's error is at most the window total
+ * divided by this */
+#define TT_ROLLUP_SKETCH_SIZE 256
+
+/* reported per rollup */
+#define TT_ROLLUP_TOP 20
+
+enum tt_rollup_field {
+	TT_ROLLUP_SRC,
+	TT_ROLLUP_DST,
+	TT_ROLLUP_SPORT,
+	TT_ROLLUP_DPORT,
+	TT_ROLLUP_PROTO,
+	TT_ROLLUP_TCLASS
+};
+
+struct tt_rollup {
+	char name[TT_ROLLUP_NAME_LEN];
+	enum tt_rollup_field field;
+	int prefix4; /* address prefix lengths, for TT_ROLLUP_SRC/DST */
+	int prefix6;
+};
+
+extern struct tt_rollup const tt_rollups[];
+extern int const tt_rollup_count;
+
+/* no implicit padding: keys are hashed and compared bytewise */
+struct tt_rollup_key {
+	uint8_t addr[16];
+	uint16_t ethertype;
+	uint16_t value; /* port, protocol or traffic class */
+	uint8_t plen;   /* prefix length of addr */
+	uint8_t pad;
+};
+
+struct tt_rollup_entry {
+	struct tt_rollup_key key;
+	int64_t bytes;
+	int64_t packets;
+	int64_t error; /* bytes may be over-estimated by this much */
+};
+
+/* the top keys of one rollup over the last complete window, in bytes and
+ * packets per second */
+struct tt_rollup_top {
+	int count;
+	int64_t total_bytes;
+	int64_t total_packets;
+	struct tt_rollup_entry entry[TT_ROLLUP_TOP];
+};
+
+/* Returns the index of the named rollup in tt_rollups[], or -1. */
+int tt_rollup_find(const char *name);
+
+/* Count the packet in every rollup. */
+void tt_rollup_add(const struct flow_pkt *pkt);
+
+/* The window has ended: write the top keys of every rollup to top[] and
+ * start counting afresh. */
+void tt_rollup_publish(struct tt_rollup_top top[TT_ROLLUP_MAX],
+                       struct timeval window);
+
+void tt_rollup_clear(void);
+
+#endif
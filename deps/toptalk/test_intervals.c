@@ -0,0 +1,309 @@
+/*
+ * Replays a synthetic packet stream through the flow tables and checks every
+ * report against a model that keeps eager per-interval tables: each flow's
+ * counters for all the intervals are rotated as soon as an interval ends,
+ * as they were before the counters moved into the flow entry and were
+ * rolled lazily (see roll_flow()). The top flows of each interval are
+ * checked against a brute-force ranking whenever the interval ends.
+ *
+ * intervals.c is included so that its tables can be fed directly, without
+ * a capture.
+ */
+#include "intervals.c"
+
+#define REPLAY_FLOWS 40
+#define REPLAY_TICKS 3000
+#define TICK_US 1000
+/* one tick in BURST_ODDS has a microburst of one flow */
+#define BURST_ODDS 50
+#define BURST_MIN 20
+#define BURST_MAX 40
+
+struct model_flow {
+	struct flow flow;
+	int64_t cur_bytes[INTERVAL_COUNT];
+	int64_t cur_packets[INTERVAL_COUNT];
+	int64_t done_bytes[INTERVAL_COUNT];
+	int64_t done_packets[INTERVAL_COUNT];
+	int64_t ref_bytes; /* in the window, see model_window() */
+	int64_t ref_packets;
+};
+
+struct model_pkt {
+	int flow;
+	int64_t ts;
+	int bytes;
+};
+
+static struct model_flow mflow[REPLAY_FLOWS];
+static struct model_pkt mpkt[REPLAY_TICKS * 64];
+static int mpkt_count;
+static int64_t mint_end[INTERVAL_COUNT];
+
+static struct timeval us_to_tv(int64_t us)
+{
+	struct timeval t = {.tv_sec = us / 1000000, .tv_usec = us % 1000000 };
+	return t;
+}
+
+static void model_init(int64_t t0)
+{
+	memset(mflow, 0, sizeof(mflow));
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		struct flow *fl = &mflow[f].flow;
+		fl->ethertype = ETHERTYPE_IP;
+		fl->src_ip.s_addr = htonl(0x0a000000 + f);
+		fl->dst_ip.s_addr = htonl(0x0a000101);
+		fl->sport = 1000 + f;
+		fl->dport = 80;
+		fl->proto = IPPROTO_TCP;
+	}
+	mpkt_count = 0;
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		mint_end[i] = t0 + tv_to_us(tt_intervals[i]);
+	}
+}
+
+/* the packets the tables hold after expiring those older than horizon */
+static void model_window(int64_t horizon)
+{
+	int64_t w = tv_to_us(ref_window_size);
+
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		mflow[f].ref_bytes = 0;
+		mflow[f].ref_packets = 0;
+	}
+	for (int p = mpkt_count - 1; p >= 0 && mpkt[p].ts + w >= horizon; p--) {
+		mflow[mpkt[p].flow].ref_bytes += mpkt[p].bytes;
+		mflow[mpkt[p].flow].ref_packets++;
+	}
+}
+
+static struct model_flow *model_find(const struct flow *fl)
+{
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		if (0 == memcmp(&mflow[f].flow, fl, sizeof(*fl))) {
+			return &mflow[f];
+		}
+	}
+	assert(0);
+	return NULL;
+}
+
+static void model_rotate(int64_t now)
+{
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		if (now <= mint_end[i]) {
+			continue;
+		}
+		for (int f = 0; f < REPLAY_FLOWS; f++) {
+			mflow[f].done_bytes[i] = mflow[f].cur_bytes[i];
+			mflow[f].done_packets[i] = mflow[f].cur_packets[i];
+			mflow[f].cur_bytes[i] = 0;
+			mflow[f].cur_packets[i] = 0;
+		}
+		mint_end[i] += tv_to_us(tt_intervals[i]);
+	}
+}
+
+static void add_packet(int f, int64_t ts, int bytes)
+{
+	struct flow_pkt pkt = { 0 };
+
+	pkt.flow_rec.flow = mflow[f].flow;
+	pkt.flow_rec.bytes = bytes;
+	pkt.flow_rec.packets = 1;
+	pkt.timestamp = us_to_tv(ts);
+	update_stats_tables(&pkt);
+
+	assert(mpkt_count < (int)(sizeof(mpkt) / sizeof(mpkt[0])));
+	mpkt[mpkt_count].flow = f;
+	mpkt[mpkt_count].ts = ts;
+	mpkt[mpkt_count].bytes = bytes;
+	mpkt_count++;
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		mflow[f].cur_bytes[i] += bytes;
+		mflow[f].cur_packets[i]++;
+	}
+}
+
+/* flows come and go, so that some leave the window and the intervals
+ * and are swept out, and some return after several empty intervals */
+static int flow_active(int f, int tick)
+{
+	return (tick / (50 + 37 * f)) % 3 != 0;
+}
+
+static int bytes_desc(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a;
+	int64_t y = *(const int64_t *)b;
+	return (x < y) - (x > y);
+}
+
+/* The interval has just ended: its top flows are the flows with the most
+ * bytes in it, followed by the other flows of the window. */
+static void check_interval_top(const struct tt_top_flows *t5, int i,
+                               int64_t now)
+{
+	int64_t ranking[REPLAY_FLOWS];
+	int reported[REPLAY_FLOWS] = { 0 };
+	int ranked = 0, others = 0, expected;
+
+	model_window(now);
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		if (mflow[f].cur_bytes[i]) {
+			ranking[ranked++] = mflow[f].cur_bytes[i];
+		} else if (mflow[f].ref_bytes) {
+			others++;
+		}
+	}
+	qsort(ranking, ranked, sizeof(ranking[0]), bytes_desc);
+
+	expected = (ranked + others < MAX_FLOW_COUNT) ? ranked + others
+	                                               : MAX_FLOW_COUNT;
+	assert(t5->top_count[i] == expected);
+
+	for (int n = 0; n < t5->top_count[i]; n++) {
+		const struct flow_record *out = &t5->top[i][n];
+		struct model_flow *m = model_find(&out->flow);
+		int f = m - mflow;
+
+		assert(!reported[f]);
+		reported[f] = 1;
+		if (n < ranked) {
+			/* ties go either way, so compare the counts */
+			assert(out->bytes ==
+			       rate_calc(tt_intervals[i], ranking[n]));
+			assert(out->bytes ==
+			       rate_calc(tt_intervals[i], m->cur_bytes[i]));
+			assert(out->packets ==
+			       rate_calc(tt_intervals[i], m->cur_packets[i]));
+		} else {
+			assert(0 == out->bytes && 0 == out->packets);
+			assert(0 == m->cur_bytes[i] && m->ref_bytes > 0);
+		}
+	}
+}
+
+/* the top flows of the window and their complete interval counts */
+static void check_report(const struct tt_top_flows *t5, int64_t sorted_at,
+                         int64_t now)
+{
+	int64_t sort_bytes[REPLAY_FLOWS];
+	int reported[REPLAY_FLOWS] = { 0 };
+	int64_t live = 0, total_bytes = 0, total_packets = 0;
+	int rows;
+
+	/* the table is sorted before the tick expires packets */
+	model_window(sorted_at);
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		sort_bytes[f] = mflow[f].ref_bytes;
+	}
+
+	model_window(now);
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		live += (mflow[f].ref_bytes > 0);
+		total_bytes += mflow[f].ref_bytes;
+		total_packets += mflow[f].ref_packets;
+	}
+	assert(t5->flow_count == live);
+	assert(t5->total_bytes == rate_calc(ref_window_size, total_bytes));
+	assert(t5->total_packets == rate_calc(ref_window_size, total_packets));
+
+	rows = (live < MAX_FLOW_COUNT) ? live : MAX_FLOW_COUNT;
+	for (int r = 0; r < rows; r++) {
+		struct model_flow *m = model_find(&t5->flow[r][0].flow);
+		int f = m - mflow;
+
+		assert(!reported[f]);
+		reported[f] = 1;
+		assert(m->ref_bytes > 0);
+		for (int i = 0; i < INTERVAL_COUNT; i++) {
+			assert(0 == memcmp(&t5->flow[r][i].flow, &m->flow,
+			                   sizeof(m->flow)));
+			assert(t5->flow[r][i].bytes ==
+			       rate_calc(tt_intervals[i], m->done_bytes[i]));
+			assert(t5->flow[r][i].packets ==
+			       rate_calc(tt_intervals[i], m->done_packets[i]));
+		}
+	}
+
+	/* the reported flows were the largest when sorted; ties go either
+	 * way */
+	for (int f = 0; f < REPLAY_FLOWS; f++) {
+		if (reported[f] || !mflow[f].ref_bytes) {
+			continue;
+		}
+		for (int g = 0; g < REPLAY_FLOWS; g++) {
+			assert(!reported[g] || sort_bytes[g] >= sort_bytes[f]);
+		}
+	}
+}
+
+static void replay(struct timeval window)
+{
+	static struct tt_top_flows t5;
+	int64_t t0 = 1000000000LL, sorted_at = t0;
+
+	/* as tt_intervals_init() leaves them */
+	clear_all_tables();
+	ref_window_size = window;
+	model_init(t0);
+	init_intervals(us_to_tv(t0));
+
+	for (int tick = 1; tick <= REPLAY_TICKS; tick++) {
+		int64_t now = t0 + (int64_t)tick * TICK_US;
+		int64_t ts = now - TICK_US;
+
+		/* the packets captured since the last tick, in order */
+		for (int n = rand() % 12; n > 0; n--) {
+			int f = rand() % REPLAY_FLOWS;
+
+			/* the low flows are the heavy ones */
+			f = (f * f) / REPLAY_FLOWS;
+			ts += 1 + rand() % (TICK_US / 24);
+			if (flow_active(f, tick)) {
+				add_packet(f, ts, 64 + rand() % 1400);
+				sorted_at = ts;
+			}
+		}
+
+		/* any flow can overtake the others in a single tick */
+		if (0 == rand() % BURST_ODDS) {
+			int f = rand() % REPLAY_FLOWS;
+			int n = BURST_MIN + rand() % (BURST_MAX - BURST_MIN + 1);
+
+			while (n--) {
+				ts += 1 + rand() % 10;
+				add_packet(f, ts, 1500);
+				sorted_at = ts;
+			}
+		}
+		assert(ts < now);
+
+		memset(&t5, 0, sizeof(t5));
+		tt_get_top5(&t5, us_to_tv(now));
+		for (int i = 0; i < INTERVAL_COUNT; i++) {
+			if (now > mint_end[i]) {
+				check_interval_top(&t5, i, now);
+			}
+		}
+		model_rotate(now);
+		check_report(&t5, sorted_at, now);
+		sorted_at = now;
+	}
+}
+
+int main(void)
+{
+	srand(1);
+
+	/* longer than every interval */
+	replay((struct timeval){.tv_sec = 3, .tv_usec = 0 });
+	/* shorter than most of them */
+	replay((struct timeval){.tv_sec = 0, .tv_usec = 20000 });
+
+	printf("intervals OK\n");
+	return 0;
+}
@@ -0,0 +1,327 @@
+/* jittertrap-canvas.js */
+
+/* global d3 */
+/* global JT:true */
+
+JT = (function (my) {
+  'use strict';
+
+  my.canvas = {};
+
+  /* A fixed capacity ring of samples, stored column-wise in Float64Arrays.
+   * Once full, each push overwrites the oldest sample. version changes on
+   * every modification, so that charts can skip redraws. */
+  var Ring = function (capacity, columns) {
+    this.columns = columns || 1;
+    this.version = 0;
+    this.resize(capacity);
+  };
+
+  /* discards the contents */
+  Ring.prototype.resize = function (capacity) {
+    this.capacity = capacity;
+    this.cols = [];
+    for (var c = 0; c < this.columns; c++) {
+      this.cols.push(new Float64Array(capacity));
+    }
+    this.clear();
+  };
+
+  Ring.prototype.clear = function () {
+    this.head = 0;
+    this.size = 0;
+    this.version++;
+  };
+
+  /* Take over a complete set of columns (eg. a frame from the worker) with
+   * n values each, oldest first. Returns the replaced columns. */
+  Ring.prototype.adopt = function (cols, n) {
+    var old = this.cols;
+    this.cols = cols;
+    this.capacity = cols[0].length;
+    this.size = n;
+    this.head = n % this.capacity;
+    this.version++;
+    return old;
+  };
+
+  /* one argument per column */
+  Ring.prototype.push = function () {
+    for (var c = 0; c < this.columns; c++) {
+      this.cols[c][this.head] = arguments[c];
+    }
+    this.head = (this.head + 1) % this.capacity;
+    if (this.size < this.capacity) {
+      this.size++;
+    }
+    this.version++;
+  };
+
+  /* the i'th oldest value of column c */
+  Ring.prototype.get = function (c, i) {
+    var idx = this.head - this.size + i;
+    if (idx < 0) {
+      idx += this.capacity;
+    }
+    return this.cols[c][idx];
+  };
+
+  Ring.prototype.max = function (c) {
+    var m = 0;
+    for (var i = 0; i < this.size; i++) {
+      var v = this.get(c, i);
+      if (v > m) {
+        m = v;
+      }
+    }
+    return m;
+  };
+
+  /* Trace n points into the current path of ctx, with px(i) and py(i)
+   * giving the pixel coordinates of point i. Consecutive points that fall
+   * in the same pixel column are reduced to their first, min, max and last
+   * value, so the cost of drawing depends on the width of the plot rather
+   * than the number of samples, and no peak is lost. */
+  var tracePoints = function (ctx, n, px, py, join) {
+    var col = NaN, first, last, lo, hi;
+
+    var flush = function () {
+      if (lo !== first) {
+        ctx.lineTo(col, lo);
+      }
+      if (hi !== lo) {
+        ctx.lineTo(col, hi);
+      }
+      if (last !== hi) {
+        ctx.lineTo(col, last);
+      }
+    };
+
+    for (var i = 0; i < n; i++) {
+      var x = Math.round(px(i));
+      var y = py(i);
+      if (x !== col) {
+        if (!isNaN(col)) {
+          flush();
+        }
+        if (i === 0 && !join) {
+          ctx.moveTo(x, y);
+        } else {
+          ctx.lineTo(x, y);
+        }
+        col = x;
+        first = last = lo = hi = y;
+      } else {
+        last = y;
+        lo = Math.min(lo, y);
+        hi = Math.max(hi, y);
+      }
+    }
+    if (n) {
+      flush();
+    }
+  };
+
+  /* A chart drawn on two stacked canvases: the axes, grid and labels on
+   * the bottom layer, which is only redrawn when the scales or the size
+   * change, and the data on the top layer. */
+  var Plot = function (containerId, opts) {
+    this.containerId = containerId;
+    this.margin = opts.margin;
+    this.height = opts.height;
+    this.makeYScale = opts.yScale || function () {
+      return d3.scaleLinear();
+    };
+    this.xTicks = opts.xTicks || 10;
+    this.yTicks = opts.yTicks || 5;
+    this.labels = {};
+    this.xScale = d3.scaleLinear();
+    this.yScale = this.makeYScale();
+    this.wrap = null;
+  };
+
+  Plot.prototype.reset = function (labels) {
+    var container = $(this.containerId);
+
+    container.children('.jt-plot').remove();
+    this.wrap = $('<div class="jt-plot">')
+                  .css({ position: 'relative', height: this.height + 'px' })
+                  .prependTo(container);
+    this.bg = $('<canvas>').css({ position: 'absolute', left: 0, top: 0 })
+                           .appendTo(this.wrap)[0];
+    this.fg = $('<canvas>').css({ position: 'absolute', left: 0, top: 0 })
+                           .appendTo(this.wrap)[0];
+    this.labels = labels;
+    this.width = 0;
+    this.bgKey = "";
+    this.fgKey = "";
+    this.xScale = d3.scaleLinear();
+    this.yScale = this.makeYScale();
+  };
+
+  /* Match the canvases to the container width and the display's pixel
+   * density. Returns false while the chart is hidden. */
+  Plot.prototype.fit = function () {
+    if (!this.wrap) {
+      return false;
+    }
+    var width = Math.floor(this.wrap[0].getBoundingClientRect().width);
+    var ratio = window.devicePixelRatio || 1;
+    if (width === 0) {
+      return false;
+    }
+    if (width !== this.width || ratio !== this.ratio) {
+      var canvases = [this.bg, this.fg];
+      for (var i = 0; i < canvases.length; i++) {
+        canvases[i].width = width * ratio;
+        canvases[i].height = this.height * ratio;
+        canvases[i].style.width = width + 'px';
+        canvases[i].style.height = this.height + 'px';
+      }
+      this.width = width;
+      this.ratio = ratio;
+      this.bgKey = "";
+      this.xScale.range([0, this.plotWidth()]);
+      this.yScale.range([this.plotHeight(), 0]);
+    }
+    return true;
+  };
+
+  Plot.prototype.plotWidth = function () {
+    return this.width - this.margin.left - this.margin.right;
+  };
+
+  Plot.prototype.plotHeight = function () {
+    return this.height - this.margin.top - this.margin.bottom;
+  };
+
+  Plot.prototype.setDomain = function (xDomain, yDomain) {
+    this.xScale.domain(xDomain);
+    this.yScale.domain(yDomain);
+  };
+
+  Plot.prototype.drawBackground = function () {
+    var key = this.width + ':' + this.xScale.domain() + ':'
+              + this.yScale.domain();
+    if (key === this.bgKey) {
+      return;
+    }
+    this.bgKey = key;
+
+    var m = this.margin;
+    var w = this.plotWidth();
+    var h = this.plotHeight();
+    var ctx = this.bg.getContext('2d');
+    var xTicks = this.xScale.ticks(this.xTicks);
+    var yTicks = this.yScale.ticks(this.yTicks);
+    var xFormat = this.xScale.tickFormat(this.xTicks);
+    var yFormat = this.yScale.tickFormat(this.yTicks);
+    var i, x, y;
+
+    ctx.setTransform(this.ratio, 0, 0, this.ratio, 0, 0);
+    ctx.clearRect(0, 0, this.width, this.height);
+    ctx.translate(m.left, m.top);
+    ctx.font = '10px sans-serif';
+    ctx.fillStyle = '#000';
+
+    /* grid */
+    ctx.strokeStyle = 'rgba(128, 128, 128, 0.4)';
+    ctx.lineWidth = 1;
+    ctx.beginPath();
+    for (i = 0; i < xTicks.length; i++) {
+      x = Math.round(this.xScale(xTicks[i])) + 0.5;
+      ctx.moveTo(x, 0);
+      ctx.lineTo(x, h);
+    }
+    for (i = 0; i < yTicks.length; i++) {
+      y = Math.round(this.yScale(yTicks[i])) + 0.5;
+      ctx.moveTo(0, y);
+      ctx.lineTo(w, y);
+    }
+    ctx.stroke();
+
+    /* axes */
+    ctx.strokeStyle = '#000';
+    ctx.beginPath();
+    ctx.moveTo(0.5, 0);
+    ctx.lineTo(0.5, h + 0.5);
+    ctx.lineTo(w, h + 0.5);
+    ctx.stroke();
+
+    ctx.globalAlpha = 0.4;
+    ctx.textAlign = 'center';
+    ctx.textBaseline = 'top';
+    for (i = 0; i < xTicks.length; i++) {
+      ctx.fillText(xFormat(xTicks[i]), this.xScale(xTicks[i]), h + 6);
+    }
+    ctx.textAlign = 'right';
+    ctx.textBaseline = 'middle';
+    for (i = 0; i < yTicks.length; i++) {
+      ctx.fillText(yFormat(yTicks[i]), -6, this.yScale(yTicks[i]));
+    }
+    ctx.globalAlpha = 1;
+
+    ctx.textAlign = 'center';
+    ctx.textBaseline = 'middle';
+    ctx.fillText(this.labels.title || "", w / 2, -m.top / 2);
+    ctx.fillText(this.labels.xlabel || "", w / 2, h + 30);
+
+    ctx.save();
+    ctx.rotate(-Math.PI / 2);
+    ctx.textAlign = 'end';
+    ctx.textBaseline = 'top';
+    ctx.fillText(this.labels.ylabel || "", 0, -m.left + 2);
+    ctx.restore();
+  };
+
+  /* True if the data layer already shows this version of the data at the
+   * current scales and size. Otherwise, it's assumed to be redrawn next. */
+  Plot.prototype.upToDate = function (version) {
+    var key = version + '@' + this.bgKey;
+    if (key === this.fgKey) {
+      return true;
+    }
+    this.fgKey = key;
+    return false;
+  };
+
+  /* Clear the data layer and return its context, with the origin at the
+   * top left of the plot area. */
+  Plot.prototype.beginData = function () {
+    var ctx = this.fg.getContext('2d');
+    ctx.setTransform(this.ratio, 0, 0, this.ratio, 0, 0);
+    ctx.clearRect(0, 0, this.width, this.height);
+    ctx.translate(this.margin.left, this.margin.top);
+    return ctx;
+  };
+
+  Plot.prototype.line = function (ctx, n, px, py, color) {
+    ctx.beginPath();
+    tracePoints(ctx, n, px, py, false);
+    ctx.strokeStyle = color;
+    ctx.lineWidth = 1.5;
+    ctx.stroke();
+  };
+
+  /* fill between py0 (below) and py1 (above) */
+  Plot.prototype.band = function (ctx, n, px, py0, py1, color) {
+    if (!n) {
+      return;
+    }
+    ctx.beginPath();
+    tracePoints(ctx, n, px, py1, false);
+    tracePoints(ctx, n,
+                function (i) { return px(n - 1 - i); },
+                function (i) { return py0(n - 1 - i); },
+                true);
+    ctx.closePath();
+    ctx.fillStyle = color;
+    ctx.fill();
+  };
+
+  my.canvas.Ring = Ring;
+  my.canvas.Plot = Plot;
+
+  return my;
+}(JT));
+/* End of jittertrap-canvas.js */
@@ -8,43 +8,68 @@ JT = (function (my) {
 
   my.charts.toptalk = {};
 
-  var chartData = [];
-
-  var clearChartData = function () {
-    chartData.length = 0;
+  var maxFlows = 10;
+
+  /* The top flows over the chart window, a frame from the worker:
+   * ts[i] is the timestamp of slice i, bytes[j * capacity + i] is the byte
+   * count of flow fkeys[j] in slice i. distinct has the server's estimates
+   * of the distinct flows, sources, destinations and ports in the last
+   * slice. */
+  var chartData = {
+    fkeys: [],
+    tbytes: [],
+    distinct: null,
+    n: 0,
+    capacity: 0,
+    ts: new Float64Array(0),
+    bytes: new Float64Array(0),
+    version: 0,
+
+    clear: function () {
+      this.fkeys.length = 0;
+      this.tbytes.length = 0;
+      this.distinct = null;
+      this.n = 0;
+      this.version++;
+    },
+
+    /* Take over a frame from the worker. Returns the replaced buffers. */
+    adopt: function (frame) {
+      var old = [this.ts, this.bytes];
+      this.fkeys = frame.fkeys;
+      this.tbytes = frame.tbytes;
+      this.distinct = frame.distinct;
+      this.n = frame.n;
+      this.capacity = frame.capacity;
+      this.ts = frame.ts;
+      this.bytes = frame.bytes;
+      this.version++;
+      return old;
+    }
   };
 
-  /* must return a reference to an array of {x:x, y:y} */
+  my.charts.toptalk.maxFlows = maxFlows;
+
   my.charts.toptalk.getDataRef = function () {
     return chartData;
   };
 
   my.charts.toptalk.toptalkChart = (function (m) {
-    var margin = {
-      top: 20,
-      right: 20,
-      bottom: 440,
-      left: 75
-    };
+    var plot = new JT.canvas.Plot("#chartToptalk", {
+      margin: { top: 20, right: 20, bottom: 100, left: 75 },
+      height: 400,
+      yScale: function () {
+        return d3.scalePow().exponent(0.5).clamp(true);
+      }
+    });
 
-    var size = { width: 960, height: 700 };
-    var xScale = d3.scaleLinear();
-    var yScale = d3.scaleLinear();
     var colorScale = d3.scaleOrdinal(d3.schemeCategory10);
-    var xAxis = d3.axisBottom();
-    var yAxis = d3.axisLeft();
-    var xGrid = d3.axisBottom();
-    var yGrid = d3.axisLeft();
-    var area = d3.area();
 
-/*
-    // DEBUG line
-    var line = d3.svg.line();
-*/
+    /* running totals of the stacked layers, reused between redraws:
+     * stacked[j * capacity + i] is the sum of flows j..count-1 in slice i */
+    var stacked = new Float64Array(0);
 
-    var stack = d3.stack()
-                .order(d3.stackOrderReverse)
-                .offset(d3.stackOffsetNone);
+    var legendKeys = "";
 
     /* Make a displayable title from the flow key */
     var key2legend = function (fkey) {
@@ -63,338 +88,196 @@ JT = (function (my) {
              + padtclass + a[6];
     };
 
-    var svg = {};
-
     /* Reset and redraw the things that don't change for every redraw() */
     m.reset = function() {
+      plot.reset({ title: "Top flows", xlabel: "Time", ylabel: "Bytes" });
+
+      $("#chartToptalk").children(".legendbox").remove();
+      $('<div class="legendbox">')
+        .append($('<div class="legendheading">').text(
+          "Source          : Src Port ->   Destination     : Dst Port  │ Protocol │ Traffic Class"))
+        .append('<div class="legendrows">')
+        .appendTo("#chartToptalk");
+      legendKeys = "";
+    };
 
-      d3.select("#chartToptalk").selectAll("svg").remove();
-
-      svg = d3.select("#chartToptalk")
-            .append("svg");
-
-      var width = size.width - margin.left - margin.right;
-      var height = size.height - margin.top - margin.bottom;
-
-      xScale = d3.scaleLinear().range([0, width]);
-      yScale = d3.scaleLinear().range([height, 0]);
-
-      xAxis = d3.axisBottom()
-              .scale(xScale)
-              .ticks(10);
-
-      yAxis = d3.axisLeft()
-              .scale(yScale)
-              .ticks(5);
-
-      xGrid = d3.axisBottom()
-          .scale(xScale)
-           .tickSize(-height)
-           .ticks(10)
-           .tickFormat("");
-
-      yGrid = d3.axisLeft()
-          .scale(yScale)
-           .tickSize(-width)
-           .ticks(5)
-           .tickFormat("");
-
-/*
-      // DEBUG line
-      line = d3.svg.line()
-             .x(function(d) { return xScale(d.ts); })
-             .y(function(d) { return yScale(d.bytes); })
-             .interpolate("monotone");
-             // Note: tput charts use "basis" interpolation
-*/
-
-      svg.attr("width", width + margin.left + margin.right)
-         .attr("height", height + margin.top + margin.bottom);
-
-      var graph = svg.append("g")
-         .attr("transform", "translate(" + margin.left + "," + margin.top + ")");
-
-      graph.append("text")
-         .attr("class", "title")
-         .attr("text-anchor", "middle")
-         .attr("x", width/2)
-         .attr("y", -margin.top/2)
-         .text("Top flows");
-
-      graph.append("g")
-         .attr("class", "x axis")
-         .attr("transform", "translate(0," + height + ")")
-         .call(xAxis);
-
-      graph.append("text")
-           .attr("class", "x label")
-           .attr("text-anchor", "middle")
-           .attr("x", width/2)
-           .attr("y", height + 35)
-           .text("Time");
-
-      graph.append("g")
-         .attr("class", "y axis")
-         .call(yAxis)
-         .append("text")
-         .attr("x", -margin.left)
-         .attr("transform", "rotate(-90)")
-         .attr("y", -margin.left)
-         .attr("dy", ".71em")
-         .style("text-anchor", "end")
-         .text("Bytes");
-
-      graph.append("g")
-        .attr("class", "xGrid")
-        .attr("transform", "translate(0," + height + ")")
-        .call(xGrid);
-
-      graph.append("g")
-        .attr("class", "yGrid")
-        .call(yGrid);
-
-      graph.append("g")
-         .attr("id", "flows");
-
-/*
-      // DEBUG Black line.
-      graph.append("path")
-         .datum(chartData)
-         .attr("class", "blackline")
-         .attr(
-             {
-               "fill" : "none",
-               "stroke" : "black",
-               "opacity": 1,
-               "stroke-width" : "1px"
-             });
-*/
-
-      svg.append("g")
-         .attr("class", "barsbox")
-         .attr("id", "barsbox")
-         .append("text")
-           .text("Byte Distribution")
-
-      svg.append("g")
-         .attr("class", "legendbox")
-         .attr("id", "ttlegendbox")
-         .append("text")
-	   .attr("x", 22)
-	   .attr("y", 9)
-	   .attr("dy", ".35em")
-	   .style("text-anchor", "begin")
-	   .style("font-family" ,"monospace")
-	   .style("white-space", "pre")
-	   .text("Source          : Src Port ->   Destination     : Dst Port  │ Protocol │ Traffic Class")
-             .attr("class", "legendheading")
-             .attr("transform",
-                    function(d, i) {
-                       return "translate(" + margin.left + "," + 400 + ")";
-                    }
-              );
-
-
-      my.charts.resizeChart("#chartToptalk", size)();
+    /* The legend is HTML, and only rebuilt when the set of flows changes */
+    var updateLegend = function (fkeys) {
+      var keys = fkeys.join(',');
+      if (keys === legendKeys) {
+        return;
+      }
+      legendKeys = keys;
+
+      var rows = $("#chartToptalk .legendrows").empty();
+      $.each(fkeys, function (i, fkey) {
+        $('<div class="legend">')
+          .attr("title", "Click to impair this flow")
+          .append($('<span class="legendswatch">')
+                    .css("background-color", colorScale(fkey)))
+          .append($('<span class="legendtext">').text(key2legend(fkey)))
+          .on("click", function () {
+            /* impair this flow: fill in the impairment form */
+            JT.programsModule.selectFlow(fkey);
+            $('a[href="#impairmentsPanel"]').tab('show');
+          })
+          .appendTo(rows);
+      });
     };
 
-    /* To find the range of the y-axis, find max of the stacked x values */
-    var maxBytesSlice = function(chartData) {
-      var i, j;
-      var flowCount, sampleCount, maxSlice = 0;
+    /* Stack the flows, the first (largest) on top, as before.
+     * Returns the height of the highest stack. */
+    var stackFlows = function () {
+      var cap = chartData.capacity;
+      var count = chartData.fkeys.length;
+      var n = chartData.n;
+      var maxSlice = 0;
 
-      flowCount = chartData.length;
-      if (!flowCount) {
-        return 0;
+      if (stacked.length < cap * (count + 1)) {
+        stacked = new Float64Array(cap * (maxFlows + 1));
       }
 
-      sampleCount = chartData[0].values.length;
-
-      for (i = 0; i < sampleCount; i++) {
-        var thisSliceBytes = 0;
-        for (j = 0; j < flowCount; j++) {
-          thisSliceBytes += chartData[j].values[i].bytes;
+      for (var i = 0; i < n; i++) {
+        var sum = 0;
+        stacked[count * cap + i] = 0;
+        for (var j = count - 1; j >= 0; j--) {
+          sum += chartData.bytes[j * cap + i];
+          stacked[j * cap + i] = sum;
         }
-        if (thisSliceBytes > maxSlice) {
-          maxSlice = thisSliceBytes;
+        if (sum > maxSlice) {
+          maxSlice = sum;
         }
       }
       return maxSlice;
     };
 
-    /* Reformat chartData to work with the new d3 v4 API
-     * Ref: https://github.com/d3/d3-shape/blob/master/README.md#stack */
-    var formatData = function(chartData) {
-      var bins = [];
-
-      for (var key in chartData)
-      {
-	  	  var row = chartData[key];
-        for (var val in row.values)
-        {
-          var o = row.values[val];
-
-          var prevTsIndex = bins.map(function (d) { return d.ts }).indexOf(o.ts);
-          if (prevTsIndex === -1) // create new ts row
-          {
-            bins.push({
-              "ts": o.ts, 
-              [row.fkey]: o.bytes // use var as key
-            });
-          } else { // update current row with key
-            if (bins[prevTsIndex][row.fkey]) 
-              bins[prevTsIndex][row.fkey] += o.bytes;
-            else
-              bins[prevTsIndex][row.fkey] = o.bytes;
-          }
-	  	  }
-      }
-      return bins;
-    }
+    var drawDistribution = function (ctx) {
+      var width = plot.plotWidth();
+      var y = plot.plotHeight() + 55;
+      var total = 0, x0 = 0, j;
 
-    /* Update the chart (try to avoid memory allocations here!) */
-    m.redraw = function() {
+      for (j = 0; j < chartData.tbytes.length; j++) {
+        total += chartData.tbytes[j];
+      }
 
-      var width = size.width - margin.left - margin.right;
-      var height = size.height - margin.top - margin.bottom;
+      ctx.fillStyle = '#000';
+      ctx.font = '10px sans-serif';
+      ctx.textAlign = 'start';
+      ctx.textBaseline = 'bottom';
+      ctx.fillText("Byte Distribution", 0, y - 2);
+
+      var d = chartData.distinct;
+      if (d) {
+        ctx.textAlign = 'end';
+        ctx.fillText("~" + d.flows + " flows, ~" + d.src + " sources, ~"
+                     + d.dst + " destinations, ~" + d.dport
+                     + " destination ports", width, y - 2);
+      }
 
-      xScale = d3.scaleLinear().range([0, width]);
-      //yScale = d3.scale.linear().range([height, 0]);
-      //yScale = d3.scale.log().clamp(true).range([height, 1]);
-      yScale = d3.scalePow().exponent(0.5).clamp(true).range([height, 1]);
+      if (!total) {
+        return;
+      }
+      for (j = 0; j < chartData.tbytes.length; j++) {
+        var x1 = x0 + chartData.tbytes[j] / total * width;
+        ctx.fillStyle = colorScale(chartData.fkeys[j]);
+        ctx.fillRect(Math.round(x0), y, Math.round(x1) - Math.round(x0), 23);
+        x0 = x1;
+      }
+    };
 
-      /* compute the domain of x as the [min,max] extent of timestamps
-       * of the first (largest) flow */
-      if (chartData[0]) {
-        xScale.domain(d3.extent(chartData[0].values, function(d) {
-          return d.ts;
-        }));
+    /* Update the chart (try to avoid memory allocations here!) */
+    m.redraw = function() {
+      if (!plot.fit()) {
+        return;
       }
 
-      yScale.domain([0, maxBytesSlice(chartData)]);
+      var cap = chartData.capacity;
+      var n = chartData.n;
+      var count = chartData.fkeys.length;
+      var x = plot.xScale;
+      var y = plot.yScale;
 
-      xAxis.scale(xScale);
-      yAxis.scale(yScale);
+      colorScale.domain(chartData.fkeys);
+      updateLegend(chartData.fkeys);
 
-      xGrid.scale(xScale);
-      yGrid.scale(yScale);
+      var maxSlice = stackFlows();
+      plot.setDomain(n ? [chartData.ts[0], chartData.ts[n - 1]] : [0, 1],
+                     [0, maxSlice || 1]);
+      plot.drawBackground();
 
-      svg = d3.select("#chartToptalk");
-/*
-      // DEBUG Line
-      svg.select(".blackline").attr("d", line(chartData[0].values));
-*/
-      svg.select(".x.axis").call(xAxis);
-      svg.select(".y.axis").call(yAxis);
-      svg.select(".xGrid").call(xGrid);
-      svg.select(".yGrid").call(yGrid);
+      if (plot.upToDate(chartData.version)) {
+        return;
+      }
 
-      var fkeys = chartData.map(function(f) { return f.fkey; });
-      colorScale.domain(fkeys);
+      var ctx = plot.beginData();
+      var px = function (i) { return x(chartData.ts[i]); };
 
-      stack.keys(fkeys);
+      for (var j = 0; j < count; j++) {
+        plot.band(ctx, n, px,
+                  function (i) { return y(stacked[(j + 1) * cap + i]); },
+                  function (i) { return y(stacked[j * cap + i]); },
+                  colorScale(chartData.fkeys[j]));
+      }
 
-      // Format the data, so they're flat arrays
-      var stackedChartData = stack(
-        formatData(chartData));
+      drawDistribution(ctx);
+    };
 
-      area = d3.area()
-               .curve(d3.curveMonotoneX)
-               .x(function (d) { return xScale(d.data.ts); })
-               .y0(function (d) { return yScale(d[0]); })
-               .y1(function (d) { return yScale(d[0] + d[1]); });
+    return m;
 
-      svg.select("#flows").selectAll(".layer").remove();
+  }({}));
 
-      svg.select("#flows").selectAll("path")
-         .data(stackedChartData)
-       .enter().append("path")
-         .attr("class", "layer")
-         .attr("d", area)
-         .style("fill", function(d, i) { return colorScale(d.key); });
+  /* The top keys of the selected rollup (eg. source /24), over the last
+   * window of the longest toptalk interval. The server only sends the
+   * rollup that was asked for, so a table is all it takes. */
+  my.charts.toptalk.rollupTable = (function (m) {
+    var name = "";
 
+    var formatRate = function (bytes) {
+      return d3.format(".3s")(bytes * 8) + "bps";
+    };
 
-      // distribution bar
-      var contribs = chartData.map(function(f) {
-        return { k: f.fkey, b: f.tbytes, p :f.tpackets };
-      });
+    m.reset = function (groupBy) {
+      name = groupBy || "";
+      $("#rollupTable").empty();
+      $("#chartToptalk").toggle(!name);
+      if (name) {
+        $("#rollupTable").append(
+          $('<p>').text("Waiting for the end of the current window..."));
+      }
+    };
 
-      var tbytes = contribs.reduce(function(a,b) { return a + b.b }, 0 );
-
-      var rangeStop = 0;
-      var barData = contribs.map(function(d) {
-        var new_d = {
-          k: d.k,
-          x0: rangeStop,
-          x1: (rangeStop + d.b)
-        };
-        rangeStop = new_d.x1;
-        return new_d;
-      });
+    m.update = function (p) {
+      if (p.name !== name) {
+        return;
+      }
 
-      var x = d3.scaleLinear()
-                      .rangeRound([0, width])
-                      .domain([0,tbytes]);
-
-      var y = d3.scaleBand()
-                      .range([0, 10])
-                      .round(.3);
-
-      var barsbox = svg.select("#barsbox");
-      barsbox.selectAll(".subbar").remove();
-      var bars = barsbox.selectAll("rect")
-                    .data(barData)
-                    .enter().append("g").attr("class", "subbar");
-
-      bars.append("rect")
-          .attr("height", 23)
-          .attr("y", 9)
-          .attr("x", function(d) { return x(d.x0); })
-          .attr("width", function(d) { return x(d.x1) - x(d.x0); })
-          .style("fill", function(d) { return colorScale(d.k); });
-
-      barsbox.attr("transform", function(d) {
-        return "translate(" + margin.left + "," + 350 + ")";
+      var table = $('<table class="table table-condensed rollup">');
+      $('<tr>')
+        .append($('<th>').text(name))
+        .append($('<th>').text("Rate"))
+        .append($('<th>').text("Packets/s"))
+        .append($('<th>').text("Share"))
+        .append($('<th>').text("Error").attr("title",
+                  "The rate may be over-estimated by up to this much"))
+        .appendTo(table);
+
+      $.each(p.top, function (i, e) {
+        var share = p.tbytes ? e[1] / p.tbytes : 0;
+        $('<tr>')
+          .append($('<td>').text(e[0]))
+          .append($('<td>').text(formatRate(e[1])))
+          .append($('<td>').text(e[2]))
+          .append($('<td>').text(d3.format(".1%")(share)))
+          .append($('<td>').text(e[3] ? "±" + formatRate(e[3]) : ""))
+          .appendTo(table);
       });
 
-
-      // legend box handling
-      var legend_tabs = colorScale.domain();
-      var legendbox = svg.select("#ttlegendbox");
-      legendbox.selectAll(".legend").remove();
-      var legend = legendbox.selectAll(".legend")
-                   .data(fkeys.slice()).enter()
-                   .append("g")
-                   .attr("class", "legend")
-                   .attr("transform",
-                         function(d, i) {
-                           return "translate(" + margin.left + ","
-                                             + (400 + ((i+1) * 25)) + ")";
-                         }
-                   );
-
-      legend.append("rect")
-	      .attr("x", 0)
-	      .attr("width", 18)
-	      .attr("height", 18)
-	      .style("fill", colorScale);
-
-      legend.append("text")
-	      .attr("x", 22)
-	      .attr("y", 9)
-	      .attr("dy", ".35em")
-	      .style("text-anchor", "begin")
-	      .style("font-family" ,"monospace")
-	      .style("white-space", "pre")
-	      .text(function(d) { return key2legend(d); });
-
+      $("#rollupTable").empty()
+        .append($('<p>').text("Total " + formatRate(p.tbytes) + " over "
+                              + (p.interval_ns / 1E9) + "s"))
+        .append(table);
     };
 
-
-    /* Set the callback for resizing the chart */
-    d3.select(window).on('resize.chartToptalk',
-                         my.charts.resizeChart("#chartToptalk", size));
-
     return m;
 
   }({}));
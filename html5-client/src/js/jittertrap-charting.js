@@ -16,54 +16,56 @@ JT = (function (my) {
   params.plotPeriodMin     = 1;
   params.plotPeriodMax     = 1000;
 
-  /* chart redraw/refresh/updates; milliseconds; 40ms == 25 Hz */
+  /* chart redraw/refresh/updates; milliseconds; 16ms ~= 60 Hz */
   params.redrawPeriod      = 60;
-  params.redrawPeriodMin   = 40;
+  params.redrawPeriodMin   = 16;
   params.redrawPeriodMax   = 100;
   params.redrawPeriodSaved = 0;
+  params.redrawPeriodStopped = 9999999999;
+
+  my.core.setChartPeriod(params.plotPeriod);
 
   var clearChartData = function () {
-    my.charts.tput.getTputRef().length = 0;
-    my.charts.pgaps.getMinMaxRef().length = 0;
-    my.charts.pgaps.getMeanRef().length = 0;
+    my.charts.tput.getTputRef().clear();
+    my.charts.pgaps.getRingRef().clear();
+    my.charts.toptalk.getDataRef().clear();
   };
 
-  /* must return a reference to an array of {x:x, y:y} */
+  /* a ring with one value per sample */
   my.charts.getMainChartRef = function () {
     return my.charts.tput.getTputRef();
   };
 
-  my.charts.getPacketGapMeanRef = function () {
-    return my.charts.pgaps.getMeanRef();
-  };
-
-  my.charts.getPacketGapMinMaxRef = function () {
-    return my.charts.pgaps.getMinMaxRef();
+  /* a ring of mean, min, max per sample */
+  my.charts.getPacketGapRef = function () {
+    return my.charts.pgaps.getRingRef();
   };
 
   my.charts.getTopFlowsRef = function () {
     return my.charts.toptalk.getDataRef();
   };
 
-  /* newSize is an OUT parameter */
-  my.charts.resizeChart = function(containerId, newSize) {
-    return function() {
-      var container = d3.select(containerId);
-      var new_width = container.node().getBoundingClientRect().width;
-      var new_height = container.node().getBoundingClientRect().height;
-      if (new_width === 0 ) {
-        return;
-      }
-      newSize.width = new_width;
-      newSize.height = new_height;
-      container.attr("width", new_width)
-               .attr("height", new_height);
-      container.select("svg")
-               .attr("width", new_width)
-               .attr("height", new_height);
-    };
+  /* Only the charted time scale is used (the measurements and traps are
+   * also on it), and the top flows or the selected rollup only when they
+   * are shown. While the page is hidden or the charts are stopped, one
+   * update per second keeps the traps going. */
+  var updateRateIdle = 1;
+
+  var sendUpdateRate = function() {
+    var ival = params.plotPeriod * 1E6;
+    var idle = document.hidden ||
+               params.redrawPeriod === params.redrawPeriodStopped;
+    var shown = $("#toptalkPanel").hasClass("active");
+    var groupBy = $("#chopts_groupby").val();
+    var toptalk = shown ? [ival] : [];
+    var rollups = (shown && groupBy) ? [groupBy] : [];
+
+    my.ws.set_update_rate(idle ? updateRateIdle : 0, [ival], toptalk,
+                          rollups);
   };
 
+  $(document).on("visibilitychange", sendUpdateRate);
+
   var resetChart = function() {
     var selectedSeriesOpt = $("#chopts_series option:selected").val();
     my.core.setSelectedSeriesName(selectedSeriesOpt);
@@ -71,6 +73,8 @@ JT = (function (my) {
     my.charts.tput.tputChart.reset(my.core.getSelectedSeries());
     my.charts.pgaps.packetGapChart.reset();
     my.charts.toptalk.toptalkChart.reset();
+    my.charts.toptalk.rollupTable.reset($("#chopts_groupby").val());
+    sendUpdateRate();
   };
 
   var renderCount = 0;
@@ -84,12 +88,11 @@ JT = (function (my) {
       return;
     }
 
-    var avgRenderTime =  Math.floor(renderTime / renderCount);
-    //console.log("Rendering time: " + avgRenderTime
-    //            + " Processing time: " + procTime
-    //            + " Charting Period: " + chartingPeriod);
+    var avgRenderTime = renderTime / renderCount;
 
-    params.redrawPeriod = params.plotPeriod / 2;
+    /* No point in redrawing faster than the data changes, and leave most
+     * of the main thread to everything else. */
+    params.redrawPeriod = Math.max(params.plotPeriod / 2, 4 * avgRenderTime);
 
     if (params.redrawPeriod < params.redrawPeriodMin) {
       params.redrawPeriod = params.redrawPeriodMin;
@@ -97,42 +100,58 @@ JT = (function (my) {
       params.redrawPeriod = params.redrawPeriodMax;
     }
 
-    setUpdatePeriod();
-
     renderCount = renderCount % tuneWindowSize;
     renderTime = 0;
   };
 
 
   var renderGraphs = function() {
-    var d1 = Date.now();
+    var d1 = window.performance.now();
     my.charts.tput.tputChart.redraw();
     my.charts.pgaps.packetGapChart.redraw();
     my.charts.toptalk.toptalkChart.redraw();
 
-    var d2 = Date.now();
+    /* compares the server's clock with ours, so it's only as good as
+     * their synchronisation */
+    var s = my.core.takeUndrawnSample();
+    if (s) {
+      my.measurementsModule.updateLatency(Date.now() - s.time, s.trace);
+    }
+
+    var d2 = window.performance.now();
     renderCount++;
     renderTime += d2 - d1;
     tuneChartUpdatePeriod();
   };
 
-  var drawIntervalID = setInterval(renderGraphs, params.redrawPeriod);
+  /* Draw in step with the display, at most once per redrawPeriod. The
+   * charts skip the work when their data hasn't changed. */
+  var lastRender = 0;
+
+  var renderFrame = function(now) {
+    window.requestAnimationFrame(renderFrame);
+    if (now - lastRender < params.redrawPeriod) {
+      return;
+    }
+    lastRender = now;
+    renderGraphs();
+  };
+
+  window.requestAnimationFrame(renderFrame);
 
   var setUpdatePeriod = function() {
-    var updateRate = 1000.0 / params.redrawPeriod; /* Hz */
-    clearInterval(drawIntervalID);
-    drawIntervalID = setInterval(renderGraphs, params.redrawPeriod);
+    lastRender = 0;
   };
 
   var toggleStopStartGraph = function() {
-    var maxUpdatePeriod = 9999999999;
-    if (params.redrawPeriod !== maxUpdatePeriod) {
+    if (params.redrawPeriod !== params.redrawPeriodStopped) {
       params.redrawPeriodSaved = params.redrawPeriod;
-      params.redrawPeriod = maxUpdatePeriod;
+      params.redrawPeriod = params.redrawPeriodStopped;
     } else {
       params.redrawPeriod = params.redrawPeriodSaved;
     }
     setUpdatePeriod();
+    sendUpdateRate();
     return false;
   };
 
@@ -148,6 +167,7 @@ JT = (function (my) {
     }
 
     params.plotPeriod = newPeriod;
+    JT.core.setChartPeriod(newPeriod);
     var sampleCount = JT.core.sampleCount(newPeriod);
     JT.core.resizeDataBufs(sampleCount);
     JT.charts.resetChart();
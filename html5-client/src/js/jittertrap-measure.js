@@ -11,6 +11,9 @@ JT = (function (my) {
   measurements.txRate = {};
   measurements.rxPacketRate = {};
   measurements.txPacketRate = {};
+  measurements.latency = "";
+  measurements.pgaps = null;
+  measurements.psizes = null;
 
   var updateTputDOM = function () {
     $("#jt-measure-tput-min-rx").html(measurements.rxRate.min);
@@ -40,11 +43,71 @@ JT = (function (my) {
     $("#jt-measure-zRun-mean-tx").html(measurements.txRate.meanZ);
   };
 
+  /* the capture's gaps are in ns; show them in us */
+  var updatePGapDOM = function () {
+    var dirs = ["rx", "tx"];
+
+    for (var i = 0; i < dirs.length; i++) {
+      var g = measurements.pgaps && measurements.pgaps[dirs[i]];
+      var show = g && g.n;
+
+      $("#jt-measure-pgap-min-" + dirs[i]).html(
+        show ? (g.min / 1E3).toFixed(1) : "");
+      $("#jt-measure-pgap-max-" + dirs[i]).html(
+        show ? (g.max / 1E3).toFixed(1) : "");
+      $("#jt-measure-pgap-mean-" + dirs[i]).html(
+        show ? (g.mean / 1E3).toFixed(1) : "");
+    }
+  };
+
+  /* The lengths of the bucket holding the q-th quantile of a packet
+   * length histogram: bucket n is shorter than 2^(n + 6) bytes, the
+   * last one holds the rest. */
+  var psizeQuantile = function (hist, q) {
+    var buckets = 11;
+    var total = 0;
+    var seen = 0;
+    var b;
+
+    for (b = 0; b < hist.length; b++) {
+      total += hist[b];
+    }
+    for (b = 0; b < hist.length; b++) {
+      seen += hist[b];
+      if (seen >= q * total) {
+        break;
+      }
+    }
+    if (b === 0) {
+      return "&lt; 64";
+    } else if (b >= buckets - 1) {
+      return "&ge; " + Math.pow(2, buckets + 4);
+    }
+    return Math.pow(2, b + 5) + "&ndash;" + (Math.pow(2, b + 6) - 1);
+  };
+
+  var updatePSizeDOM = function () {
+    var dirs = ["rx", "tx"];
+
+    for (var i = 0; i < dirs.length; i++) {
+      var h = measurements.psizes && measurements.psizes[dirs[i]];
+      var show = h && h.length;
+
+      $("#jt-measure-psize-median-" + dirs[i]).html(
+        show ? psizeQuantile(h, 0.5) : "");
+      $("#jt-measure-psize-p95-" + dirs[i]).html(
+        show ? psizeQuantile(h, 0.95) : "");
+    }
+  };
+
   var updateDOM = function () {
     updateTputDOM();
     updateRateDOM();
     updateZRunDOM();
+    updatePGapDOM();
+    updatePSizeDOM();
     $("#jt-measure-sample-period").html(my.charts.getChartPeriod() + "ms");
+    $("#jt-measure-latency").html(measurements.latency);
 
   };
 
@@ -62,6 +125,28 @@ JT = (function (my) {
     measurements[series].meanZ = stats.meanPG.toFixed(2);
   };
 
+  /* the interface's packet gaps in the last toptalk slice, or null */
+  my.measurementsModule.updatePacketGaps = function (pgaps) {
+    measurements.pgaps = pgaps;
+  };
+
+  /* the interface's packet lengths in the last toptalk slice, or null */
+  my.measurementsModule.updatePacketSizes = function (psizes) {
+    measurements.psizes = psizes;
+  };
+
+  /* ms from reading a sample on the server to drawing it, and the
+   * server's part of that, the last of its trace (us) */
+  my.measurementsModule.updateLatency = function (ms, trace) {
+    var text = Math.round(ms) + "ms";
+
+    if (trace && trace.length) {
+      text += " (server " + (trace[trace.length - 1] / 1000).toFixed(1) +
+              "ms)";
+    }
+    measurements.latency = text;
+  };
+
   return my;
 }(JT));
 /* end of jittertrap-measure.js */
@@ -17,16 +17,50 @@ JT = (function (my) {
     this.name = json.name;
     this.timeoutHandles = {};
     this.impairments = json.impairments;
+    /* optional: more ifaces to impair together with the selected one */
+    this.ifaces = json.ifaces || [];
 
     programs[this.id] = this;
 
+    /* The schedule runs in the server, so that step timing does not depend
+     * on browser timers or the websocket round trip. */
+    var toSteps = function(impairments) {
+      var steps = [];
+      for (var i in impairments) {
+        var imp = impairments[i];
+        steps.push({
+          t: Math.round(parseFloat(i) * 1000000),
+          delay: imp.stop ? 0 : parseInt(imp.delay),
+          jitter: imp.stop ? 0 : parseInt(imp.jitter),
+          /* convert the percentage to an integer in parts per million. */
+          loss: imp.stop ? 0 : parseInt(Math.round(10000 * imp.loss))
+        });
+      }
+      steps.sort(function(a, b) { return a.t - b.t; });
+      return steps;
+    };
+
     this.play = function() {
       console.log("playing program: " + this.id);
-      if (runningProgram && runningProgram.stop) {
-        runningProgram.stop();
+      if (runningProgram && runningProgram != this) {
+        runningProgram.setStopped();
       }
-      JT.ws.clear_netem();
       runningProgram = this;
+      this.setRunning();
+      JT.ws.set_program(this.name, toSteps(this.impairments), this.ifaces);
+    };
+
+    this.stop = function() {
+      console.log("stopping program: " + this.id);
+      if (runningProgram && this != runningProgram) {
+        return runningProgram.stop();
+      }
+      JT.ws.stop_program();
+      this.setStopped();
+      JT.ws.clear_netem();
+    };
+
+    this.setRunning = function() {
       $("#"+this.id+"_play").css('color','green');
       $("#delay").prop('readonly', true);
       $("#jitter").prop('readonly', true);
@@ -34,46 +68,9 @@ JT = (function (my) {
       $("#set_netem_button").prop('disabled', true);
       $("#clear_netem_button").prop('disabled', true);
       $("#netem_status").html("Program Running");
-
-      for (var i in this.impairments) {
-        if (json.impairments[i].stop) {
-          console.log("stop at " + i);
-          this.timeoutHandles[i] = setTimeout(function() {
-              $("#delay").val(0);
-              $("#jitter").val(0);
-              $("#loss").val(0);
-              JT.ws.set_netem();
-              runningProgram.stop();
-            },
-            i * 1000
-          );
-        } else {
-          this.timeoutHandles[i] = setTimeout(function(t, d, j, l) {
-              console.log(Date.now() + " t = " + t + ", d: " + d + ", j: " + j + ", l:" + l);
-              $("#delay").val(d);
-              $("#jitter").val(j);
-              $("#loss").val(l);
-              JT.ws.set_netem();
-            },
-            i*1000,
-            i,
-            runningProgram.impairments[i].delay,
-            runningProgram.impairments[i].jitter,
-            runningProgram.impairments[i].loss
-          );
-        }
-      }
     };
 
-    this.stop = function() {
-      console.log("stopping program: " + this.id);
-      if (this != runningProgram) {
-        return runningProgram.stop();
-      }
-      for (var th in this.timeoutHandles) {
-        clearTimeout(this.timeoutHandles[th]);
-      }
-      JT.ws.clear_netem();
+    this.setStopped = function() {
       runningProgram = null;
       $("#"+this.id+"_play").css('color','#333');
       $("#delay").prop('readonly', false);
@@ -88,6 +85,7 @@ JT = (function (my) {
   my.programsModule.templateProgram = JSON.stringify(
     {
       name: "templateProgram",
+      ifaces: [],
       traps: [],
       impairments: {
         0: { delay: 0,  jitter: 0, loss: 0,   trapid: 0},
@@ -151,18 +149,48 @@ JT = (function (my) {
     $('#add_program_modal button').get(1).click();
   };
 
-  my.programsModule.processNetemMsg = function (params) {
-    if (params.delay === -1 && params.jitter === -1 && params.loss === -1) {
+  /* last netem_params received, per direction */
+  var netemParams = {};
+
+  var showNetemParams = function (params) {
+    if (!params
+        || (params.delay === -1 && params.jitter === -1 && params.loss === -1)) {
       $("#netem_status").html("No active impairment on device. Set parameters to activate.");
       $("#delay").val("0");
       $("#jitter").val("0");
       $("#loss").val("0");
+      $("#dist").val("");
+      $("#flow_src").val("");
+      $("#flow_dst").val("");
+      $.each(JT.ws.netemExtFields, function (ix, f) {
+        if (f.key !== 'dir') {
+          $("#" + f.key).val("0");
+        }
+      });
     } else {
       $("#delay").val(params.delay);
       $("#jitter").val(params.jitter);
-      /* params.loss is a 10th of a percent (integer). convert it to float */
-      $("#loss").val(0.1 * params.loss);
+      /* params.loss is in parts per million (integer). convert to percent */
+      $("#loss").val(params.loss / 10000);
+      $("#dist").val(params.dist || "");
+      $("#flow_src").val(params.flow_src || "");
+      $("#flow_dst").val(params.flow_dst || "");
+      $.each(JT.ws.netemExtFields, function (ix, f) {
+        var v = params[f.key] || 0;
+        if (f.key !== 'dir') {
+          $("#" + f.key).val(f.pct ? v / 10000 : v);
+        }
+      });
+    }
+  };
+
+  my.programsModule.processNetemMsg = function (params) {
+    var dir = params.dir || 0;
+    netemParams[dir] = params;
+    if (String(dir) !== $("#dir").val()) {
+      return;
     }
+    showNetemParams(params);
     if (runningProgram) {
       $("#netem_status").html("Program Running");
     } else {
@@ -171,5 +199,74 @@ JT = (function (my) {
     }
   };
 
+  my.programsModule.selectDirection = function () {
+    showNetemParams(netemParams[$("#dir").val()]);
+  };
+
+  my.programsModule.clearFlow = function () {
+    $("#flow_src").val("");
+    $("#flow_dst").val("");
+    $("#flow_sport").val("0");
+    $("#flow_dport").val("0");
+    $("#flow_proto").val("0");
+  };
+
+  /* Fill the flow selector from a toptalk flow key,
+   * ie. interval/src/sport/dst/dport/proto/tclass */
+  my.programsModule.selectFlow = function (fkey) {
+    var protos = { "TCP": 6, "UDP": 17, "ICMP": 1, "ICMP6": 58 };
+    var a = fkey.split('/');
+    $("#flow_src").val(a[1]);
+    $("#flow_sport").val(a[2]);
+    $("#flow_dst").val(a[3]);
+    $("#flow_dport").val(a[4]);
+    $("#flow_proto").val(protos[a[5]] || 0);
+    $("#netem_status").html("Flow selected. Set parameters to impair it.");
+  };
+
+  my.programsModule.processProgramStatusMsg = function (params) {
+    console.log("program " + params.name + " step " + (params.step + 1) + "/"
+                + params.count + " late: " + params.late_us + "us"
+                + " apply: " + params.apply_us + "us");
+    if (runningProgram && !params.running) {
+      runningProgram.setStopped();
+    } else if (runningProgram) {
+      $("#netem_status").html("Program Running: step " + (params.step + 1)
+                              + "/" + params.count);
+    }
+  };
+
+  var fmtMs = function (us) {
+    return (us / 1000.0).toFixed(2) + "ms";
+  };
+
+  var fmtPct = function (ppm) {
+    return (ppm / 10000.0).toFixed(2) + "%";
+  };
+
+  my.programsModule.processVerifyResultMsg = function (params) {
+    var probes = params.probes_sent > 0;
+    $("#verify_table").show();
+    $("#verify_cfg_delay").html(fmtMs(params.cfg_delay_us));
+    $("#verify_cfg_jitter").html(fmtMs(params.cfg_jitter_us));
+    $("#verify_cfg_loss").html(fmtPct(params.cfg_loss_ppm));
+    $("#verify_delay").html(probes ? fmtMs(params.delay_mean_us)
+                            + " (" + fmtMs(params.delay_min_us) + " - "
+                            + fmtMs(params.delay_max_us) + ")" : "-");
+    $("#verify_jitter").html(probes ? fmtMs(params.jitter_us) : "-");
+    $("#verify_loss").html(probes ? fmtPct(params.loss_ppm) + " ("
+                           + params.probes_lost + "/" + params.probes_sent
+                           + " probes)" : "-");
+    $("#verify_pctl").html(probes ? "p1/5/25/50/75/95/99: "
+                           + params.delay_pctl_us.map(fmtMs).join(" / ")
+                           : "-");
+    $("#verify_qdisc").html(params.qd_packets + " pkts, "
+                            + params.qd_drops + " drops, "
+                            + params.qd_requeues + " requeues, "
+                            + params.qd_overlimits + " overlimits, max backlog "
+                            + params.qd_backlog_max + " bytes / "
+                            + params.qd_qlen_max + " pkts");
+  };
+
   return my;
 }(JT));
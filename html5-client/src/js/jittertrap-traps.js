@@ -266,5 +266,43 @@ JT = (function (my) {
     }
   };
 
+  /* The changes that the server found by itself, newest first. */
+  var anomalyRows = 10;
+
+  var anomalyNames = {
+    rx: "Rx Bitrate",
+    tx: "Tx Bitrate",
+    rx_pgap: "Max Rx Packet Spacing",
+    tx_pgap: "Max Tx Packet Spacing"
+  };
+
+  /* in the units of the traps: Kbps and ms */
+  var anomalyValue = function (series, v) {
+    if (series === "rx" || series === "tx") {
+      return (v * 8 / 1000).toFixed(0) + " Kbps";
+    }
+    return v + " ms";
+  };
+
+  my.trapModule.addAnomaly = function (p) {
+    var onset = new Date(p.onset.tv_sec * 1E3 + p.onset.tv_nsec / 1E6);
+    var tbody = $("#anomalies_table tbody");
+    var row;
+
+    if (p.iface !== $("#dev_select").val()) {
+      return;
+    }
+
+    row = $("<tr>");
+    row.append($("<td>").text(onset.toLocaleTimeString() + "." +
+                              ("00" + onset.getMilliseconds()).slice(-3)));
+    row.append($("<td>").text(p.ival_ns / 1E6 + "ms"));
+    row.append($("<td>").text(anomalyNames[p.series] || p.series));
+    row.append($("<td>").text(anomalyValue(p.series, p.baseline) + " \u2192 " +
+                              anomalyValue(p.series, p.level)));
+    tbody.prepend(row);
+    tbody.children().slice(anomalyRows).remove();
+  };
+
   return my;
 }(JT));
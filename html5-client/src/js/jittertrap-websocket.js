@@ -7,30 +7,19 @@ JT = (function (my) {
 
   my.ws = {};
 
-  var selectedIface = {}; // set on dev_select message
-
   /* the websocket object, see my.ws.init() */
   var sock = {};
 
   /**
    * Websocket Callback Functions
-   * i.e. Referred to in websocket.onmessage
+   * i.e. for the messages passed back by the decoding worker. The stats
+   * and toptalk messages are handled entirely by the worker.
    */
 
-  var handleMsgUpdateStats = function (params) {
-    JT.core.processDataMsg(params.s, params.ival_ns);
-  };
-
-  var handleMsgToptalk = function (params) {
-    JT.core.processTopTalkMsg(params);
-  };
-
   var handleMsgDevSelect = function(params) {
     var iface = params.iface;
     console.log("iface: " + iface);
     $('#dev_select').val(iface);
-    selectedIface = $('#dev_select').val();
-    JT.core.clearAllSeries();
     JT.charts.resetChart();
   };
 
@@ -49,13 +38,20 @@ JT = (function (my) {
     JT.programsModule.processNetemMsg(params);
   };
 
+  var handleMsgProgramStatus = function(params) {
+    JT.programsModule.processProgramStatusMsg(params);
+  };
+
+  var handleMsgVerifyResult = function(params) {
+    JT.programsModule.processVerifyResultMsg(params);
+  };
+
   var handleMsgSamplePeriod = function(params) {
     var period = params.period;
     my.core.samplePeriod(period);
     $("#jt-measure-sample-period").html(period / 1000.0 + "ms");
     console.log("sample period: " + period);
     my.charts.setUpdatePeriod();
-    JT.core.clearAllSeries();
     JT.charts.resetChart();
   };
 
@@ -70,29 +66,133 @@ JT = (function (my) {
     sock.send(msg);
   };
 
+  /* The optional netem parameters. The form input ids match the message
+   * keys. Percentages (pct) are sent as integer parts per million. */
+  var netemExtFields = [
+    { key: 'delay_corr', pct: true },
+    { key: 'loss_corr', pct: true },
+    { key: 'ge_p', pct: true },
+    { key: 'ge_r', pct: true },
+    { key: 'ge_loss_bad', pct: true },
+    { key: 'ge_loss_good', pct: true },
+    { key: 'dup', pct: true },
+    { key: 'dup_corr', pct: true },
+    { key: 'reorder', pct: true },
+    { key: 'reorder_corr', pct: true },
+    { key: 'gap' },
+    { key: 'corrupt', pct: true },
+    { key: 'corrupt_corr', pct: true },
+    { key: 'limit' },
+    { key: 'rate' },
+    { key: 'rate_overhead' },
+    { key: 'slot_min' },
+    { key: 'slot_max' },
+    { key: 'slot_packets' },
+    { key: 'slot_bytes' },
+    { key: 'dir' },
+    { key: 'flow_sport' },
+    { key: 'flow_dport' },
+    { key: 'flow_proto' }
+  ];
+
+  var pctToPPM = function(pct) {
+    return parseInt(Math.round(10000 * (pct || 0)));
+  };
+
   var set_netem = function() {
-    var msg = JSON.stringify(
-      {'msg': 'set_netem',
-       'p': {
-         'dev': $("#dev_select").val(),
-         'delay': parseInt($("#delay").val()),
-         'jitter': parseInt($("#jitter").val()),
-         /* convert the float to an integer representing 10ths of percent. */
-         'loss': parseInt(Math.round(10 * $("#loss").val()))
-       }
-      });
+    var p = {
+      'dev': $("#dev_select").val(),
+      'delay': parseInt($("#delay").val()),
+      'jitter': parseInt($("#jitter").val()),
+      'loss': pctToPPM($("#loss").val()),
+      'dist': $("#dist").val() || "",
+      'flow_src': $("#flow_src").val().trim(),
+      'flow_dst': $("#flow_dst").val().trim()
+    };
+    $.each(netemExtFields, function (ix, f) {
+      var v = $("#" + f.key).val();
+      p[f.key] = f.pct ? pctToPPM(v) : (parseInt(v) || 0);
+    });
+    var msg = JSON.stringify({'msg': 'set_netem', 'p': p});
     sock.send(msg);
     return false;
   };
 
+  /* clears the impairment, for the selected direction and flow */
   var clear_netem = function() {
     $("#delay").val(0);
     $("#jitter").val(0);
     $("#loss").val(0);
+    $("#dist").val("");
+    $.each(netemExtFields, function (ix, f) {
+      if (f.key.indexOf('flow_') !== 0 && f.key !== 'dir') {
+        $("#" + f.key).val(0);
+      }
+    });
     set_netem();
     return false;
   };
 
+  var set_program = function(name, steps, ifaces) {
+    var msg = JSON.stringify(
+      {'msg': 'set_program',
+       'p': {
+         'dev': $("#dev_select").val(),
+         'name': name,
+         'ifaces': ifaces || [],
+         'steps': steps
+       }
+      });
+    sock.send(msg);
+    return false;
+  };
+
+  var stop_program = function() {
+    set_program("", []);
+    return false;
+  };
+
+  /* Probes are optional; without a target only qdisc stats are reported. */
+  var set_verify = function() {
+    var msg = JSON.stringify(
+      {'msg': 'verify',
+       'p': {
+         'dev': $("#dev_select").val(),
+         'enable': $("#verify_enable").is(':checked') ? 1 : 0,
+         'probe_dst': $("#verify_probe_dst").val(),
+         'probe_port': parseInt($("#verify_probe_port").val(), 10) || 0,
+         'probe_rate': parseInt($("#verify_probe_rate").val(), 10) || 0
+       }
+      });
+    sock.send(msg);
+    return false;
+  };
+
+  /* the last flow control request, re-sent on (re)connection */
+  var updateRate = null;
+
+  /* Ask the server for the stats and toptalk intervals that are shown (in
+   * ns; null for all) at no more than maxRate updates per second each (0
+   * for no limit), and the named rollups, if any. Everything else is
+   * skipped for this session.
+   * Toptalk is requested by flow id, the worker keeps the dictionary. */
+  var set_update_rate = function(maxRate, statsIvals, ttIvals, rollups) {
+    updateRate = { 'max_rate': maxRate, 'flow_ids': 1 };
+    if (statsIvals) {
+      updateRate.stats = statsIvals;
+    }
+    if (ttIvals) {
+      updateRate.toptalk = ttIvals;
+    }
+    if (rollups && rollups.length) {
+      updateRate.rollups = rollups;
+    }
+    if (sock.readyState === WebSocket.OPEN) {
+      sock.send(JSON.stringify({'msg': 'update_rate', 'p': updateRate}));
+    }
+    return false;
+  };
+
   my.ws.init = function(uri) {
     // Initialize WebSocket
     sock = new WebSocket(uri, "jittertrap");
@@ -100,6 +200,9 @@ JT = (function (my) {
     sock.onopen = function(evt) {
       var msg = JSON.stringify({'msg': 'hello'});
       sock.send(msg);
+      if (updateRate) {
+        sock.send(JSON.stringify({'msg': 'update_rate', 'p': updateRate}));
+      }
     };
 
     sock.onclose = function(evt) {
@@ -120,44 +223,47 @@ JT = (function (my) {
     };
 
     sock.onmessage = function(evt) {
-      var msg;
-      try {
-        msg = JSON.parse(evt.data);
-      }
-      catch (err) {
-        console.log("Error: " + err.message);
-      }
-
-      if (!msg || !msg.msg) {
-        console.log("unrecognised message: " + evt.data);
-        return;
-      }
-      var msgType = msg.msg;
-
-      if ((msgType === "stats") && msg.p.iface === selectedIface) {
-        handleMsgUpdateStats(msg.p);
-      } else if (msgType === "toptalk") {
-        handleMsgToptalk(msg.p);
-      } else if (msgType === "dev_select") {
-        handleMsgDevSelect(msg.p);
-      } else if (msgType === "iface_list") {
-        handleMsgIfaces(msg.p);
-      } else if (msgType === "netem_params") {
-        handleMsgNetemParams(msg.p);
-      } else if (msgType === "sample_period") {
-        handleMsgSamplePeriod(msg.p);
-      } else {
-        console.log("unhandled message: " + evt.data);
-      }
+      JT.core.decodeMsg(evt.data);
     };
   };
 
+  /* a decoded message, from the worker */
+  var dispatch = function(msg) {
+    var msgType = msg.msg;
+
+    if (msgType === "dev_select") {
+      handleMsgDevSelect(msg.p);
+    } else if (msgType === "iface_list") {
+      handleMsgIfaces(msg.p);
+    } else if (msgType === "netem_params") {
+      handleMsgNetemParams(msg.p);
+    } else if (msgType === "sample_period") {
+      handleMsgSamplePeriod(msg.p);
+    } else if (msgType === "program_status") {
+      handleMsgProgramStatus(msg.p);
+    } else if (msgType === "verify_result") {
+      handleMsgVerifyResult(msg.p);
+    } else if (msgType === "rollup") {
+      JT.charts.toptalk.rollupTable.update(msg.p);
+    } else if (msgType === "anomaly") {
+      JT.trapModule.addAnomaly(msg.p);
+    } else {
+      console.log("unhandled message: " + JSON.stringify(msg));
+    }
+  };
+
   /**
    * Websocket Sending Functions
    */
   my.ws.dev_select = dev_select;
   my.ws.set_netem = set_netem;
   my.ws.clear_netem = clear_netem;
+  my.ws.netemExtFields = netemExtFields;
+  my.ws.set_program = set_program;
+  my.ws.stop_program = stop_program;
+  my.ws.set_verify = set_verify;
+  my.ws.set_update_rate = set_update_rate;
+  my.ws.dispatch = dispatch;
 
   return my;
 }(JT));
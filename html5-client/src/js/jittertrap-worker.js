@@ -0,0 +1,624 @@
+/* jittertrap-worker.js */
+
+/* Runs in a Web Worker, off the main thread. It decodes the websocket
+ * messages, keeps the sample series and flow tables, computes the
+ * statistics and posts ready-to-draw frames back to the main thread.
+ *
+ * Frame buffers are transferred, not copied. The main thread hands each
+ * one back with a 'recycle' command once it has been replaced, so that the
+ * steady state allocates nothing.
+ *
+ * Commands from the main thread:
+ *   {cmd:'ws', data:<websocket text>}
+ *   {cmd:'config', samplePeriod, chartPeriod, series, sampleCount}
+ *   {cmd:'clear'}
+ *   {cmd:'recycle', buffers:[ArrayBuffer...]}
+ *
+ * Messages to the main thread:
+ *   {type:'msg', msg:<decoded message>}   anything not handled here
+ *   {type:'series', ...}                  see postSeriesFrame()
+ *   {type:'toptalk', ...}                 see postToptalkFrame()
+ */
+
+/* global self */
+
+(function () {
+  'use strict';
+
+  /* microseconds, from the server's sample_period message */
+  var samplePeriod = 1000;
+
+  /* milliseconds, the time scale shown on the charts */
+  var chartPeriod = 100;
+
+  /* number of samples to keep for a complete chart series. */
+  var sampleCount = 200;
+
+  var selectedSeriesName = "rxRate";
+  var selectedIface = null;
+
+  /* while a backfill is being replayed, frames are posted once, at the end */
+  var backfilling = false;
+
+  var timeScaleTable = { "5ms": 5, "10ms": 10, "20ms": 20, "50ms": 50,
+                         "100ms": 100, "200ms": 200, "500ms": 500,
+                         "1000ms": 1000 };
+
+  /***** Buffer pool *****/
+
+  /* spare Float64Arrays, by length */
+  var pool = {};
+
+  var takeBuffer = function (len) {
+    var spares = pool[len];
+    if (spares && spares.length) {
+      return spares.pop();
+    }
+    return new Float64Array(len);
+  };
+
+  var recycle = function (buffers) {
+    for (var i = 0; i < buffers.length; i++) {
+      var b = new Float64Array(buffers[i]);
+      if (!b.length) {
+        continue;
+      }
+      if (!pool[b.length]) {
+        pool[b.length] = [];
+      }
+      if (pool[b.length].length < 8) {
+        pool[b.length].push(b);
+      }
+    }
+  };
+
+  /***** Sample rings *****/
+
+  /* A fixed capacity ring of doubles; the newest value overwrites the
+   * oldest once full. */
+  var Ring = function (capacity) {
+    this.data = new Float64Array(capacity);
+    this.head = 0;
+    this.size = 0;
+  };
+
+  Ring.prototype.push = function (v) {
+    this.data[this.head] = v;
+    this.head = (this.head + 1) % this.data.length;
+    if (this.size < this.data.length) {
+      this.size++;
+    }
+  };
+
+  /* the i'th oldest value */
+  Ring.prototype.get = function (i) {
+    var idx = this.head - this.size + i;
+    if (idx < 0) {
+      idx += this.data.length;
+    }
+    return this.data[idx];
+  };
+
+  Ring.prototype.last = function () {
+    return this.get(this.size - 1);
+  };
+
+  Ring.prototype.clear = function () {
+    this.head = 0;
+    this.size = 0;
+  };
+
+  /* a new ring of the given capacity, holding the newest values of this */
+  Ring.prototype.resized = function (capacity) {
+    var r = new Ring(capacity);
+    var n = Math.min(this.size, capacity);
+    for (var i = this.size - n; i < this.size; i++) {
+      r.push(this.get(i));
+    }
+    return r;
+  };
+
+  /* copy the values, oldest first, into dst */
+  Ring.prototype.copyTo = function (dst) {
+    for (var i = 0; i < this.size; i++) {
+      dst[i] = this.get(i);
+    }
+  };
+
+  /***** Series *****/
+
+  /* count must be bytes, samplePeriod is microseconds */
+  var byteCountToKbpsRate = function (count) {
+    return count / samplePeriod * 8000.0 * (samplePeriod / 1000);
+  };
+
+  var packetDeltaToRate = function (count) {
+    return count * (1000000.0 / samplePeriod) * (samplePeriod / 1000);
+  };
+
+  var Series = function (name, rateFormatter) {
+    this.name = name;
+    this.rateFormatter = rateFormatter;
+    this.stats = {min: 0, max: 0, median: 0, mean: 0, cur: 0,
+                  maxPG: 0, meanPG: 0};
+    this.samples = {};
+    this.pgMean = {};
+    this.pgMin = {};
+    this.pgMax = {};
+    for (var ts in timeScaleTable) {
+      this.samples[ts] = new Ring(sampleCount);
+      this.pgMean[ts] = new Ring(sampleCount);
+      this.pgMin[ts] = new Ring(sampleCount);
+      this.pgMax[ts] = new Ring(sampleCount);
+    }
+  };
+
+  var sBin = {};  // a container (Bin) for series.
+  sBin.rxRate = new Series("rxRate", byteCountToKbpsRate);
+  sBin.txRate = new Series("txRate", byteCountToKbpsRate);
+  sBin.txPacketRate = new Series("txPacketRate", packetDeltaToRate);
+  sBin.rxPacketRate = new Series("rxPacketRate", packetDeltaToRate);
+
+  var seriesNames = ["rxRate", "txRate", "rxPacketRate", "txPacketRate"];
+
+  var forEachRing = function (s, fn) {
+    for (var ts in timeScaleTable) {
+      s.samples[ts] = fn(s.samples[ts]);
+      s.pgMean[ts] = fn(s.pgMean[ts]);
+      s.pgMin[ts] = fn(s.pgMin[ts]);
+      s.pgMax[ts] = fn(s.pgMax[ts]);
+    }
+  };
+
+  var resizeSeries = function (len) {
+    if (len === sampleCount) {
+      return;
+    }
+    sampleCount = len;
+    clearFlows();
+    for (var i = 0; i < seriesNames.length; i++) {
+      forEachRing(sBin[seriesNames[i]], function (r) {
+        return r.resized(len);
+      });
+    }
+  };
+
+  var clearSeries = function () {
+    for (var i = 0; i < seriesNames.length; i++) {
+      forEachRing(sBin[seriesNames[i]], function (r) {
+        r.clear();
+        return r;
+      });
+    }
+  };
+
+  /* reused for the order statistics */
+  var sortScratch = new Float64Array(0);
+
+  var updateStats = function (series, timeScale) {
+    var samples = series.samples[timeScale];
+    var n = samples.size;
+    var sum = 0;
+
+    if (sortScratch.length !== n) {
+      sortScratch = new Float64Array(n);
+    }
+    samples.copyTo(sortScratch);
+    for (var i = 0; i < n; i++) {
+      sum += sortScratch[i];
+    }
+    sortScratch.sort();
+
+    series.stats.cur = samples.last();
+    series.stats.min = sortScratch[0];
+    series.stats.max = sortScratch[n - 1];
+    series.stats.median = sortScratch[Math.floor(n / 2.0)];
+    series.stats.mean = sum / n;
+    series.stats.maxPG = series.pgMax[timeScale].last();
+    series.stats.meanPG = series.pgMean[timeScale].last();
+  };
+
+  var ringFrame = function (ring) {
+    var buf = takeBuffer(sampleCount);
+    ring.copyTo(buf);
+    return buf;
+  };
+
+  /* When the newest sample was read, in ms since the epoch by the server's
+   * clock, and how long it took to reach each stage of the server's
+   * pipeline (compute, dequeue, pack), in us. */
+  var sampleTime = 0;
+  var sampleTrace = null;
+
+  /* The selected series and its packet gaps, oldest first, plus the
+   * current statistics of all series for the measurements and traps. */
+  var postSeriesFrame = function (timeScale) {
+    var s = sBin[selectedSeriesName];
+    var stats = {};
+
+    for (var i = 0; i < seriesNames.length; i++) {
+      stats[seriesNames[i]] = sBin[seriesNames[i]].stats;
+    }
+
+    var frame = {
+      type: 'series',
+      series: selectedSeriesName,
+      sampleTime: sampleTime,
+      trace: sampleTrace,
+      n: s.samples[timeScale].size,
+      samples: ringFrame(s.samples[timeScale]),
+      pgMean: ringFrame(s.pgMean[timeScale]),
+      pgMin: ringFrame(s.pgMin[timeScale]),
+      pgMax: ringFrame(s.pgMax[timeScale]),
+      stats: stats
+    };
+    self.postMessage(frame, [frame.samples.buffer, frame.pgMean.buffer,
+                             frame.pgMin.buffer, frame.pgMax.buffer]);
+  };
+
+  var pushSeries = function (series, yVal, pgMin, pgMax, pgMean, timeScale) {
+    series.samples[timeScale].push(series.rateFormatter(yVal / 1000.0));
+    series.pgMin[timeScale].push(pgMin);
+    series.pgMax[timeScale].push(pgMax);
+    series.pgMean[timeScale].push(pgMean / 1000.0);
+  };
+
+  var updateData = function (d, timeScale) {
+    pushSeries(sBin.txRate, d.tx,
+               d.min_tx_pgap, d.max_tx_pgap, d.mean_tx_pgap, timeScale);
+    pushSeries(sBin.rxRate, d.rx,
+               d.min_rx_pgap, d.max_rx_pgap, d.mean_rx_pgap, timeScale);
+    pushSeries(sBin.txPacketRate, d.txP,
+               d.min_tx_pgap, d.max_tx_pgap, d.mean_tx_pgap, timeScale);
+    pushSeries(sBin.rxPacketRate, d.rxP,
+               d.min_rx_pgap, d.max_rx_pgap, d.mean_rx_pgap, timeScale);
+
+    if (backfilling || chartPeriod !== timeScaleTable[timeScale]) {
+      return;
+    }
+
+    for (var i = 0; i < seriesNames.length; i++) {
+      updateStats(sBin[seriesNames[i]], timeScale);
+    }
+    postSeriesFrame(timeScale);
+  };
+
+  var processDataMsg = function (stats, interval) {
+    var timeScale = (interval / 1E6) + "ms";
+
+    if (!timeScaleTable[timeScale]) {
+      console.log("unknown interval: " + interval);
+      return;
+    }
+    updateData(stats, timeScale);
+  };
+
+  /***** Top Flows follows *****/
+
+  /* Per interval: a ring of slice timestamps and, for each flow, a ring of
+   * byte counts in the same slots, plus totals and a time-to-live. */
+  var flowTables = {};
+
+  /* must match JT.charts.toptalk.maxFlows, it sets the frame layout */
+  var maxFlows = 10;
+
+  /* The server's flow ids (toptalk_ids messages) to their tuple, as
+   * announced in flow_dict messages. This belongs to the connection, so it
+   * survives clearFlows(). */
+  var flowDict = {};
+
+  /* discard all previous flow data, like when changing capture interface */
+  var clearFlows = function () {
+    flowTables = {};
+  };
+
+  var getFlowTuple = function (flow) {
+    return flow.src + '/' + flow.sport + '/' + flow.dst + '/' + flow.dport +
+           '/' + flow.proto + '/' + flow.tclass;
+  };
+
+  var getFlowKey = function (interval, flow) {
+    return interval + '/' + (flow.tuple || getFlowTuple(flow));
+  };
+
+  var processFlowDictMsg = function (msg) {
+    for (var i = 0; i < msg.flows.length; i++) {
+      flowDict[msg.flows[i].id] = getFlowTuple(msg.flows[i]);
+    }
+  };
+
+  /* toptalk_ids refers to flows by id: [[id, bytes, packets, sizes], ...],
+   * where the sizes are optional. Turn it into a toptalk message. */
+  var idsToTopTalkMsg = function (msg) {
+    var flows = [];
+    for (var i = 0; i < msg.f.length; i++) {
+      var tuple = flowDict[msg.f[i][0]];
+      if (tuple === undefined) {
+        /* never announced; can't happen unless messages were lost */
+        continue;
+      }
+      flows.push({ tuple: tuple, bytes: msg.f[i][1], packets: msg.f[i][2],
+                   sizes: msg.f[i][3] || null });
+    }
+    msg.flows = flows;
+    return msg;
+  };
+
+  var FlowTable = function () {
+    this.ts = new Ring(sampleCount);
+    this.flows = {};
+    this.rank = []; /* flow keys, by descending total bytes */
+    this.distinct = null; /* estimates of the last slice, if any */
+    this.pgaps = null; /* the interface's packet gaps in the last slice */
+    this.psizes = null; /* and its packet lengths */
+  };
+
+  var msgToFlows = function (msg, timestamp) {
+    var interval = msg.interval_ns;
+    var fcnt = msg.flows.length;
+    var fkey;
+
+    /* we haven't seen this interval before, initialise it. */
+    if (!flowTables[interval]) {
+      flowTables[interval] = new FlowTable();
+    }
+    var table = flowTables[interval];
+    var slot = table.ts.head;
+
+    table.ts.push(timestamp);
+    table.distinct = msg.distinct;
+    table.pgaps = msg.pgaps;
+    table.psizes = msg.psizes;
+
+    /* flows absent from this message had no bytes in this slice */
+    for (fkey in table.flows) {
+      table.flows[fkey].bytes[slot] = 0;
+    }
+
+    for (var i = 0; i < fcnt; i++) {
+      var f = msg.flows[i];
+      fkey = getFlowKey(interval, f);
+
+      /* create new flow entry if we haven't seen it before */
+      var flow = table.flows[fkey];
+      if (!flow) {
+        flow = table.flows[fkey] = {
+          bytes: new Float64Array(table.ts.data.length),
+          ttl: sampleCount,
+          tbytes: 0,
+          tpackets: 0
+        };
+        table.rank.push(fkey);
+      }
+
+      flow.bytes[slot] = f.bytes;
+
+      /* reset the time-to-live to the chart window length (in samples),
+       * so that it can be removed when it ages beyond the window. */
+      flow.ttl = sampleCount;
+      flow.tbytes += f.bytes;
+      flow.tpackets += f.packets;
+    }
+  };
+
+  /* reduce the time-to-live for the flows, expire those with no samples
+   * within the visible chart window and re-rank the rest */
+  var expireOldFlowsAndUpdateRank = function (interval) {
+    var table = flowTables[interval];
+    var flows = table.flows;
+    var rank = table.rank;
+    var kept = 0;
+
+    for (var i = 0; i < rank.length; i++) {
+      var flow = flows[rank[i]];
+      flow.ttl -= 1;
+      if (flow.ttl <= 0) {
+        delete flows[rank[i]];
+      } else {
+        rank[kept++] = rank[i];
+      }
+    }
+    rank.length = kept;
+
+    /* descending order */
+    rank.sort(function (a, b) {
+      return flows[b].tbytes - flows[a].tbytes;
+    });
+  };
+
+  /* The top flows of the interval over the chart window: ts[i] is the
+   * time of slice i, bytes[j * capacity + i] is flow fkeys[j] in slice i */
+  var postToptalkFrame = function (interval) {
+    var table = flowTables[interval];
+    var n = table.ts.size;
+    var cap = table.ts.data.length;
+    var fcount = Math.min(table.rank.length, maxFlows);
+    var ts = takeBuffer(cap);
+    var bytes = takeBuffer(cap * maxFlows);
+    var fkeys = [];
+    var tbytes = [];
+
+    table.ts.copyTo(ts);
+
+    for (var j = 0; j < fcount; j++) {
+      var fkey = table.rank[j];
+      var flow = table.flows[fkey];
+      var row = j * cap;
+      var idx = table.ts.head - n;
+      if (idx < 0) {
+        idx += cap;
+      }
+      for (var i = 0; i < n; i++) {
+        bytes[row + i] = flow.bytes[idx];
+        idx = (idx + 1) % cap;
+      }
+      fkeys.push(fkey);
+      tbytes.push(flow.tbytes);
+    }
+
+    var frame = {
+      type: 'toptalk',
+      n: n,
+      capacity: cap,
+      ts: ts,
+      bytes: bytes,
+      fkeys: fkeys,
+      tbytes: tbytes,
+      distinct: table.distinct || null,
+      pgaps: table.pgaps || null,
+      psizes: table.psizes || null
+    };
+    self.postMessage(frame, [ts.buffer, bytes.buffer]);
+  };
+
+  var processTopTalkMsg = function (msg) {
+    var interval = msg.interval_ns;
+    var tstamp = msg.timestamp.tv_sec + msg.timestamp.tv_nsec / 1E9;
+
+    if (!timeScaleTable[(interval / 1E6) + "ms"]) {
+      console.log("unknown interval: " + interval);
+      return;
+    }
+    console.assert(!(Number.isNaN(tstamp)));
+
+    msgToFlows(msg, tstamp);
+    expireOldFlowsAndUpdateRank(interval);
+
+    // interval is in ns, chartPeriod in ms.
+    if (!backfilling && chartPeriod === interval / 1E6) {
+      postToptalkFrame(interval);
+    }
+  };
+
+  /***** Backfill *****/
+
+  var backfillFields = [ "rx", "tx", "rxP", "txP",
+                         "min_rx_pgap", "max_rx_pgap", "mean_rx_pgap",
+                         "min_tx_pgap", "max_tx_pgap", "mean_tx_pgap" ];
+
+  /* What the server recorded before this connection, oldest first: the
+   * stats as a column per field, and the toptalk slices as toptalk_ids
+   * messages. Replay it as if it had arrived one message at a time, then
+   * post a frame for the charts that are shown. */
+  var processBackfillMsg = function (msg) {
+    var i, j, k;
+
+    backfilling = true;
+    if (msg.iface === selectedIface) {
+      for (i = 0; i < msg.stats.length; i++) {
+        var ival = msg.stats[i];
+        for (j = 0; j < ival.rx.length; j++) {
+          var d = {};
+          for (k = 0; k < backfillFields.length; k++) {
+            d[backfillFields[k]] = ival[backfillFields[k]][j];
+          }
+          processDataMsg(d, ival.ival_ns);
+        }
+      }
+    }
+    for (i = 0; i < msg.toptalk.length; i++) {
+      processTopTalkMsg(idsToTopTalkMsg(msg.toptalk[i]));
+    }
+    backfilling = false;
+
+    var timeScale = chartPeriod + "ms";
+    if (sBin[selectedSeriesName].samples[timeScale].size) {
+      for (i = 0; i < seriesNames.length; i++) {
+        updateStats(sBin[seriesNames[i]], timeScale);
+      }
+      postSeriesFrame(timeScale);
+    }
+    if (flowTables[chartPeriod * 1E6]) {
+      postToptalkFrame(chartPeriod * 1E6);
+    }
+  };
+
+  /***** Message decoding *****/
+
+  var processWsMsg = function (data) {
+    var msg;
+    try {
+      msg = JSON.parse(data);
+    }
+    catch (err) {
+      console.log("Error: " + err.message);
+    }
+
+    if (!msg || !msg.msg) {
+      console.log("unrecognised message: " + data);
+      return;
+    }
+
+    switch (msg.msg) {
+      case "stats":
+        if (msg.p.iface === selectedIface) {
+          sampleTime = msg.p.t.tv_sec * 1E3 + msg.p.t.tv_nsec / 1E6;
+          sampleTrace = msg.p.trace || null;
+          processDataMsg(msg.p.s, msg.p.ival_ns);
+        }
+        return;
+      case "toptalk":
+        processTopTalkMsg(msg.p);
+        return;
+      case "toptalk_ids":
+        processTopTalkMsg(idsToTopTalkMsg(msg.p));
+        return;
+      case "flow_dict":
+        processFlowDictMsg(msg.p);
+        return;
+      case "backfill":
+        processBackfillMsg(msg.p);
+        return;
+      case "latency":
+        /* the server's stage histograms, for other tools; ours is
+         * measured per sample */
+        return;
+      case "dev_select":
+        /* everything queued behind this is for the new interface */
+        selectedIface = msg.p.iface;
+        clearSeries();
+        clearFlows();
+        break;
+      case "sample_period":
+        samplePeriod = msg.p.period;
+        clearSeries();
+        clearFlows();
+        break;
+    }
+    self.postMessage({type: 'msg', msg: msg});
+  };
+
+  self.onmessage = function (evt) {
+    var c = evt.data;
+
+    switch (c.cmd) {
+      case 'ws':
+        processWsMsg(c.data);
+        break;
+      case 'config':
+        if (c.samplePeriod) {
+          samplePeriod = c.samplePeriod;
+        }
+        if (c.chartPeriod) {
+          chartPeriod = Number(c.chartPeriod);
+        }
+        if (c.series) {
+          selectedSeriesName = c.series;
+        }
+        if (c.sampleCount) {
+          resizeSeries(c.sampleCount);
+        }
+        break;
+      case 'clear':
+        clearSeries();
+        clearFlows();
+        break;
+      case 'recycle':
+        recycle(c.buffers);
+        break;
+      default:
+        console.log("unknown worker command: " + c.cmd);
+    }
+  };
+}());
+/* End of jittertrap-worker.js */
@@ -19,9 +19,13 @@ $(document).ready(function() {
 
   // UI Event Handlers
   $("#chopts_series").bind('change', JT.charts.resetChart);
+  $("#chopts_groupby").bind('change', JT.charts.resetChart);
   $('#set_netem_button').bind('click', JT.ws.set_netem);
   $('#clear_netem_button').bind('click', JT.ws.clear_netem);
+  $('#clear_flow_button').bind('click', JT.programsModule.clearFlow);
+  $('#dir').bind('change', JT.programsModule.selectDirection);
   $('#dev_select').bind('change', JT.ws.dev_select);
+  $('#verifyForm').bind('change', JT.ws.set_verify);
   $('#chopts_stop_start').bind('click', JT.charts.toggleStopStartGraph);
 
   $("#chopts_chartPeriod").bind('change', function() {
@@ -50,6 +54,7 @@ $(document).ready(function() {
   $('#chartsForm').submit(function(e){ e.preventDefault(); });
   $('#devSelectForm').submit(function(e){ e.preventDefault(); });
   $('#impairmentsForm').submit(false);
+  $('#verifyForm').submit(false);
 
 
   // Changing traps from the list of traps in the trap modal
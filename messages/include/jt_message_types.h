@@ -7,14 +7,25 @@ typedef enum {
 	/* Server to Client messages */
 	JT_MSG_STATS_V1         = 50,
 	JT_MSG_TOPTALK_V1       = 60,
+	JT_MSG_TOPTALK_IDS_V1   = 61,
+	JT_MSG_FLOW_DICT_V1     = 62,
+	JT_MSG_ROLLUP_V1        = 63,
+	JT_MSG_BACKFILL_V1      = 64,
+	JT_MSG_LATENCY_V1       = 65,
+	JT_MSG_ANOMALY_V1       = 66,
 	JT_MSG_IFACE_LIST_V1    = 100,
 	JT_MSG_SELECT_IFACE_V1  = 110, // used in both s2c and c2s directions
 	JT_MSG_NETEM_PARAMS_V1  = 120,
 	JT_MSG_SAMPLE_PERIOD_V1 = 130,
+	JT_MSG_PROGRAM_STATUS_V1 = 135,
+	JT_MSG_VERIFY_RESULT_V1 = 136,
 
 	/* Client to Server messages */
 	JT_MSG_SET_NETEM_V1     = 140,
 	JT_MSG_HELLO_V1         = 141,
+	JT_MSG_SET_PROGRAM_V1   = 142,
+	JT_MSG_VERIFY_V1        = 143,
+	JT_MSG_UPDATE_RATE_V1   = 144,
 
 	/* terminator */
 	JT_MSG_END              = 255
@@ -23,10 +34,18 @@ typedef enum {
 static const int jt_msg_types_s2c[] = {
 	JT_MSG_STATS_V1,
 	JT_MSG_TOPTALK_V1,
+	JT_MSG_TOPTALK_IDS_V1,
+	JT_MSG_FLOW_DICT_V1,
+	JT_MSG_ROLLUP_V1,
+	JT_MSG_BACKFILL_V1,
+	JT_MSG_LATENCY_V1,
+	JT_MSG_ANOMALY_V1,
         JT_MSG_IFACE_LIST_V1,
         JT_MSG_SELECT_IFACE_V1,
 	JT_MSG_NETEM_PARAMS_V1,
         JT_MSG_SAMPLE_PERIOD_V1,
+	JT_MSG_PROGRAM_STATUS_V1,
+	JT_MSG_VERIFY_RESULT_V1,
 
 	/* terminator */
 	JT_MSG_END
@@ -36,6 +55,9 @@ static const int jt_msg_types_c2s[] = {
 	JT_MSG_SELECT_IFACE_V1,
 	JT_MSG_SET_NETEM_V1,
 	JT_MSG_HELLO_V1,
+	JT_MSG_SET_PROGRAM_V1,
+	JT_MSG_VERIFY_V1,
+	JT_MSG_UPDATE_RATE_V1,
 
 	/* terminator */
 	JT_MSG_END
@@ -14,6 +14,17 @@
 #include "jt_msg_sample_period.h"
 #include "jt_msg_set_netem.h"
 #include "jt_msg_hello.h"
+#include "jt_msg_set_program.h"
+#include "jt_msg_program_status.h"
+#include "jt_msg_verify.h"
+#include "jt_msg_verify_result.h"
+#include "jt_msg_update_rate.h"
+#include "jt_msg_toptalk_ids.h"
+#include "jt_msg_flow_dict.h"
+#include "jt_msg_rollup.h"
+#include "jt_msg_backfill.h"
+#include "jt_msg_latency.h"
+#include "jt_msg_anomaly.h"
 
 static const struct jt_msg_type jt_messages[] =
     {[JT_MSG_STATS_V1] = { .type = JT_MSG_STATS_V1,
@@ -82,6 +93,96 @@ static const struct jt_msg_type jt_messages[] =
 		           .free = jt_hello_free,
 		           .get_test_msg = jt_hello_test_msg_get },
 
+     [JT_MSG_SET_PROGRAM_V1] = { .type = JT_MSG_SET_PROGRAM_V1,
+		                 .key = "set_program",
+		                 .to_struct = jt_set_program_unpacker,
+		                 .to_json_string = jt_set_program_packer,
+		                 .print = jt_set_program_printer,
+		                 .free = jt_set_program_free,
+		                 .get_test_msg = jt_set_program_test_msg_get },
+
+     [JT_MSG_PROGRAM_STATUS_V1] = { .type = JT_MSG_PROGRAM_STATUS_V1,
+		                    .key = "program_status",
+		                    .to_struct = jt_program_status_unpacker,
+		                    .to_json_string = jt_program_status_packer,
+		                    .print = jt_program_status_printer,
+		                    .free = jt_program_status_free,
+		                    .get_test_msg =
+		                        jt_program_status_test_msg_get },
+
+     [JT_MSG_VERIFY_V1] = { .type = JT_MSG_VERIFY_V1,
+		            .key = "verify",
+		            .to_struct = jt_verify_unpacker,
+		            .to_json_string = jt_verify_packer,
+		            .print = jt_verify_printer,
+		            .free = jt_verify_free,
+		            .get_test_msg = jt_verify_test_msg_get },
+
+     [JT_MSG_VERIFY_RESULT_V1] = { .type = JT_MSG_VERIFY_RESULT_V1,
+		                   .key = "verify_result",
+		                   .to_struct = jt_verify_result_unpacker,
+		                   .to_json_string = jt_verify_result_packer,
+		                   .print = jt_verify_result_printer,
+		                   .free = jt_verify_result_free,
+		                   .get_test_msg =
+		                       jt_verify_result_test_msg_get },
+
+     [JT_MSG_UPDATE_RATE_V1] = { .type = JT_MSG_UPDATE_RATE_V1,
+		                 .key = "update_rate",
+		                 .to_struct = jt_update_rate_unpacker,
+		                 .to_json_string = jt_update_rate_packer,
+		                 .print = jt_update_rate_printer,
+		                 .free = jt_update_rate_free,
+		                 .get_test_msg = jt_update_rate_test_msg_get },
+
+     [JT_MSG_TOPTALK_IDS_V1] = { .type = JT_MSG_TOPTALK_IDS_V1,
+		                 .key = "toptalk_ids",
+		                 .to_struct = jt_toptalk_ids_unpacker,
+		                 .to_json_string = jt_toptalk_ids_packer,
+		                 .print = jt_toptalk_ids_printer,
+		                 .free = jt_toptalk_ids_free,
+		                 .get_test_msg = jt_toptalk_ids_test_msg_get },
+
+     [JT_MSG_FLOW_DICT_V1] = { .type = JT_MSG_FLOW_DICT_V1,
+		               .key = "flow_dict",
+		               .to_struct = jt_flow_dict_unpacker,
+		               .to_json_string = jt_flow_dict_packer,
+		               .print = jt_flow_dict_printer,
+		               .free = jt_flow_dict_free,
+		               .get_test_msg = jt_flow_dict_test_msg_get },
+
+     [JT_MSG_ROLLUP_V1] = { .type = JT_MSG_ROLLUP_V1,
+		            .key = "rollup",
+		            .to_struct = jt_rollup_unpacker,
+		            .to_json_string = jt_rollup_packer,
+		            .print = jt_rollup_printer,
+		            .free = jt_rollup_free,
+		            .get_test_msg = jt_rollup_test_msg_get },
+
+     [JT_MSG_BACKFILL_V1] = { .type = JT_MSG_BACKFILL_V1,
+		              .key = "backfill",
+		              .to_struct = jt_backfill_unpacker,
+		              .to_json_string = jt_backfill_packer,
+		              .print = jt_backfill_printer,
+		              .free = jt_backfill_free,
+		              .get_test_msg = jt_backfill_test_msg_get },
+
+     [JT_MSG_LATENCY_V1] = { .type = JT_MSG_LATENCY_V1,
+		             .key = "latency",
+		             .to_struct = jt_latency_unpacker,
+		             .to_json_string = jt_latency_packer,
+		             .print = jt_latency_printer,
+		             .free = jt_latency_free,
+		             .get_test_msg = jt_latency_test_msg_get },
+
+     [JT_MSG_ANOMALY_V1] = { .type = JT_MSG_ANOMALY_V1,
+		             .key = "anomaly",
+		             .to_struct = jt_anomaly_unpacker,
+		             .to_json_string = jt_anomaly_packer,
+		             .print = jt_anomaly_printer,
+		             .free = jt_anomaly_free,
+		             .get_test_msg = jt_anomaly_test_msg_get },
+
      [JT_MSG_END] = {
 	     .type = JT_MSG_END, .key = NULL, .to_struct = NULL, .print = NULL
      } };
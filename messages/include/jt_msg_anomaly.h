@@ -0,0 +1,38 @@
+#ifndef JT_MSG_ANOMALY_H
+#define JT_MSG_ANOMALY_H
+
+int jt_anomaly_packer(void *data, char **out);
+int jt_anomaly_unpacker(json_t *root, void **data);
+int jt_anomaly_printer(void *data, char *out, int len);
+int jt_anomaly_free(void *data);
+const char *jt_anomaly_test_msg_get(void);
+
+/* The series of the stats messages that the server watches for changes,
+ * in the same units: "rx" and "tx" are the mean rates, in bytes per
+ * second, and "rx_pgap" and "tx_pgap" the longest packet gaps, in ms. */
+enum jt_anomaly_series {
+	JT_ANOMALY_RX_RATE,
+	JT_ANOMALY_TX_RATE,
+	JT_ANOMALY_RX_PGAP,
+	JT_ANOMALY_TX_PGAP,
+	JT_ANOMALY_SERIES
+};
+
+/* A change in one of the series of a stats interval, found by the server
+ * without any thresholds being set:
+ *   {"iface", "series", "ival_ns", "onset": {"tv_sec", "tv_nsec"},
+ *    "t": {"tv_sec", "tv_nsec"}, "baseline", "level", "sd"}
+ * The level is the mean since the onset; the times are CLOCK_REALTIME. */
+struct jt_msg_anomaly
+{
+	char iface[MAX_IFACE_LEN];
+	enum jt_anomaly_series series;
+	uint64_t interval_ns;
+	struct timespec onset;
+	struct timespec timestamp; /* when it was found */
+	int64_t baseline;
+	int64_t level;
+	int64_t sd;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef JT_MSG_BACKFILL_H
+#define JT_MSG_BACKFILL_H
+
+#include "jt_msg_toptalk_ids.h"
+
+int jt_backfill_packer(void *data, char **out);
+int jt_backfill_unpacker(json_t *root, void **data);
+int jt_backfill_printer(void *data, char *out, int len);
+int jt_backfill_free(void *data);
+const char *jt_backfill_test_msg_get(void);
+
+/* a chart's worth of samples, the client's sampleWindowSize */
+#define BACKFILL_MAX_SAMPLES 200
+#define BACKFILL_MAX_IVALS 8
+
+/* The fields of the "s" object of a stats message, the ones charted. */
+enum jt_backfill_field {
+	BACKFILL_RX,
+	BACKFILL_TX,
+	BACKFILL_RXP,
+	BACKFILL_TXP,
+	BACKFILL_MIN_RX_PGAP,
+	BACKFILL_MAX_RX_PGAP,
+	BACKFILL_MEAN_RX_PGAP,
+	BACKFILL_MIN_TX_PGAP,
+	BACKFILL_MAX_TX_PGAP,
+	BACKFILL_MEAN_TX_PGAP,
+	BACKFILL_FIELDS
+};
+
+/* The recent stats and toptalk messages, oldest first, sent once to a new
+ * session so that its charts are full straight away.
+ *
+ * The stats are by interval, with a column of samples per field:
+ *   "stats": [{"ival_ns": n, "rx": [...], "tx": [...], ...}, ...]
+ * The toptalk slices are the "p" objects of toptalk_ids messages, by
+ * interval; the flows they refer to are announced first, as usual. */
+struct jt_msg_backfill
+{
+	char iface[MAX_IFACE_LEN];
+	int stats_count;
+	struct {
+		uint64_t interval_ns;
+		int count;
+		int64_t v[BACKFILL_MAX_SAMPLES][BACKFILL_FIELDS];
+	} stats[BACKFILL_MAX_IVALS];
+	int toptalk_count;
+	struct jt_msg_toptalk_ids toptalk[BACKFILL_MAX_IVALS *
+	                                  BACKFILL_MAX_SAMPLES];
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef JT_MSG_FLOW_DICT_H
+#define JT_MSG_FLOW_DICT_H
+
+#include "jt_msg_toptalk.h"
+
+int jt_flow_dict_packer(void *data, char **out);
+int jt_flow_dict_unpacker(json_t *root, void **data);
+int jt_flow_dict_printer(void *data, char *out, int len);
+int jt_flow_dict_free(void *data);
+const char *jt_flow_dict_test_msg_get(void);
+
+/* Announces the flows behind flow ids, before the first toptalk_ids
+ * message that uses them. An id may be announced again for a different
+ * flow, once the old one has long expired. */
+struct jt_msg_flow_dict
+{
+	int count;
+	struct {
+		uint32_t id;
+		uint16_t sport;
+		uint16_t dport;
+		char src[ADDR_LEN];
+		char dst[ADDR_LEN];
+		char proto[PROTO_LEN];
+		char tclass[TCLASS_LEN];
+	} flows[MAX_FLOWS];
+};
+
+#endif
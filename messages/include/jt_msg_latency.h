@@ -0,0 +1,34 @@
+#ifndef JT_MSG_LATENCY_H
+#define JT_MSG_LATENCY_H
+
+int jt_latency_packer(void *data, char **out);
+int jt_latency_unpacker(json_t *root, void **data);
+int jt_latency_printer(void *data, char *out, int len);
+int jt_latency_free(void *data);
+const char *jt_latency_test_msg_get(void);
+
+/* The stages of the stats pipeline, as in the trace of a stats message,
+ * and the whole of it, from reading the counters to the websocket write. */
+enum jt_latency_stage {
+	JT_LATENCY_COMPUTE, /* counters read to decimated */
+	JT_LATENCY_DEQUEUE, /* to taken off mq_stats */
+	JT_LATENCY_ENCODE,  /* to packed and queued for the websocket */
+	JT_LATENCY_WRITE,   /* to written, for each session */
+	JT_LATENCY_TOTAL,
+	JT_LATENCY_STAGES
+};
+
+/* Bucket n counts the latencies of less than 2^n microseconds that didn't
+ * fit the bucket before it; the last one counts everything longer. */
+#define JT_LATENCY_BUCKETS 24
+
+/* How long the stats messages spent in each stage since the last latency
+ * message:
+ *   {"compute": [counts...], "dequeue": [...], "encode": [...],
+ *    "write": [...], "total": [...]} */
+struct jt_msg_latency
+{
+	uint32_t hist[JT_LATENCY_STAGES][JT_LATENCY_BUCKETS];
+};
+
+#endif
@@ -7,12 +7,52 @@ int jt_netem_params_printer(void *data, char *out, int len);
 int jt_netem_params_free(void *data);
 const char *jt_netem_params_test_msg_get(void);
 
+#define NETEM_DIST_LEN 16
+#define NETEM_ADDR_LEN 46
+
+/* Probabilities and correlations are in parts per million (ppm), so that
+ * 10000 is 1%. Times are in milliseconds, except for the slot times which are
+ * in microseconds. A value of zero leaves the feature disabled. */
 struct jt_msg_netem_params
 {
 	char iface[MAX_IFACE_LEN];
 	int delay;
 	int jitter;
+	int delay_corr;
+	char dist[NETEM_DIST_LEN]; /* delay distribution, "" for uniform */
 	int loss;
+	int loss_corr;
+	int ge_p;          /* Gilbert-Elliott: P(good -> bad) */
+	int ge_r;          /* Gilbert-Elliott: P(bad -> good) */
+	int ge_loss_bad;   /* Gilbert-Elliott: loss probability in bad state */
+	int ge_loss_good;  /* Gilbert-Elliott: loss probability in good state */
+	int dup;
+	int dup_corr;
+	int reorder;
+	int reorder_corr;
+	int gap;
+	int corrupt;
+	int corrupt_corr;
+	int limit;         /* queue limit, packets */
+	int rate;          /* kbit/s */
+	int rate_overhead; /* bytes per packet */
+	int slot_min;      /* us */
+	int slot_max;      /* us */
+	int slot_packets;
+	int slot_bytes;
+	int dir;           /* 0: egress, 1: ingress */
+	/* impair only this flow; no addresses means all traffic */
+	char flow_src[NETEM_ADDR_LEN];
+	char flow_dst[NETEM_ADDR_LEN];
+	int flow_sport;
+	int flow_dport;
+	int flow_proto;
 };
 
+/* The fields beyond delay, jitter and loss are optional on the wire and are
+ * shared by the netem_params and set_netem messages. */
+void jt_netem_params_pack_ext(json_t *p,
+                              const struct jt_msg_netem_params *params);
+int jt_netem_params_unpack_ext(json_t *p, struct jt_msg_netem_params *params);
+
 #endif
@@ -0,0 +1,21 @@
+#ifndef JT_MSG_PROGRAM_STATUS_H
+#define JT_MSG_PROGRAM_STATUS_H
+
+int jt_program_status_packer(void *data, char **out);
+int jt_program_status_unpacker(json_t *root, void **data);
+int jt_program_status_printer(void *data, char *out, int len);
+int jt_program_status_free(void *data);
+const char *jt_program_status_test_msg_get(void);
+
+struct jt_msg_program_status
+{
+	char iface[MAX_IFACE_LEN];
+	char name[PROGRAM_NAME_LEN];
+	int running;
+	int step;  /* index of the last applied step, -1 if none */
+	int count;
+	int64_t late_us;  /* apply time of the last step, relative to schedule */
+	int64_t apply_us; /* duration of the last netlink update */
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef JT_MSG_ROLLUP_H
+#define JT_MSG_ROLLUP_H
+
+#include "jt_msg_toptalk.h"
+
+int jt_rollup_packer(void *data, char **out);
+int jt_rollup_unpacker(json_t *root, void **data);
+int jt_rollup_printer(void *data, char *out, int len);
+int jt_rollup_free(void *data);
+const char *jt_rollup_test_msg_get(void);
+
+#define ROLLUP_NAME_LEN 16
+#define ROLLUP_KEY_LEN (ADDR_LEN + 5) /* address and "/plen" */
+
+/* The top keys of one rollup (eg. source /24, destination port) over the
+ * last window, in bytes and packets per second. The keys are estimates:
+ * each one's bytes may be over-counted by up to its error.
+ * On the wire, each key is an array: [key, bytes, packets, error]. */
+struct jt_msg_rollup
+{
+	struct timespec timestamp;
+	uint64_t interval_ns;
+	char name[ROLLUP_NAME_LEN];
+	int64_t tbytes;
+	int64_t tpackets;
+	int count;
+	struct {
+		char key[ROLLUP_KEY_LEN];
+		int64_t bytes;
+		int64_t packets;
+		int64_t error;
+	} entries[MAX_FLOWS];
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef JT_MSG_SET_PROGRAM_H
+#define JT_MSG_SET_PROGRAM_H
+
+int jt_set_program_packer(void *data, char **out);
+int jt_set_program_unpacker(json_t *root, void **data);
+int jt_set_program_printer(void *data, char *out, int len);
+int jt_set_program_free(void *data);
+const char *jt_set_program_test_msg_get(void);
+
+#define MAX_PROGRAM_STEPS 64
+#define PROGRAM_NAME_LEN 32
+#define PROGRAM_MAX_IFACES 8
+
+/* An impairment program: a list of netem parameter sets, each applied at an
+ * offset (microseconds) from the start of the program. An empty program
+ * (count == 0) stops the running program. Each step is also applied to the
+ * optional extra ifaces, at the same instant. */
+struct jt_msg_program
+{
+	char iface[MAX_IFACE_LEN];
+	int iface_count;
+	char ifaces[PROGRAM_MAX_IFACES][MAX_IFACE_LEN];
+	char name[PROGRAM_NAME_LEN];
+	int count;
+	struct {
+		uint64_t t_us;
+		int delay;
+		int jitter;
+		int loss; /* ppm */
+	} steps[MAX_PROGRAM_STEPS];
+};
+
+#endif
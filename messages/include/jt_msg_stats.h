@@ -7,8 +7,18 @@ int jt_stats_printer(void *data, char *out, int len);
 int jt_stats_free(void *data);
 const char *jt_stats_test_msg_get(void);
 
+/* The stages that a stats message has passed through by the time it is
+ * packed, in its "trace": microseconds after the counters were read. */
+enum jt_trace_stage {
+	JT_TRACE_COMPUTE, /* decimated by the compute thread */
+	JT_TRACE_DEQUEUE, /* taken off mq_stats by the websocket thread */
+	JT_TRACE_PACK,    /* handed to the packer */
+	JT_TRACE_STAGES
+};
+
 struct jt_msg_stats
 {
+	/* when the counters of the newest sample were read, CLOCK_REALTIME */
 	struct timespec timestamp;
 	uint64_t interval_ns;
 
@@ -47,6 +57,11 @@ struct jt_msg_stats
 	uint32_t sd_tx_packet_gap;
 
 	char iface[MAX_IFACE_LEN];
+
+	uint32_t trace_us[JT_TRACE_STAGES];
+
+	/* the same as timestamp, on the server's CLOCK_MONOTONIC; not sent */
+	int64_t sample_ns;
 };
 
 #endif
@@ -8,10 +8,62 @@ int jt_toptalk_free(void *data);
 const char *jt_toptalk_test_msg_get(void);
 
 #define MAX_FLOWS 20
-#define ADDR_LEN 40
+#define ADDR_LEN 46 /* INET6_ADDRSTRLEN */
 #define PROTO_LEN 5
 #define TCLASS_LEN 5
 
+/* Estimated distinct counts over the interval, from HyperLogLog sketches.
+ * On the wire: "distinct": {"flows", "src", "dst", "dport"}; optional. */
+struct jt_msg_distinct
+{
+	int64_t flows;
+	int64_t sources;
+	int64_t destinations;
+	int64_t dports;
+};
+
+json_t *jt_distinct_pack(const struct jt_msg_distinct *d);
+int jt_distinct_unpack(json_t *params, struct jt_msg_distinct *d);
+
+/* The interface's inter-packet gaps over the interval, from the capture
+ * timestamps, in ns. hist[n] counts the gaps of less than 2^n us that
+ * didn't fit hist[n - 1]; the last bucket counts everything longer.
+ * On the wire: "pgaps": {"rx": {"n", "min", "max", "mean", "h": [...]},
+ * "tx": {...}}, without the empty buckets at the end of "h"; optional, and
+ * left out when there were no gaps. */
+#define JT_PGAP_BUCKETS 24
+
+enum { JT_PGAP_RX, JT_PGAP_TX, JT_PGAP_DIRS };
+
+struct jt_msg_pgaps
+{
+	int64_t count;
+	int64_t min_ns;
+	int64_t max_ns;
+	int64_t mean_ns;
+	uint32_t hist[JT_PGAP_BUCKETS];
+};
+
+void jt_pgaps_pack(json_t *params, const struct jt_msg_pgaps *p);
+int jt_pgaps_unpack(json_t *params, struct jt_msg_pgaps *p);
+
+/* Packet lengths over the interval, in bytes on the wire. hist[n] counts
+ * the packets shorter than 2^(n + JT_PSIZE_SHIFT) bytes that didn't fit
+ * hist[n - 1]; the last bucket counts everything longer.
+ * On the wire, a histogram is an array of counts without the empty buckets
+ * at the end. The interface's are "psizes": {"rx": [...], "tx": [...]},
+ * left out when nothing was captured; each flow's are "sizes" in toptalk
+ * and a fourth element in toptalk_ids, left out when empty. Optional. */
+#define JT_PSIZE_SHIFT 6
+#define JT_PSIZE_BUCKETS 11
+
+json_t *jt_psize_hist_pack(const uint32_t *hist);
+int jt_psize_hist_unpack(json_t *a, uint32_t *hist);
+/* psizes is [JT_PGAP_DIRS][JT_PSIZE_BUCKETS] */
+void jt_psizes_pack(json_t *params, const uint32_t *psizes);
+int jt_psizes_unpack(json_t *params,
+                     uint32_t psizes[JT_PGAP_DIRS][JT_PSIZE_BUCKETS]);
+
 struct jt_msg_toptalk
 {
 	struct timespec timestamp;
@@ -19,9 +71,13 @@ struct jt_msg_toptalk
 	uint32_t tflows;
 	int64_t tbytes;
 	int64_t tpackets;
+	struct jt_msg_distinct distinct;
+	struct jt_msg_pgaps pgaps[JT_PGAP_DIRS];
+	uint32_t psizes[JT_PGAP_DIRS][JT_PSIZE_BUCKETS];
 	struct {
 		int64_t bytes;
 		int64_t packets;
+		uint32_t sizes[JT_PSIZE_BUCKETS];
 		uint16_t sport;
 		uint16_t dport;
 		char src[ADDR_LEN];
@@ -0,0 +1,39 @@
+#ifndef JT_MSG_TOPTALK_IDS_H
+#define JT_MSG_TOPTALK_IDS_H
+
+#include "jt_msg_toptalk.h"
+
+int jt_toptalk_ids_packer(void *data, char **out);
+int jt_toptalk_ids_unpacker(json_t *root, void **data);
+int jt_toptalk_ids_printer(void *data, char *out, int len);
+int jt_toptalk_ids_free(void *data);
+const char *jt_toptalk_ids_test_msg_get(void);
+
+/* The same as a toptalk message, but each flow is given by its id from
+ * the flow dictionary (see jt_msg_flow_dict.h) instead of its full tuple.
+ * On the wire, each flow is an array: [id, bytes, packets], and its packet
+ * lengths after those when there are any. */
+struct jt_msg_toptalk_ids
+{
+	struct timespec timestamp;
+	uint64_t interval_ns;
+	uint32_t tflows;
+	int64_t tbytes;
+	int64_t tpackets;
+	struct jt_msg_distinct distinct;
+	struct jt_msg_pgaps pgaps[JT_PGAP_DIRS];
+	uint32_t psizes[JT_PGAP_DIRS][JT_PSIZE_BUCKETS];
+	int count;
+	struct {
+		uint32_t id;
+		int64_t bytes;
+		int64_t packets;
+		uint32_t sizes[JT_PSIZE_BUCKETS];
+	} flows[MAX_FLOWS];
+};
+
+/* The "p" object alone, for messages that carry several of them. */
+json_t *jt_toptalk_ids_pack_params(const struct jt_msg_toptalk_ids *tt);
+int jt_toptalk_ids_unpack_params(json_t *params, struct jt_msg_toptalk_ids *tt);
+
+#endif
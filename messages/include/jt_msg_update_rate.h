@@ -0,0 +1,34 @@
+#ifndef JT_MSG_UPDATE_RATE_H
+#define JT_MSG_UPDATE_RATE_H
+
+#include "jt_msg_rollup.h"
+
+int jt_update_rate_packer(void *data, char **out);
+int jt_update_rate_unpacker(json_t *root, void **data);
+int jt_update_rate_printer(void *data, char *out, int len);
+int jt_update_rate_free(void *data);
+const char *jt_update_rate_test_msg_get(void);
+
+#define UPDATE_RATE_MAX_IVALS 16
+
+/* Flow control from a client: the stats and toptalk intervals it shows,
+ * and how many updates per second of each it can use. The server skips
+ * everything else for that client's session.
+ * A count of -1 means all intervals (the default); the lists are of
+ * interval lengths in nanoseconds.
+ * With flow_ids, toptalk is sent as toptalk_ids and flow_dict messages
+ * instead of full toptalk messages.
+ * Rollups are named, and none are sent unless asked for. */
+struct jt_msg_update_rate
+{
+	int max_rate; /* updates per second per interval, 0 for no limit */
+	int stats_count;
+	int64_t stats[UPDATE_RATE_MAX_IVALS];
+	int tt_count;
+	int64_t tt[UPDATE_RATE_MAX_IVALS];
+	int flow_ids;
+	int rollup_count;
+	char rollups[UPDATE_RATE_MAX_IVALS][ROLLUP_NAME_LEN];
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef JT_MSG_VERIFY_H
+#define JT_MSG_VERIFY_H
+
+int jt_verify_packer(void *data, char **out);
+int jt_verify_unpacker(json_t *root, void **data);
+int jt_verify_printer(void *data, char *out, int len);
+int jt_verify_free(void *data);
+const char *jt_verify_test_msg_get(void);
+
+#define VERIFY_ADDR_LEN 46
+
+/* Enable/disable impairment verification on an iface. Without a probe
+ * destination, only the netem qdisc statistics are reported. Probes must
+ * come back to the server: either the destination is local, or it echoes
+ * the probe back to probe_port. */
+struct jt_msg_verify
+{
+	char iface[MAX_IFACE_LEN];
+	int enable;
+	char probe_dst[VERIFY_ADDR_LEN];
+	int probe_port;
+	int probe_rate; /* probes per second */
+};
+
+#endif
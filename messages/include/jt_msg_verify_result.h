@@ -0,0 +1,44 @@
+#ifndef JT_MSG_VERIFY_RESULT_H
+#define JT_MSG_VERIFY_RESULT_H
+
+int jt_verify_result_packer(void *data, char **out);
+int jt_verify_result_unpacker(json_t *root, void **data);
+int jt_verify_result_printer(void *data, char *out, int len);
+int jt_verify_result_free(void *data);
+const char *jt_verify_result_test_msg_get(void);
+
+/* probe delay percentiles: 1, 5, 25, 50, 75, 95, 99 */
+#define VERIFY_PCTL_COUNT 7
+
+/* Configured vs. observed impairment over one reporting interval. */
+struct jt_msg_verify_result
+{
+	char iface[MAX_IFACE_LEN];
+	int64_t interval_ms;
+
+	/* configured */
+	int64_t cfg_delay_us;
+	int64_t cfg_jitter_us;
+	int64_t cfg_loss_ppm;
+
+	/* netem qdisc statistics: deltas, and maxima of the gauges */
+	int64_t qd_packets;
+	int64_t qd_drops;
+	int64_t qd_requeues;
+	int64_t qd_overlimits;
+	int64_t qd_backlog_max; /* bytes */
+	int64_t qd_qlen_max;    /* packets */
+
+	/* probes: loss is counted over the probes sent at least the grace
+	 * period ago, delay over the probes received in this interval. */
+	int64_t probes_sent;
+	int64_t probes_lost;
+	int64_t loss_ppm;
+	int64_t delay_min_us;
+	int64_t delay_max_us;
+	int64_t delay_mean_us;
+	int64_t jitter_us; /* standard deviation of the delay */
+	int64_t delay_pctl_us[VERIFY_PCTL_COUNT];
+};
+
+#endif
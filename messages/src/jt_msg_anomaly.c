@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+#include <inttypes.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_anomaly.h"
+
+static const char *jt_anomaly_test_msg =
+    "{\"msg\":\"anomaly\","
+    " \"p\":{\"iface\":\"em1\", \"series\":\"rx\", \"ival_ns\":5000000,"
+    " \"onset\":{\"tv_sec\":123, \"tv_nsec\":400000000},"
+    " \"t\":{\"tv_sec\":123, \"tv_nsec\":460000000},"
+    " \"baseline\":1250000, \"level\":9800000, \"sd\":78125}}";
+
+/* in enum jt_anomaly_series order */
+static const char *const series_keys[JT_ANOMALY_SERIES] = {
+	[JT_ANOMALY_RX_RATE] = "rx",
+	[JT_ANOMALY_TX_RATE] = "tx",
+	[JT_ANOMALY_RX_PGAP] = "rx_pgap",
+	[JT_ANOMALY_TX_PGAP] = "tx_pgap"
+};
+
+const char *jt_anomaly_test_msg_get(void)
+{
+	return jt_anomaly_test_msg;
+}
+
+int jt_anomaly_free(void *data)
+{
+	struct jt_msg_anomaly *a = data;
+	free(a);
+	return 0;
+}
+
+int jt_anomaly_printer(void *data, char *out, int len)
+{
+	struct jt_msg_anomaly *a = data;
+
+	snprintf(out, len,
+	         "anomaly: %s %s %" PRId64 " -> %" PRId64 " at %ld.%09ld",
+	         a->iface, series_keys[a->series], a->baseline, a->level,
+	         a->onset.tv_sec, a->onset.tv_nsec);
+	return 0;
+}
+
+static json_t *timespec_pack(const struct timespec *ts)
+{
+	json_t *o = json_object();
+
+	json_object_set_new(o, "tv_sec", json_integer(ts->tv_sec));
+	json_object_set_new(o, "tv_nsec", json_integer(ts->tv_nsec));
+	return o;
+}
+
+static int timespec_unpack(json_t *o, struct timespec *ts)
+{
+	json_t *sec = json_object_get(o, "tv_sec");
+	json_t *nsec = json_object_get(o, "tv_nsec");
+
+	if (!json_is_integer(sec) || !json_is_integer(nsec)) {
+		return -1;
+	}
+	ts->tv_sec = json_integer_value(sec);
+	ts->tv_nsec = json_integer_value(nsec);
+	return 0;
+}
+
+int jt_anomaly_packer(void *data, char **out)
+{
+	struct jt_msg_anomaly *a = data;
+	json_t *t = json_object();
+	json_t *params = json_object();
+
+	assert(a->series >= 0 && a->series < JT_ANOMALY_SERIES);
+
+	json_object_set_new(params, "iface", json_string(a->iface));
+	json_object_set_new(params, "series",
+	                    json_string(series_keys[a->series]));
+	json_object_set_new(params, "ival_ns", json_integer(a->interval_ns));
+	json_object_set_new(params, "onset", timespec_pack(&a->onset));
+	json_object_set_new(params, "t", timespec_pack(&a->timestamp));
+	json_object_set_new(params, "baseline", json_integer(a->baseline));
+	json_object_set_new(params, "level", json_integer(a->level));
+	json_object_set_new(params, "sd", json_integer(a->sd));
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_ANOMALY_V1].key));
+	json_object_set(t, "p", params);
+	*out = json_dumps(t, 0);
+	json_object_clear(params);
+	json_decref(params);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_anomaly_unpacker(json_t *root, void **data)
+{
+	json_t *params, *t;
+	struct jt_msg_anomaly *a;
+	const char *series;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	a = calloc(1, sizeof(struct jt_msg_anomaly));
+	assert(a);
+
+	t = json_object_get(params, "iface");
+	if (!json_is_string(t)) {
+		goto unpack_fail;
+	}
+	snprintf(a->iface, MAX_IFACE_LEN, "%s", json_string_value(t));
+
+	t = json_object_get(params, "series");
+	if (!json_is_string(t)) {
+		goto unpack_fail;
+	}
+	series = json_string_value(t);
+	for (a->series = 0; a->series < JT_ANOMALY_SERIES; a->series++) {
+		if (0 == strcmp(series, series_keys[a->series])) {
+			break;
+		}
+	}
+	if (JT_ANOMALY_SERIES == a->series) {
+		goto unpack_fail;
+	}
+
+	t = json_object_get(params, "ival_ns");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	a->interval_ns = json_integer_value(t);
+
+	if (timespec_unpack(json_object_get(params, "onset"), &a->onset)
+	    || timespec_unpack(json_object_get(params, "t"), &a->timestamp)) {
+		goto unpack_fail;
+	}
+
+	t = json_object_get(params, "baseline");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	a->baseline = json_integer_value(t);
+
+	t = json_object_get(params, "level");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	a->level = json_integer_value(t);
+
+	t = json_object_get(params, "sd");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	a->sd = json_integer_value(t);
+
+	*data = a;
+	json_object_clear(params);
+	return 0;
+
+unpack_fail:
+	free(a);
+	json_object_clear(params);
+	return -1;
+}
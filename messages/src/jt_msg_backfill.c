@@ -0,0 +1,194 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+#include <inttypes.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_backfill.h"
+
+static const char *jt_backfill_test_msg =
+    "{\"msg\":\"backfill\","
+    " \"p\":{\"iface\":\"em1\","
+    " \"stats\":[{\"ival_ns\":5000000,"
+    " \"rx\":[100, 200], \"tx\":[10, 20], \"rxP\":[1, 2], \"txP\":[3, 4],"
+    " \"min_rx_pgap\":[0, 1], \"max_rx_pgap\":[5, 6],"
+    " \"mean_rx_pgap\":[2, 3], \"min_tx_pgap\":[0, 0],"
+    " \"max_tx_pgap\":[9, 8], \"mean_tx_pgap\":[4, 4]}],"
+    " \"toptalk\":[{\"tflows\":5, \"tbytes\":9999, \"tpackets\":888,"
+    " \"interval_ns\":5000000,"
+    " \"timestamp\":{\"tv_sec\":123, \"tv_nsec\":456},"
+    " \"f\":[[0, 100, 10], [7, 50, 5]]}]}}";
+
+/* in enum jt_backfill_field order; the keys of the stats message */
+static const char *const field_keys[BACKFILL_FIELDS] = {
+	[BACKFILL_RX] = "rx",
+	[BACKFILL_TX] = "tx",
+	[BACKFILL_RXP] = "rxP",
+	[BACKFILL_TXP] = "txP",
+	[BACKFILL_MIN_RX_PGAP] = "min_rx_pgap",
+	[BACKFILL_MAX_RX_PGAP] = "max_rx_pgap",
+	[BACKFILL_MEAN_RX_PGAP] = "mean_rx_pgap",
+	[BACKFILL_MIN_TX_PGAP] = "min_tx_pgap",
+	[BACKFILL_MAX_TX_PGAP] = "max_tx_pgap",
+	[BACKFILL_MEAN_TX_PGAP] = "mean_tx_pgap"
+};
+
+const char *jt_backfill_test_msg_get(void)
+{
+	return jt_backfill_test_msg;
+}
+
+int jt_backfill_free(void *data)
+{
+	struct jt_msg_backfill *b = data;
+	free(b);
+	return 0;
+}
+
+int jt_backfill_printer(void *data, char *out, int len)
+{
+	struct jt_msg_backfill *b = data;
+	int samples = 0;
+
+	for (int i = 0; i < b->stats_count; i++) {
+		samples += b->stats[i].count;
+	}
+	snprintf(out, len, "backfill %s: %d stats samples, %d toptalk slices",
+	         b->iface, samples, b->toptalk_count);
+	return 0;
+}
+
+int jt_backfill_packer(void *data, char **out)
+{
+	struct jt_msg_backfill *b = data;
+	json_t *t = json_object();
+	json_t *params = json_object();
+	json_t *stats = json_array();
+	json_t *toptalk = json_array();
+
+	json_object_set_new(params, "iface", json_string(b->iface));
+
+	for (int i = 0; i < b->stats_count; i++) {
+		json_t *ival = json_object();
+
+		json_object_set_new(ival, "ival_ns",
+		                    json_integer(b->stats[i].interval_ns));
+		for (int f = 0; f < BACKFILL_FIELDS; f++) {
+			json_t *col = json_array();
+			for (int j = 0; j < b->stats[i].count; j++) {
+				json_array_append_new(
+				    col, json_integer(b->stats[i].v[j][f]));
+			}
+			json_object_set_new(ival, field_keys[f], col);
+		}
+		json_array_append_new(stats, ival);
+	}
+	json_object_set_new(params, "stats", stats);
+
+	for (int i = 0; i < b->toptalk_count; i++) {
+		json_array_append_new(toptalk,
+		                      jt_toptalk_ids_pack_params(&b->toptalk[i]));
+	}
+	json_object_set_new(params, "toptalk", toptalk);
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_BACKFILL_V1].key));
+	json_object_set(t, "p", params);
+	*out = json_dumps(t, 0);
+	json_object_clear(params);
+	json_decref(params);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+static int unpack_stats(json_t *ival, struct jt_msg_backfill *b, int i)
+{
+	json_t *t;
+	int count = -1;
+
+	t = json_object_get(ival, "ival_ns");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	b->stats[i].interval_ns = json_integer_value(t);
+
+	for (int f = 0; f < BACKFILL_FIELDS; f++) {
+		json_t *col = json_object_get(ival, field_keys[f]);
+
+		/* all the columns are the same length */
+		if (!json_is_array(col)
+		    || json_array_size(col) > BACKFILL_MAX_SAMPLES
+		    || (count >= 0 && (int)json_array_size(col) != count)) {
+			return -1;
+		}
+		count = json_array_size(col);
+
+		for (int j = 0; j < count; j++) {
+			t = json_array_get(col, j);
+			if (!json_is_integer(t)) {
+				return -1;
+			}
+			b->stats[i].v[j][f] = json_integer_value(t);
+		}
+	}
+	b->stats[i].count = count;
+	return 0;
+}
+
+int jt_backfill_unpacker(json_t *root, void **data)
+{
+	json_t *params, *t, *stats, *toptalk;
+	struct jt_msg_backfill *b;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	b = calloc(1, sizeof(struct jt_msg_backfill));
+	assert(b);
+
+	t = json_object_get(params, "iface");
+	if (!json_is_string(t)) {
+		goto unpack_fail;
+	}
+	snprintf(b->iface, MAX_IFACE_LEN, "%s", json_string_value(t));
+
+	stats = json_object_get(params, "stats");
+	if (!json_is_array(stats)
+	    || json_array_size(stats) > BACKFILL_MAX_IVALS) {
+		goto unpack_fail;
+	}
+	b->stats_count = json_array_size(stats);
+	for (int i = 0; i < b->stats_count; i++) {
+		if (unpack_stats(json_array_get(stats, i), b, i)) {
+			goto unpack_fail;
+		}
+	}
+
+	toptalk = json_object_get(params, "toptalk");
+	if (!json_is_array(toptalk)
+	    || json_array_size(toptalk)
+	           > BACKFILL_MAX_IVALS * BACKFILL_MAX_SAMPLES) {
+		goto unpack_fail;
+	}
+	b->toptalk_count = json_array_size(toptalk);
+	for (int i = 0; i < b->toptalk_count; i++) {
+		if (jt_toptalk_ids_unpack_params(json_array_get(toptalk, i),
+		                                 &b->toptalk[i])) {
+			goto unpack_fail;
+		}
+	}
+
+	*data = b;
+	json_object_clear(params);
+	return 0;
+
+unpack_fail:
+	free(b);
+	json_object_clear(params);
+	return -1;
+}
@@ -0,0 +1,142 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_flow_dict.h"
+
+static const char *jt_flow_dict_test_msg =
+    "{\"msg\":\"flow_dict\", \"p\":{\"flows\":["
+    "{\"id\":0, \"src\":\"192.168.0.1\", \"dst\":\"192.168.0.2\", "
+    "\"sport\":32000, \"dport\":53, \"proto\":\"udp\", \"tclass\":\"BE\"},"
+    "{\"id\":7, \"src\":\"fe80::1\", \"dst\":\"fe80::2\", "
+    "\"sport\":443, \"dport\":40000, \"proto\":\"tcp\", \"tclass\":\"AF41\"}"
+    "]}}";
+
+const char *jt_flow_dict_test_msg_get(void) { return jt_flow_dict_test_msg; }
+
+int jt_flow_dict_free(void *data)
+{
+	struct jt_msg_flow_dict *d = data;
+	free(d);
+	return 0;
+}
+
+int jt_flow_dict_printer(void *data, char *out, int len)
+{
+	struct jt_msg_flow_dict *d = data;
+
+	snprintf(out, len, "Flow dictionary: %d new flows", d->count);
+	return 0;
+}
+
+int jt_flow_dict_packer(void *data, char **out)
+{
+	struct jt_msg_flow_dict *d = data;
+	json_t *t = json_object();
+	json_t *p = json_object();
+	json_t *flows = json_array();
+
+	for (int i = 0; i < d->count; i++) {
+		json_t *f = json_object();
+		json_object_set_new(f, "id", json_integer(d->flows[i].id));
+		json_object_set_new(f, "src", json_string(d->flows[i].src));
+		json_object_set_new(f, "dst", json_string(d->flows[i].dst));
+		json_object_set_new(f, "sport", json_integer(d->flows[i].sport));
+		json_object_set_new(f, "dport", json_integer(d->flows[i].dport));
+		json_object_set_new(f, "proto", json_string(d->flows[i].proto));
+		json_object_set_new(f, "tclass",
+		                    json_string(d->flows[i].tclass));
+		json_array_append_new(flows, f);
+	}
+	json_object_set_new(p, "flows", flows);
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_FLOW_DICT_V1].key));
+	json_object_set(t, "p", p);
+	*out = json_dumps(t, 0);
+	json_object_clear(p);
+	json_decref(p);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_flow_dict_unpacker(json_t *root, void **data)
+{
+	json_t *params, *flows, *t;
+	struct jt_msg_flow_dict *d;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	d = calloc(1, sizeof(struct jt_msg_flow_dict));
+	assert(d);
+
+	flows = json_object_get(params, "flows");
+	if (!json_is_array(flows) || json_array_size(flows) > MAX_FLOWS) {
+		goto unpack_fail;
+	}
+
+	d->count = json_array_size(flows);
+	for (int i = 0; i < d->count; i++) {
+		json_t *f = json_array_get(flows, i);
+
+		t = json_object_get(f, "id");
+		if (!json_is_integer(t)) {
+			goto unpack_fail;
+		}
+		d->flows[i].id = json_integer_value(t);
+
+		t = json_object_get(f, "sport");
+		if (!json_is_integer(t)) {
+			goto unpack_fail;
+		}
+		d->flows[i].sport = json_integer_value(t);
+
+		t = json_object_get(f, "dport");
+		if (!json_is_integer(t)) {
+			goto unpack_fail;
+		}
+		d->flows[i].dport = json_integer_value(t);
+
+		t = json_object_get(f, "src");
+		if (!json_is_string(t)) {
+			goto unpack_fail;
+		}
+		snprintf(d->flows[i].src, ADDR_LEN, "%s", json_string_value(t));
+
+		t = json_object_get(f, "dst");
+		if (!json_is_string(t)) {
+			goto unpack_fail;
+		}
+		snprintf(d->flows[i].dst, ADDR_LEN, "%s", json_string_value(t));
+
+		t = json_object_get(f, "proto");
+		if (!json_is_string(t)) {
+			goto unpack_fail;
+		}
+		snprintf(d->flows[i].proto, PROTO_LEN, "%s",
+		         json_string_value(t));
+
+		t = json_object_get(f, "tclass");
+		if (!json_is_string(t)) {
+			goto unpack_fail;
+		}
+		snprintf(d->flows[i].tclass, TCLASS_LEN, "%s",
+		         json_string_value(t));
+	}
+
+	*data = d;
+	json_object_clear(params);
+	return 0;
+
+unpack_fail:
+	free(d);
+	json_object_clear(params);
+	return -1;
+}
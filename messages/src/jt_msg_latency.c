@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+#include <inttypes.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_latency.h"
+
+static const char *jt_latency_test_msg =
+    "{\"msg\":\"latency\","
+    " \"p\":{\"compute\":[0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 97],"
+    " \"dequeue\":[0, 0, 0, 0, 0, 0, 0, 100],"
+    " \"encode\":[0, 0, 0, 0, 0, 90, 10],"
+    " \"write\":[0, 0, 0, 0, 0, 0, 50, 140, 10],"
+    " \"total\":[0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 180, 10]}}";
+
+/* in enum jt_latency_stage order */
+static const char *const stage_keys[JT_LATENCY_STAGES] = {
+	[JT_LATENCY_COMPUTE] = "compute",
+	[JT_LATENCY_DEQUEUE] = "dequeue",
+	[JT_LATENCY_ENCODE] = "encode",
+	[JT_LATENCY_WRITE] = "write",
+	[JT_LATENCY_TOTAL] = "total"
+};
+
+const char *jt_latency_test_msg_get(void)
+{
+	return jt_latency_test_msg;
+}
+
+int jt_latency_free(void *data)
+{
+	struct jt_msg_latency *l = data;
+	free(l);
+	return 0;
+}
+
+int jt_latency_printer(void *data, char *out, int len)
+{
+	struct jt_msg_latency *l = data;
+	uint32_t count = 0;
+
+	for (int b = 0; b < JT_LATENCY_BUCKETS; b++) {
+		count += l->hist[JT_LATENCY_TOTAL][b];
+	}
+	snprintf(out, len, "latency: %" PRIu32 " messages", count);
+	return 0;
+}
+
+int jt_latency_packer(void *data, char **out)
+{
+	struct jt_msg_latency *l = data;
+	json_t *t = json_object();
+	json_t *params = json_object();
+
+	for (int s = 0; s < JT_LATENCY_STAGES; s++) {
+		json_t *hist = json_array();
+		int used = 0;
+
+		/* leave off the empty buckets at the end */
+		for (int b = 0; b < JT_LATENCY_BUCKETS; b++) {
+			if (l->hist[s][b]) {
+				used = b + 1;
+			}
+		}
+		for (int b = 0; b < used; b++) {
+			json_array_append_new(hist, json_integer(l->hist[s][b]));
+		}
+		json_object_set_new(params, stage_keys[s], hist);
+	}
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_LATENCY_V1].key));
+	json_object_set(t, "p", params);
+	*out = json_dumps(t, 0);
+	json_object_clear(params);
+	json_decref(params);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_latency_unpacker(json_t *root, void **data)
+{
+	json_t *params, *hist, *t;
+	struct jt_msg_latency *l;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	l = calloc(1, sizeof(struct jt_msg_latency));
+	assert(l);
+
+	for (int s = 0; s < JT_LATENCY_STAGES; s++) {
+		hist = json_object_get(params, stage_keys[s]);
+		if (!json_is_array(hist)
+		    || json_array_size(hist) > JT_LATENCY_BUCKETS) {
+			goto unpack_fail;
+		}
+		for (size_t b = 0; b < json_array_size(hist); b++) {
+			t = json_array_get(hist, b);
+			if (!json_is_integer(t)) {
+				goto unpack_fail;
+			}
+			l->hist[s][b] = json_integer_value(t);
+		}
+	}
+
+	*data = l;
+	json_object_clear(params);
+	return 0;
+
+unpack_fail:
+	free(l);
+	json_object_clear(params);
+	return -1;
+}
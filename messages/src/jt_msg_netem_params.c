@@ -1,4 +1,5 @@
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 #include <jansson.h>
 
@@ -9,7 +10,105 @@
 
 static const char *jt_netem_params_test_msg =
     "{\"msg\":\"netem_params\", \"p\":{\"iface\":\"em1\", \"delay\":-1, "
-    "\"jitter\":-1, \"loss\":-1}}";
+    "\"jitter\":-1, \"loss\":-1, \"dist\":\"normal\", \"reorder\":250000, "
+    "\"gap\":5, \"rate\":10000, \"slot_min\":800, \"slot_max\":1200, "
+    "\"dir\":1, \"flow_src\":\"10.0.0.1\", \"flow_dst\":\"10.0.0.2\", "
+    "\"flow_sport\":5004, \"flow_dport\":5006, \"flow_proto\":17}}";
+
+static const struct {
+	const char *key;
+	size_t offset;
+} ext_fields[] = {
+	{ "delay_corr", offsetof(struct jt_msg_netem_params, delay_corr) },
+	{ "loss_corr", offsetof(struct jt_msg_netem_params, loss_corr) },
+	{ "ge_p", offsetof(struct jt_msg_netem_params, ge_p) },
+	{ "ge_r", offsetof(struct jt_msg_netem_params, ge_r) },
+	{ "ge_loss_bad", offsetof(struct jt_msg_netem_params, ge_loss_bad) },
+	{ "ge_loss_good", offsetof(struct jt_msg_netem_params, ge_loss_good) },
+	{ "dup", offsetof(struct jt_msg_netem_params, dup) },
+	{ "dup_corr", offsetof(struct jt_msg_netem_params, dup_corr) },
+	{ "reorder", offsetof(struct jt_msg_netem_params, reorder) },
+	{ "reorder_corr", offsetof(struct jt_msg_netem_params, reorder_corr) },
+	{ "gap", offsetof(struct jt_msg_netem_params, gap) },
+	{ "corrupt", offsetof(struct jt_msg_netem_params, corrupt) },
+	{ "corrupt_corr", offsetof(struct jt_msg_netem_params, corrupt_corr) },
+	{ "limit", offsetof(struct jt_msg_netem_params, limit) },
+	{ "rate", offsetof(struct jt_msg_netem_params, rate) },
+	{ "rate_overhead", offsetof(struct jt_msg_netem_params, rate_overhead) },
+	{ "slot_min", offsetof(struct jt_msg_netem_params, slot_min) },
+	{ "slot_max", offsetof(struct jt_msg_netem_params, slot_max) },
+	{ "slot_packets", offsetof(struct jt_msg_netem_params, slot_packets) },
+	{ "slot_bytes", offsetof(struct jt_msg_netem_params, slot_bytes) },
+	{ "dir", offsetof(struct jt_msg_netem_params, dir) },
+	{ "flow_sport", offsetof(struct jt_msg_netem_params, flow_sport) },
+	{ "flow_dport", offsetof(struct jt_msg_netem_params, flow_dport) },
+	{ "flow_proto", offsetof(struct jt_msg_netem_params, flow_proto) },
+};
+
+static const struct {
+	const char *key;
+	size_t offset;
+	size_t len;
+} ext_str_fields[] = {
+	{ "dist", offsetof(struct jt_msg_netem_params, dist), NETEM_DIST_LEN },
+	{ "flow_src", offsetof(struct jt_msg_netem_params, flow_src),
+	  NETEM_ADDR_LEN },
+	{ "flow_dst", offsetof(struct jt_msg_netem_params, flow_dst),
+	  NETEM_ADDR_LEN },
+};
+
+#define EXT_FIELD(params, i) \
+	((int *)((char *)(params) + ext_fields[(i)].offset))
+#define EXT_STR_FIELD(params, i) \
+	((char *)(params) + ext_str_fields[(i)].offset)
+
+void jt_netem_params_pack_ext(json_t *p,
+                              const struct jt_msg_netem_params *params)
+{
+	for (size_t i = 0;
+	     i < sizeof(ext_str_fields) / sizeof(ext_str_fields[0]); i++) {
+		json_object_set_new(p, ext_str_fields[i].key,
+		                    json_string(EXT_STR_FIELD(params, i)));
+	}
+	for (size_t i = 0; i < sizeof(ext_fields) / sizeof(ext_fields[0]);
+	     i++) {
+		json_object_set_new(p, ext_fields[i].key,
+		                    json_integer(*EXT_FIELD(params, i)));
+	}
+}
+
+int jt_netem_params_unpack_ext(json_t *p, struct jt_msg_netem_params *params)
+{
+	json_t *token;
+
+	for (size_t i = 0;
+	     i < sizeof(ext_str_fields) / sizeof(ext_str_fields[0]); i++) {
+		*EXT_STR_FIELD(params, i) = '\0';
+		token = json_object_get(p, ext_str_fields[i].key);
+		if (!token) {
+			continue;
+		}
+		if (!json_is_string(token)) {
+			return -1;
+		}
+		snprintf(EXT_STR_FIELD(params, i), ext_str_fields[i].len, "%s",
+		         json_string_value(token));
+	}
+
+	for (size_t i = 0; i < sizeof(ext_fields) / sizeof(ext_fields[0]);
+	     i++) {
+		*EXT_FIELD(params, i) = 0;
+		token = json_object_get(p, ext_fields[i].key);
+		if (!token) {
+			continue;
+		}
+		if (!json_is_integer(token)) {
+			return -1;
+		}
+		*EXT_FIELD(params, i) = json_integer_value(token);
+	}
+	return 0;
+}
 
 const char *jt_netem_params_test_msg_get(void)
 {
@@ -30,9 +129,19 @@ int jt_netem_params_printer(void *data, char *out, int len)
 	snprintf(out, len, "Impairment params:\n"
 	       "\tInterface:  %s\n"
 	       "\tDelay:      %dms\n"
-	       "\tJitter:  +/-%dms\n"
-	       "\tLoss:       %d",
-	       p->iface, p->delay, p->jitter, p->loss);
+	       "\tJitter:  +/-%dms %s\n"
+	       "\tLoss:       %dppm\n"
+	       "\tDuplicate:  %dppm\n"
+	       "\tReorder:    %dppm gap %d\n"
+	       "\tCorrupt:    %dppm\n"
+	       "\tRate:       %dkbit/s\n"
+	       "\tSlot:       %d-%dus\n"
+	       "\tDirection:  %s\n"
+	       "\tFlow:       %s:%d -> %s:%d proto %d",
+	       p->iface, p->delay, p->jitter, p->dist, p->loss, p->dup,
+	       p->reorder, p->gap, p->corrupt, p->rate, p->slot_min,
+	       p->slot_max, p->dir ? "ingress" : "egress", p->flow_src,
+	       p->flow_sport, p->flow_dst, p->flow_dport, p->flow_proto);
 	return 0;
 }
 
@@ -76,6 +185,10 @@ int jt_netem_params_unpacker(json_t *root, void **data)
 	}
 	params->loss = json_integer_value(token);
 
+	if (jt_netem_params_unpack_ext(params_token, params)) {
+		goto cleanup_unpack_fail;
+	}
+
 	*data = params;
 	return 0;
 
@@ -94,6 +207,7 @@ int jt_netem_params_packer(void *data, char **out)
 	json_object_set_new(p, "delay", json_integer(params->delay));
 	json_object_set_new(p, "jitter", json_integer(params->jitter));
 	json_object_set_new(p, "loss", json_integer(params->loss));
+	jt_netem_params_pack_ext(p, params);
 
 	json_object_set_new(
 	    t, "msg", json_string(jt_messages[JT_MSG_NETEM_PARAMS_V1].key));
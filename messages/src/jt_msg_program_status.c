@@ -0,0 +1,125 @@
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_program_status.h"
+
+static const char *jt_program_status_test_msg =
+    "{\"msg\":\"program_status\", "
+    "\"p\":{\"iface\":\"em1\", \"name\":\"test\", \"running\":1, "
+    "\"step\":1, \"count\":3, \"late_us\":42, \"apply_us\":310}}";
+
+const char *jt_program_status_test_msg_get(void)
+{
+	return jt_program_status_test_msg;
+}
+
+int jt_program_status_free(void *data)
+{
+	struct jt_msg_program_status *s = data;
+	free(s);
+	return 0;
+}
+
+int jt_program_status_printer(void *data, char *out, int len)
+{
+	struct jt_msg_program_status *s = data;
+
+	snprintf(out, len, "Program %s on %s: %s, step %d/%d, "
+	         "late: %" PRId64 "us, apply: %" PRId64 "us",
+	         s->name, s->iface, s->running ? "running" : "stopped",
+	         s->step + 1, s->count, s->late_us, s->apply_us);
+	return 0;
+}
+
+int jt_program_status_packer(void *data, char **out)
+{
+	struct jt_msg_program_status *status = data;
+	json_t *t = json_object();
+	json_t *p = json_object();
+
+	json_object_set_new(p, "iface", json_string(status->iface));
+	json_object_set_new(p, "name", json_string(status->name));
+	json_object_set_new(p, "running", json_integer(status->running));
+	json_object_set_new(p, "step", json_integer(status->step));
+	json_object_set_new(p, "count", json_integer(status->count));
+	json_object_set_new(p, "late_us", json_integer(status->late_us));
+	json_object_set_new(p, "apply_us", json_integer(status->apply_us));
+
+	json_object_set_new(
+	    t, "msg", json_string(jt_messages[JT_MSG_PROGRAM_STATUS_V1].key));
+	json_object_set(t, "p", p);
+	*out = json_dumps(t, 0);
+	json_object_clear(p);
+	json_decref(p);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_program_status_unpacker(json_t *root, void **data)
+{
+	json_t *params, *token;
+	struct jt_msg_program_status *status;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	status = malloc(sizeof(struct jt_msg_program_status));
+	assert(status);
+
+	token = json_object_get(params, "iface");
+	if (!json_is_string(token)) {
+		goto unpack_fail;
+	}
+	snprintf(status->iface, MAX_IFACE_LEN, "%s", json_string_value(token));
+
+	token = json_object_get(params, "name");
+	if (!json_is_string(token)) {
+		goto unpack_fail;
+	}
+	snprintf(status->name, PROGRAM_NAME_LEN, "%s",
+	         json_string_value(token));
+
+	token = json_object_get(params, "running");
+	if (!json_is_integer(token)) {
+		goto unpack_fail;
+	}
+	status->running = json_integer_value(token);
+
+	token = json_object_get(params, "step");
+	if (!json_is_integer(token)) {
+		goto unpack_fail;
+	}
+	status->step = json_integer_value(token);
+
+	token = json_object_get(params, "count");
+	if (!json_is_integer(token)) {
+		goto unpack_fail;
+	}
+	status->count = json_integer_value(token);
+
+	token = json_object_get(params, "late_us");
+	if (!json_is_integer(token)) {
+		goto unpack_fail;
+	}
+	status->late_us = json_integer_value(token);
+
+	token = json_object_get(params, "apply_us");
+	if (!json_is_integer(token)) {
+		goto unpack_fail;
+	}
+	status->apply_us = json_integer_value(token);
+
+	*data = status;
+	return 0;
+
+unpack_fail:
+	free(status);
+	return -1;
+}
@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+#include <inttypes.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_rollup.h"
+
+static const char *jt_rollup_test_msg =
+    "{\"msg\":\"rollup\","
+    " \"p\":{\"name\":\"src/24\", \"tbytes\":9999, \"tpackets\":888,"
+    " \"interval_ns\":3000000000,"
+    " \"timestamp\":{\"tv_sec\":123, \"tv_nsec\":456},"
+    " \"top\":[[\"192.168.0.0/24\", 8000, 700, 0],"
+    " [\"fe80::/64\", 1500, 150, 20]]}}";
+
+const char *jt_rollup_test_msg_get(void)
+{
+	return jt_rollup_test_msg;
+}
+
+int jt_rollup_free(void *data)
+{
+	struct jt_msg_rollup *r = data;
+	free(r);
+	return 0;
+}
+
+int jt_rollup_printer(void *data, char *out, int len)
+{
+	struct jt_msg_rollup *r = data;
+
+	snprintf(out, len,
+	         "t:%ld.%09ld rollup %s: %d keys, b: %" PRId64 ", p:%" PRId64,
+	         r->timestamp.tv_sec, r->timestamp.tv_nsec, r->name, r->count,
+	         r->tbytes, r->tpackets);
+	return 0;
+}
+
+int jt_rollup_packer(void *data, char **out)
+{
+	struct jt_msg_rollup *r = data;
+	json_t *t = json_object();
+	json_t *params = json_object();
+	json_t *timestamp = json_object();
+	json_t *top = json_array();
+
+	json_object_set_new(params, "name", json_string(r->name));
+	json_object_set_new(params, "tbytes", json_integer(r->tbytes));
+	json_object_set_new(params, "tpackets", json_integer(r->tpackets));
+	json_object_set_new(params, "interval_ns",
+	                    json_integer(r->interval_ns));
+
+	json_object_set_new(timestamp, "tv_sec",
+	                    json_integer(r->timestamp.tv_sec));
+	json_object_set_new(timestamp, "tv_nsec",
+	                    json_integer(r->timestamp.tv_nsec));
+	json_object_set_new(params, "timestamp", timestamp);
+
+	for (int i = 0; i < r->count; i++) {
+		json_t *e = json_array();
+		json_array_append_new(e, json_string(r->entries[i].key));
+		json_array_append_new(e, json_integer(r->entries[i].bytes));
+		json_array_append_new(e, json_integer(r->entries[i].packets));
+		json_array_append_new(e, json_integer(r->entries[i].error));
+		json_array_append_new(top, e);
+	}
+	json_object_set_new(params, "top", top);
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_ROLLUP_V1].key));
+	json_object_set(t, "p", params);
+	*out = json_dumps(t, 0);
+	json_object_clear(params);
+	json_decref(params);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_rollup_unpacker(json_t *root, void **data)
+{
+	json_t *params, *t, *timestamp, *top;
+	struct jt_msg_rollup *r;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	r = calloc(1, sizeof(struct jt_msg_rollup));
+	assert(r);
+
+	t = json_object_get(params, "name");
+	if (!json_is_string(t)) {
+		goto unpack_fail;
+	}
+	snprintf(r->name, ROLLUP_NAME_LEN, "%s", json_string_value(t));
+
+	t = json_object_get(params, "tbytes");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	r->tbytes = json_integer_value(t);
+
+	t = json_object_get(params, "tpackets");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	r->tpackets = json_integer_value(t);
+
+	t = json_object_get(params, "interval_ns");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	r->interval_ns = json_integer_value(t);
+
+	timestamp = json_object_get(params, "timestamp");
+	if (!json_is_object(timestamp)) {
+		goto unpack_fail;
+	}
+	t = json_object_get(timestamp, "tv_sec");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	r->timestamp.tv_sec = json_integer_value(t);
+
+	t = json_object_get(timestamp, "tv_nsec");
+	if (!json_is_integer(t)) {
+		goto unpack_fail;
+	}
+	r->timestamp.tv_nsec = json_integer_value(t);
+
+	top = json_object_get(params, "top");
+	if (!json_is_array(top) || json_array_size(top) > MAX_FLOWS) {
+		goto unpack_fail;
+	}
+
+	r->count = json_array_size(top);
+	for (int i = 0; i < r->count; i++) {
+		json_t *e = json_array_get(top, i);
+		json_t *key = json_array_get(e, 0);
+		json_t *bytes = json_array_get(e, 1);
+		json_t *packets = json_array_get(e, 2);
+		json_t *error = json_array_get(e, 3);
+
+		if (!json_is_string(key) || !json_is_integer(bytes)
+		    || !json_is_integer(packets) || !json_is_integer(error)) {
+			goto unpack_fail;
+		}
+		snprintf(r->entries[i].key, ROLLUP_KEY_LEN, "%s",
+		         json_string_value(key));
+		r->entries[i].bytes = json_integer_value(bytes);
+		r->entries[i].packets = json_integer_value(packets);
+		r->entries[i].error = json_integer_value(error);
+	}
+
+	*data = r;
+	json_object_clear(params);
+	return 0;
+
+unpack_fail:
+	free(r);
+	json_object_clear(params);
+	return -1;
+}
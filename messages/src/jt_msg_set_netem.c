@@ -9,7 +9,8 @@
 
 static const char *jt_set_netem_test_msg =
     "{\"msg\":\"set_netem\", "
-    "\"p\":{\"dev\":\"wlp3s0\",\"delay\":0,\"jitter\":0,\"loss\":0}}";
+    "\"p\":{\"dev\":\"wlp3s0\",\"delay\":0,\"jitter\":0,\"loss\":0,"
+    "\"dup\":1000,\"corrupt\":100,\"limit\":1000,\"ge_p\":0}}";
 
 const char *jt_set_netem_test_msg_get(void) { return jt_set_netem_test_msg; }
 
@@ -27,9 +28,19 @@ int jt_set_netem_printer(void *data, char *out, int len)
 	snprintf(out, len, "Impairment params:\n"
 	         "\tInterface:  %s\n"
 	         "\tDelay:      %dms\n"
-	         "\tJitter:  +/-%dms\n"
-	         "\tLoss:       %d",
-	         p->iface, p->delay, p->jitter, p->loss);
+	         "\tJitter:  +/-%dms %s\n"
+	         "\tLoss:       %dppm\n"
+	         "\tDuplicate:  %dppm\n"
+	         "\tReorder:    %dppm gap %d\n"
+	         "\tCorrupt:    %dppm\n"
+	         "\tRate:       %dkbit/s\n"
+	         "\tSlot:       %d-%dus\n"
+	         "\tDirection:  %s\n"
+	         "\tFlow:       %s:%d -> %s:%d proto %d",
+	         p->iface, p->delay, p->jitter, p->dist, p->loss, p->dup,
+	         p->reorder, p->gap, p->corrupt, p->rate, p->slot_min,
+	         p->slot_max, p->dir ? "ingress" : "egress", p->flow_src,
+	         p->flow_sport, p->flow_dst, p->flow_dport, p->flow_proto);
 	return 0;
 }
 
@@ -43,6 +54,7 @@ int jt_set_netem_packer(void *data, char **out)
 	json_object_set_new(p, "delay", json_integer(params->delay));
 	json_object_set_new(p, "jitter", json_integer(params->jitter));
 	json_object_set_new(p, "loss", json_integer(params->loss));
+	jt_netem_params_pack_ext(p, params);
 
 	json_object_set_new(
 	    t, "msg", json_string(jt_messages[JT_MSG_SET_NETEM_V1].key));
@@ -92,6 +104,10 @@ int jt_set_netem_unpacker(json_t *root, void **data)
 	}
 	params->loss = json_integer_value(token);
 
+	if (jt_netem_params_unpack_ext(params_token, params)) {
+		goto cleanup_unpack_fail;
+	}
+
 	*data = params;
 	json_object_clear(params_token);
 	return 0;
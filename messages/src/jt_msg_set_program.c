@@ -0,0 +1,179 @@
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_set_program.h"
+
+static const char *jt_set_program_test_msg =
+    "{\"msg\":\"set_program\", "
+    "\"p\":{\"dev\":\"wlp3s0\", \"name\":\"test\", \"ifaces\":[\"eth0\"], "
+    "\"steps\":["
+    "{\"t\":0, \"delay\":0, \"jitter\":0, \"loss\":0},"
+    "{\"t\":500, \"delay\":10, \"jitter\":2, \"loss\":0},"
+    "{\"t\":5000000, \"delay\":0, \"jitter\":0, \"loss\":0}]}}";
+
+const char *jt_set_program_test_msg_get(void)
+{
+	return jt_set_program_test_msg;
+}
+
+int jt_set_program_free(void *data)
+{
+	struct jt_msg_program *p = data;
+	free(p);
+	return 0;
+}
+
+int jt_set_program_printer(void *data, char *out, int len)
+{
+	struct jt_msg_program *p = data;
+
+	snprintf(out, len, "Impairment program:\n"
+	         "\tInterface:  %s (+%d)\n"
+	         "\tName:       %s\n"
+	         "\tSteps:      %d\n"
+	         "\tDuration:   %" PRIu64 "us",
+	         p->iface, p->iface_count, p->name, p->count,
+	         p->count ? p->steps[p->count - 1].t_us : 0);
+	return 0;
+}
+
+int jt_set_program_packer(void *data, char **out)
+{
+	struct jt_msg_program *prog = data;
+	json_t *t = json_object();
+	json_t *p = json_object();
+	json_t *steps = json_array();
+
+	for (int i = 0; i < prog->count; i++) {
+		json_t *s = json_object();
+		json_object_set_new(s, "t", json_integer(prog->steps[i].t_us));
+		json_object_set_new(s, "delay",
+		                    json_integer(prog->steps[i].delay));
+		json_object_set_new(s, "jitter",
+		                    json_integer(prog->steps[i].jitter));
+		json_object_set_new(s, "loss",
+		                    json_integer(prog->steps[i].loss));
+		json_array_append_new(steps, s);
+	}
+
+	json_object_set_new(p, "dev", json_string(prog->iface));
+	json_object_set_new(p, "name", json_string(prog->name));
+	json_object_set(p, "steps", steps);
+	if (prog->iface_count) {
+		json_t *ifaces = json_array();
+		for (int i = 0; i < prog->iface_count; i++) {
+			json_array_append_new(ifaces,
+			                      json_string(prog->ifaces[i]));
+		}
+		json_object_set_new(p, "ifaces", ifaces);
+	}
+
+	json_object_set_new(
+	    t, "msg", json_string(jt_messages[JT_MSG_SET_PROGRAM_V1].key));
+	json_object_set(t, "p", p);
+	*out = json_dumps(t, 0);
+	json_decref(steps);
+	json_object_clear(p);
+	json_decref(p);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_set_program_unpacker(json_t *root, void **data)
+{
+	json_t *params_token, *steps, *token;
+	struct jt_msg_program *prog;
+	uint64_t prev_t_us = 0;
+
+	params_token = json_object_get(root, "p");
+	assert(params_token);
+	assert(JSON_OBJECT == json_typeof(params_token));
+	assert(0 < json_object_size(params_token));
+
+	prog = calloc(1, sizeof(struct jt_msg_program));
+	assert(prog);
+
+	token = json_object_get(params_token, "dev");
+	if (!json_is_string(token)) {
+		goto cleanup_unpack_fail;
+	}
+	snprintf(prog->iface, MAX_IFACE_LEN, "%s", json_string_value(token));
+
+	token = json_object_get(params_token, "name");
+	if (json_is_string(token)) {
+		snprintf(prog->name, PROGRAM_NAME_LEN, "%s",
+		         json_string_value(token));
+	}
+
+	/* optional */
+	token = json_object_get(params_token, "ifaces");
+	if (token) {
+		if (!json_is_array(token)
+		    || json_array_size(token) > PROGRAM_MAX_IFACES) {
+			goto cleanup_unpack_fail;
+		}
+		prog->iface_count = json_array_size(token);
+		for (int i = 0; i < prog->iface_count; i++) {
+			json_t *iface = json_array_get(token, i);
+			if (!json_is_string(iface)) {
+				goto cleanup_unpack_fail;
+			}
+			snprintf(prog->ifaces[i], MAX_IFACE_LEN, "%s",
+			         json_string_value(iface));
+		}
+	}
+
+	steps = json_object_get(params_token, "steps");
+	if (!json_is_array(steps)
+	    || json_array_size(steps) > MAX_PROGRAM_STEPS) {
+		goto cleanup_unpack_fail;
+	}
+	prog->count = json_array_size(steps);
+
+	for (int i = 0; i < prog->count; i++) {
+		json_t *s = json_array_get(steps, i);
+
+		token = json_object_get(s, "t");
+		if (!json_is_integer(token) || json_integer_value(token) < 0) {
+			goto cleanup_unpack_fail;
+		}
+		prog->steps[i].t_us = json_integer_value(token);
+
+		/* steps must be in chronological order */
+		if (prog->steps[i].t_us < prev_t_us) {
+			goto cleanup_unpack_fail;
+		}
+		prev_t_us = prog->steps[i].t_us;
+
+		token = json_object_get(s, "delay");
+		if (!json_is_integer(token)) {
+			goto cleanup_unpack_fail;
+		}
+		prog->steps[i].delay = json_integer_value(token);
+
+		token = json_object_get(s, "jitter");
+		if (!json_is_integer(token)) {
+			goto cleanup_unpack_fail;
+		}
+		prog->steps[i].jitter = json_integer_value(token);
+
+		token = json_object_get(s, "loss");
+		if (!json_is_integer(token)) {
+			goto cleanup_unpack_fail;
+		}
+		prog->steps[i].loss = json_integer_value(token);
+	}
+
+	*data = prog;
+	return 0;
+
+cleanup_unpack_fail:
+	free(prog);
+	return -1;
+}
@@ -21,7 +21,7 @@ static const char *jt_stats_test_msg =
     "\"min_rx_pgap\":0,\"max_rx_pgap\":0,\"mean_rx_pgap\":0, "
     "\"min_tx_pgap\":0,\"max_tx_pgap\":0,\"mean_tx_pgap\":0}, "
     "\"whoosh_err_mean\": 42809, \"whoosh_err_max\": 54759, \"whoosh_err_sd\": "
-    "43249}}";
+    "43249, \"trace\": [310, 1250, 1262]}}";
 
 const char *jt_stats_test_msg_get(void) { return jt_stats_test_msg; }
 
@@ -180,6 +180,21 @@ int jt_stats_unpacker(json_t *root, void **data)
 	}
 	stats->timestamp.tv_nsec = json_integer_value(t);
 
+	/* older servers don't trace their messages */
+	memset(stats->trace_us, 0, sizeof(stats->trace_us));
+	t = json_object_get(params, "trace");
+	if (json_is_array(t)) {
+		for (size_t i = 0;
+		     i < json_array_size(t) && i < JT_TRACE_STAGES; i++) {
+			json_t *us = json_array_get(t, i);
+			if (!json_is_integer(us)) {
+				goto unpack_fail;
+			}
+			stats->trace_us[i] = json_integer_value(us);
+		}
+	}
+	stats->sample_ns = 0;
+
 	*data = stats;
 	json_object_clear(params);
 	return 0;
@@ -191,12 +206,12 @@ unpack_fail:
 
 int jt_stats_packer(void *data, char **out)
 {
-	struct timespec mts; /* message timestamp */
 	struct jt_msg_stats *stats_msg = data;
 	json_t *t = json_object();
 	json_t *stats = json_object();
 	json_t *params = json_object();
 	json_t *jmts = json_object();
+	json_t *trace = json_array();
 
 	json_object_set_new(params, "iface", json_string(stats_msg->iface));
 	json_object_set_new(params, "ival_ns",
@@ -237,12 +252,19 @@ int jt_stats_packer(void *data, char **out)
 	                    json_string(jt_messages[JT_MSG_STATS_V1].key));
 	json_object_set(t, "p", params);
 
-	/* timestamp the new message */
-	clock_gettime(CLOCK_MONOTONIC, &mts);
-	json_object_set_new(jmts, "tv_sec", json_integer(mts.tv_sec));
-	json_object_set_new(jmts, "tv_nsec", json_integer(mts.tv_nsec));
+	/* the time of the sample, not of the message */
+	json_object_set_new(jmts, "tv_sec",
+	                    json_integer(stats_msg->timestamp.tv_sec));
+	json_object_set_new(jmts, "tv_nsec",
+	                    json_integer(stats_msg->timestamp.tv_nsec));
 	json_object_set_new(params, "t", jmts);
 
+	for (int i = 0; i < JT_TRACE_STAGES; i++) {
+		json_array_append_new(trace,
+		                      json_integer(stats_msg->trace_us[i]));
+	}
+	json_object_set_new(params, "trace", trace);
+
 	*out = json_dumps(t, 0);
 	json_object_clear(stats);
 	json_decref(stats);
@@ -17,9 +17,14 @@ static const char *tt_test_msg =
     "{\"msg\":\"toptalk\","
     " \"p\":{\"tflows\":5, \"tbytes\": 9999, \"tpackets\": 888,"
     " \"interval_ns\": 123,"
+    " \"distinct\": {\"flows\": 5, \"src\": 1, \"dst\": 1, \"dport\": 5},"
+    " \"pgaps\": {\"rx\": {\"n\": 9, \"min\": 800, \"max\": 70000,"
+    " \"mean\": 11000, \"h\": [1, 0, 0, 2, 4, 0, 1, 1]},"
+    " \"tx\": {\"n\": 0, \"min\": 0, \"max\": 0, \"mean\": 0, \"h\": []}},"
+    " \"psizes\": {\"rx\": [0, 2, 0, 0, 0, 8], \"tx\": []},"
     " \"timestamp\": {\"tv_sec\": 123, \"tv_nsec\": 456},"
     " \"flows\": ["
-    "{\"src\":\"192.168.0.1\", \"dst\": \"192.168.0.2\", \"sport\":32000, \"dport\":32000, \"proto\": \"udp\", \"bytes\":100, \"packets\":10, \"tclass\":\"af11\" },"
+    "{\"src\":\"192.168.0.1\", \"dst\": \"192.168.0.2\", \"sport\":32000, \"dport\":32000, \"proto\": \"udp\", \"bytes\":100, \"packets\":10, \"tclass\":\"af11\", \"sizes\": [0, 2, 0, 0, 0, 8] },"
     "{\"src\":\"192.168.0.1\", \"dst\": \"192.168.0.2\", \"sport\":32001, \"dport\":32001, \"proto\": \"udp\", \"bytes\":100, \"packets\":10, \"tclass\":\"BE\"},"
     "{\"src\":\"192.168.0.1\", \"dst\": \"192.168.0.2\", \"sport\":32002, \"dport\":32002, \"proto\": \"udp\", \"tclass\":\"EF\", \"bytes\":100, \"packets\":10},"
     "{\"src\":\"192.168.0.1\", \"dst\": \"192.168.0.2\", \"sport\":32003, \"dport\":32003, \"tclass\":\"cs1\", \"proto\": \"udp\", \"bytes\":100, \"packets\":10},"
@@ -28,6 +33,213 @@ static const char *tt_test_msg =
 
 const char* jt_toptalk_test_msg_get(void) { return tt_test_msg; }
 
+json_t *jt_distinct_pack(const struct jt_msg_distinct *d)
+{
+	json_t *o = json_object();
+
+	json_object_set_new(o, "flows", json_integer(d->flows));
+	json_object_set_new(o, "src", json_integer(d->sources));
+	json_object_set_new(o, "dst", json_integer(d->destinations));
+	json_object_set_new(o, "dport", json_integer(d->dports));
+	return o;
+}
+
+/* optional, all zero if missing */
+int jt_distinct_unpack(json_t *params, struct jt_msg_distinct *d)
+{
+	json_t *o = json_object_get(params, "distinct");
+	json_t *flows, *src, *dst, *dport;
+
+	memset(d, 0, sizeof(*d));
+	if (!o) {
+		return 0;
+	}
+
+	flows = json_object_get(o, "flows");
+	src = json_object_get(o, "src");
+	dst = json_object_get(o, "dst");
+	dport = json_object_get(o, "dport");
+	if (!json_is_integer(flows) || !json_is_integer(src)
+	    || !json_is_integer(dst) || !json_is_integer(dport)) {
+		return -1;
+	}
+	d->flows = json_integer_value(flows);
+	d->sources = json_integer_value(src);
+	d->destinations = json_integer_value(dst);
+	d->dports = json_integer_value(dport);
+	return 0;
+}
+
+static const char *const pgap_dir_keys[JT_PGAP_DIRS] = {
+	[JT_PGAP_RX] = "rx",
+	[JT_PGAP_TX] = "tx"
+};
+
+void jt_pgaps_pack(json_t *params, const struct jt_msg_pgaps *p)
+{
+	json_t *o;
+
+	if (!p[JT_PGAP_RX].count && !p[JT_PGAP_TX].count) {
+		return;
+	}
+
+	o = json_object();
+	for (int d = 0; d < JT_PGAP_DIRS; d++) {
+		json_t *dir = json_object();
+		json_t *hist = json_array();
+		int used = 0;
+
+		json_object_set_new(dir, "n", json_integer(p[d].count));
+		json_object_set_new(dir, "min", json_integer(p[d].min_ns));
+		json_object_set_new(dir, "max", json_integer(p[d].max_ns));
+		json_object_set_new(dir, "mean", json_integer(p[d].mean_ns));
+
+		for (int b = 0; b < JT_PGAP_BUCKETS; b++) {
+			if (p[d].hist[b]) {
+				used = b + 1;
+			}
+		}
+		for (int b = 0; b < used; b++) {
+			json_array_append_new(hist, json_integer(p[d].hist[b]));
+		}
+		json_object_set_new(dir, "h", hist);
+		json_object_set_new(o, pgap_dir_keys[d], dir);
+	}
+	json_object_set_new(params, "pgaps", o);
+}
+
+/* optional, all zero if missing */
+int jt_pgaps_unpack(json_t *params, struct jt_msg_pgaps *p)
+{
+	json_t *o = json_object_get(params, "pgaps");
+
+	memset(p, 0, JT_PGAP_DIRS * sizeof(*p));
+	if (!o) {
+		return 0;
+	}
+
+	for (int d = 0; d < JT_PGAP_DIRS; d++) {
+		json_t *dir = json_object_get(o, pgap_dir_keys[d]);
+		json_t *n, *min, *max, *mean, *hist;
+
+		if (!json_is_object(dir)) {
+			return -1;
+		}
+		n = json_object_get(dir, "n");
+		min = json_object_get(dir, "min");
+		max = json_object_get(dir, "max");
+		mean = json_object_get(dir, "mean");
+		hist = json_object_get(dir, "h");
+		if (!json_is_integer(n) || !json_is_integer(min)
+		    || !json_is_integer(max) || !json_is_integer(mean)
+		    || !json_is_array(hist)
+		    || json_array_size(hist) > JT_PGAP_BUCKETS) {
+			return -1;
+		}
+		p[d].count = json_integer_value(n);
+		p[d].min_ns = json_integer_value(min);
+		p[d].max_ns = json_integer_value(max);
+		p[d].mean_ns = json_integer_value(mean);
+
+		for (size_t b = 0; b < json_array_size(hist); b++) {
+			json_t *c = json_array_get(hist, b);
+
+			if (!json_is_integer(c)) {
+				return -1;
+			}
+			p[d].hist[b] = json_integer_value(c);
+		}
+	}
+	return 0;
+}
+
+json_t *jt_psize_hist_pack(const uint32_t *hist)
+{
+	json_t *a;
+	int used = 0;
+
+	for (int b = 0; b < JT_PSIZE_BUCKETS; b++) {
+		if (hist[b]) {
+			used = b + 1;
+		}
+	}
+	if (!used) {
+		return NULL;
+	}
+
+	a = json_array();
+	for (int b = 0; b < used; b++) {
+		json_array_append_new(a, json_integer(hist[b]));
+	}
+	return a;
+}
+
+/* optional, all zero if a is missing */
+int jt_psize_hist_unpack(json_t *a, uint32_t *hist)
+{
+	memset(hist, 0, JT_PSIZE_BUCKETS * sizeof(*hist));
+	if (!a) {
+		return 0;
+	}
+
+	if (!json_is_array(a) || json_array_size(a) > JT_PSIZE_BUCKETS) {
+		return -1;
+	}
+	for (size_t b = 0; b < json_array_size(a); b++) {
+		json_t *c = json_array_get(a, b);
+
+		if (!json_is_integer(c)) {
+			return -1;
+		}
+		hist[b] = json_integer_value(c);
+	}
+	return 0;
+}
+
+void jt_psizes_pack(json_t *params, const uint32_t *psizes)
+{
+	json_t *dirs[JT_PGAP_DIRS];
+	json_t *o;
+
+	for (int d = 0; d < JT_PGAP_DIRS; d++) {
+		dirs[d] = jt_psize_hist_pack(psizes + d * JT_PSIZE_BUCKETS);
+	}
+	if (!dirs[JT_PGAP_RX] && !dirs[JT_PGAP_TX]) {
+		return;
+	}
+
+	o = json_object();
+	for (int d = 0; d < JT_PGAP_DIRS; d++) {
+		json_object_set_new(o, pgap_dir_keys[d],
+		                    dirs[d] ? dirs[d] : json_array());
+	}
+	json_object_set_new(params, "psizes", o);
+}
+
+/* optional, all zero if missing */
+int jt_psizes_unpack(json_t *params,
+                     uint32_t psizes[JT_PGAP_DIRS][JT_PSIZE_BUCKETS])
+{
+	json_t *o = json_object_get(params, "psizes");
+
+	memset(psizes, 0, JT_PGAP_DIRS * sizeof(psizes[0]));
+	if (!o) {
+		return 0;
+	}
+	if (!json_is_object(o)) {
+		return -1;
+	}
+
+	for (int d = 0; d < JT_PGAP_DIRS; d++) {
+		json_t *a = json_object_get(o, pgap_dir_keys[d]);
+
+		if (!a || jt_psize_hist_unpack(a, psizes[d])) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
 int jt_toptalk_printer(void *data, char *out, int len)
 {
 	struct jt_msg_toptalk *t = (struct jt_msg_toptalk*)data;
@@ -77,6 +289,18 @@ int jt_toptalk_unpacker(json_t *root, void **data)
 	}
 	tt->interval_ns = json_integer_value(t);
 
+	if (jt_distinct_unpack(params, &tt->distinct)) {
+		goto unpack_fail;
+	}
+
+	if (jt_pgaps_unpack(params, tt->pgaps)) {
+		goto unpack_fail;
+	}
+
+	if (jt_psizes_unpack(params, tt->psizes)) {
+		goto unpack_fail;
+	}
+
 	timestamp = json_object_get(params, "timestamp");
 	if ((JSON_OBJECT != json_typeof(timestamp))
 	    || (0 == json_object_size(timestamp)))
@@ -120,6 +344,11 @@ int jt_toptalk_unpacker(json_t *root, void **data)
 		}
 		tt->flows[i].packets = json_integer_value(t);
 
+		if (jt_psize_hist_unpack(json_object_get(f, "sizes"),
+		                         tt->flows[i].sizes)) {
+			goto unpack_fail;
+		}
+
 		t = json_object_get(f, "sport");
 		if (!json_is_integer(t)) {
 			goto unpack_fail;
@@ -178,6 +407,7 @@ int jt_toptalk_packer(void *data, char **out)
 	json_t *params = json_object();
 	json_t *flows_arr = json_array();
 	json_t *flows[MAX_FLOWS];
+	json_t *sizes;
 
 	assert(tt_msg);
 
@@ -186,6 +416,10 @@ int jt_toptalk_packer(void *data, char **out)
 	json_object_set_new(params, "tpackets", json_integer(tt_msg->tpackets));
 	json_object_set_new(params, "interval_ns",
 	                    json_integer(tt_msg->interval_ns));
+	json_object_set_new(params, "distinct",
+	                    jt_distinct_pack(&tt_msg->distinct));
+	jt_pgaps_pack(params, tt_msg->pgaps);
+	jt_psizes_pack(params, tt_msg->psizes[0]);
 
 	json_object_set(timestamp, "tv_sec", json_integer(tt_msg->timestamp.tv_sec));
 	json_object_set(timestamp, "tv_nsec", json_integer(tt_msg->timestamp.tv_nsec));
@@ -205,6 +439,10 @@ int jt_toptalk_packer(void *data, char **out)
 		                    json_integer(tt_msg->flows[i].bytes));
 		json_object_set_new(flows[i], "packets",
 		                    json_integer(tt_msg->flows[i].packets));
+		sizes = jt_psize_hist_pack(tt_msg->flows[i].sizes);
+		if (sizes) {
+			json_object_set_new(flows[i], "sizes", sizes);
+		}
 		json_object_set_new(flows[i], "sport",
 		                    json_integer(tt_msg->flows[i].sport));
 		json_object_set_new(flows[i], "dport",
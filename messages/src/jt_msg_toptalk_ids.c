@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+#include <inttypes.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_toptalk_ids.h"
+
+static const char *jt_toptalk_ids_test_msg =
+    "{\"msg\":\"toptalk_ids\","
+    " \"p\":{\"tflows\":5, \"tbytes\":9999, \"tpackets\":888,"
+    " \"interval_ns\":5000000,"
+    " \"distinct\":{\"flows\":5, \"src\":2, \"dst\":3, \"dport\":4},"
+    " \"pgaps\":{\"rx\":{\"n\":3, \"min\":900, \"max\":5000,"
+    " \"mean\":2300, \"h\":[1, 0, 1, 1]},"
+    " \"tx\":{\"n\":1, \"min\":40000, \"max\":40000, \"mean\":40000,"
+    " \"h\":[0, 0, 0, 0, 0, 0, 1]}},"
+    " \"psizes\":{\"rx\":[0, 1, 0, 0, 0, 14], \"tx\":[1]},"
+    " \"timestamp\":{\"tv_sec\":123, \"tv_nsec\":456},"
+    " \"f\":[[0, 100, 10, [0, 0, 0, 0, 0, 10]], [7, 50, 5], [3, 20, 1]]}}";
+
+const char *jt_toptalk_ids_test_msg_get(void)
+{
+	return jt_toptalk_ids_test_msg;
+}
+
+int jt_toptalk_ids_free(void *data)
+{
+	struct jt_msg_toptalk_ids *t = data;
+	free(t);
+	return 0;
+}
+
+int jt_toptalk_ids_printer(void *data, char *out, int len)
+{
+	struct jt_msg_toptalk_ids *t = data;
+
+	snprintf(out, len,
+	         "t:%ld.%09ld fc:%" PRId32 ", b: %" PRId64 ", p:%" PRId64 "",
+	         t->timestamp.tv_sec, t->timestamp.tv_nsec, t->tflows,
+	         t->tbytes, t->tpackets);
+	return 0;
+}
+
+json_t *jt_toptalk_ids_pack_params(const struct jt_msg_toptalk_ids *tt)
+{
+	json_t *params = json_object();
+	json_t *timestamp = json_object();
+	json_t *flows = json_array();
+	json_t *sizes;
+
+	json_object_set_new(params, "tflows", json_integer(tt->tflows));
+	json_object_set_new(params, "tbytes", json_integer(tt->tbytes));
+	json_object_set_new(params, "tpackets", json_integer(tt->tpackets));
+	json_object_set_new(params, "interval_ns",
+	                    json_integer(tt->interval_ns));
+	json_object_set_new(params, "distinct", jt_distinct_pack(&tt->distinct));
+	jt_pgaps_pack(params, tt->pgaps);
+	jt_psizes_pack(params, tt->psizes[0]);
+
+	json_object_set_new(timestamp, "tv_sec",
+	                    json_integer(tt->timestamp.tv_sec));
+	json_object_set_new(timestamp, "tv_nsec",
+	                    json_integer(tt->timestamp.tv_nsec));
+	json_object_set_new(params, "timestamp", timestamp);
+
+	for (int i = 0; i < tt->count; i++) {
+		json_t *f = json_array();
+		json_array_append_new(f, json_integer(tt->flows[i].id));
+		json_array_append_new(f, json_integer(tt->flows[i].bytes));
+		json_array_append_new(f, json_integer(tt->flows[i].packets));
+		sizes = jt_psize_hist_pack(tt->flows[i].sizes);
+		if (sizes) {
+			json_array_append_new(f, sizes);
+		}
+		json_array_append_new(flows, f);
+	}
+	json_object_set_new(params, "f", flows);
+	return params;
+}
+
+int jt_toptalk_ids_packer(void *data, char **out)
+{
+	struct jt_msg_toptalk_ids *tt = data;
+	json_t *t = json_object();
+	json_t *params = jt_toptalk_ids_pack_params(tt);
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_TOPTALK_IDS_V1].key));
+	json_object_set(t, "p", params);
+	*out = json_dumps(t, 0);
+	json_object_clear(params);
+	json_decref(params);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_toptalk_ids_unpack_params(json_t *params, struct jt_msg_toptalk_ids *tt)
+{
+	json_t *t, *timestamp, *flows;
+
+	if (!json_is_object(params)) {
+		return -1;
+	}
+
+	t = json_object_get(params, "tflows");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	tt->tflows = json_integer_value(t);
+
+	t = json_object_get(params, "tbytes");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	tt->tbytes = json_integer_value(t);
+
+	t = json_object_get(params, "tpackets");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	tt->tpackets = json_integer_value(t);
+
+	t = json_object_get(params, "interval_ns");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	tt->interval_ns = json_integer_value(t);
+
+	if (jt_distinct_unpack(params, &tt->distinct)) {
+		return -1;
+	}
+
+	if (jt_pgaps_unpack(params, tt->pgaps)) {
+		return -1;
+	}
+
+	if (jt_psizes_unpack(params, tt->psizes)) {
+		return -1;
+	}
+
+	timestamp = json_object_get(params, "timestamp");
+	if (!json_is_object(timestamp)) {
+		return -1;
+	}
+	t = json_object_get(timestamp, "tv_sec");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	tt->timestamp.tv_sec = json_integer_value(t);
+
+	t = json_object_get(timestamp, "tv_nsec");
+	if (!json_is_integer(t)) {
+		return -1;
+	}
+	tt->timestamp.tv_nsec = json_integer_value(t);
+
+	flows = json_object_get(params, "f");
+	if (!json_is_array(flows) || json_array_size(flows) > MAX_FLOWS) {
+		return -1;
+	}
+
+	tt->count = json_array_size(flows);
+	for (int i = 0; i < tt->count; i++) {
+		json_t *f = json_array_get(flows, i);
+		json_t *id = json_array_get(f, 0);
+		json_t *bytes = json_array_get(f, 1);
+		json_t *packets = json_array_get(f, 2);
+
+		if (!json_is_integer(id) || !json_is_integer(bytes)
+		    || !json_is_integer(packets)) {
+			return -1;
+		}
+		tt->flows[i].id = json_integer_value(id);
+		tt->flows[i].bytes = json_integer_value(bytes);
+		tt->flows[i].packets = json_integer_value(packets);
+		if (jt_psize_hist_unpack(json_array_get(f, 3),
+		                         tt->flows[i].sizes)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int jt_toptalk_ids_unpacker(json_t *root, void **data)
+{
+	json_t *params;
+	struct jt_msg_toptalk_ids *tt;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	tt = calloc(1, sizeof(struct jt_msg_toptalk_ids));
+	assert(tt);
+
+	if (jt_toptalk_ids_unpack_params(params, tt)) {
+		free(tt);
+		json_object_clear(params);
+		return -1;
+	}
+
+	*data = tt;
+	json_object_clear(params);
+	return 0;
+}
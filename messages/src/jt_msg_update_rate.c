@@ -0,0 +1,189 @@
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_update_rate.h"
+
+static const char *jt_update_rate_test_msg =
+    "{\"msg\":\"update_rate\", "
+    "\"p\":{\"max_rate\":10, \"stats\":[100000000], "
+    "\"toptalk\":[100000000, 1000000000], \"flow_ids\":1, "
+    "\"rollups\":[\"src/24\", \"dport\"]}}";
+
+const char *jt_update_rate_test_msg_get(void)
+{
+	return jt_update_rate_test_msg;
+}
+
+int jt_update_rate_free(void *data)
+{
+	struct jt_msg_update_rate *u = data;
+	free(u);
+	return 0;
+}
+
+static void ivals_print(char *out, int len, const int64_t *ivals, int count)
+{
+	int i, n;
+
+	if (count < 0) {
+		snprintf(out, len, "all");
+		return;
+	}
+	out[0] = '\0';
+	for (i = 0; i < count && len > 1; i++) {
+		n = snprintf(out, len, "%s%" PRId64 "ms", i ? "," : "",
+		             ivals[i] / 1000000);
+		if (n < 0 || n >= len) {
+			break;
+		}
+		out += n;
+		len -= n;
+	}
+}
+
+int jt_update_rate_printer(void *data, char *out, int len)
+{
+	struct jt_msg_update_rate *u = data;
+	char stats[128], tt[128];
+
+	ivals_print(stats, sizeof(stats), u->stats, u->stats_count);
+	ivals_print(tt, sizeof(tt), u->tt, u->tt_count);
+	snprintf(out, len,
+	         "Update rate: %d/s, stats: %s, toptalk: %s%s, rollups: %d",
+	         u->max_rate, stats, tt, u->flow_ids ? " (by flow id)" : "",
+	         u->rollup_count);
+	return 0;
+}
+
+static json_t *ivals_pack(const int64_t *ivals, int count)
+{
+	json_t *a = json_array();
+	int i;
+
+	for (i = 0; i < count; i++) {
+		json_array_append_new(a, json_integer(ivals[i]));
+	}
+	return a;
+}
+
+int jt_update_rate_packer(void *data, char **out)
+{
+	struct jt_msg_update_rate *u = data;
+	json_t *t = json_object();
+	json_t *p = json_object();
+
+	json_object_set_new(p, "max_rate", json_integer(u->max_rate));
+	if (u->stats_count >= 0) {
+		json_object_set_new(p, "stats",
+		                    ivals_pack(u->stats, u->stats_count));
+	}
+	if (u->tt_count >= 0) {
+		json_object_set_new(p, "toptalk", ivals_pack(u->tt, u->tt_count));
+	}
+	json_object_set_new(p, "flow_ids", json_integer(u->flow_ids));
+	if (u->rollup_count) {
+		json_t *a = json_array();
+		for (int i = 0; i < u->rollup_count; i++) {
+			json_array_append_new(a, json_string(u->rollups[i]));
+		}
+		json_object_set_new(p, "rollups", a);
+	}
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_UPDATE_RATE_V1].key));
+	json_object_set(t, "p", p);
+	*out = json_dumps(t, 0);
+	json_object_clear(p);
+	json_decref(p);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+/* a missing list means all intervals */
+static int ivals_unpack(json_t *params_token, const char *key,
+                        int64_t *ivals, int *count)
+{
+	json_t *token;
+
+	token = json_object_get(params_token, key);
+	if (!token) {
+		*count = -1;
+		return 0;
+	}
+	if (!json_is_array(token)
+	    || json_array_size(token) > UPDATE_RATE_MAX_IVALS) {
+		return -1;
+	}
+	*count = json_array_size(token);
+	for (int i = 0; i < *count; i++) {
+		json_t *ival = json_array_get(token, i);
+		if (!json_is_integer(ival) || json_integer_value(ival) <= 0) {
+			return -1;
+		}
+		ivals[i] = json_integer_value(ival);
+	}
+	return 0;
+}
+
+int jt_update_rate_unpacker(json_t *root, void **data)
+{
+	json_t *params_token, *token;
+	struct jt_msg_update_rate *u;
+
+	params_token = json_object_get(root, "p");
+	assert(params_token);
+	assert(JSON_OBJECT == json_typeof(params_token));
+
+	u = calloc(1, sizeof(struct jt_msg_update_rate));
+	assert(u);
+
+	token = json_object_get(params_token, "max_rate");
+	if (!json_is_integer(token) || json_integer_value(token) < 0) {
+		goto cleanup_unpack_fail;
+	}
+	u->max_rate = json_integer_value(token);
+
+	if (ivals_unpack(params_token, "stats", u->stats, &u->stats_count)
+	    || ivals_unpack(params_token, "toptalk", u->tt, &u->tt_count)) {
+		goto cleanup_unpack_fail;
+	}
+
+	/* optional */
+	token = json_object_get(params_token, "flow_ids");
+	if (json_is_integer(token)) {
+		u->flow_ids = json_integer_value(token);
+	}
+
+	/* optional, none if missing */
+	token = json_object_get(params_token, "rollups");
+	if (token) {
+		if (!json_is_array(token)
+		    || json_array_size(token) > UPDATE_RATE_MAX_IVALS) {
+			goto cleanup_unpack_fail;
+		}
+		u->rollup_count = json_array_size(token);
+		for (int i = 0; i < u->rollup_count; i++) {
+			json_t *name = json_array_get(token, i);
+			if (!json_is_string(name)) {
+				goto cleanup_unpack_fail;
+			}
+			snprintf(u->rollups[i], ROLLUP_NAME_LEN, "%s",
+			         json_string_value(name));
+		}
+	}
+
+	*data = u;
+	json_object_clear(params_token);
+	return 0;
+
+cleanup_unpack_fail:
+	free(u);
+	json_object_clear(params_token);
+	return -1;
+}
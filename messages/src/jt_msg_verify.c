@@ -0,0 +1,107 @@
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_verify.h"
+
+static const char *jt_verify_test_msg =
+    "{\"msg\":\"verify\", "
+    "\"p\":{\"dev\":\"veth0\", \"enable\":1, \"probe_dst\":\"10.0.0.2\", "
+    "\"probe_port\":7777, \"probe_rate\":100}}";
+
+const char *jt_verify_test_msg_get(void) { return jt_verify_test_msg; }
+
+int jt_verify_free(void *data)
+{
+	struct jt_msg_verify *v = data;
+	free(v);
+	return 0;
+}
+
+int jt_verify_printer(void *data, char *out, int len)
+{
+	struct jt_msg_verify *v = data;
+
+	snprintf(out, len, "Verification %s on %s, probes: %s:%d at %d/s",
+	         v->enable ? "enabled" : "disabled", v->iface,
+	         v->probe_dst[0] ? v->probe_dst : "none", v->probe_port,
+	         v->probe_rate);
+	return 0;
+}
+
+int jt_verify_packer(void *data, char **out)
+{
+	struct jt_msg_verify *v = data;
+	json_t *t = json_object();
+	json_t *p = json_object();
+
+	json_object_set_new(p, "dev", json_string(v->iface));
+	json_object_set_new(p, "enable", json_integer(v->enable));
+	json_object_set_new(p, "probe_dst", json_string(v->probe_dst));
+	json_object_set_new(p, "probe_port", json_integer(v->probe_port));
+	json_object_set_new(p, "probe_rate", json_integer(v->probe_rate));
+
+	json_object_set_new(t, "msg",
+	                    json_string(jt_messages[JT_MSG_VERIFY_V1].key));
+	json_object_set(t, "p", p);
+	*out = json_dumps(t, 0);
+	json_object_clear(p);
+	json_decref(p);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_verify_unpacker(json_t *root, void **data)
+{
+	json_t *params_token, *token;
+	struct jt_msg_verify *v;
+
+	params_token = json_object_get(root, "p");
+	assert(params_token);
+	assert(JSON_OBJECT == json_typeof(params_token));
+
+	v = calloc(1, sizeof(struct jt_msg_verify));
+	assert(v);
+
+	token = json_object_get(params_token, "dev");
+	if (!json_is_string(token)) {
+		goto cleanup_unpack_fail;
+	}
+	snprintf(v->iface, MAX_IFACE_LEN, "%s", json_string_value(token));
+
+	token = json_object_get(params_token, "enable");
+	if (!json_is_integer(token)) {
+		goto cleanup_unpack_fail;
+	}
+	v->enable = json_integer_value(token);
+
+	/* the probe settings are optional */
+	token = json_object_get(params_token, "probe_dst");
+	if (json_is_string(token)) {
+		snprintf(v->probe_dst, VERIFY_ADDR_LEN, "%s",
+		         json_string_value(token));
+	}
+
+	token = json_object_get(params_token, "probe_port");
+	if (json_is_integer(token)) {
+		v->probe_port = json_integer_value(token);
+	}
+
+	token = json_object_get(params_token, "probe_rate");
+	if (json_is_integer(token)) {
+		v->probe_rate = json_integer_value(token);
+	}
+
+	*data = v;
+	json_object_clear(params_token);
+	return 0;
+
+cleanup_unpack_fail:
+	free(v);
+	json_object_clear(params_token);
+	return -1;
+}
@@ -0,0 +1,155 @@
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jt_msg_verify_result.h"
+
+static const char *jt_verify_result_test_msg =
+    "{\"msg\":\"verify_result\", \"p\":{\"iface\":\"veth0\", "
+    "\"interval_ms\":1000, \"cfg_delay_us\":20000, \"cfg_jitter_us\":5000, "
+    "\"cfg_loss_ppm\":10000, \"qd_packets\":10210, \"qd_drops\":98, "
+    "\"qd_requeues\":0, \"qd_overlimits\":0, \"qd_backlog_max\":42000, "
+    "\"qd_qlen_max\":310, \"probes_sent\":100, \"probes_lost\":1, "
+    "\"loss_ppm\":10000, \"delay_min_us\":15020, \"delay_max_us\":24970, "
+    "\"delay_mean_us\":20011, \"jitter_us\":2890, "
+    "\"delay_pctl_us\":[15070, 15500, 17450, 20010, 22500, 24500, 24900]}}";
+
+static const struct {
+	const char *key;
+	size_t offset;
+} fields[] = {
+	{ "interval_ms", offsetof(struct jt_msg_verify_result, interval_ms) },
+	{ "cfg_delay_us", offsetof(struct jt_msg_verify_result, cfg_delay_us) },
+	{ "cfg_jitter_us",
+	  offsetof(struct jt_msg_verify_result, cfg_jitter_us) },
+	{ "cfg_loss_ppm", offsetof(struct jt_msg_verify_result, cfg_loss_ppm) },
+	{ "qd_packets", offsetof(struct jt_msg_verify_result, qd_packets) },
+	{ "qd_drops", offsetof(struct jt_msg_verify_result, qd_drops) },
+	{ "qd_requeues", offsetof(struct jt_msg_verify_result, qd_requeues) },
+	{ "qd_overlimits",
+	  offsetof(struct jt_msg_verify_result, qd_overlimits) },
+	{ "qd_backlog_max",
+	  offsetof(struct jt_msg_verify_result, qd_backlog_max) },
+	{ "qd_qlen_max", offsetof(struct jt_msg_verify_result, qd_qlen_max) },
+	{ "probes_sent", offsetof(struct jt_msg_verify_result, probes_sent) },
+	{ "probes_lost", offsetof(struct jt_msg_verify_result, probes_lost) },
+	{ "loss_ppm", offsetof(struct jt_msg_verify_result, loss_ppm) },
+	{ "delay_min_us", offsetof(struct jt_msg_verify_result, delay_min_us) },
+	{ "delay_max_us", offsetof(struct jt_msg_verify_result, delay_max_us) },
+	{ "delay_mean_us",
+	  offsetof(struct jt_msg_verify_result, delay_mean_us) },
+	{ "jitter_us", offsetof(struct jt_msg_verify_result, jitter_us) },
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+#define FIELD(r, i) ((int64_t *)((char *)(r) + fields[(i)].offset))
+
+const char *jt_verify_result_test_msg_get(void)
+{
+	return jt_verify_result_test_msg;
+}
+
+int jt_verify_result_free(void *data)
+{
+	struct jt_msg_verify_result *r = data;
+	free(r);
+	return 0;
+}
+
+int jt_verify_result_printer(void *data, char *out, int len)
+{
+	struct jt_msg_verify_result *r = data;
+
+	snprintf(out, len, "Verification of %s over %" PRId64 "ms:\n"
+	         "\tDelay:  configured %" PRId64 "us, observed %" PRId64 "us\n"
+	         "\tJitter: configured %" PRId64 "us, observed %" PRId64 "us\n"
+	         "\tLoss:   configured %" PRId64 "ppm, observed %" PRId64
+	         "ppm\n"
+	         "\tQdisc:  %" PRId64 " drops, %" PRId64 " requeues, "
+	         "backlog max %" PRId64 " bytes",
+	         r->iface, r->interval_ms, r->cfg_delay_us, r->delay_mean_us,
+	         r->cfg_jitter_us, r->jitter_us, r->cfg_loss_ppm, r->loss_ppm,
+	         r->qd_drops, r->qd_requeues, r->qd_backlog_max);
+	return 0;
+}
+
+int jt_verify_result_packer(void *data, char **out)
+{
+	struct jt_msg_verify_result *r = data;
+	json_t *t = json_object();
+	json_t *p = json_object();
+	json_t *pctl = json_array();
+
+	json_object_set_new(p, "iface", json_string(r->iface));
+	for (size_t i = 0; i < FIELD_COUNT; i++) {
+		json_object_set_new(p, fields[i].key,
+		                    json_integer(*FIELD(r, i)));
+	}
+	for (int i = 0; i < VERIFY_PCTL_COUNT; i++) {
+		json_array_append_new(pctl, json_integer(r->delay_pctl_us[i]));
+	}
+	json_object_set(p, "delay_pctl_us", pctl);
+
+	json_object_set_new(
+	    t, "msg", json_string(jt_messages[JT_MSG_VERIFY_RESULT_V1].key));
+	json_object_set(t, "p", p);
+	*out = json_dumps(t, 0);
+	json_decref(pctl);
+	json_object_clear(p);
+	json_decref(p);
+	json_object_clear(t);
+	json_decref(t);
+	return 0;
+}
+
+int jt_verify_result_unpacker(json_t *root, void **data)
+{
+	json_t *params, *token;
+	struct jt_msg_verify_result *r;
+
+	params = json_object_get(root, "p");
+	assert(params);
+	assert(JSON_OBJECT == json_typeof(params));
+
+	r = malloc(sizeof(struct jt_msg_verify_result));
+	assert(r);
+
+	token = json_object_get(params, "iface");
+	if (!json_is_string(token)) {
+		goto unpack_fail;
+	}
+	snprintf(r->iface, MAX_IFACE_LEN, "%s", json_string_value(token));
+
+	for (size_t i = 0; i < FIELD_COUNT; i++) {
+		token = json_object_get(params, fields[i].key);
+		if (!json_is_integer(token)) {
+			goto unpack_fail;
+		}
+		*FIELD(r, i) = json_integer_value(token);
+	}
+
+	token = json_object_get(params, "delay_pctl_us");
+	if (!json_is_array(token)
+	    || VERIFY_PCTL_COUNT != json_array_size(token)) {
+		goto unpack_fail;
+	}
+	for (int i = 0; i < VERIFY_PCTL_COUNT; i++) {
+		json_t *v = json_array_get(token, i);
+		if (!json_is_integer(v)) {
+			goto unpack_fail;
+		}
+		r->delay_pctl_us[i] = json_integer_value(v);
+	}
+
+	*data = r;
+	return 0;
+
+unpack_fail:
+	free(r);
+	return -1;
+}
@@ -0,0 +1,188 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "proto.h"
+
+/*
+ * Compresses a stream of stats and toptalk_ids messages, in the format and
+ * mix that jt-server sends, the way permessage-deflate (RFC 7692) does:
+ * raw deflate, each message ending in a sync flush with its 00 00 ff ff
+ * tail removed. Reports the bytes on the wire and the CPU time per message
+ * with and without compression and for a few settings, including the
+ * WS_DEFLATE_* ones that jt-server uses. The CPU time includes making up
+ * the messages, which is all that "none" measures.
+ *
+ * Usage: bench-deflate [message count]
+ */
+
+#define MSG_LEN 2048
+
+struct setting {
+	const char *name;
+	int level;
+	int window_bits;
+	int mem_level;
+	int takeover; /* keep the window from one message to the next */
+};
+
+static const struct setting settings[] = {
+	{ "none", 0, 0, 0, 0 },
+	{ "no context takeover", 1, 15, 8, 0 },
+	{ "libwebsockets default", 1, 15, 8, 1 },
+	{ "jt-server", WS_DEFLATE_LEVEL, WS_DEFLATE_WINDOW_BITS,
+	  WS_DEFLATE_MEM_LEVEL, 1 },
+	{ "level 6", 6, 15, 8, 1 },
+};
+
+static const int64_t intervals_ms[] = { 5, 10, 20, 50, 100, 200, 500, 1000 };
+#define INTERVALS (int)(sizeof(intervals_ms) / sizeof(intervals_ms[0]))
+
+static uint32_t seed = 1;
+
+static uint32_t lcg(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+/* around base, give or take a quarter */
+static int64_t around(int64_t base)
+{
+	return base - base / 4 + (int64_t)(lcg() % (base / 2 + 1));
+}
+
+static int stats_msg(char *s, int64_t ival_ms, int64_t t_ms)
+{
+	int64_t scale = ival_ms;
+
+	return snprintf(s, MSG_LEN,
+	    "{\"msg\": \"stats\", \"p\": {\"iface\": \"enp3s0\", "
+	    "\"ival_ns\": %" PRId64 ", \"whoosh_err_mean\": %" PRId64 ", "
+	    "\"whoosh_err_max\": %" PRId64 ", \"whoosh_err_sd\": %" PRId64 ", "
+	    "\"s\": {\"rx\": %" PRId64 ", \"tx\": %" PRId64 ", "
+	    "\"rxP\": %" PRId64 ", \"txP\": %" PRId64 ", "
+	    "\"min_rx_pgap\": %" PRId64 ", \"max_rx_pgap\": %" PRId64 ", "
+	    "\"mean_rx_pgap\": %" PRId64 ", \"min_tx_pgap\": %" PRId64 ", "
+	    "\"max_tx_pgap\": %" PRId64 ", \"mean_tx_pgap\": %" PRId64 "}, "
+	    "\"t\": {\"tv_sec\": %" PRId64 ", \"tv_nsec\": %" PRId64 "}}}",
+	    ival_ms * 1000000, around(40000), around(90000), around(20000),
+	    around(125000 * scale), around(30000 * scale), around(90 * scale),
+	    around(40 * scale), around(2), around(900), around(60), around(3),
+	    around(2000), around(150), 1700000000 + t_ms / 1000,
+	    (t_ms % 1000) * 1000000);
+}
+
+static int toptalk_ids_msg(char *s, int64_t ival_ms, int64_t t_ms)
+{
+	int flows = 10;
+	int n;
+
+	n = snprintf(s, MSG_LEN,
+	    "{\"msg\": \"toptalk_ids\", \"p\": {\"tflows\": %d, "
+	    "\"tbytes\": %" PRId64 ", \"tpackets\": %" PRId64 ", "
+	    "\"interval_ns\": %" PRId64 ", \"distinct\": {\"flows\": %d, "
+	    "\"src\": %d, \"dst\": %d, \"dport\": %d}, "
+	    "\"timestamp\": {\"tv_sec\": %" PRId64 ", \"tv_nsec\": %" PRId64
+	    "}, \"f\": [",
+	    30, around(125000 * ival_ms), around(90 * ival_ms),
+	    ival_ms * 1000000, 30, 8, 12, 9, 1700000000 + t_ms / 1000,
+	    (t_ms % 1000) * 1000000);
+	for (int i = 0; i < flows; i++) {
+		int64_t bytes = around(100000 * ival_ms >> i);
+		n += snprintf(s + n, MSG_LEN - n, "%s[%d, %" PRId64 ", %" PRId64 "]",
+		              i ? ", " : "", i * 7 % 31, bytes, bytes / 900 + 1);
+	}
+	n += snprintf(s + n, MSG_LEN - n, "]}}");
+	return n;
+}
+
+static double cpu_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1E9;
+}
+
+static void run(const struct setting *st, int count)
+{
+	static char msg[MSG_LEN];
+	static uint8_t out[2 * MSG_LEN];
+	z_stream z;
+	int64_t in_bytes = 0, out_bytes = 0;
+	int64_t t_ms = 0;
+	int produced = 0;
+	double start;
+
+	memset(&z, 0, sizeof(z));
+	if (st->level) {
+		int err = deflateInit2(&z, st->level, Z_DEFLATED,
+		                       -st->window_bits, st->mem_level,
+		                       Z_DEFAULT_STRATEGY);
+		assert(Z_OK == err);
+	}
+
+	seed = 1;
+	start = cpu_seconds();
+	while (produced < count) {
+		for (int i = 0; i < INTERVALS && produced < count; i++) {
+			int len;
+
+			if (t_ms % intervals_ms[i]) {
+				continue;
+			}
+			len = (produced & 1)
+			          ? toptalk_ids_msg(msg, intervals_ms[i], t_ms)
+			          : stats_msg(msg, intervals_ms[i], t_ms);
+			produced++;
+			in_bytes += len;
+
+			if (!st->level) {
+				out_bytes += len;
+				continue;
+			}
+			if (!st->takeover) {
+				deflateReset(&z);
+			}
+			z.next_in = (uint8_t *)msg;
+			z.avail_in = len;
+			z.next_out = out;
+			z.avail_out = sizeof(out);
+			deflate(&z, Z_SYNC_FLUSH);
+			assert(0 == z.avail_in);
+			/* without the 00 00 ff ff */
+			out_bytes += sizeof(out) - z.avail_out - 4;
+		}
+		t_ms += intervals_ms[0];
+	}
+
+	printf("%-22s %8.1f bytes/msg %6.1f%% %8.0f ns/msg",
+	       st->name, (double)out_bytes / count,
+	       100.0 * out_bytes / in_bytes,
+	       1E9 * (cpu_seconds() - start) / count);
+	if (st->level) {
+		/* from zconf.h, the deflate state of each session */
+		printf(" %4d KiB/session",
+		       ((1 << (st->window_bits + 2)) +
+		        (1 << (st->mem_level + 9))) / 1024);
+		deflateEnd(&z);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int count = (argc > 1) ? atoi(argv[1]) : 200000;
+
+	printf("%d stats and toptalk_ids messages\n", count);
+	for (unsigned i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+		run(&settings[i], count);
+	}
+	return 0;
+}
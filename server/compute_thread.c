@@ -23,7 +23,9 @@
 #include "sampling_thread.h"
 
 #include "mq_msg_stats.h"
-#include "slist.h"
+#include "sample_ring.h"
+#include "detect.h"
+#include "update_rate.h"
 
 static pthread_mutex_t unsent_frame_count_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -41,88 +43,43 @@ static struct {
 struct iface_stats *g_raw_samples;
 int g_unsent_frame_count = 0;
 
-struct slist *sample_list;
+/* the last MAX_LIST_LEN samples are used */
+static struct sample_ring samples;
 int g_sample_count;
 
 /* local prototypes */
 static void *run(void *data);
 
 #define MAX_LIST_LEN 1000
+_Static_assert(MAX_LIST_LEN <= SAMPLE_RING_LEN, "the ring holds a window");
 #define DECIMATIONS_COUNT 8
 int decs[DECIMATIONS_COUNT] = { 5, 10, 20, 50, 100, 200, 500, 1000 };
 
-/* TODO: check all integer divisions and consider using FP */
-
-struct minmaxmean {
-	uint32_t min;
-	uint32_t max;
-	uint32_t mean;
+/* one for each series of each decimation */
+static struct detector detectors[DECIMATIONS_COUNT][MQ_STATS_SERIES];
+/* the interface the detectors have learned */
+static char detectors_iface[MAX_IFACE_LEN];
+
+/* the smallest changes worth reporting: 10kB/s and 1 sample */
+static const double detect_min_sd[MQ_STATS_SERIES] = {
+	[MQ_STATS_RX_RATE] = 10000,
+	[MQ_STATS_TX_RATE] = 10000,
+	[MQ_STATS_RX_PGAP] = 1,
+	[MQ_STATS_TX_PGAP] = 1
 };
 
-enum { RX = 0, TX = 1 };
-
-inline static struct minmaxmean
-calc_min_max_mean_gap(struct slist *list, int decim8, int rxtx)
-{
-	struct slist *ln;
-	int32_t size = slist_size(list);
-	int32_t gap_lengths[MAX_LIST_LEN] = { 0 };
-	int32_t gap_idx = 0;
-	int found_gap = 0;
-	int32_t min_gap = decim8 + 1;
-	int32_t max_gap = 0;
-	int32_t sum_gap = 0;
-	int32_t mean_gap = 0;
-
-	assert(size >= decim8);
-	assert(decim8 > 0);
-
-	ln = slist_idx(list, size - decim8);
-	for (int i = decim8; i > 0; i--) {
-		struct sample *s = ln->s;
-		if (((RX == rxtx) && (0 == s->rx_packets_delta)) ||
-		    ((TX == rxtx) && (0 == s->tx_packets_delta))) {
-			found_gap = 1;
-			gap_lengths[gap_idx]++;
-			max_gap = (max_gap > gap_lengths[gap_idx])
-			              ? max_gap
-			              : gap_lengths[gap_idx];
-		} else if (found_gap) {
-			found_gap = 0;
-			gap_idx++;
-		}
-		ln = ln->next;
-	}
-
-	assert(gap_idx <= decim8);
-	assert(max_gap <= decim8);
-
-	for (int i = 0; i <= gap_idx; i++) {
-		sum_gap += gap_lengths[i];
-		if (min_gap > gap_lengths[i]) {
-			min_gap = gap_lengths[i];
-		}
-	}
-	assert(sum_gap <= decim8);
-	assert((min_gap <= decim8) || (sum_gap == 0));
-
-	/* gap is the last index into the gap_lengths, so +1 for count. */
-	mean_gap = roundl((1000.0 * sum_gap) / (gap_idx + 1));
-	assert(1000 * min_gap <= mean_gap);
-
-	return (struct minmaxmean){min_gap, max_gap, mean_gap};
-}
+/* TODO: check all integer divisions and consider using FP */
 
 inline static int
-calc_packet_gap(struct slist *list, struct mq_stats_msg *m, int decim8)
+calc_packet_gap(struct sample_ring *r, struct mq_stats_msg *m, int decim8)
 {
-	struct minmaxmean rx, tx;
-	rx = calc_min_max_mean_gap(list, decim8, RX);
+	struct sample_gaps rx, tx;
+	rx = sample_ring_gaps(r, SAMPLE_RX, decim8);
 	m->max_rx_packet_gap = rx.max;
 	m->min_rx_packet_gap = rx.min;
 	m->mean_rx_packet_gap = rx.mean;
 
-	tx = calc_min_max_mean_gap(list, decim8, TX);
+	tx = sample_ring_gaps(r, SAMPLE_TX, decim8);
 	m->max_tx_packet_gap = tx.max;
 	m->min_tx_packet_gap = tx.min;
 	m->mean_tx_packet_gap = tx.mean;
@@ -131,21 +88,20 @@ calc_packet_gap(struct slist *list, struct mq_stats_msg *m, int decim8)
 }
 
 inline static int
-calc_whoosh_err(struct slist *list, struct mq_stats_msg *m, int decim8)
+calc_whoosh_err(struct sample_ring *r, struct mq_stats_msg *m, int decim8)
 {
 	uint32_t whoosh_sum = 0, whoosh_max = 0, whoosh_sum2 = 0;
-	struct slist *ln;
-	int size = slist_size(list);
-
-	ln = slist_idx(list, size - decim8);
-	for (int i = decim8; i > 0; i--) {
-		struct sample *s = ln->s;
-		whoosh_sum += s->whoosh_error_ns;
-		whoosh_sum2 += (s->whoosh_error_ns * s->whoosh_error_ns);
-		whoosh_max = (whoosh_max > s->whoosh_error_ns)
-		                 ? whoosh_max
-		                 : s->whoosh_error_ns;
-		ln = ln->next;
+	struct sample_span span = sample_ring_last(r, decim8);
+
+	for (int p = 0, i = span.start; p < 2; p++, i = 0) {
+		const uint64_t *whoosh = &r->whoosh_error_ns[i];
+
+		for (int j = 0; j < span.len[p]; j++) {
+			whoosh_sum += whoosh[j];
+			whoosh_sum2 += (whoosh[j] * whoosh[j]);
+			whoosh_max = (whoosh_max > whoosh[j]) ? whoosh_max
+			                                      : whoosh[j];
+		}
 	}
 
 	m->max_whoosh = whoosh_max;
@@ -166,7 +122,7 @@ calc_whoosh_err(struct slist *list, struct mq_stats_msg *m, int decim8)
 }
 
 inline static int
-calc_txrx_minmaxmean(struct slist *list, struct mq_stats_msg *m, int decim8)
+calc_txrx_minmaxmean(struct sample_ring *r, struct mq_stats_msg *m, int decim8)
 {
 	uint64_t rxb_sum = 0, txb_sum = 0, rxp_sum = 0, txp_sum = 0;
 	uint64_t rxb_max = 0, txb_max = 0;
@@ -174,35 +130,29 @@ calc_txrx_minmaxmean(struct slist *list, struct mq_stats_msg *m, int decim8)
 	uint64_t rxb_min = UINT64_MAX, txb_min = UINT64_MAX;
 	uint32_t rxp_min = UINT32_MAX, txp_min = UINT32_MAX;
 
-	struct slist *ln;
-	int size = slist_size(list);
-
-	ln = slist_idx(list, size - decim8);
-	for (int i = decim8; i > 0; i--) {
-		struct sample *s = ln->s;
-		rxb_sum += s->rx_bytes_delta;
-		txb_sum += s->tx_bytes_delta;
-		rxp_sum += s->rx_packets_delta;
-		txp_sum += s->tx_packets_delta;
-
-		rxb_max =
-		    (rxb_max > s->rx_bytes_delta) ? rxb_max : s->rx_bytes_delta;
-		txb_max =
-		    (txb_max > s->tx_bytes_delta) ? txb_max : s->tx_bytes_delta;
-		rxp_max = (rxp_max > s->rx_packets_delta) ? rxp_max
-		                                          : s->rx_packets_delta;
-		txp_max = (txp_max > s->tx_packets_delta) ? txp_max
-		                                          : s->tx_packets_delta;
-		rxb_min =
-		    (rxb_min < s->rx_bytes_delta) ? rxb_min : s->rx_bytes_delta;
-		txb_min =
-		    (txb_min < s->tx_bytes_delta) ? txb_min : s->tx_bytes_delta;
-		rxp_min = (rxp_min < s->rx_packets_delta) ? rxp_min
-		                                          : s->rx_packets_delta;
-		txp_min = (txp_min < s->tx_packets_delta) ? txp_min
-		                                          : s->tx_packets_delta;
-
-		ln = ln->next;
+	struct sample_span span = sample_ring_last(r, decim8);
+
+	for (int p = 0, i = span.start; p < 2; p++, i = 0) {
+		const uint64_t *rxb = &r->rx_bytes_delta[i];
+		const uint64_t *txb = &r->tx_bytes_delta[i];
+		const uint64_t *rxp = &r->rx_packets_delta[i];
+		const uint64_t *txp = &r->tx_packets_delta[i];
+
+		for (int j = 0; j < span.len[p]; j++) {
+			rxb_sum += rxb[j];
+			txb_sum += txb[j];
+			rxp_sum += rxp[j];
+			txp_sum += txp[j];
+
+			rxb_max = (rxb_max > rxb[j]) ? rxb_max : rxb[j];
+			txb_max = (txb_max > txb[j]) ? txb_max : txb[j];
+			rxp_max = (rxp_max > rxp[j]) ? rxp_max : rxp[j];
+			txp_max = (txp_max > txp[j]) ? txp_max : txp[j];
+			rxb_min = (rxb_min < rxb[j]) ? rxb_min : rxb[j];
+			txb_min = (txb_min < txb[j]) ? txb_min : txb[j];
+			rxp_min = (rxp_min < rxp[j]) ? rxp_min : rxp[j];
+			txp_min = (txp_min < txp[j]) ? txp_min : txp[j];
+		}
 	}
 
 	m->min_rx_bytes = rxb_min;
@@ -224,10 +174,75 @@ calc_txrx_minmaxmean(struct slist *list, struct mq_stats_msg *m, int decim8)
 	return 0;
 }
 
+/* Stamps the message with the time of the newest sample, which the
+ * sampling thread took from CLOCK_MONOTONIC, and with the same time on
+ * CLOCK_REALTIME for the clients to compare with their own clocks. */
+static void stamp_sample_time(struct sample_ring *r, struct mq_stats_msg *m)
+{
+	struct timespec mono, real;
+	const struct timespec *newest = &r->timestamp[sample_ring_newest(r)];
+	int64_t now_ns, real_ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+	clock_gettime(CLOCK_REALTIME, &real);
+	now_ns = mono.tv_sec * 1000000000LL + mono.tv_nsec;
+
+	m->sample_ns = newest->tv_sec * 1000000000LL + newest->tv_nsec;
+	m->compute_us = (now_ns - m->sample_ns) / 1000;
+
+	real_ns = real.tv_sec * 1000000000LL + real.tv_nsec -
+	          (now_ns - m->sample_ns);
+	m->timestamp.tv_sec = real_ns / 1000000000LL;
+	m->timestamp.tv_nsec = real_ns % 1000000000LL;
+}
+
+static void detectors_init(void)
+{
+	for (int i = 0; i < DECIMATIONS_COUNT; i++) {
+		for (int s = 0; s < MQ_STATS_SERIES; s++) {
+			detector_init(&detectors[i][s], detect_min_sd[s]);
+		}
+	}
+}
+
+/* Watches the message's series for changes; constant time per message. */
+static void detect_changes(struct mq_stats_msg *m, int decim8)
+{
+	struct detector *d = NULL;
+	double x[MQ_STATS_SERIES] = {
+		[MQ_STATS_RX_RATE] = m->mean_rx_bytes,
+		[MQ_STATS_TX_RATE] = m->mean_tx_bytes,
+		[MQ_STATS_RX_PGAP] = m->max_rx_packet_gap,
+		[MQ_STATS_TX_PGAP] = m->max_tx_packet_gap
+	};
+
+	/* another interface's traffic is not a change in this one's */
+	if (strncmp(detectors_iface, m->iface, MAX_IFACE_LEN)) {
+		detectors_init();
+		snprintf(detectors_iface, MAX_IFACE_LEN, "%s", m->iface);
+	}
+
+	for (int i = 0; i < DECIMATIONS_COUNT; i++) {
+		if (decs[i] == decim8) {
+			d = detectors[i];
+		}
+	}
+	assert(d);
+
+	m->anomaly_count = 0;
+	for (int s = 0; s < MQ_STATS_SERIES; s++) {
+		if (detector_add(&d[s], m->sample_ns, x[s],
+		                 &m->anomalies[m->anomaly_count].e)) {
+			m->anomalies[m->anomaly_count].series = s;
+			m->anomaly_count++;
+		}
+	}
+}
+
 inline static int
-stats_filter(struct slist *list, struct mq_stats_msg *m, int decim8)
+stats_filter(struct sample_ring *r, struct mq_stats_msg *m, int decim8)
 {
-	int size = slist_size(list);
+	int size = (r->count < MAX_LIST_LEN) ? r->count : MAX_LIST_LEN;
 	int smod = size % decim8;
 
 	if (!size || smod) {
@@ -240,9 +255,11 @@ stats_filter(struct slist *list, struct mq_stats_msg *m, int decim8)
 	/* FIXME - get this from mq_stats_msg ? */
 	sprintf(m->iface, "%s", g_selected_iface);
 
-	calc_txrx_minmaxmean(list, m, decim8);
-	calc_whoosh_err(list, m, decim8);
-	calc_packet_gap(list, m, decim8);
+	calc_txrx_minmaxmean(r, m, decim8);
+	calc_whoosh_err(r, m, decim8);
+	calc_packet_gap(r, m, decim8);
+	stamp_sample_time(r, m);
+	detect_changes(m, decim8);
 
 	return 0;
 }
@@ -250,7 +267,7 @@ stats_filter(struct slist *list, struct mq_stats_msg *m, int decim8)
 inline static int message_producer(struct mq_stats_msg *m, void *data)
 {
 	int *decimation_factor = (int *)data;
-	return stats_filter(sample_list, m, *decimation_factor);
+	return stats_filter(&samples, m, *decimation_factor);
 }
 
 void send_decimations(void)
@@ -267,21 +284,14 @@ void send_decimations(void)
 	}
 }
 
-static int frames_to_sample_list(void)
+static int frames_to_samples(void)
 {
 	int new_samples = 0;
 
 	pthread_mutex_lock(&unsent_frame_count_mutex);
 	while (g_unsent_frame_count > 0) {
 		for (int i = 0; i < SAMPLES_PER_FRAME; i++) {
-			struct sample *s = malloc(sizeof(struct sample));
-			assert(s);
-			memcpy(s, &(g_raw_samples->samples[i]),
-			       sizeof(struct sample));
-			struct slist *ln = malloc(sizeof(struct slist));
-			assert(ln);
-			ln->s = s;
-			slist_push(sample_list, ln);
+			sample_ring_push(&samples, &(g_raw_samples->samples[i]));
 			g_sample_count++;
 			new_samples++;
 		}
@@ -289,18 +299,6 @@ static int frames_to_sample_list(void)
 	}
 	pthread_mutex_unlock(&unsent_frame_count_mutex);
 
-	int overflow = (slist_size(sample_list) > MAX_LIST_LEN)
-	                   ? slist_size(sample_list) - MAX_LIST_LEN
-	                   : 0;
-
-	while (overflow--) {
-		struct slist *ln = slist_pop(sample_list);
-		assert(ln);
-		assert(ln->s);
-		free(ln->s);
-		free(ln);
-	}
-
 	if (g_sample_count > MAX_LIST_LEN) {
 		g_sample_count -= MAX_LIST_LEN;
 	}
@@ -318,10 +316,18 @@ void sample_thread_event_handler(struct iface_stats *raw_samples)
 
 int compute_thread_init(void)
 {
+	int64_t ivals[DECIMATIONS_COUNT];
 	int err;
 
-	sample_list = slist_new();
-	assert(sample_list);
+	sample_ring_init(&samples);
+	detectors_init();
+
+	/* the stats intervals that sessions can ask for */
+	for (int i = 0; i < DECIMATIONS_COUNT; i++) {
+		ivals[i] = 1000000LL * decs[i];
+	}
+	err = update_rate_configure(UPDATE_STATS, ivals, DECIMATIONS_COUNT);
+	assert(!err);
 
 	assert(!thread_info.thread_id);
 	err = pthread_create(&thread_info.thread_id, NULL, run, NULL);
@@ -395,7 +401,7 @@ static void *run(void *data)
 	clock_gettime(CLOCK_MONOTONIC, &deadline);
 
 	for (;;) {
-		if (0 < frames_to_sample_list()) {
+		if (0 < frames_to_samples()) {
 			send_decimations();
 		}
 
@@ -0,0 +1,89 @@
+#include <string.h>
+#include <math.h>
+
+#include "detect.h"
+
+void detector_init(struct detector *d, double min_sd)
+{
+	memset(d, 0, sizeof(*d));
+	d->min_sd = min_sd;
+}
+
+static double baseline_sd(const struct detector *d)
+{
+	double sd = sqrt(d->var);
+	double rel = fabs(d->mean) * DETECT_REL_SD;
+
+	sd = (sd > rel) ? sd : rel;
+	return (sd > d->min_sd) ? sd : d->min_sd;
+}
+
+/* exponentially weighted mean and variance; the first samples are
+ * weighted equally, so that the baseline doesn't start at zero */
+static void baseline_add(struct detector *d, double x)
+{
+	double alpha = 1.0 / (d->warm + 1);
+	double diff = x - d->mean;
+	double incr;
+
+	alpha = (alpha > DETECT_ALPHA) ? alpha : DETECT_ALPHA;
+	incr = alpha * diff;
+	d->mean += incr;
+	d->var = (1 - alpha) * (d->var + diff * incr);
+	if (d->warm < DETECT_WARMUP) {
+		d->warm++;
+	}
+}
+
+/* Returns 1 if the side's sum went over the threshold. */
+static int side_add(struct detect_side *s, double z, int64_t t_ns, double x)
+{
+	if (0 == s->sum) {
+		s->onset_ns = t_ns;
+		s->level_sum = 0;
+		s->level_count = 0;
+	}
+	s->sum += z - DETECT_ALLOWANCE;
+	if (s->sum <= 0) {
+		s->sum = 0;
+		return 0;
+	}
+	s->level_sum += x;
+	s->level_count++;
+	return s->sum > DETECT_THRESHOLD;
+}
+
+int detector_add(struct detector *d, int64_t t_ns, double x,
+                 struct detect_event *e)
+{
+	struct detect_side *s = NULL;
+	double sd, z;
+
+	if (d->warm < DETECT_WARMUP) {
+		baseline_add(d, x);
+		return 0;
+	}
+
+	sd = baseline_sd(d);
+	z = (x - d->mean) / sd;
+	if (side_add(&d->rise, z, t_ns, x)) {
+		s = &d->rise;
+	}
+	if (side_add(&d->fall, -z, t_ns, x)) {
+		s = &d->fall;
+	}
+
+	if (s) {
+		e->onset_ns = s->onset_ns;
+		e->baseline = d->mean;
+		e->level = s->level_sum / s->level_count;
+		e->sd = sd;
+		detector_init(d, d->min_sd);
+		return 1;
+	}
+
+	if (0 == d->rise.sum && 0 == d->fall.sum) {
+		baseline_add(d, x);
+	}
+	return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef DETECT_H
+#define DETECT_H
+
+#include <stdint.h>
+
+/* Change detection on a stream of samples, in constant time and space per
+ * sample, so that it can watch every series of every decimation.
+ *
+ * Each sample is compared with an exponentially weighted baseline, in
+ * units of the baseline's standard deviation, and the differences are
+ * summed in a two-sided CUSUM: one sum for rises and one for falls, each
+ * less an allowance per sample and never below zero. A sum over the
+ * threshold is a change, starting when that sum last left zero.
+ *
+ * The baseline only follows the series while both sums are at rest, so
+ * that a slow change can't hide by dragging the baseline along. After a
+ * change, the baseline is learned again from the new level. */
+
+#define DETECT_WARMUP 32          /* samples before the baseline is used */
+#define DETECT_ALPHA (1.0 / 32)   /* weight of a sample in the baseline */
+#define DETECT_ALLOWANCE 1.0      /* per sample, in sd */
+#define DETECT_THRESHOLD 12.0     /* in sd */
+#define DETECT_REL_SD (1.0 / 16)  /* smallest sd, relative to the baseline */
+
+struct detect_side {
+	double sum;
+	int64_t onset_ns;
+	double level_sum;
+	int level_count;
+};
+
+struct detector {
+	double min_sd; /* smallest sd, in the units of the series */
+	int warm;
+	double mean;
+	double var;
+	struct detect_side rise;
+	struct detect_side fall;
+};
+
+struct detect_event {
+	int64_t onset_ns; /* the time of the first sample of the change */
+	double baseline;
+	double level; /* the mean of the samples since the onset */
+	double sd;    /* of the baseline */
+};
+
+/* min_sd keeps a flat series, such as an idle interface, from treating
+ * any change at all as significant. */
+void detector_init(struct detector *d, double min_sd);
+
+/* The sample x was taken at t_ns. Returns 1 if it completes a change,
+ * which is written to e, and 0 otherwise. */
+int detector_add(struct detector *d, int64_t t_ns, double x,
+                 struct detect_event *e);
+
+#endif
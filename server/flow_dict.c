@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "flow_dict.h"
+
+struct flow_dict_entry {
+	struct flow_dict_key key;
+	uint32_t gen; /* 0: never used */
+	uint64_t last_used;
+};
+
+static struct flow_dict_entry dict[FLOW_DICT_SIZE];
+static uint64_t dict_clock;
+
+/* FNV-1a */
+static uint32_t key_hash(const struct flow_dict_key *key)
+{
+	const unsigned char *p = (const unsigned char *)key;
+	uint32_t h = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(*key); i++) {
+		h ^= p[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+void flow_dict_advance(void)
+{
+	dict_clock++;
+}
+
+int flow_dict_id(const struct flow_dict_key *key)
+{
+	uint32_t start = key_hash(key) % FLOW_DICT_SIZE;
+	int stale = -1;
+
+	/* Open addressing with linear probing. Entries are never emptied,
+	 * only reused once stale, so a probe ends at the first unused slot. */
+	for (uint32_t n = 0; n < FLOW_DICT_SIZE; n++) {
+		uint32_t i = (start + n) % FLOW_DICT_SIZE;
+		struct flow_dict_entry *e = &dict[i];
+
+		if (!e->gen) {
+			if (stale < 0) {
+				stale = i;
+			}
+			break;
+		}
+		if (0 == memcmp(&e->key, key, sizeof(*key))) {
+			e->last_used = dict_clock;
+			return i;
+		}
+		if (stale < 0 && dict_clock - e->last_used > FLOW_DICT_STALE) {
+			stale = i;
+		}
+	}
+
+	if (stale < 0) {
+		return -1;
+	}
+
+	dict[stale].key = *key;
+	dict[stale].gen++;
+	dict[stale].last_used = dict_clock;
+	return stale;
+}
+
+const struct flow_dict_key *flow_dict_get(int id)
+{
+	if (id < 0 || id >= FLOW_DICT_SIZE || !dict[id].gen) {
+		return NULL;
+	}
+	return &dict[id].key;
+}
+
+uint32_t flow_dict_gen(int id)
+{
+	if (id < 0 || id >= FLOW_DICT_SIZE) {
+		return 0;
+	}
+	return dict[id].gen;
+}
+
+int flow_dict_session_missing(struct flow_dict_session *s, const uint16_t *ids,
+                              int count, uint16_t *missing)
+{
+	int n = 0;
+
+	for (int i = 0; i < count; i++) {
+		uint16_t id = ids[i];
+		if (id < FLOW_DICT_SIZE && s->known[id] != dict[id].gen) {
+			s->known[id] = dict[id].gen;
+			missing[n++] = id;
+		}
+	}
+	return n;
+}
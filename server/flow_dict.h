@@ -0,0 +1,56 @@
+#ifndef FLOW_DICT_H
+#define FLOW_DICT_H
+
+#include <stdint.h>
+
+/* A dictionary of flow ids, so that toptalk updates can refer to flows by
+ * a small number instead of their full tuple. Sessions remember which ids
+ * they have been told about, and only new (or reused) ids are announced.
+ *
+ * Ids are only reused once a flow has been unused for FLOW_DICT_STALE
+ * toptalk messages, far longer than any message waits in the queue.
+ *
+ * Only used from the websocket service thread, so there is no locking. */
+
+#define FLOW_DICT_SIZE 1024
+#define FLOW_DICT_STALE 8192
+
+#define FLOW_DICT_ADDR_LEN 46
+#define FLOW_DICT_PROTO_LEN 8
+#define FLOW_DICT_TCLASS_LEN 8
+
+struct flow_dict_key {
+	char src[FLOW_DICT_ADDR_LEN];
+	char dst[FLOW_DICT_ADDR_LEN];
+	uint16_t sport;
+	uint16_t dport;
+	char proto[FLOW_DICT_PROTO_LEN];
+	char tclass[FLOW_DICT_TCLASS_LEN];
+};
+
+/* what one session has been told: the generation of each id */
+struct flow_dict_session {
+	uint32_t known[FLOW_DICT_SIZE];
+};
+
+/* Start a new toptalk message; ids used from now on are kept fresh. */
+void flow_dict_advance(void);
+
+/* Returns the id of the flow, adding it if need be, or -1 if the
+ * dictionary is full of live flows. The key must be zeroed before it is
+ * filled in, so that it compares equal bytewise. */
+int flow_dict_id(const struct flow_dict_key *key);
+
+/* The flow behind an id, or NULL if the id is unused. */
+const struct flow_dict_key *flow_dict_get(int id);
+
+/* The generation of an id, which changes whenever it is reused for
+ * another flow; 0 if it is unused. */
+uint32_t flow_dict_gen(int id);
+
+/* Which of these ids does the session need to be told about? Writes them
+ * to missing[] and returns how many; they are then assumed known. */
+int flow_dict_session_missing(struct flow_dict_session *s, const uint16_t *ids,
+                              int count, uint16_t *missing);
+
+#endif
@@ -0,0 +1,212 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "update_rate.h"
+#include "flow_dict.h"
+#include "history.h"
+
+_Static_assert(HISTORY_IVALS == BACKFILL_MAX_IVALS,
+               "one history ring per interval of the backfill");
+
+/* Rings of the newest BACKFILL_MAX_SAMPLES messages of an interval. The
+ * n'th message written goes to slot n % BACKFILL_MAX_SAMPLES, so the
+ * count of messages written is all it takes to know what is still there. */
+struct stats_ring {
+	int64_t interval_ns; /* 0 for a ring not in use */
+	uint64_t written;
+	int64_t v[BACKFILL_MAX_SAMPLES][BACKFILL_FIELDS];
+};
+
+struct toptalk_ring {
+	int64_t interval_ns;
+	uint64_t written;
+	struct jt_msg_toptalk_ids slice[BACKFILL_MAX_SAMPLES];
+	/* the generation of each flow id when it was recorded */
+	uint32_t gen[BACKFILL_MAX_SAMPLES][MAX_FLOWS];
+};
+
+static struct stats_ring stats_rings[HISTORY_IVALS];
+static struct toptalk_ring toptalk_rings[HISTORY_IVALS];
+static char history_iface[MAX_IFACE_LEN];
+static uint32_t epoch;
+
+static struct stats_ring *stats_ring(int64_t interval_ns)
+{
+	for (int i = 0; i < HISTORY_IVALS; i++) {
+		struct stats_ring *r = &stats_rings[i];
+		if (!r->interval_ns) {
+			r->interval_ns = interval_ns;
+		}
+		if (r->interval_ns == interval_ns) {
+			return r;
+		}
+	}
+	return NULL;
+}
+
+static struct toptalk_ring *toptalk_ring(int64_t interval_ns)
+{
+	for (int i = 0; i < HISTORY_IVALS; i++) {
+		struct toptalk_ring *r = &toptalk_rings[i];
+		if (!r->interval_ns) {
+			r->interval_ns = interval_ns;
+		}
+		if (r->interval_ns == interval_ns) {
+			return r;
+		}
+	}
+	return NULL;
+}
+
+void history_add_stats(const struct jt_msg_stats *s)
+{
+	struct stats_ring *r;
+	int64_t *v;
+
+	if (strncmp(history_iface, s->iface, MAX_IFACE_LEN)) {
+		history_clear();
+		snprintf(history_iface, MAX_IFACE_LEN, "%s", s->iface);
+	}
+
+	r = stats_ring(s->interval_ns);
+	if (!r) {
+		return;
+	}
+
+	/* as in the "s" object of jt_stats_packer() */
+	v = r->v[r->written % BACKFILL_MAX_SAMPLES];
+	v[BACKFILL_RX] = s->mean_rx_bytes;
+	v[BACKFILL_TX] = s->mean_tx_bytes;
+	v[BACKFILL_RXP] = s->mean_rx_packets;
+	v[BACKFILL_TXP] = s->mean_tx_packets;
+	v[BACKFILL_MIN_RX_PGAP] = s->min_rx_packet_gap;
+	v[BACKFILL_MAX_RX_PGAP] = s->max_rx_packet_gap;
+	v[BACKFILL_MEAN_RX_PGAP] = s->mean_rx_packet_gap;
+	v[BACKFILL_MIN_TX_PGAP] = s->min_tx_packet_gap;
+	v[BACKFILL_MAX_TX_PGAP] = s->max_tx_packet_gap;
+	v[BACKFILL_MEAN_TX_PGAP] = s->mean_tx_packet_gap;
+	r->written++;
+}
+
+void history_add_toptalk(const struct jt_msg_toptalk_ids *t)
+{
+	struct toptalk_ring *r = toptalk_ring(t->interval_ns);
+	int slot;
+
+	if (!r) {
+		return;
+	}
+
+	slot = r->written % BACKFILL_MAX_SAMPLES;
+	r->slice[slot] = *t;
+	/* only the newest gaps and sizes are shown, so keep them out of the
+	 * backfill */
+	memset(r->slice[slot].pgaps, 0, sizeof(r->slice[slot].pgaps));
+	memset(r->slice[slot].psizes, 0, sizeof(r->slice[slot].psizes));
+	for (int f = 0; f < t->count; f++) {
+		r->gen[slot][f] = flow_dict_gen(t->flows[f].id);
+		memset(r->slice[slot].flows[f].sizes, 0,
+		       sizeof(r->slice[slot].flows[f].sizes));
+	}
+	r->written++;
+}
+
+void history_clear(void)
+{
+	memset(stats_rings, 0, sizeof(stats_rings));
+	memset(toptalk_rings, 0, sizeof(toptalk_rings));
+	history_iface[0] = '\0';
+	epoch++;
+}
+
+void history_mark(struct history_mark *mark)
+{
+	mark->epoch = epoch;
+	for (int i = 0; i < HISTORY_IVALS; i++) {
+		mark->stats[i] = stats_rings[i].written;
+		mark->toptalk[i] = toptalk_rings[i].written;
+	}
+}
+
+/* the oldest message still in a ring */
+static inline uint64_t oldest(uint64_t written)
+{
+	return (written > BACKFILL_MAX_SAMPLES)
+	           ? written - BACKFILL_MAX_SAMPLES
+	           : 0;
+}
+
+int history_backfill(const struct history_mark *mark,
+                     const struct update_rate *u, struct jt_msg_backfill *b,
+                     uint16_t *ids)
+{
+	uint8_t seen[FLOW_DICT_SIZE] = { 0 };
+	int id_count = 0;
+
+	snprintf(b->iface, MAX_IFACE_LEN, "%s", history_iface);
+	b->stats_count = 0;
+	b->toptalk_count = 0;
+
+	if (mark->epoch != epoch) {
+		/* the session was told about the new interface */
+		return 0;
+	}
+
+	for (int i = 0; i < HISTORY_IVALS; i++) {
+		struct stats_ring *r = &stats_rings[i];
+		uint64_t w = oldest(r->written);
+
+		if (!r->interval_ns || w >= mark->stats[i] ||
+		    !update_rate_shows(u, UPDATE_STATS, r->interval_ns)) {
+			continue;
+		}
+		b->stats[b->stats_count].interval_ns = r->interval_ns;
+		b->stats[b->stats_count].count = 0;
+		for (; w < mark->stats[i]; w++) {
+			int n = b->stats[b->stats_count].count++;
+			memcpy(b->stats[b->stats_count].v[n],
+			       r->v[w % BACKFILL_MAX_SAMPLES],
+			       sizeof(r->v[0]));
+		}
+		b->stats_count++;
+	}
+
+	for (int i = 0; i < HISTORY_IVALS; i++) {
+		struct toptalk_ring *r = &toptalk_rings[i];
+		uint64_t w = oldest(r->written);
+
+		if (!r->interval_ns || w >= mark->toptalk[i] ||
+		    !update_rate_shows(u, UPDATE_TOPTALK, r->interval_ns)) {
+			continue;
+		}
+		for (; w < mark->toptalk[i]; w++) {
+			int slot = w % BACKFILL_MAX_SAMPLES;
+			struct jt_msg_toptalk_ids *t =
+			    &b->toptalk[b->toptalk_count++];
+
+			*t = r->slice[slot];
+			t->count = 0;
+			for (int f = 0; f < r->slice[slot].count; f++) {
+				uint32_t id = r->slice[slot].flows[f].id;
+
+				if (flow_dict_gen(id) != r->gen[slot][f]) {
+					/* reused for another flow since */
+					continue;
+				}
+				t->flows[t->count++] = r->slice[slot].flows[f];
+				if (!seen[id]) {
+					seen[id] = 1;
+					ids[id_count++] = id;
+				}
+			}
+		}
+	}
+	return id_count;
+}
@@ -0,0 +1,47 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+
+/* The last BACKFILL_MAX_SAMPLES stats and toptalk messages of each
+ * interval, so that a new session's charts can be filled in at once
+ * instead of over the next chart window (see jt_msg_backfill.h).
+ *
+ * Stats keep only the charted fields, and toptalk the flow ids, so the
+ * rings are small and need no encoding until a session joins.
+ *
+ * Only used from the websocket service thread, so there is no locking. */
+
+struct jt_msg_stats;
+struct jt_msg_toptalk_ids;
+struct jt_msg_backfill;
+struct update_rate;
+
+/* BACKFILL_MAX_IVALS */
+#define HISTORY_IVALS 8
+
+/* How far the history went when a session joined. Later messages reach
+ * the session through its queue, so they aren't part of its backfill. */
+struct history_mark {
+	uint32_t epoch;
+	uint64_t stats[HISTORY_IVALS];
+	uint64_t toptalk[HISTORY_IVALS];
+};
+
+void history_add_stats(const struct jt_msg_stats *s);
+void history_add_toptalk(const struct jt_msg_toptalk_ids *t);
+
+/* Forget everything, eg. when the interface changes. */
+void history_clear(void);
+
+void history_mark(struct history_mark *mark);
+
+/* Fill in b with what was recorded before the mark, for the intervals that
+ * the session shows, and write the flow ids it refers to to ids[] (of
+ * FLOW_DICT_SIZE). Flows whose ids have since been reused are left out.
+ * Returns the number of ids. */
+int history_backfill(const struct history_mark *mark,
+                     const struct update_rate *u, struct jt_msg_backfill *b,
+                     uint16_t *ids);
+
+#endif
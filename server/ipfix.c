@@ -0,0 +1,504 @@
+#include <stdint.h>
+#include <string.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+
+#include "ipfix.h"
+
+#define IPFIX_VERSION 10
+#define HEADER_LEN 16
+#define SET_HEADER_LEN 4
+#define SET_ID_TEMPLATE 2
+#define ENTERPRISE_BIT 0x8000
+
+/* the IANA IEs that are used */
+enum {
+	IE_OCTET_DELTA_COUNT = 1,
+	IE_PACKET_DELTA_COUNT = 2,
+	IE_PROTOCOL = 4,
+	IE_CLASS_OF_SERVICE = 5,
+	IE_SRC_PORT = 7,
+	IE_SRC_IPV4 = 8,
+	IE_DST_PORT = 11,
+	IE_DST_IPV4 = 12,
+	IE_SRC_IPV6 = 27,
+	IE_DST_IPV6 = 28,
+	IE_FLOW_END_REASON = 136,
+	IE_FLOW_START_MS = 152,
+	IE_FLOW_END_MS = 153,
+	IE_DSCP = 195
+};
+
+#define COMMON_FIELDS                                                          \
+	{ IE_SRC_PORT, 2, 0 },                                                 \
+	{ IE_DST_PORT, 2, 0 },                                                 \
+	{ IE_PROTOCOL, 1, 0 },                                                 \
+	{ IE_CLASS_OF_SERVICE, 1, 0 },                                         \
+	{ IE_DSCP, 1, 0 },                                                     \
+	{ IE_FLOW_END_REASON, 1, 0 },                                          \
+	{ IE_OCTET_DELTA_COUNT, 8, 0 },                                        \
+	{ IE_PACKET_DELTA_COUNT, 8, 0 },                                       \
+	{ IE_FLOW_START_MS, 8, 0 },                                            \
+	{ IE_FLOW_END_MS, 8, 0 },                                              \
+	{ IPFIX_IE_GAP_MIN, 4, IPFIX_ENTERPRISE_ID },                          \
+	{ IPFIX_IE_GAP_MAX, 4, IPFIX_ENTERPRISE_ID },                          \
+	{ IPFIX_IE_GAP_MEAN, 4, IPFIX_ENTERPRISE_ID },                         \
+	{ IPFIX_IE_JITTER, 4, IPFIX_ENTERPRISE_ID }
+
+static const struct ipfix_field fields_v4[] = {
+	{ IE_SRC_IPV4, 4, 0 },
+	{ IE_DST_IPV4, 4, 0 },
+	COMMON_FIELDS
+};
+
+static const struct ipfix_field fields_v6[] = {
+	{ IE_SRC_IPV6, 16, 0 },
+	{ IE_DST_IPV6, 16, 0 },
+	COMMON_FIELDS
+};
+
+#define FIELD_COUNT(f) ((int)(sizeof(f) / sizeof((f)[0])))
+
+static const struct {
+	uint16_t id;
+	const struct ipfix_field *field;
+	int field_count;
+} templates[] = {
+	{ IPFIX_TEMPLATE_V4, fields_v4, FIELD_COUNT(fields_v4) },
+	{ IPFIX_TEMPLATE_V6, fields_v6, FIELD_COUNT(fields_v6) }
+};
+
+/* network byte order, for any of the integer lengths */
+static void put_uint(uint8_t *p, uint64_t v, int len)
+{
+	for (int i = len - 1; i >= 0; i--) {
+		p[i] = v & 0xff;
+		v >>= 8;
+	}
+}
+
+static uint64_t get_uint(const uint8_t *p, int len)
+{
+	uint64_t v = 0;
+
+	for (int i = 0; i < len; i++) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static int64_t tv_to_ms(struct timeval t)
+{
+	return t.tv_sec * 1000LL + t.tv_usec / 1000;
+}
+
+static struct timeval ms_to_tv(int64_t ms)
+{
+	return (struct timeval){ .tv_sec = ms / 1000,
+		                 .tv_usec = (ms % 1000) * 1000 };
+}
+
+static uint32_t clamp32(int64_t v)
+{
+	return (v < 0) ? 0 : (v > UINT32_MAX) ? UINT32_MAX : (uint32_t)v;
+}
+
+static int record_len(const struct ipfix_field *field, int count)
+{
+	int len = 0;
+
+	for (int i = 0; i < count; i++) {
+		len += field[i].len;
+	}
+	return len;
+}
+
+static void encode_field(uint8_t *p, const struct ipfix_field *f,
+                         const struct tt_flow_export *r)
+{
+	if (f->enterprise) {
+		switch (f->id) {
+		case IPFIX_IE_GAP_MIN:
+			put_uint(p, clamp32(r->gap_min), f->len);
+			break;
+		case IPFIX_IE_GAP_MAX:
+			put_uint(p, clamp32(r->gap_max), f->len);
+			break;
+		case IPFIX_IE_GAP_MEAN:
+			put_uint(p, clamp32(r->gap_mean), f->len);
+			break;
+		case IPFIX_IE_JITTER:
+			put_uint(p, clamp32(r->jitter), f->len);
+			break;
+		}
+		return;
+	}
+
+	switch (f->id) {
+	case IE_SRC_IPV4:
+		memcpy(p, &r->flow.src_ip, f->len);
+		break;
+	case IE_DST_IPV4:
+		memcpy(p, &r->flow.dst_ip, f->len);
+		break;
+	case IE_SRC_IPV6:
+		memcpy(p, &r->flow.src_ip6, f->len);
+		break;
+	case IE_DST_IPV6:
+		memcpy(p, &r->flow.dst_ip6, f->len);
+		break;
+	case IE_SRC_PORT:
+		put_uint(p, r->flow.sport, f->len);
+		break;
+	case IE_DST_PORT:
+		put_uint(p, r->flow.dport, f->len);
+		break;
+	case IE_PROTOCOL:
+		put_uint(p, r->flow.proto, f->len);
+		break;
+	case IE_CLASS_OF_SERVICE:
+		put_uint(p, r->flow.tclass, f->len);
+		break;
+	case IE_DSCP:
+		put_uint(p, r->flow.tclass >> 2, f->len);
+		break;
+	case IE_FLOW_END_REASON:
+		put_uint(p, r->end, f->len);
+		break;
+	case IE_OCTET_DELTA_COUNT:
+		put_uint(p, r->bytes, f->len);
+		break;
+	case IE_PACKET_DELTA_COUNT:
+		put_uint(p, r->packets, f->len);
+		break;
+	case IE_FLOW_START_MS:
+		put_uint(p, tv_to_ms(r->first), f->len);
+		break;
+	case IE_FLOW_END_MS:
+		put_uint(p, tv_to_ms(r->last), f->len);
+		break;
+	}
+}
+
+static void decode_field(const uint8_t *p, const struct ipfix_field *f,
+                         struct tt_flow_export *r)
+{
+	uint64_t v = (f->len <= 8) ? get_uint(p, f->len) : 0;
+
+	if (f->enterprise) {
+		if (IPFIX_ENTERPRISE_ID != f->enterprise) {
+			return;
+		}
+		switch (f->id) {
+		case IPFIX_IE_GAP_MIN:
+			r->gap_min = v;
+			break;
+		case IPFIX_IE_GAP_MAX:
+			r->gap_max = v;
+			break;
+		case IPFIX_IE_GAP_MEAN:
+			r->gap_mean = v;
+			break;
+		case IPFIX_IE_JITTER:
+			r->jitter = v;
+			break;
+		}
+		return;
+	}
+
+	switch (f->id) {
+	case IE_SRC_IPV4:
+	case IE_DST_IPV4:
+		if (sizeof(struct in_addr) == f->len) {
+			r->flow.ethertype = ETHERTYPE_IP;
+			memcpy((IE_SRC_IPV4 == f->id) ? (void *)&r->flow.src_ip
+			                              : (void *)&r->flow.dst_ip,
+			       p, f->len);
+		}
+		break;
+	case IE_SRC_IPV6:
+	case IE_DST_IPV6:
+		if (sizeof(struct in6_addr) == f->len) {
+			r->flow.ethertype = ETHERTYPE_IPV6;
+			memcpy((IE_SRC_IPV6 == f->id) ? (void *)&r->flow.src_ip6
+			                              : (void *)&r->flow.dst_ip6,
+			       p, f->len);
+		}
+		break;
+	case IE_SRC_PORT:
+		r->flow.sport = v;
+		break;
+	case IE_DST_PORT:
+		r->flow.dport = v;
+		break;
+	case IE_PROTOCOL:
+		r->flow.proto = v;
+		break;
+	case IE_CLASS_OF_SERVICE:
+		r->flow.tclass = v;
+		break;
+	case IE_FLOW_END_REASON:
+		r->end = v;
+		break;
+	case IE_OCTET_DELTA_COUNT:
+		r->bytes = v;
+		break;
+	case IE_PACKET_DELTA_COUNT:
+		r->packets = v;
+		break;
+	case IE_FLOW_START_MS:
+		r->first = ms_to_tv(v);
+		break;
+	case IE_FLOW_END_MS:
+		r->last = ms_to_tv(v);
+		break;
+	}
+}
+
+static void open_set(struct ipfix_msg *m, uint16_t id)
+{
+	m->set_start = m->len;
+	m->set_id = id;
+	m->len += SET_HEADER_LEN;
+}
+
+static void close_set(struct ipfix_msg *m)
+{
+	if (!m->set_start) {
+		return;
+	}
+	put_uint(m->buf + m->set_start, m->set_id, 2);
+	put_uint(m->buf + m->set_start + 2, m->len - m->set_start, 2);
+	m->set_start = 0;
+}
+
+void ipfix_msg_begin(struct ipfix_msg *m, int with_templates)
+{
+	m->len = HEADER_LEN;
+	m->set_start = 0;
+	m->records = 0;
+
+	if (!with_templates) {
+		return;
+	}
+
+	open_set(m, SET_ID_TEMPLATE);
+	for (unsigned int t = 0; t < sizeof(templates) / sizeof(templates[0]);
+	     t++) {
+		put_uint(m->buf + m->len, templates[t].id, 2);
+		put_uint(m->buf + m->len + 2, templates[t].field_count, 2);
+		m->len += 4;
+		for (int i = 0; i < templates[t].field_count; i++) {
+			const struct ipfix_field *f = &templates[t].field[i];
+			uint16_t id = f->id | (f->enterprise ? ENTERPRISE_BIT : 0);
+
+			put_uint(m->buf + m->len, id, 2);
+			put_uint(m->buf + m->len + 2, f->len, 2);
+			m->len += 4;
+			if (f->enterprise) {
+				put_uint(m->buf + m->len, f->enterprise, 4);
+				m->len += 4;
+			}
+		}
+	}
+	close_set(m);
+}
+
+int ipfix_msg_add(struct ipfix_msg *m, const struct tt_flow_export *r)
+{
+	int t, len;
+
+	switch (r->flow.ethertype) {
+	case ETHERTYPE_IP:
+		t = 0;
+		break;
+	case ETHERTYPE_IPV6:
+		t = 1;
+		break;
+	default:
+		return 1;
+	}
+
+	len = record_len(templates[t].field, templates[t].field_count);
+	if (m->set_id != templates[t].id || !m->set_start) {
+		len += SET_HEADER_LEN;
+	}
+	if (m->len + len > IPFIX_MAX_MSG_LEN) {
+		return -1;
+	}
+
+	if (m->set_id != templates[t].id || !m->set_start) {
+		close_set(m);
+		open_set(m, templates[t].id);
+	}
+	for (int i = 0; i < templates[t].field_count; i++) {
+		encode_field(m->buf + m->len, &templates[t].field[i], r);
+		m->len += templates[t].field[i].len;
+	}
+	m->records++;
+	return 0;
+}
+
+int ipfix_msg_end(struct ipfix_msg *m, uint32_t export_time, uint32_t seq,
+                  uint32_t domain)
+{
+	close_set(m);
+	put_uint(m->buf, IPFIX_VERSION, 2);
+	put_uint(m->buf + 2, m->len, 2);
+	put_uint(m->buf + 4, export_time, 4);
+	put_uint(m->buf + 8, seq, 4);
+	put_uint(m->buf + 12, domain, 4);
+	return m->len;
+}
+
+static int parse_templates(struct ipfix_parser *p, const uint8_t *b,
+                           int len)
+{
+	while (len >= 4) {
+		uint16_t id = get_uint(b, 2);
+		int count = get_uint(b + 2, 2);
+		int slot;
+
+		b += 4;
+		len -= 4;
+		if (count > IPFIX_MAX_FIELDS || id < 256) {
+			return -1;
+		}
+		if (0 == count) {
+			/* withdrawn; records with it are skipped from now on */
+			for (slot = 0; slot < p->template_count; slot++) {
+				if (p->template[slot].id == id) {
+					p->template[slot].id = 0;
+				}
+			}
+			continue;
+		}
+
+		for (slot = 0; slot < p->template_count; slot++) {
+			if (p->template[slot].id == id) {
+				break;
+			}
+		}
+		if (slot == IPFIX_MAX_TEMPLATES) {
+			return -1;
+		}
+
+		p->template[slot].id = id;
+		p->template[slot].field_count = 0;
+		for (int i = 0; i < count; i++) {
+			struct ipfix_field *f = &p->template[slot].field[i];
+
+			if (len < 4) {
+				return -1;
+			}
+			f->id = get_uint(b, 2) & ~ENTERPRISE_BIT;
+			f->len = get_uint(b + 2, 2);
+			f->enterprise = 0;
+			if (get_uint(b, 2) & ENTERPRISE_BIT) {
+				if (len < 8) {
+					return -1;
+				}
+				f->enterprise = get_uint(b + 4, 4);
+				b += 4;
+				len -= 4;
+			}
+			if (0xffff == f->len) {
+				/* variable length; not used here */
+				return -1;
+			}
+			b += 4;
+			len -= 4;
+		}
+		p->template[slot].field_count = count;
+		if (slot == p->template_count) {
+			p->template_count++;
+		}
+	}
+	return 0;
+}
+
+static int parse_data(struct ipfix_parser *p, uint16_t set_id,
+                      const uint8_t *b, int len, ipfix_record_fn fn,
+                      void *data)
+{
+	int slot, rlen, records = 0;
+
+	for (slot = 0; slot < p->template_count; slot++) {
+		if (p->template[slot].id == set_id) {
+			break;
+		}
+	}
+	if (slot == p->template_count) {
+		/* the template hasn't been seen yet */
+		return 0;
+	}
+
+	rlen = record_len(p->template[slot].field,
+	                  p->template[slot].field_count);
+	if (!rlen) {
+		return -1;
+	}
+
+	/* anything shorter than a record at the end is padding */
+	while (len >= rlen) {
+		struct tt_flow_export r;
+
+		memset(&r, 0, sizeof(r));
+		for (int i = 0; i < p->template[slot].field_count; i++) {
+			const struct ipfix_field *f =
+			    &p->template[slot].field[i];
+			decode_field(b, f, &r);
+			b += f->len;
+		}
+		len -= rlen;
+		fn(&r, data);
+		records++;
+	}
+	return records;
+}
+
+int ipfix_parse(struct ipfix_parser *p, const uint8_t *buf, int len,
+                ipfix_record_fn fn, void *data)
+{
+	int msg_len, pos, records = 0;
+	uint32_t seq;
+
+	if (len < HEADER_LEN || IPFIX_VERSION != get_uint(buf, 2)) {
+		return -1;
+	}
+	msg_len = get_uint(buf + 2, 2);
+	if (msg_len > len || msg_len < HEADER_LEN) {
+		return -1;
+	}
+
+	seq = get_uint(buf + 8, 4);
+	if (p->started && seq != p->next_seq) {
+		p->lost += seq - p->next_seq;
+	}
+
+	for (pos = HEADER_LEN; pos + SET_HEADER_LEN <= msg_len;) {
+		uint16_t set_id = get_uint(buf + pos, 2);
+		int set_len = get_uint(buf + pos + 2, 2);
+		int n = 0;
+
+		if (set_len < SET_HEADER_LEN || pos + set_len > msg_len) {
+			return -1;
+		}
+		if (SET_ID_TEMPLATE == set_id) {
+			n = parse_templates(p, buf + pos + SET_HEADER_LEN,
+			                    set_len - SET_HEADER_LEN);
+		} else if (set_id >= 256) {
+			n = parse_data(p, set_id, buf + pos + SET_HEADER_LEN,
+			               set_len - SET_HEADER_LEN, fn, data);
+		}
+		if (n < 0) {
+			return -1;
+		}
+		records += n;
+		pos += set_len;
+	}
+
+	p->started = 1;
+	p->next_seq = seq + records;
+	return records;
+}
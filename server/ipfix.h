@@ -0,0 +1,90 @@
+#ifndef IPFIX_H
+#define IPFIX_H
+
+#include <stdint.h>
+
+#include "flow_export.h"
+
+/* IPFIX (RFC 7011) encoding of flow records, and just enough of a
+ * collector to decode them again, for testing.
+ *
+ * There are two templates, for IPv4 and IPv6 flows, with the flow key,
+ * DSCP, byte and packet counts, start and end times and the end reason.
+ * The inter-packet gaps and jitter are enterprise-specific IEs.
+ * Other flows (not IP) are not exported.
+ */
+
+#define IPFIX_PORT 4739
+
+/* the templates and as many records as fit are sent in one datagram,
+ * which is kept below a typical path MTU */
+#define IPFIX_MAX_MSG_LEN 1400
+
+#define IPFIX_TEMPLATE_V4 256
+#define IPFIX_TEMPLATE_V6 257
+
+/* The private enterprise number of the gap and jitter IEs. The default is
+ * the one reserved for documentation (RFC 5612). */
+#ifndef IPFIX_ENTERPRISE_ID
+#define IPFIX_ENTERPRISE_ID 32473
+#endif
+
+/* enterprise-specific IEs, unsigned32, in microseconds */
+enum ipfix_jt_ie {
+	IPFIX_IE_GAP_MIN = 1,
+	IPFIX_IE_GAP_MAX = 2,
+	IPFIX_IE_GAP_MEAN = 3,
+	IPFIX_IE_JITTER = 4
+};
+
+struct ipfix_msg {
+	uint8_t buf[IPFIX_MAX_MSG_LEN];
+	int len;
+	int set_start; /* of the open set, or 0 if there isn't one */
+	uint16_t set_id;
+	uint32_t records; /* data records in the message */
+};
+
+/* Start a message, with the template set if templates is set. */
+void ipfix_msg_begin(struct ipfix_msg *m, int templates);
+
+/* Add a data record. Returns 0 if it was added, 1 if it can't be exported
+ * (not IP) and -1 if the message is full. */
+int ipfix_msg_add(struct ipfix_msg *m, const struct tt_flow_export *r);
+
+/* Complete the message header. seq is the number of data records sent in
+ * the observation domain before this message. Returns the length. */
+int ipfix_msg_end(struct ipfix_msg *m, uint32_t export_time, uint32_t seq,
+                  uint32_t domain);
+
+/* The collector side: the templates seen so far. */
+#define IPFIX_MAX_TEMPLATES 8
+#define IPFIX_MAX_FIELDS 32
+
+struct ipfix_field {
+	uint16_t id;
+	uint16_t len;
+	uint32_t enterprise; /* 0 for IANA IEs */
+};
+
+struct ipfix_parser {
+	int template_count;
+	struct {
+		uint16_t id;
+		int field_count;
+		struct ipfix_field field[IPFIX_MAX_FIELDS];
+	} template[IPFIX_MAX_TEMPLATES];
+	int started;
+	uint32_t next_seq; /* expected sequence number of the next message */
+	uint32_t lost;     /* data records missing from the sequence */
+};
+
+typedef void (*ipfix_record_fn)(const struct tt_flow_export *r,
+                                void *data);
+
+/* Decode one message, calling fn for each data record that has a known
+ * template. Returns the number of records, or -1 if it is malformed. */
+int ipfix_parse(struct ipfix_parser *p, const uint8_t *buf, int len,
+                ipfix_record_fn fn, void *data);
+
+#endif
@@ -0,0 +1,85 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <net/ethernet.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "ipfix.h"
+
+/*
+ * A stand-in for an IPFIX collector, to check what jt-server exports:
+ * listens on UDP and prints every flow record it can decode.
+ *
+ * Usage: ipfix-collector [port]
+ */
+
+static void print_record(const struct tt_flow_export *r,
+                         void *data __attribute__((unused)))
+{
+	char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+	int af = (ETHERTYPE_IPV6 == r->flow.ethertype) ? AF_INET6 : AF_INET;
+
+	inet_ntop(af, &r->flow.src_ip6, src, sizeof(src));
+	inet_ntop(af, &r->flow.dst_ip6, dst, sizeof(dst));
+
+	printf("%s:%d -> %s:%d proto %d dscp %d, %" PRId64 " bytes %" PRId64
+	       " packets in %" PRId64 "ms, gaps %" PRId64 "/%" PRId64
+	       "/%" PRId64 "us jitter %" PRId64 "us, end %d\n",
+	       src, r->flow.sport, dst, r->flow.dport, r->flow.proto,
+	       r->flow.tclass >> 2, r->bytes, r->packets,
+	       (r->last.tv_sec - r->first.tv_sec) * 1000
+	           + (r->last.tv_usec - r->first.tv_usec) / 1000,
+	       r->gap_min, r->gap_mean, r->gap_max, r->jitter, r->end);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct ipfix_parser parser;
+	struct addrinfo hints = { 0 };
+	struct addrinfo *res;
+	uint8_t buf[65536];
+	char port[8];
+	int sock, err;
+
+	snprintf(port, sizeof(port), "%s", (argc > 1) ? argv[1] : "4739");
+
+	hints.ai_family = AF_INET6;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_PASSIVE;
+	err = getaddrinfo(NULL, port, &hints, &res);
+	if (err) {
+		fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(err));
+		return 1;
+	}
+
+	/* IPv6, which also takes IPv4 unless the system says otherwise */
+	sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (sock < 0 || bind(sock, res->ai_addr, res->ai_addrlen)) {
+		perror("bind");
+		return 1;
+	}
+	freeaddrinfo(res);
+	printf("listening on port %s\n", port);
+
+	for (;;) {
+		ssize_t len = recv(sock, buf, sizeof(buf), 0);
+		if (len < 0) {
+			perror("recv");
+			return 1;
+		}
+		if (ipfix_parse(&parser, buf, len, print_record, NULL) < 0) {
+			printf("malformed message, %zd bytes\n", len);
+		}
+		if (parser.lost) {
+			printf("%" PRIu32 " records lost so far\n", parser.lost);
+		}
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,254 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "flow_export.h"
+#include "mq_msg_flow.h"
+#include "ipfix.h"
+#include "tt_thread.h"
+#include "ipfix_thread.h"
+
+/*
+ * The flow records are queued by the toptalk thread as flows expire, and
+ * sent from here in batches: every EXPORT_PERIOD_NS, or as soon as a
+ * datagram is full. Over UDP, the templates are sent again every
+ * TEMPLATE_PERIOD_S, in the same datagram as the records that follow.
+ */
+
+#define EXPORT_PERIOD_NS 100000000
+#define TEMPLATE_PERIOD_S 60
+#define DEFAULT_ACTIVE_TIMEOUT_S 60
+
+static struct {
+	pthread_t thread_id;
+	pthread_attr_t thread_attr;
+	const char * const thread_name;
+} thread_info = {
+	0,
+	.thread_name = "jt-ipfix"
+};
+
+static char collector_host[256];
+static char collector_port[8];
+static int active_timeout_s = DEFAULT_ACTIVE_TIMEOUT_S;
+
+/* owned by the exporter thread */
+static int sock = -1;
+static unsigned long consumer_id;
+static struct ipfix_msg msg;
+static int msg_templates; /* the message has the templates */
+static uint32_t sequence;
+static time_t templates_sent;
+
+/* records that didn't fit in the queue; written by the toptalk thread */
+static volatile unsigned long dropped;
+
+/* local prototypes */
+static void *run(void *data);
+
+int ipfix_configure(const char *collector, int active_timeout)
+{
+	const char *host = collector;
+	const char *port = NULL;
+	int host_len;
+
+	if ('[' == collector[0]) {
+		const char *end = strchr(collector, ']');
+		if (!end || (end[1] && ':' != end[1])) {
+			return -1;
+		}
+		host = collector + 1;
+		host_len = end - host;
+		port = end[1] ? end + 2 : NULL;
+	} else {
+		const char *colon = strchr(collector, ':');
+		/* more than one colon is a bare IPv6 address */
+		if (colon && !strchr(colon + 1, ':')) {
+			port = colon + 1;
+			host_len = colon - collector;
+		} else {
+			host_len = strlen(collector);
+		}
+	}
+
+	if (!host_len || host_len >= (int)sizeof(collector_host)) {
+		return -1;
+	}
+	snprintf(collector_host, sizeof(collector_host), "%.*s", host_len,
+	         host);
+	snprintf(collector_port, sizeof(collector_port), "%s",
+	         (port && *port) ? port : "4739");
+
+	if (active_timeout > 0) {
+		active_timeout_s = active_timeout;
+	}
+	return 0;
+}
+
+/* called by the toptalk thread */
+static int record_producer(struct mq_flow_msg *m, void *data)
+{
+	m->r = *(const struct tt_flow_export *)data;
+	return 0;
+}
+
+static void queue_record(const struct tt_flow_export *r,
+                         void *data __attribute__((unused)))
+{
+	int cb_err;
+
+	if (mq_flow_produce(record_producer, (void *)r, &cb_err)) {
+		dropped++;
+	}
+}
+
+static int open_socket(void)
+{
+	struct addrinfo hints = { 0 };
+	struct addrinfo *res, *ai;
+	int err;
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	err = getaddrinfo(collector_host, collector_port, &hints, &res);
+	if (err) {
+		syslog(LOG_ERR, "ipfix: can't resolve collector %s: %s\n",
+		       collector_host, gai_strerror(err));
+		return -1;
+	}
+
+	for (ai = res; ai; ai = ai->ai_next) {
+		sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (sock < 0) {
+			continue;
+		}
+		/* connected, so that send() needs no address */
+		if (0 == connect(sock, ai->ai_addr, ai->ai_addrlen)) {
+			break;
+		}
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(res);
+
+	if (sock < 0) {
+		syslog(LOG_ERR, "ipfix: can't reach collector %s port %s\n",
+		       collector_host, collector_port);
+		return -1;
+	}
+	return 0;
+}
+
+int ipfix_thread_init(void)
+{
+	int err;
+
+	if (!collector_host[0]) {
+		return 0;
+	}
+
+	if (open_socket()) {
+		return -1;
+	}
+
+	mq_flow_init("flow");
+	err = mq_flow_consumer_subscribe(&consumer_id);
+	assert(!err);
+
+	assert(!thread_info.thread_id);
+	err = pthread_attr_init(&thread_info.thread_attr);
+	assert(!err);
+
+	err = pthread_create(&thread_info.thread_id, &thread_info.thread_attr,
+	                     run, NULL);
+	assert(!err);
+	pthread_setname_np(thread_info.thread_id, thread_info.thread_name);
+
+	tt_thread_set_flow_export(queue_record, NULL,
+	                          (struct timeval){ .tv_sec = active_timeout_s });
+
+	syslog(LOG_INFO, "ipfix: exporting flows to %s port %s\n",
+	       collector_host, collector_port);
+	return 0;
+}
+
+static void msg_begin(void)
+{
+	time_t now = time(NULL);
+
+	msg_templates = (now - templates_sent >= TEMPLATE_PERIOD_S);
+	ipfix_msg_begin(&msg, msg_templates);
+	if (msg_templates) {
+		templates_sent = now;
+	}
+}
+
+static void msg_send(void)
+{
+	int len = ipfix_msg_end(&msg, time(NULL), sequence, 0);
+
+	if (send(sock, msg.buf, len, 0) < 0) {
+		syslog(LOG_DEBUG, "ipfix: send failed: %s\n", strerror(errno));
+	}
+	/* counted whether they arrived or not, so the collector can tell */
+	sequence += msg.records;
+	msg_begin();
+}
+
+/* Returns non-zero to leave the record in the queue, when the message is
+ * full. */
+static int record_consumer(struct mq_flow_msg *m,
+                           void *data __attribute__((unused)))
+{
+	return (ipfix_msg_add(&msg, &m->r) < 0);
+}
+
+static void *run(void *data __attribute__((unused)))
+{
+	struct timespec period = { .tv_sec = 0, .tv_nsec = EXPORT_PERIOD_NS };
+	unsigned long reported_drops = 0;
+	int ret, cb_err;
+
+	templates_sent = time(NULL) - TEMPLATE_PERIOD_S;
+	msg_begin();
+
+	for (;;) {
+		nanosleep(&period, NULL);
+
+		do {
+			ret = mq_flow_consume(consumer_id, record_consumer,
+			                      NULL, &cb_err);
+			if (-JT_WS_MQ_CB_ERR == ret) {
+				msg_send();
+			}
+		} while (-JT_WS_MQ_EMPTY != ret);
+
+		/* the templates may be due, even without any records */
+		if (!msg.records && !msg_templates) {
+			msg_begin();
+		}
+		if (msg.records || msg_templates) {
+			msg_send();
+		}
+
+		if (dropped != reported_drops) {
+			syslog(LOG_WARNING,
+			       "ipfix: %lu flow records dropped, queue full\n",
+			       dropped - reported_drops);
+			reported_drops = dropped;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,13 @@
+#ifndef IPFIX_THREAD_H
+#define IPFIX_THREAD_H
+
+/* Export the toptalk flow records to an IPFIX collector, given as
+ * "host", "host:port" or "[ipv6]:port". Flows that are active for longer
+ * than active_timeout seconds are reported every active_timeout.
+ * Must be called before ipfix_thread_init(). */
+int ipfix_configure(const char *collector, int active_timeout);
+
+/* Start the exporter, if it has been configured. */
+int ipfix_thread_init(void);
+
+#endif
@@ -32,7 +32,7 @@ static_assert(
     " (int)" xstr(SAMPLES_PER_FRAME *SAMPLE_PERIOD_US
                       *MESSAGES_PER_SECOND) " != (int)" xstr(USECS_PER_SECOND));
 
-/* for synchronization of netlink cache operations. */
+/* for synchronization of the sampling thread netlink socket. */
 extern pthread_mutex_t nl_sock_mutex;
 extern char g_selected_iface[MAX_IFACE_LEN];
 
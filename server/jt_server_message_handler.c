@@ -21,7 +21,15 @@
 #include "sampling_thread.h"
 #include "compute_thread.h"
 #include "tt_thread.h"
+#include "program_thread.h"
+#include "verify_thread.h"
+#include "ipfix_thread.h"
 #include "netem.h"
+#include "update_rate.h"
+#include "flow_dict.h"
+#include "history.h"
+#include "latency.h"
+#include "rollup.h"
 
 #include "mq_msg_stats.h"
 #include "mq_msg_ws.h"
@@ -47,18 +55,153 @@ char g_selected_iface[MAX_IFACE_LEN];
 unsigned long stats_consumer_id;
 unsigned long tt_consumer_id;
 
+/* The message and netem structs share units; see jt_msg_netem_params.h.
+ * The flow fields are narrower in netem_params, so they are checked here,
+ * before they would wrap; netem_validate_params() checks the rest. */
+static int jt_msg_to_netem_params(const struct jt_msg_netem_params *m,
+                                  struct netem_params *p)
+{
+	const char *reason = NULL;
+
+	if (m->flow_sport < 0 || m->flow_sport > UINT16_MAX
+	    || m->flow_dport < 0 || m->flow_dport > UINT16_MAX) {
+		reason = "flow port out of range";
+	} else if (m->flow_proto < 0 || m->flow_proto > UINT8_MAX) {
+		reason = "flow protocol out of range";
+	}
+	if (reason) {
+		syslog(LOG_ERR, "invalid netem params for %s: %s\n", m->iface,
+		       reason);
+		return -EINVAL;
+	}
+
+	snprintf(p->iface, MAX_IFACE_LEN, "%s", m->iface);
+	p->delay = m->delay;
+	p->jitter = m->jitter;
+	p->delay_corr = m->delay_corr;
+	snprintf(p->dist, NETEM_DIST_LEN, "%s", m->dist);
+	p->loss = m->loss;
+	p->loss_corr = m->loss_corr;
+	p->ge_p = m->ge_p;
+	p->ge_r = m->ge_r;
+	p->ge_loss_bad = m->ge_loss_bad;
+	p->ge_loss_good = m->ge_loss_good;
+	p->dup = m->dup;
+	p->dup_corr = m->dup_corr;
+	p->reorder = m->reorder;
+	p->reorder_corr = m->reorder_corr;
+	p->gap = m->gap;
+	p->corrupt = m->corrupt;
+	p->corrupt_corr = m->corrupt_corr;
+	p->limit = m->limit;
+	p->rate = m->rate;
+	p->rate_overhead = m->rate_overhead;
+	p->slot_min = m->slot_min;
+	p->slot_max = m->slot_max;
+	p->slot_packets = m->slot_packets;
+	p->slot_bytes = m->slot_bytes;
+	p->dir = m->dir;
+	snprintf(p->flow.src, NETEM_ADDR_LEN, "%s", m->flow_src);
+	snprintf(p->flow.dst, NETEM_ADDR_LEN, "%s", m->flow_dst);
+	p->flow.sport = m->flow_sport;
+	p->flow.dport = m->flow_dport;
+	p->flow.proto = m->flow_proto;
+	return 0;
+}
+
+static void netem_params_to_jt_msg(const struct netem_params *p,
+                                   struct jt_msg_netem_params *m)
+{
+	snprintf(m->iface, MAX_IFACE_LEN, "%s", p->iface);
+	m->delay = p->delay;
+	m->jitter = p->jitter;
+	m->delay_corr = p->delay_corr;
+	snprintf(m->dist, NETEM_DIST_LEN, "%s", p->dist);
+	m->loss = p->loss;
+	m->loss_corr = p->loss_corr;
+	m->ge_p = p->ge_p;
+	m->ge_r = p->ge_r;
+	m->ge_loss_bad = p->ge_loss_bad;
+	m->ge_loss_good = p->ge_loss_good;
+	m->dup = p->dup;
+	m->dup_corr = p->dup_corr;
+	m->reorder = p->reorder;
+	m->reorder_corr = p->reorder_corr;
+	m->gap = p->gap;
+	m->corrupt = p->corrupt;
+	m->corrupt_corr = p->corrupt_corr;
+	m->limit = p->limit;
+	m->rate = p->rate;
+	m->rate_overhead = p->rate_overhead;
+	m->slot_min = p->slot_min;
+	m->slot_max = p->slot_max;
+	m->slot_packets = p->slot_packets;
+	m->slot_bytes = p->slot_bytes;
+	m->dir = p->dir;
+	snprintf(m->flow_src, NETEM_ADDR_LEN, "%s", p->flow.src);
+	snprintf(m->flow_dst, NETEM_ADDR_LEN, "%s", p->flow.dst);
+	m->flow_sport = p->flow.sport;
+	m->flow_dport = p->flow.dport;
+	m->flow_proto = p->flow.proto;
+}
+
 static int set_netem(void *data)
 {
 	struct jt_msg_netem_params *p1 = data;
-	struct netem_params p2 = {
-		.delay = p1->delay, .jitter = p1->jitter, .loss = p1->loss,
-	};
+	struct netem_params p2;
+	int err;
 
-	netem_set_params(p1->iface, &p2);
+	/* invalid params are rejected (and logged) here or by
+	 * netem_set_params. Either way, tell the client what is actually in
+	 * effect. */
+	err = jt_msg_to_netem_params(p1, &p2);
+	if (!err) {
+		err = netem_set_params(p1->iface, &p2);
+	}
 	jt_srv_send_netem_params();
+	return err;
+}
+
+static int set_program(void *data)
+{
+	struct jt_msg_program *p = data;
+
+	if (0 == p->count) {
+		program_stop();
+	} else if (program_load(p)) {
+		return -1;
+	}
+	jt_srv_send_program_status();
 	return 0;
 }
 
+static int set_update_rate(void *data, struct update_rate *u)
+{
+	struct jt_msg_update_rate *m = data;
+	int64_t rollups[UPDATE_RATE_MAX_IVALS];
+	int rollup_count = 0;
+
+	for (int i = 0; i < m->rollup_count; i++) {
+		int r = tt_rollup_find(m->rollups[i]);
+		if (r < 0) {
+			syslog(LOG_WARNING, "ignoring unknown rollup: [%s]\n",
+			       m->rollups[i]);
+			continue;
+		}
+		rollups[rollup_count++] = r;
+	}
+
+	return update_rate_set(u, m->max_rate, m->stats, m->stats_count,
+	                       m->tt, m->tt_count, m->flow_ids,
+	                       rollups, rollup_count);
+}
+
+static int set_verify(void *data)
+{
+	struct jt_msg_verify *v = data;
+	return verify_configure(v);
+}
+
 static int select_iface(void *data)
 {
 	char(*iface)[MAX_IFACE_LEN] = data;
@@ -70,10 +213,16 @@ static int select_iface(void *data)
 		       *iface, EXPAND_AND_QUOTE(ALLOWED_IFACES));
 		return -1;
 	}
+	/* ingress impairment is only shown for the selected iface, so
+	 * don't leave it behind where it can't be cleared */
+	if (g_selected_iface[0] && strcmp(g_selected_iface, *iface)) {
+		netem_ingress_release(g_selected_iface);
+	}
 	snprintf(g_selected_iface, MAX_IFACE_LEN, "%s", *iface);
 	syslog(LOG_INFO, "switching to iface: [%s]\n", *iface);
 	sample_iface(*iface);
 	tt_thread_restart(*iface);
+	history_clear();
 
 	jt_srv_send_select_iface();
 	jt_srv_send_netem_params();
@@ -125,16 +274,69 @@ static void mq_stats_msg_to_jt_msg_stats(struct mq_stats_msg *mq_s,
 	msg_s->mean_tx_packet_gap = mq_s->mean_tx_packet_gap;
 
 	msg_s->interval_ns = mq_s->interval_ns;
+
+	msg_s->timestamp = mq_s->timestamp;
+	msg_s->sample_ns = mq_s->sample_ns;
+	msg_s->trace_us[JT_TRACE_COMPUTE] = mq_s->compute_us;
 }
 
+struct ws_msg_src {
+	const char *s;
+	int len; /* of s, including the NUL */
+	enum update_kind kind;
+	int64_t interval_ns;
+	int flow_ids;
+	int flow_id_count;
+	const uint16_t *flow_id;
+	unsigned long backfill_for;
+	int64_t sample_ns;
+};
+
 inline static int message_producer(struct mq_ws_msg *m, void *data)
 {
-	char *s = (char *)data;
-	snprintf(m->m, MAX_JSON_MSG_LEN, "%s", s);
+	struct ws_msg_src *src = (struct ws_msg_src *)data;
+	m->update_kind = src->kind;
+	m->interval_ns = src->interval_ns;
+	m->flow_ids = src->flow_ids;
+	m->flow_id_count = src->flow_id_count;
+	if (src->flow_id_count) {
+		memcpy(m->flow_id, src->flow_id,
+		       src->flow_id_count * sizeof(m->flow_id[0]));
+	}
+	m->backfill_for = src->backfill_for;
+	m->sample_ns = src->sample_ns;
+	m->queued_ns = src->sample_ns ? latency_now_ns() : 0;
+	memcpy(m->m, src->s, m->len);
 	return 0;
 }
 
-int jt_srv_send(int msg_type, void *msg_data)
+/* the periodic messages are subject to each session's update rate */
+static void msg_update_kind(int msg_type, void *msg_data,
+                            struct ws_msg_src *src)
+{
+	switch (msg_type) {
+	case JT_MSG_STATS_V1:
+		src->kind = UPDATE_STATS;
+		src->interval_ns = ((struct jt_msg_stats *)msg_data)->interval_ns;
+		break;
+	case JT_MSG_TOPTALK_V1:
+		src->kind = UPDATE_TOPTALK;
+		src->interval_ns =
+		    ((struct jt_msg_toptalk *)msg_data)->interval_ns;
+		break;
+	case JT_MSG_ROLLUP_V1:
+		/* rollups are told apart by their index, not their interval */
+		src->kind = UPDATE_ROLLUP;
+		src->interval_ns =
+		    tt_rollup_find(((struct jt_msg_rollup *)msg_data)->name);
+		break;
+	default:
+		src->kind = UPDATE_NONE;
+		src->interval_ns = 0;
+	}
+}
+
+static int send_src(int msg_type, void *msg_data, struct ws_msg_src *src)
 {
 	char *tmpstr;
 	int cb_err, err = 0;
@@ -146,37 +348,219 @@ int jt_srv_send(int msg_type, void *msg_data)
 	}
 
 	/* write the json string to a websocket message */
-	err = mq_ws_produce(message_producer, tmpstr, &cb_err);
+	src->s = tmpstr;
+	src->len = strlen(tmpstr) + 1;
+	err = mq_ws_produce(src->len, message_producer, src, &cb_err);
 	free(tmpstr);
+
+	if (!err && src->sample_ns) {
+		latency_record(JT_LATENCY_ENCODE,
+		               latency_now_ns() - src->sample_ns);
+	}
 	return err;
 }
 
-int jt_srv_send_netem_params(void)
+/* The compact form of a toptalk message, for sessions that keep a flow
+ * dictionary: the flows are replaced by their ids, which are also written
+ * to ids[]. */
+static void toptalk_to_ids(const struct jt_msg_toptalk *t,
+                           struct jt_msg_toptalk_ids *m, uint16_t *ids)
+{
+	struct flow_dict_key key;
+	int count = (t->tflows < MAX_FLOWS) ? t->tflows : MAX_FLOWS;
+
+	m->timestamp = t->timestamp;
+	m->interval_ns = t->interval_ns;
+	m->tflows = t->tflows;
+	m->tbytes = t->tbytes;
+	m->tpackets = t->tpackets;
+	m->distinct = t->distinct;
+	memcpy(m->pgaps, t->pgaps, sizeof(m->pgaps));
+	memcpy(m->psizes, t->psizes, sizeof(m->psizes));
+	m->count = 0;
+
+	flow_dict_advance();
+	for (int i = 0; i < count && i < WS_MSG_MAX_FLOW_IDS; i++) {
+		memset(&key, 0, sizeof(key));
+		snprintf(key.src, sizeof(key.src), "%s", t->flows[i].src);
+		snprintf(key.dst, sizeof(key.dst), "%s", t->flows[i].dst);
+		key.sport = t->flows[i].sport;
+		key.dport = t->flows[i].dport;
+		snprintf(key.proto, sizeof(key.proto), "%s", t->flows[i].proto);
+		snprintf(key.tclass, sizeof(key.tclass), "%s",
+		         t->flows[i].tclass);
+
+		int id = flow_dict_id(&key);
+		if (id < 0) {
+			/* dictionary full; leave it out, it's in the totals */
+			continue;
+		}
+		ids[m->count] = id;
+		m->flows[m->count].id = id;
+		m->flows[m->count].bytes = t->flows[i].bytes;
+		m->flows[m->count].packets = t->flows[i].packets;
+		memcpy(m->flows[m->count].sizes, t->flows[i].sizes,
+		       sizeof(m->flows[m->count].sizes));
+		m->count++;
+	}
+}
+
+/* Toptalk is always converted to flow ids, for the history, and sent in
+ * that form if any session wants it. */
+static int send_toptalk_ids(struct jt_msg_toptalk *t, struct ws_msg_src *src)
 {
-	struct netem_params p;
-	struct jt_msg_netem_params *m =
-	    malloc(sizeof(struct jt_msg_netem_params));
+	struct jt_msg_toptalk_ids *m;
+	uint16_t ids[WS_MSG_MAX_FLOW_IDS];
+	int err = 0;
+
+	m = malloc(sizeof(struct jt_msg_toptalk_ids));
 	assert(m);
 
+	toptalk_to_ids(t, m, ids);
+	history_add_toptalk(m);
+
+	if (update_rate_wanted(src->kind, 1, src->interval_ns)) {
+		src->flow_ids = 1;
+		src->flow_id_count = m->count;
+		src->flow_id = ids;
+		err = send_src(JT_MSG_TOPTALK_IDS_V1, m, src);
+		src->flow_ids = 0;
+		src->flow_id_count = 0;
+	}
+	free(m);
+	return err;
+}
+
+int jt_srv_send(int msg_type, void *msg_data)
+{
+	struct ws_msg_src src = { 0 };
+	int err = 0;
+
+	msg_update_kind(msg_type, msg_data, &src);
+
+	if (JT_MSG_TOPTALK_V1 == msg_type) {
+		err = send_toptalk_ids(msg_data, &src);
+	} else if (JT_MSG_STATS_V1 == msg_type) {
+		history_add_stats(msg_data);
+	}
+
+	if (!update_rate_wanted(src.kind, 0, src.interval_ns)) {
+		/* no session shows it, don't bother encoding it */
+		return err;
+	}
+	if (JT_MSG_STATS_V1 == msg_type) {
+		struct jt_msg_stats *s = msg_data;
+
+		src.sample_ns = s->sample_ns;
+		s->trace_us[JT_TRACE_PACK] =
+		    (latency_now_ns() - s->sample_ns) / 1000;
+	}
+	if (send_src(msg_type, msg_data, &src)) {
+		return -1;
+	}
+	return err;
+}
+
+/* A place in the queue for the session's backfill, behind the messages
+ * that it was sent on connecting, which reset its charts. The other
+ * sessions skip it. */
+int jt_srv_send_backfill_marker(unsigned long consumer_id)
+{
+	struct ws_msg_src src = { 0 };
+	int cb_err;
+
+	src.s = "";
+	src.len = 1;
+	src.kind = UPDATE_NONE;
+	src.backfill_for = consumer_id;
+	return mq_ws_produce(src.len, message_producer, &src, &cb_err);
+}
+
+/* The session's backfill message, and the flow ids that it refers to. */
+int jt_srv_pack_backfill(const struct history_mark *mark,
+                         const struct update_rate *u, uint16_t *ids,
+                         int *id_count, char **out)
+{
+	/* Megabytes, so it is reused rather than allocated per session. Only
+	 * the websocket service thread packs backfills, like the history. */
+	static struct jt_msg_backfill b;
+
+	*id_count = history_backfill(mark, u, &b, ids);
+	if (!b.stats_count && !b.toptalk_count) {
+		/* nothing to fill in */
+		*out = NULL;
+		return 0;
+	}
+
+	return jt_messages[JT_MSG_BACKFILL_V1].to_json_string(&b, out);
+}
+
+/* Announce the flows behind these ids, as a flow_dict message. */
+int jt_srv_pack_flow_dict(const uint16_t *ids, int count, char **out)
+{
+	struct jt_msg_flow_dict *d;
+	int err;
+
+	d = calloc(1, sizeof(struct jt_msg_flow_dict));
+	assert(d);
+
+	for (int i = 0; i < count && d->count < MAX_FLOWS; i++) {
+		const struct flow_dict_key *key = flow_dict_get(ids[i]);
+		if (!key) {
+			continue;
+		}
+		d->flows[d->count].id = ids[i];
+		d->flows[d->count].sport = key->sport;
+		d->flows[d->count].dport = key->dport;
+		snprintf(d->flows[d->count].src, ADDR_LEN, "%s", key->src);
+		snprintf(d->flows[d->count].dst, ADDR_LEN, "%s", key->dst);
+		snprintf(d->flows[d->count].proto, PROTO_LEN, "%s", key->proto);
+		snprintf(d->flows[d->count].tclass, TCLASS_LEN, "%s",
+		         key->tclass);
+		d->count++;
+	}
+
+	err = jt_messages[JT_MSG_FLOW_DICT_V1].to_json_string(d, out);
+	free(d);
+	return err;
+}
+
+static int send_netem_params(uint32_t dir)
+{
+	struct netem_params p = { 0 };
+	struct jt_msg_netem_params *m;
+
 	memcpy(p.iface, g_selected_iface, MAX_IFACE_LEN);
+	p.dir = dir;
 
 	if (0 != netem_get_params(p.iface, &p)) {
 		/* There need not be a netem qdisc on the interface */
+		if (NETEM_DIR_INGRESS == dir) {
+			/* and ingress is only set up on demand */
+			return 0;
+		}
+		memset(&p, 0, sizeof(p));
+		memcpy(p.iface, g_selected_iface, MAX_IFACE_LEN);
 		p.delay = -1;
 		p.jitter = -1;
 		p.loss = -1;
 	}
 
-	m->delay = p.delay;
-	m->jitter = p.jitter;
-	m->loss = p.loss;
-	snprintf(m->iface, MAX_IFACE_LEN, "%s", p.iface);
+	m = malloc(sizeof(struct jt_msg_netem_params));
+	assert(m);
+	netem_params_to_jt_msg(&p, m);
 
 	int err = jt_srv_send(JT_MSG_NETEM_PARAMS_V1, m);
 	free(m);
 	return err;
 }
 
+int jt_srv_send_netem_params(void)
+{
+	int err = send_netem_params(NETEM_DIR_EGRESS);
+	return err ? err : send_netem_params(NETEM_DIR_INGRESS);
+}
+
 int jt_srv_send_select_iface(void)
 {
 	char iface[MAX_IFACE_LEN];
@@ -244,16 +628,100 @@ int jt_srv_send_sample_period(void)
 	return jt_srv_send(JT_MSG_SAMPLE_PERIOD_V1, &sp);
 }
 
+int jt_srv_send_program_status(void)
+{
+	struct jt_msg_program_status *m =
+	    malloc(sizeof(struct jt_msg_program_status));
+	assert(m);
+
+	program_get_status(m);
+
+	int err = jt_srv_send(JT_MSG_PROGRAM_STATUS_V1, m);
+	free(m);
+	return err;
+}
+
+int jt_srv_send_verify_result(void)
+{
+	struct jt_msg_verify_result *m =
+	    malloc(sizeof(struct jt_msg_verify_result));
+	assert(m);
+
+	verify_get_result(m);
+
+	int err = jt_srv_send(JT_MSG_VERIFY_RESULT_V1, m);
+	free(m);
+	return err;
+}
+
+_Static_assert((int)JT_ANOMALY_SERIES == (int)MQ_STATS_SERIES
+               && (int)JT_ANOMALY_TX_PGAP == (int)MQ_STATS_TX_PGAP,
+               "anomaly series are passed on as they are");
+
+/* The changes found in a stats message's series, each as a message of
+ * its own. The onsets are moved from CLOCK_MONOTONIC to the message's
+ * CLOCK_REALTIME. */
+static int send_anomalies(const struct mq_stats_msg *m)
+{
+	struct jt_msg_anomaly a;
+	int64_t real_ns = m->timestamp.tv_sec * 1000000000LL +
+	                  m->timestamp.tv_nsec;
+	int err = 0;
+
+	for (int i = 0; i < m->anomaly_count; i++) {
+		const struct detect_event *e = &m->anomalies[i].e;
+		int64_t onset_ns = real_ns - (m->sample_ns - e->onset_ns);
+
+		memset(&a, 0, sizeof(a));
+		snprintf(a.iface, MAX_IFACE_LEN, "%s", m->iface);
+		a.series = (enum jt_anomaly_series)m->anomalies[i].series;
+		a.interval_ns = m->interval_ns;
+		a.onset.tv_sec = onset_ns / 1000000000LL;
+		a.onset.tv_nsec = onset_ns % 1000000000LL;
+		a.timestamp = m->timestamp;
+		a.baseline = llround(e->baseline);
+		a.level = llround(e->level);
+		a.sd = llround(e->sd);
+		err |= jt_srv_send(JT_MSG_ANOMALY_V1, &a);
+	}
+	return err;
+}
+
 static int stats_consumer(struct mq_stats_msg *m, void *data)
 {
 	struct jt_msg_stats *s = (struct jt_msg_stats *)data;
 	mq_stats_msg_to_jt_msg_stats(m, s);
+	send_anomalies(m);
+
+	s->trace_us[JT_TRACE_DEQUEUE] = (latency_now_ns() - s->sample_ns) / 1000;
+	latency_record(JT_LATENCY_COMPUTE,
+	               s->trace_us[JT_TRACE_COMPUTE] * 1000LL);
+	latency_record(JT_LATENCY_DEQUEUE,
+	               s->trace_us[JT_TRACE_DEQUEUE] * 1000LL);
 	if (0 == jt_srv_send(JT_MSG_STATS_V1, s)) {
 		return 0;
 	}
 	return 1;
 }
 
+/* The stage latencies of the last second, if there were any stats. */
+static int jt_srv_send_latency(void)
+{
+	static int64_t last_ns;
+	struct jt_msg_latency m;
+	int64_t now_ns = latency_now_ns();
+
+	if (now_ns - last_ns < 1000000000LL) {
+		return 0;
+	}
+	last_ns = now_ns;
+
+	if (!latency_take(&m)) {
+		return 0;
+	}
+	return jt_srv_send(JT_MSG_LATENCY_V1, &m);
+}
+
 int jt_srv_send_stats(void)
 {
 	struct jt_msg_stats *msg_stats;
@@ -278,7 +746,9 @@ static int tt_consumer(struct mq_tt_msg *m, void *data)
 
 	//jt_messages[JT_MSG_TOPTALK_V1].print(m);
 
-	if (0 == jt_srv_send(JT_MSG_TOPTALK_V1, (struct jt_msg_toptalk *)m)) {
+	if (0 == jt_srv_send(m->type, (JT_MSG_ROLLUP_V1 == m->type)
+	                                  ? (void *)&m->r
+	                                  : (void *)&m->m)) {
 		return 0;
 	}
 	return 1;
@@ -320,6 +790,9 @@ static int jt_init(void)
 	mq_stats_init("stats");
 	compute_thread_init();
 	intervals_thread_init();
+	program_thread_init();
+	verify_thread_init();
+	ipfix_thread_init();
 
 	err = mq_stats_consumer_subscribe(&stats_consumer_id);
 	assert(!err);
@@ -343,6 +816,10 @@ int jt_srv_pause(void)
 	err = mq_tt_consumer_unsubscribe(tt_consumer_id);
 	assert(!err);
 
+	/* nothing is recorded while paused, so the next session mustn't be
+	 * filled in from before the gap */
+	history_clear();
+
 	g_jt_state = JT_STATE_PAUSED;
 	return 0;
 }
@@ -378,6 +855,7 @@ int jt_server_tick(void)
 		/* queue a stats msg (if there is one) */
 		jt_srv_send_stats();
 		jt_srv_send_tt();
+		jt_srv_send_latency();
 		break;
 	case JT_STATE_PAUSED:
 		break;
@@ -385,13 +863,14 @@ int jt_server_tick(void)
 	return 0;
 }
 
-static int jt_msg_handler(char *in_unsafe, int len, const int *msg_type_arr)
+static int jt_msg_handler(char *in_unsafe, int len, const int *msg_type_arr,
+                          struct update_rate *u)
 {
 	json_t *root;
 	json_error_t error;
 	void *data;
 	const int *msg_type;
-	char in_safe[1024];
+	char in_safe[MAX_JSON_MSG_LEN];
 
 	if (len <= 0) {
 		syslog(LOG_ERR, "error: message cannot have negative length");
@@ -448,6 +927,15 @@ static int jt_msg_handler(char *in_unsafe, int len, const int *msg_type_arr)
 		case JT_MSG_SET_NETEM_V1:
 			err = set_netem(data);
 			break;
+		case JT_MSG_SET_PROGRAM_V1:
+			err = set_program(data);
+			break;
+		case JT_MSG_VERIFY_V1:
+			err = set_verify(data);
+			break;
+		case JT_MSG_UPDATE_RATE_V1:
+			err = set_update_rate(data, u);
+			break;
 		case JT_MSG_HELLO_V1:
 			syslog(LOG_INFO, "new session");
 			break;
@@ -465,7 +953,7 @@ static int jt_msg_handler(char *in_unsafe, int len, const int *msg_type_arr)
 }
 
 /* handle messages received from client in server */
-int jt_server_msg_receive(char *in, int len)
+int jt_server_msg_receive(char *in, int len, struct update_rate *u)
 {
-	return jt_msg_handler(in, len, &jt_msg_types_c2s[0]);
+	return jt_msg_handler(in, len, &jt_msg_types_c2s[0], u);
 }
@@ -1,13 +1,25 @@
 #ifndef JT_SERVER_MSG_HANDLER_H
 #define JT_SERVER_MSG_HANDLER_H
 
+#include <stdint.h>
+
+struct update_rate;
+struct history_mark;
+
 int jt_server_tick(void);
-int jt_server_msg_receive(char *in, int len);
+int jt_server_msg_receive(char *in, int len, struct update_rate *u);
 
 int jt_srv_send_iface_list(void);
 int jt_srv_send_select_iface(void);
 int jt_srv_send_netem_params(void);
 int jt_srv_send_sample_period(void);
+int jt_srv_send_program_status(void);
+int jt_srv_send_verify_result(void);
+int jt_srv_pack_flow_dict(const uint16_t *ids, int count, char **out);
+int jt_srv_send_backfill_marker(unsigned long consumer_id);
+int jt_srv_pack_backfill(const struct history_mark *mark,
+                         const struct update_rate *u, uint16_t *ids,
+                         int *id_count, char **out);
 int jt_srv_resume(void);
 int jt_srv_pause(void);
 #endif
@@ -0,0 +1,54 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <jansson.h>
+
+#include "jt_msg_latency.h"
+#include "latency.h"
+
+static struct jt_msg_latency hist;
+static int recorded;
+
+int64_t latency_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void latency_record(int stage, int64_t ns)
+{
+	int64_t us = ns / 1000;
+	int b = 0;
+
+	assert(stage >= 0 && stage < JT_LATENCY_STAGES);
+
+	/* the first bucket whose bound of 2^b us is more than us */
+	while (b < JT_LATENCY_BUCKETS - 1 && us >= (1LL << b)) {
+		b++;
+	}
+	hist.hist[stage][b]++;
+	recorded = 1;
+}
+
+void latency_record_written(int64_t sample_ns, int64_t queued_ns)
+{
+	int64_t now_ns = latency_now_ns();
+
+	latency_record(JT_LATENCY_WRITE, now_ns - queued_ns);
+	latency_record(JT_LATENCY_TOTAL, now_ns - sample_ns);
+}
+
+int latency_take(struct jt_msg_latency *m)
+{
+	if (!recorded) {
+		return 0;
+	}
+	memcpy(m, &hist, sizeof(hist));
+	memset(&hist, 0, sizeof(hist));
+	recorded = 0;
+	return 1;
+}
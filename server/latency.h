@@ -0,0 +1,28 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+/* Histograms of how long the stats messages take to get through each
+ * stage of the pipeline (enum jt_latency_stage), from reading the counters
+ * to writing the message to a websocket, sent to the clients once a
+ * second in a latency message.
+ *
+ * Only used from the websocket service thread, so there is no locking. */
+
+struct jt_msg_latency;
+
+/* CLOCK_MONOTONIC, the clock of the samples */
+int64_t latency_now_ns(void);
+
+void latency_record(int stage, int64_t ns);
+
+/* A stats message that was queued at queued_ns has just been written to a
+ * session: the write and total stages. */
+void latency_record_written(int64_t sample_ns, int64_t queued_ns);
+
+/* Move the counts since the last call into m. Returns 0 if there were
+ * none, so that there's nothing to send. */
+int latency_take(struct jt_msg_latency *m);
+
+#endif
@@ -8,7 +8,8 @@ typedef enum {
 	JT_WS_MQ_EMPTY = 1,
 	JT_WS_MQ_FULL = 2,
 	JT_WS_MQ_CB_ERR = 3,
-	JT_WS_MQ_NO_CONSUMERS = 4
+	JT_WS_MQ_NO_CONSUMERS = 4,
+	JT_WS_MQ_TOO_LONG = 5
 } jtmq_err;
 
 #endif  /* JT_MQ_GENERIC_ERRORS */
@@ -16,6 +17,7 @@ typedef enum {
 /* The remaining parameterized definitions MUST be unique and SHOULD be
  * included every time a specific queue type is used.
  */
+#ifdef NS
 
 struct NS(msg);
 
@@ -30,3 +32,4 @@ int NS(produce)(NS(callback) cb, void *cb_data, int *cb_err);
 int NS(consume)(unsigned long id, NS(callback) cb, void *cb_data, int *cb_err);
 int NS(maxlen)(void);
 
+#endif /* NS */
@@ -0,0 +1,13 @@
+#include <time.h>
+#include <inttypes.h>
+
+#include "mq_msg_flow.h"
+
+#define MAX_CONSUMERS 1
+/* room for the flows that expire together at the end of a long interval */
+#define MAX_Q_DEPTH 4096
+
+#define NS(name) PRIMITIVE_CAT(mq_flow_, name)
+#define PRIMITIVE_CAT(a, ...) a##__VA_ARGS__
+#include "mq_generic.c"
+#undef NS
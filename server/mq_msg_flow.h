@@ -0,0 +1,18 @@
+#ifndef MQ_MSG_FLOW_H
+#define MQ_MSG_FLOW_H
+
+#define NS(name) PRIMITIVE_CAT(mq_flow_, name)
+#define PRIMITIVE_CAT(a, ...) a##__VA_ARGS__
+
+#include "flow_export.h"
+
+
+/* flow records on their way from the toptalk thread to the exporter */
+struct NS(msg) {
+	struct tt_flow_export r;
+};
+
+#include "mq_generic.h"
+
+#undef NS
+#endif
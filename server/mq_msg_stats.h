@@ -1,12 +1,27 @@
 #ifndef MQ_MSG_STATS_H
 #define MQ_MSG_STATS_H
 
+#include "detect.h"
+
 #define NS(name) PRIMITIVE_CAT(mq_stats_, name)
 #define PRIMITIVE_CAT(a, ...) a##__VA_ARGS__
 
+/* the series that are watched for changes, see detect.h */
+enum mq_stats_series {
+	MQ_STATS_RX_RATE,
+	MQ_STATS_TX_RATE,
+	MQ_STATS_RX_PGAP,
+	MQ_STATS_TX_PGAP,
+	MQ_STATS_SERIES
+};
+
 
 struct NS(msg) {
+	/* when the newest sample was read: realtime, and monotonic in ns */
 	struct timespec timestamp;
+	int64_t sample_ns;
+	/* how long after sample_ns the message was produced */
+	uint32_t compute_us;
 	uint64_t interval_ns;
 
 	uint64_t min_rx_bytes;
@@ -38,6 +53,13 @@ struct NS(msg) {
 	uint32_t mean_tx_packet_gap;
 
 	char iface[MAX_IFACE_LEN];
+
+	/* the changes that this message's samples completed */
+	int anomaly_count;
+	struct {
+		enum mq_stats_series series;
+		struct detect_event e;
+	} anomalies[MQ_STATS_SERIES];
 };
 
 #include "mq_generic.h"
@@ -4,7 +4,8 @@
 #include "mq_msg_tt.h"
 
 #define MAX_CONSUMERS 1
-#define MAX_Q_DEPTH 16
+/* room for every interval and rollup at the longest interval's tick */
+#define MAX_Q_DEPTH 32
 
 #define NS(name) PRIMITIVE_CAT(mq_tt_, name)
 #define PRIMITIVE_CAT(a, ...) a##__VA_ARGS__
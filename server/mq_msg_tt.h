@@ -6,10 +6,16 @@
 
 #define json_t void
 #include "jt_msg_toptalk.h"
+#include "jt_msg_rollup.h"
 
 
+/* type is JT_MSG_TOPTALK_V1 or JT_MSG_ROLLUP_V1 */
 struct NS(msg) {
-	struct jt_msg_toptalk m;
+	int type;
+	union {
+		struct jt_msg_toptalk m;
+		struct jt_msg_rollup r;
+	};
 };
 
 #include "mq_generic.h"
@@ -1,12 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+#include <sys/time.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syslog.h>
+#include <pthread.h>
+
 #include "mq_msg_ws.h"
 
 #define MAX_CONSUMERS 8
-#define MAX_Q_DEPTH 16
 
-#define NS(name) PRIMITIVE_CAT(mq_ws_, name)
-#define PRIMITIVE_CAT(a, ...) a##__VA_ARGS__
+/*
+ * This is the same multi-consumer ring as mq_generic.c, except that it
+ * counts bytes of the arena instead of messages.
+ *
+ * Each record is a struct record, the struct mq_ws_msg and its text,
+ * rounded up to REC_ALIGN. A record is never split across the end of the
+ * arena: when it doesn't fit, the producer leaves a record of size 0 to
+ * send the consumers back to the start.
+ *
+ * produce_off is where the next record goes, and a consumer's offset is
+ * the next record for it to read, so the queue is empty for it when the
+ * two are equal. The producer never catches up with the consumer that is
+ * furthest behind, so that full and empty can be told apart.
+ */
+struct record {
+	uint32_t size; /* of the whole record, or 0 to wrap around */
+	uint32_t pad;
+};
+
+#define REC_ALIGN 8
+
+static pthread_mutex_t mq_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t *arena = NULL;
+static size_t produce_off;
+
+static size_t consumer_offs[MAX_CONSUMERS];
+static int consumer_subscribed[MAX_CONSUMERS] = { 0 };
+static int consumer_count = 0;
+
+/* lets start at non-zero to make sure our array indices are correct. */
+static unsigned long consumer_id_start = 42424242;
+static const char *qname;
+
+static inline size_t record_size(int len)
+{
+	size_t size = sizeof(struct record) + sizeof(struct mq_ws_msg) + len;
+	return (size + REC_ALIGN - 1) & ~(size_t)(REC_ALIGN - 1);
+}
+
+static inline struct record *record_at(size_t off)
+{
+	return (struct record *)(arena + off);
+}
+
+static inline struct mq_ws_msg *record_msg(size_t off)
+{
+	return (struct mq_ws_msg *)(arena + off + sizeof(struct record));
+}
+
+/* the bytes that the consumer furthest behind hasn't consumed yet */
+static size_t bytes_used(void)
+{
+	size_t used = 0;
+
+	for (int i = 0; i < MAX_CONSUMERS; i++) {
+		size_t u;
+
+		if (!consumer_subscribed[i]) {
+			continue;
+		}
+		u = (produce_off + MQ_WS_ARENA_LEN - consumer_offs[i]) %
+		    MQ_WS_ARENA_LEN;
+		used = (u > used) ? u : used;
+	}
+	return used;
+}
+
+int mq_ws_init(const char *mq_name)
+{
+	pthread_mutex_lock(&mq_mutex);
+	assert(!arena);
+	if (0 == consumer_count) {
+		qname = mq_name;
+		syslog(LOG_INFO, "creating new queue (%s) of %d bytes for messages of up to %d bytes\n",
+		       qname, MQ_WS_ARENA_LEN, MQ_WS_MAX_MSG_LEN);
+
+		arena = malloc(MQ_WS_ARENA_LEN);
+		assert(arena);
+		produce_off = 0;
+	}
+	pthread_mutex_unlock(&mq_mutex);
+
+	assert(arena);
+
+	return consumer_count;
+}
+
+int mq_ws_destroy(void)
+{
+	pthread_mutex_lock(&mq_mutex);
+	assert(arena);
+
+	if (0 == consumer_count) {
+		free(arena);
+		arena = NULL;
+	}
+
+	pthread_mutex_unlock(&mq_mutex);
+	return consumer_count;
+}
+
+int mq_ws_consumer_subscribe(unsigned long *subscriber_id)
+{
+	int real_id = -1;
+
+	pthread_mutex_lock(&mq_mutex);
+
+	if (MAX_CONSUMERS == consumer_count) {
+		*subscriber_id = 0;
+		pthread_mutex_unlock(&mq_mutex);
+		return -1;
+	}
+
+	/* find the next open slot */
+	for (int i = 0; i < MAX_CONSUMERS; i++) {
+		if (!consumer_subscribed[i]) {
+			real_id = i;
+			break;
+		}
+	}
+
+	assert(real_id >= 0);
+	assert(real_id < MAX_CONSUMERS);
+
+	consumer_offs[real_id] = produce_off;
+	consumer_subscribed[real_id] = 1;
+	*subscriber_id = real_id + consumer_id_start;
+	consumer_count++;
+
+	pthread_mutex_unlock(&mq_mutex);
+
+	syslog(LOG_DEBUG, "consumer %lu joined queue %s\n", *subscriber_id, qname);
+
+	return 0;
+}
+
+int mq_ws_consumer_unsubscribe(unsigned long subscriber_id)
+{
+	int real_id = subscriber_id - consumer_id_start;
+
+	assert(real_id >= 0);
+	assert(real_id < MAX_CONSUMERS);
+
+	pthread_mutex_lock(&mq_mutex);
+
+	assert(consumer_count);
+	assert(consumer_subscribed[real_id]);
+
+	consumer_subscribed[real_id] = 0;
+	consumer_count--;
+
+	pthread_mutex_unlock(&mq_mutex);
+
+	syslog(LOG_INFO, "consumer %lu left queue %s\n", subscriber_id, qname);
+
+	return 0;
+}
+
+int mq_ws_produce(int len, mq_ws_callback cb, void *cb_data, int *cb_err)
+{
+	size_t size, tail, need, start;
+	struct mq_ws_msg *m;
+
+	assert(cb_err);
+
+	if (len <= 0 || len > MQ_WS_MAX_MSG_LEN) {
+		syslog(LOG_ERR, "message of %d bytes doesn't fit queue %s\n",
+		       len, qname);
+		return -JT_WS_MQ_TOO_LONG;
+	}
+
+	pthread_mutex_lock(&mq_mutex);
+	assert(NULL != arena);
+
+	/* check if there are any consumers, to prevent queue overflow
+	 * and ensure that you can produce and consume exactly the same number
+	 * of messages. */
+	if (0 == consumer_count) {
+		pthread_mutex_unlock(&mq_mutex);
+		return -JT_WS_MQ_NO_CONSUMERS;
+	}
+
+	size = record_size(len);
+	tail = MQ_WS_ARENA_LEN - produce_off;
+	if (size <= tail) {
+		start = produce_off;
+		need = size;
+	} else {
+		/* the rest of the arena is skipped */
+		start = 0;
+		need = tail + size;
+	}
+
+	/* check if queue is full */
+	if (bytes_used() + need >= MQ_WS_ARENA_LEN) {
+		pthread_mutex_unlock(&mq_mutex);
+		return -JT_WS_MQ_FULL;
+	}
+
+	m = record_msg(start);
+	m->len = len;
+	*cb_err = cb(m, cb_data);
+	if (*cb_err) {
+		pthread_mutex_unlock(&mq_mutex);
+		return -JT_WS_MQ_CB_ERR;
+	}
+
+	if (start != produce_off) {
+		record_at(produce_off)->size = 0;
+	}
+	record_at(start)->size = size;
+
+	produce_off = (start + size) % MQ_WS_ARENA_LEN;
+	pthread_mutex_unlock(&mq_mutex);
+	return 0;
+}
+
+int mq_ws_consume(unsigned long id, mq_ws_callback cb, void *cb_data,
+                  int *cb_err)
+{
+	size_t off;
+	int real_id = id - consumer_id_start;
+
+	assert(real_id >= 0);
+	assert(real_id < MAX_CONSUMERS);
+	assert(cb_err);
+
+	pthread_mutex_lock(&mq_mutex);
+
+	assert(consumer_subscribed[real_id]);
+
+	/* check if queue is empty */
+	off = consumer_offs[real_id];
+	if (off == produce_off) {
+		pthread_mutex_unlock(&mq_mutex);
+		return -JT_WS_MQ_EMPTY;
+	}
+
+	if (0 == record_at(off)->size) {
+		off = 0;
+	}
+
+	/* call the callback */
+	*cb_err = cb(record_msg(off), cb_data);
+	if (*cb_err) {
+		pthread_mutex_unlock(&mq_mutex);
+		return -JT_WS_MQ_CB_ERR;
+	}
 
-/* note that we include the C file here, not the header. */
-#include "mq_generic.c"
+	/* callback success, message consumed. */
+	consumer_offs[real_id] = (off + record_at(off)->size) % MQ_WS_ARENA_LEN;
+	pthread_mutex_unlock(&mq_mutex);
+	return 0;
+}
 
-#undef NS
+int mq_ws_maxlen(void)
+{
+	return MQ_WS_MAX_MSG_LEN;
+}
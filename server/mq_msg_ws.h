@@ -1,15 +1,54 @@
 #ifndef MQ_MSG_WS_H
 #define MQ_MSG_WS_H
 
-#define NS(name) PRIMITIVE_CAT(mq_ws_, name)
-#define PRIMITIVE_CAT(a, ...) a##__VA_ARGS__
+#include <stdint.h>
 
-struct NS(msg) {
-	char m[MAX_JSON_MSG_LEN];
+/* only the error codes; this queue has its own implementation */
+#include "mq_generic.h"
+
+/* the most flow ids one message can refer to */
+#define WS_MSG_MAX_FLOW_IDS 20
+
+/*
+ * The websocket queue holds JSON text of any length up to MQ_WS_MAX_MSG_LEN.
+ *
+ * Instead of fixed slots sized for the largest message, the messages are
+ * kept back to back in one arena, each one a header followed by just as
+ * much text as it has. Most messages are a few hundred bytes, so many more
+ * of them fit in the same memory, and long ones aren't cut short.
+ */
+#define MQ_WS_ARENA_LEN (64 * 1024)
+#define MQ_WS_MAX_MSG_LEN (16 * 1024)
+
+struct mq_ws_msg {
+	int update_kind; /* enum update_kind, for per session flow control */
+	int64_t interval_ns;
+	int flow_ids; /* toptalk by flow id; these need announcing first */
+	int flow_id_count;
+	uint16_t flow_id[WS_MSG_MAX_FLOW_IDS];
+	unsigned long backfill_for; /* marks a session's backfill, or 0 */
+	/* for the latency of stats: when the sample was read and when the
+	 * message was queued, CLOCK_MONOTONIC ns; 0 for other messages */
+	int64_t sample_ns;
+	int64_t queued_ns;
+	int len; /* of m, including the terminating NUL */
+	char m[];
 };
 
-#include "mq_generic.h"
+int mq_ws_init(const char *mq_name);
+int mq_ws_destroy(void);
+int mq_ws_consumer_subscribe(unsigned long *subscriber_id);
+int mq_ws_consumer_unsubscribe(unsigned long subscriber_id);
+
+typedef int (*mq_ws_callback)(struct mq_ws_msg *m, void *data);
+
+/* Add a message of len bytes of text (including the NUL), which cb must
+ * fill in. Returns -JT_WS_MQ_TOO_LONG if len is over MQ_WS_MAX_MSG_LEN. */
+int mq_ws_produce(int len, mq_ws_callback cb, void *cb_data, int *cb_err);
+int mq_ws_consume(unsigned long id, mq_ws_callback cb, void *cb_data,
+                  int *cb_err);
 
-#undef NS
+/* the longest text that a message can hold */
+int mq_ws_maxlen(void);
 
 #endif
@@ -1,31 +1,151 @@
 #define _POSIX_C_SOURCE 200809L
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <limits.h>
 #include <assert.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <syslog.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
 #include <netlink/netlink.h>
 #include <netlink/socket.h>
 #include <netlink/cache.h>
 #include <netlink/route/link.h>
 #include <netlink/route/qdisc.h>
 #include <netlink/route/qdisc/netem.h>
+#include <netlink/route/qdisc/prio.h>
+#include <netlink/route/classifier.h>
+#include <netlink/route/cls/u32.h>
+#include <netlink/route/cls/matchall.h>
+#include <netlink/route/action.h>
+#include <netlink/route/act/mirred.h>
+#include <linux/pkt_sched.h>
+#include <linux/pkt_cls.h>
 
 #include "jittertrap.h"
 #include "netem.h"
 
+/* sock is used for requests (eg. qdisc changes) and is protected by
+ * netem_sock_mutex. The caches are owned by the cache manager, which keeps
+ * them current from RTNLGRP_LINK and RTNLGRP_TC events on its own socket.
+ * Lookups take cache_lock for reading; only applying events takes it for
+ * writing, so readers never wait for a netlink round trip. */
 static struct nl_sock *sock;
+static pthread_mutex_t netem_sock_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct nl_cache_mngr *cache_mngr;
 static struct nl_cache *link_cache, *qdisc_cache;
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* libnl doesn't decode the rate, slot and loss model attributes, nor can it
+ * name a loaded delay distribution, so remember what was last applied to each
+ * iface and direction, along with the flow selector. */
+#define MAX_SHADOW_PARAMS 32
+static struct netem_params shadow_params[MAX_SHADOW_PARAMS];
+static pthread_mutex_t shadow_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Ingress traffic is redirected to an ifb device named IFB_PREFIX<ifindex>
+ * and impaired on its egress.
+ *
+ * To impair a single flow, the root is a prio qdisc. A u32 filter sends
+ * the flow to the last band, where the netem qdisc is attached. Everything
+ * else goes to the first band. */
+#define IFB_PREFIX "jtifb"
+#define FLOW_PRIO_HANDLE TC_HANDLE(1, 0)
+#define FLOW_BANDS 4
+#define FLOW_CLASS TC_HANDLE(1, FLOW_BANDS)
+#define FLOW_NETEM_HANDLE TC_HANDLE(0x40, 0)
+#define INGRESS_HANDLE TC_H_MAKE(TC_H_INGRESS, 0)
+
+#define PPM_MAX 1000000
+#define NETEM_MAX_DELAY_MS (INT_MAX / 1000)
+#define NETEM_MAX_SLOT_US (10 * 1000000)
+#define NETEM_MAX_GAP 1000000
+
+/* A transaction collects the requests for one or more netem changes (on
+ * several ifaces, or several levels of one qdisc tree) and sends them in a
+ * single sendmsg(), so that they take effect together. The kernel processes
+ * and acks every request in order, even after one of them fails. ACKs are
+ * matched to requests by sequence number. */
+#define TXN_MAX_REQS 64
+#define TXN_MAX_PARAMS 16
+/* Larger transactions are split into several sends. The request socket's
+ * send buffer is raised to TXN_SNDBUF to fit one batch. */
+#define TXN_BATCH_BYTES (64 * 1024)
+#define TXN_SNDBUF (256 * 1024)
+#define TXN_IGNORE_ANY INT_MAX
+/* Requests still unanswered after this long are failed, so that a lost ACK
+ * can't hold netem_sock_mutex forever. */
+#define TXN_TIMEOUT_MS 5000
+
+static struct {
+	pthread_t thread_id;
+	pthread_attr_t thread_attr;
+	const char * const thread_name;
+} thread_info = {
+	0,
+	.thread_name = "jt-netlink"
+};
 
 #define QUOTE(str) #str
 #define EXPAND_AND_QUOTE(str) QUOTE(str)
 
+/* Apply any pending link/qdisc events to the caches. */
+static int cache_sync(void)
+{
+	int err;
+
+	pthread_rwlock_wrlock(&cache_lock);
+	err = nl_cache_mngr_data_ready(cache_mngr);
+	if (err < 0) {
+		/* Events were lost (eg. socket buffer overrun), start over. */
+		syslog(LOG_WARNING, "netlink cache update failed: %s. "
+		       "resyncing.\n", nl_geterror(err));
+		pthread_mutex_lock(&netem_sock_mutex);
+		nl_cache_refill(sock, link_cache);
+		nl_cache_refill(sock, qdisc_cache);
+		pthread_mutex_unlock(&netem_sock_mutex);
+	}
+	pthread_rwlock_unlock(&cache_lock);
+	return err;
+}
+
+static void *run(void *data)
+{
+	struct pollfd pfd = {
+		.fd = nl_cache_mngr_get_fd(cache_mngr),
+		.events = POLLIN
+	};
+	(void)data; /* unused parameter. silence warning. */
+
+	for (;;) {
+		if (poll(&pfd, 1, -1) < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			syslog(LOG_ERR, "netlink cache poll failed: %s\n",
+			       strerror(errno));
+			break;
+		}
+		if (pfd.revents & POLLIN) {
+			cache_sync();
+		}
+	}
+	return NULL;
+}
+
 int netem_init(void)
 {
+	int err, one = 1;
+
 	/* Allocate and initialize a new netlink handle */
 	if (!(sock = nl_socket_alloc())) {
 		syslog(LOG_ERR, "Failed to alloc netlink socket\n");
@@ -38,18 +158,41 @@ int netem_init(void)
 		return -EOPNOTSUPP;
 	}
 
+	if ((err = nl_cache_mngr_alloc(NULL, NETLINK_ROUTE, 0, &cache_mngr))
+	    < 0) {
+		syslog(LOG_ERR, "Error creating netlink cache manager: %s\n",
+		       nl_geterror(err));
+		return -EOPNOTSUPP;
+	}
+
+	/* Room for a batch of requests, see netem_txn_commit(). Error ACKs
+	 * needn't echo the (possibly large) request back. */
+	nl_socket_set_buffer_size(sock, 0, TXN_SNDBUF);
+	setsockopt(nl_socket_get_fd(sock), SOL_NETLINK, NETLINK_CAP_ACK, &one,
+	           sizeof(one));
+
 	/* Retrieve a list of all available interfaces and populate cache. */
-	if (rtnl_link_alloc_cache(sock, AF_UNSPEC, &link_cache) < 0) {
+	if (nl_cache_mngr_add(cache_mngr, "route/link", NULL, NULL,
+	                      &link_cache) < 0) {
 		syslog(LOG_ERR, "Error creating link cache\n");
 		return -EOPNOTSUPP;
 	}
 
 	/* Retrieve a list of all available qdiscs and populate cache. */
-	if (rtnl_qdisc_alloc_cache(sock, &qdisc_cache) < 0) {
+	if (nl_cache_mngr_add(cache_mngr, "route/qdisc", NULL, NULL,
+	                      &qdisc_cache) < 0) {
 		syslog(LOG_ERR, "Error creating qdisc cache\n");
 		return -EOPNOTSUPP;
 	}
 
+	assert(!thread_info.thread_id);
+	err = pthread_attr_init(&thread_info.thread_attr);
+	assert(!err);
+	err = pthread_create(&thread_info.thread_id, &thread_info.thread_attr,
+	                     run, NULL);
+	assert(!err);
+	pthread_setname_np(thread_info.thread_id, thread_info.thread_name);
+
 	return 0;
 }
 
@@ -83,7 +226,7 @@ char **netem_list_ifaces(void)
 	char **i;
 	int count, size;
 
-	pthread_mutex_lock(&nl_sock_mutex);
+	pthread_rwlock_rdlock(&cache_lock);
 
 	count = nl_cache_nitems(link_cache);
 	size = (count + 1) * sizeof(char *);
@@ -95,7 +238,9 @@ char **netem_list_ifaces(void)
 	while (link) {
 		char *j = rtnl_link_get_name(link);
 
-		if ((strcmp("lo", j) != 0) && is_iface_allowed(j)) {
+		if ((strcmp("lo", j) != 0)
+		    && (strncmp(IFB_PREFIX, j, strlen(IFB_PREFIX)) != 0)
+		    && is_iface_allowed(j)) {
 			*i = malloc(strlen(j) + 1);
 			assert(NULL != *i);
 			sprintf(*i, "%s", j);
@@ -106,7 +251,7 @@ char **netem_list_ifaces(void)
 	}
 	*i = 0;
 
-	pthread_mutex_unlock(&nl_sock_mutex);
+	pthread_rwlock_unlock(&cache_lock);
 	return ifaces;
 }
 
@@ -158,48 +303,774 @@ nl_cache_find(struct nl_cache *cache, struct nl_object *filter)
 
 #endif
 
-int netem_get_params(char *iface, struct netem_params *params)
+static uint32_t ppm_to_prob(uint32_t ppm)
 {
-	struct rtnl_link *link;
-	struct rtnl_qdisc *filter_qdisc;
-	struct rtnl_qdisc *found_qdisc = NULL;
+	return (uint64_t)ppm * UINT32_MAX / PPM_MAX;
+}
+
+/* libnl returns probabilities as int; large values will appear negative. */
+static uint32_t prob_to_ppm(int prob)
+{
+	if (-NLE_NOATTR == prob) {
+		return 0;
+	}
+	return ((uint64_t)(uint32_t)prob * PPM_MAX + UINT32_MAX / 2)
+	       / UINT32_MAX;
+}
+
+/* must hold shadow_mutex */
+static struct netem_params *shadow_find(const char *iface, uint32_t dir,
+                                        int create)
+{
+	struct netem_params *free_slot = NULL;
+
+	for (int i = 0; i < MAX_SHADOW_PARAMS; i++) {
+		if (0 == strcmp(shadow_params[i].iface, iface)
+		    && shadow_params[i].dir == dir) {
+			return &shadow_params[i];
+		} else if (!free_slot && '\0' == shadow_params[i].iface[0]) {
+			free_slot = &shadow_params[i];
+		}
+	}
+	if (create && free_slot) {
+		snprintf(free_slot->iface, MAX_IFACE_LEN, "%s", iface);
+		free_slot->dir = dir;
+		return free_slot;
+	}
+	return NULL;
+}
+
+static int flow_is_set(const struct netem_flow *flow)
+{
+	return flow->src[0] || flow->dst[0];
+}
+
+/* returns the address family of the flow, or -1 if the addresses are
+ * invalid or of mixed families. */
+static int flow_family(const struct netem_flow *flow)
+{
+	struct in6_addr addr;
+	int af = AF_UNSPEC;
+	const char *addrs[] = { flow->src, flow->dst };
+
+	for (int i = 0; i < 2; i++) {
+		int this_af;
+		if (!addrs[i][0]) {
+			continue;
+		}
+		if (1 == inet_pton(AF_INET, addrs[i], &addr)) {
+			this_af = AF_INET;
+		} else if (1 == inet_pton(AF_INET6, addrs[i], &addr)) {
+			this_af = AF_INET6;
+		} else {
+			return -1;
+		}
+		if (AF_UNSPEC != af && af != this_af) {
+			return -1;
+		}
+		af = this_af;
+	}
+	return af;
+}
+
+int netem_validate_params(const struct netem_params *params,
+                          const char **reason)
+{
+	static const char *const dists[] = { "normal", "pareto",
+		                             "paretonormal", NULL };
+	const uint32_t probs[] = {
+		params->delay_corr, params->loss, params->loss_corr,
+		params->ge_p, params->ge_r, params->ge_loss_bad,
+		params->ge_loss_good, params->dup, params->dup_corr,
+		params->reorder, params->reorder_corr, params->corrupt,
+		params->corrupt_corr
+	};
+
+	if (params->delay > NETEM_MAX_DELAY_MS
+	    || params->jitter > NETEM_MAX_DELAY_MS) {
+		*reason = "delay or jitter out of range";
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < sizeof(probs) / sizeof(probs[0]); i++) {
+		if (probs[i] > PPM_MAX) {
+			*reason = "probability out of range [0-1000000ppm]";
+			return -EINVAL;
+		}
+	}
+
+	if (params->dist[0]) {
+		const char *const *d;
+		for (d = dists; *d && strcmp(*d, params->dist); d++)
+			;
+		if (!*d) {
+			*reason = "unknown delay distribution";
+			return -EINVAL;
+		}
+		if (!params->jitter) {
+			*reason = "delay distribution requires jitter";
+			return -EINVAL;
+		}
+	}
+
+	if (params->reorder && !params->delay) {
+		*reason = "reordering requires delay";
+		return -EINVAL;
+	}
+
+	if (params->gap < 0 || params->gap > NETEM_MAX_GAP) {
+		*reason = "gap out of range";
+		return -EINVAL;
+	}
+
+	if (params->gap && !params->reorder) {
+		*reason = "gap requires reordering";
+		return -EINVAL;
+	}
+
+	if (params->ge_p && params->loss) {
+		*reason = "random loss and Gilbert-Elliott loss are exclusive";
+		return -EINVAL;
+	}
+
+	if (params->slot_min < 0 || params->slot_max < 0
+	    || params->slot_max > NETEM_MAX_SLOT_US) {
+		*reason = "slot delay out of range";
+		return -EINVAL;
+	}
+
+	if (params->slot_min > params->slot_max) {
+		*reason = "slot min must not exceed slot max";
+		return -EINVAL;
+	}
+
+	if (params->slot_packets > INT32_MAX || params->slot_bytes > INT32_MAX
+	    || params->limit > INT32_MAX) {
+		*reason = "slot or queue limit out of range";
+		return -EINVAL;
+	}
+
+	if (params->rate_overhead > 65535 || params->rate_overhead < -65535) {
+		*reason = "rate overhead out of range";
+		return -EINVAL;
+	}
+
+	if (NETEM_DIR_EGRESS != params->dir
+	    && NETEM_DIR_INGRESS != params->dir) {
+		*reason = "unknown direction";
+		return -EINVAL;
+	}
+
+	if (flow_is_set(&params->flow)) {
+		if (flow_family(&params->flow) < 0) {
+			*reason = "invalid flow address";
+			return -EINVAL;
+		}
+		if ((params->flow.sport || params->flow.dport)
+		    && !params->flow.proto) {
+			*reason = "flow ports require a protocol";
+			return -EINVAL;
+		}
+	} else if (params->flow.sport || params->flow.dport
+	           || params->flow.proto) {
+		*reason = "flow requires a source or destination address";
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+struct txn_req {
+	struct nl_msg *msg;
+	const char *what;  /* for error messages */
+	int ignore_err;    /* NLE_* code that isn't a failure, or TXN_IGNORE_ANY */
+	int param_idx;     /* the netem change this request is part of */
+	uint32_t seq;
+	int done;
+	int err;           /* -NLE_* */
+};
+
+struct netem_txn {
+	int req_count;
+	struct txn_req reqs[TXN_MAX_REQS];
+	int param_count;
+	struct netem_params params[TXN_MAX_PARAMS];
+};
+
+struct netem_txn *netem_txn_begin(void)
+{
+	return calloc(1, sizeof(struct netem_txn));
+}
+
+/* Takes ownership of msg. */
+static int txn_add_msg(struct netem_txn *txn, struct nl_msg *msg,
+                       int ignore_err, const char *what)
+{
+	struct txn_req *req;
+
+	if (txn->req_count >= TXN_MAX_REQS) {
+		syslog(LOG_ERR, "netem transaction full\n");
+		nlmsg_free(msg);
+		return -NLE_RANGE;
+	}
+	req = &txn->reqs[txn->req_count++];
+	memset(req, 0, sizeof(*req));
+	req->msg = msg;
+	req->what = what;
+	req->ignore_err = ignore_err;
+	req->param_idx = txn->param_count;
+	return 0;
+}
+
+/* drop the requests from first onwards */
+static void txn_truncate(struct netem_txn *txn, int first)
+{
+	while (txn->req_count > first) {
+		nlmsg_free(txn->reqs[--txn->req_count].msg);
+	}
+}
+
+void netem_txn_abort(struct netem_txn *txn)
+{
+	txn_truncate(txn, 0);
+	free(txn);
+}
+
+static struct txn_req *txn_find(struct netem_txn *txn, uint32_t seq)
+{
+	for (int i = 0; i < txn->req_count; i++) {
+		if (txn->reqs[i].seq == seq) {
+			return &txn->reqs[i];
+		}
+	}
+	return NULL;
+}
+
+static int txn_ack_cb(struct nl_msg *msg, void *arg)
+{
+	struct txn_req *req = txn_find(arg, nlmsg_hdr(msg)->nlmsg_seq);
+	if (req) {
+		req->done = 1;
+	}
+	return NL_OK;
+}
+
+static int txn_err_cb(struct sockaddr_nl *nla, struct nlmsgerr *e, void *arg)
+{
+	struct txn_req *req = txn_find(arg, e->msg.nlmsg_seq);
+	(void)nla; /* unused parameter. silence warning. */
+	if (req) {
+		req->done = 1;
+		req->err = -nl_syserr2nlerr(e->error);
+	}
+	/* keep going, the following requests have been processed too */
+	return NL_SKIP;
+}
+
+/* requests are matched by txn_find() instead of libnl's in-order check */
+static int txn_seq_cb(struct nl_msg *msg, void *arg)
+{
+	(void)msg;
+	(void)arg;
+	return NL_OK;
+}
+
+/* fail the requests from first onwards that haven't been answered */
+static void txn_fail_pending(struct netem_txn *txn, int first, int err)
+{
+	for (int i = first; i < txn->req_count; i++) {
+		if (!txn->reqs[i].done) {
+			txn->reqs[i].done = 1;
+			txn->reqs[i].err = err;
+		}
+	}
+}
+
+/* must hold netem_sock_mutex */
+static void txn_send(struct netem_txn *txn)
+{
+	struct iovec iov[TXN_MAX_REQS];
+	int first = 0;
+
+	while (first < txn->req_count) {
+		size_t len = 0;
+		int n = 0, err;
+
+		/* as many requests as fit in a batch, but at least one */
+		while (first + n < txn->req_count) {
+			struct txn_req *req = &txn->reqs[first + n];
+			struct nlmsghdr *nlh = nlmsg_hdr(req->msg);
+			size_t msg_len = NLMSG_ALIGN(nlh->nlmsg_len);
+
+			if (n && len + msg_len > TXN_BATCH_BYTES) {
+				break;
+			}
+			nl_complete_msg(sock, req->msg);
+			req->seq = nlh->nlmsg_seq;
+			iov[n].iov_base = nlh;
+			iov[n].iov_len = msg_len;
+			len += msg_len;
+			n++;
+		}
+
+		err = nl_send_iovec(sock, txn->reqs[first].msg, iov, n);
+		if (err < 0) {
+			syslog(LOG_ERR, "netem transaction send failed: %s\n",
+			       nl_geterror(err));
+			txn_fail_pending(txn, first, err);
+			return;
+		}
+		first += n;
+	}
+}
+
+static long long monotonic_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+/* must hold netem_sock_mutex */
+static void txn_wait(struct netem_txn *txn)
+{
+	struct nl_cb *cb = nl_cb_clone(nl_socket_get_cb(sock));
+	struct pollfd pfd = {.fd = nl_socket_get_fd(sock), .events = POLLIN };
+	long long deadline = monotonic_ms() + TXN_TIMEOUT_MS;
+	int pending;
+
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, txn_ack_cb, txn);
+	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, txn_seq_cb, NULL);
+	nl_cb_err(cb, NL_CB_CUSTOM, txn_err_cb, txn);
+
+	do {
+		long long timeout;
+		int err;
+
+		pending = 0;
+		for (int i = 0; i < txn->req_count; i++) {
+			pending += !txn->reqs[i].done;
+		}
+		if (!pending) {
+			break;
+		}
+
+		/* every ACK is a datagram of its own, so each one that
+		 * poll() reports is read by a single nl_recvmsgs() */
+		timeout = deadline - monotonic_ms();
+		err = (timeout > 0) ? poll(&pfd, 1, (int)timeout) : 0;
+		if (err < 0 && EINTR == errno) {
+			continue;
+		}
+		if (err < 0) {
+			syslog(LOG_ERR, "netem transaction: poll failed: %s\n",
+			       strerror(errno));
+			txn_fail_pending(txn, 0, -nl_syserr2nlerr(errno));
+			break;
+		}
+		if (!err) {
+			syslog(LOG_ERR, "netem transaction: %d requests not "
+			       "acked after %d ms\n", pending, TXN_TIMEOUT_MS);
+			txn_fail_pending(txn, 0, -NLE_AGAIN);
+			break;
+		}
+		if ((err = nl_recvmsgs(sock, cb)) < 0) {
+			syslog(LOG_ERR, "netem transaction: lost ACKs: %s\n",
+			       nl_geterror(err));
+			txn_fail_pending(txn, 0, err);
+			break;
+		}
+	} while (pending);
+
+	nl_cb_put(cb);
+}
+
+int netem_txn_commit(struct netem_txn *txn)
+{
+	int param_err[TXN_MAX_PARAMS] = { 0 };
+	struct netem_params *shadow;
+	int ret = 0;
+
+	if (txn->req_count) {
+		pthread_mutex_lock(&netem_sock_mutex);
+		txn_send(txn);
+		txn_wait(txn);
+		pthread_mutex_unlock(&netem_sock_mutex);
+	}
+
+	for (int i = 0; i < txn->req_count; i++) {
+		struct txn_req *req = &txn->reqs[i];
+
+		if (!req->err || TXN_IGNORE_ANY == req->ignore_err
+		    || -req->err == req->ignore_err) {
+			continue;
+		}
+		syslog(LOG_ERR, "Unable to add %s on %s: %s\n", req->what,
+		       txn->params[req->param_idx].iface,
+		       nl_geterror(req->err));
+		param_err[req->param_idx] = req->err;
+		if (!ret) {
+			ret = req->err;
+		}
+	}
+
+	pthread_mutex_lock(&shadow_mutex);
+	for (int i = 0; i < txn->param_count; i++) {
+		struct netem_params *p = &txn->params[i];
+		if (!param_err[i] && (shadow = shadow_find(p->iface, p->dir, 1))) {
+			memcpy(shadow, p, sizeof(*shadow));
+		}
+	}
+	pthread_mutex_unlock(&shadow_mutex);
+
+	netem_txn_abort(txn);
+
+	/* The kernel queues the RTNLGRP_TC notifications before it acks the
+	 * requests, so applying pending events now makes the changes visible
+	 * to the next netem_get_params() without waiting for the cache
+	 * thread. */
+	cache_sync();
+	return ret;
+}
+
+/* Create (if needed) the ifb device for iface, and add the requests that
+ * redirect all of iface's ingress traffic to it. Returns the ifindex of the
+ * ifb device.
+ * must hold netem_sock_mutex */
+static int ingress_setup(struct netem_txn *txn, int ifindex)
+{
+	char ifb_name[IFNAMSIZ];
+	struct rtnl_link *ifb, *change;
+	struct rtnl_qdisc *ingress;
+	struct rtnl_cls *cls;
+	struct rtnl_act *act;
+	struct nl_msg *msg;
+	int ifb_index, err;
+
+	snprintf(ifb_name, IFNAMSIZ, IFB_PREFIX "%d", ifindex);
+
+	if (rtnl_link_get_kernel(sock, 0, ifb_name, &ifb) < 0) {
+		ifb = rtnl_link_alloc();
+		assert(ifb);
+		rtnl_link_set_name(ifb, ifb_name);
+		rtnl_link_set_type(ifb, "ifb");
+		err = rtnl_link_add(sock, ifb, NLM_F_CREATE);
+		rtnl_link_put(ifb);
+		if (err < 0) {
+			syslog(LOG_ERR, "Unable to create %s: %s\n", ifb_name,
+			       nl_geterror(err));
+			return err;
+		}
+		if ((err = rtnl_link_get_kernel(sock, 0, ifb_name, &ifb)) < 0) {
+			return err;
+		}
+		syslog(LOG_INFO, "created %s for ingress impairment\n",
+		       ifb_name);
+	}
+	ifb_index = rtnl_link_get_ifindex(ifb);
+
+	if (!(rtnl_link_get_flags(ifb) & IFF_UP)) {
+		change = rtnl_link_alloc();
+		assert(change);
+		rtnl_link_set_flags(change, IFF_UP);
+		err = rtnl_link_change(sock, ifb, change, 0);
+		rtnl_link_put(change);
+		if (err < 0) {
+			syslog(LOG_ERR, "Unable to bring up %s: %s\n",
+			       ifb_name, nl_geterror(err));
+			rtnl_link_put(ifb);
+			return err;
+		}
+	}
+	rtnl_link_put(ifb);
+
+	if (!(ingress = rtnl_qdisc_alloc())) {
+		return -NLE_NOMEM;
+	}
+	rtnl_tc_set_ifindex(TC_CAST(ingress), ifindex);
+	rtnl_tc_set_parent(TC_CAST(ingress), TC_H_INGRESS);
+	rtnl_tc_set_handle(TC_CAST(ingress), INGRESS_HANDLE);
+	rtnl_tc_set_kind(TC_CAST(ingress), "ingress");
+	err = rtnl_qdisc_build_add_request(ingress, NLM_F_CREATE, &msg);
+	rtnl_qdisc_put(ingress);
+	if (err < 0
+	    || (err = txn_add_msg(txn, msg, NLE_EXIST, "ingress qdisc")) < 0) {
+		return err;
+	}
+
+	/* redirect everything to the ifb. only one matchall filter can
+	 * exist, so if there is one already we're done. */
+	if (!(cls = rtnl_cls_alloc())) {
+		return -NLE_NOMEM;
+	}
+	rtnl_tc_set_ifindex(TC_CAST(cls), ifindex);
+	rtnl_tc_set_parent(TC_CAST(cls), INGRESS_HANDLE);
+	rtnl_tc_set_handle(TC_CAST(cls), 1);
+	rtnl_tc_set_kind(TC_CAST(cls), "matchall");
+	rtnl_cls_set_prio(cls, 1);
+	rtnl_cls_set_protocol(cls, ETH_P_ALL);
+
+	act = rtnl_act_alloc();
+	assert(act);
+	rtnl_tc_set_kind(TC_CAST(act), "mirred");
+	rtnl_mirred_set_action(act, TCA_EGRESS_REDIR);
+	rtnl_mirred_set_policy(act, TC_ACT_STOLEN);
+	rtnl_mirred_set_ifindex(act, ifb_index);
+	rtnl_mall_append_action(cls, act);
+	rtnl_act_put(act);
+
+	err = rtnl_cls_build_add_request(cls, NLM_F_CREATE | NLM_F_EXCL, &msg);
+	rtnl_cls_put(cls);
+	if (err < 0
+	    || (err = txn_add_msg(txn, msg, NLE_EXIST, "ingress redirect"))
+	           < 0) {
+		return err;
+	}
+
+	return ifb_index;
+}
+
+/* Add the requests that undo ingress_setup(): the redirect, the ingress
+ * qdisc and the ifb device, which takes its netem qdisc with it. Any of
+ * them may be gone already, so their errors are ignored. */
+static int ingress_teardown(struct netem_txn *txn, int ifindex)
+{
+	char ifb_name[IFNAMSIZ];
+	struct rtnl_link *ifb;
+	struct rtnl_qdisc *ingress;
+	struct rtnl_cls *cls;
+	struct nl_msg *msg;
 	int err;
-	int delay, jitter, loss;
 
-	pthread_mutex_lock(&nl_sock_mutex);
-	if ((err = nl_cache_refill(sock, link_cache)) < 0) {
-		syslog(LOG_ERR, "Unable to resync link cache: %s\n",
-		       nl_geterror(err));
-		goto cleanup;
+	if (!(cls = rtnl_cls_alloc())) {
+		return -NLE_NOMEM;
+	}
+	rtnl_tc_set_ifindex(TC_CAST(cls), ifindex);
+	rtnl_tc_set_parent(TC_CAST(cls), INGRESS_HANDLE);
+	rtnl_tc_set_handle(TC_CAST(cls), 1);
+	rtnl_tc_set_kind(TC_CAST(cls), "matchall");
+	rtnl_cls_set_prio(cls, 1);
+	rtnl_cls_set_protocol(cls, ETH_P_ALL);
+	err = rtnl_cls_build_delete_request(cls, 0, &msg);
+	rtnl_cls_put(cls);
+	if (err < 0
+	    || (err = txn_add_msg(txn, msg, TXN_IGNORE_ANY,
+	                          "ingress redirect removal")) < 0) {
+		return err;
 	}
 
-	if ((err = nl_cache_refill(sock, qdisc_cache)) < 0) {
-		syslog(LOG_ERR, "Unable to resync link cache: %s\n",
-		        nl_geterror(err));
-		goto cleanup;
+	if (!(ingress = rtnl_qdisc_alloc())) {
+		return -NLE_NOMEM;
+	}
+	rtnl_tc_set_ifindex(TC_CAST(ingress), ifindex);
+	rtnl_tc_set_parent(TC_CAST(ingress), TC_H_INGRESS);
+	rtnl_tc_set_handle(TC_CAST(ingress), INGRESS_HANDLE);
+	rtnl_tc_set_kind(TC_CAST(ingress), "ingress");
+	err = rtnl_qdisc_build_delete_request(ingress, &msg);
+	rtnl_qdisc_put(ingress);
+	if (err < 0
+	    || (err = txn_add_msg(txn, msg, TXN_IGNORE_ANY,
+	                          "ingress qdisc removal")) < 0) {
+		return err;
+	}
+
+	if (!(ifb = rtnl_link_alloc())) {
+		return -NLE_NOMEM;
+	}
+	snprintf(ifb_name, IFNAMSIZ, IFB_PREFIX "%d", ifindex);
+	rtnl_link_set_name(ifb, ifb_name);
+	err = rtnl_link_build_delete_request(ifb, &msg);
+	rtnl_link_put(ifb);
+	if (err < 0
+	    || (err = txn_add_msg(txn, msg, TXN_IGNORE_ANY, "ifb removal"))
+	           < 0) {
+		return err;
+	}
+	return 0;
+}
+
+/* Nothing would be impaired; the flow selector and queue limit alone
+ * don't change the traffic. */
+static int params_idle(const struct netem_params *p)
+{
+	return !(p->delay || p->jitter || p->loss || p->ge_p || p->dup
+	         || p->reorder || p->corrupt || p->rate || p->slot_max);
+}
+
+/* Match the flow with u32 keys at fixed offsets. IPv4 packets with options
+ * and IPv6 packets with extension headers won't match. */
+static void flow_add_keys(struct rtnl_cls *cls, const struct netem_flow *flow)
+{
+	union {
+		struct in_addr v4;
+		struct in6_addr v6;
+	} addr;
+	int l4_off;
+
+	if (AF_INET == flow_family(flow)) {
+		rtnl_cls_set_protocol(cls, ETH_P_IP);
+		rtnl_u32_add_key_uint8(cls, 5, 0x0f, 0, 0); /* IHL */
+		if (flow->proto) {
+			rtnl_u32_add_key_uint8(cls, flow->proto, 0xff, 9, 0);
+		}
+		if (flow->src[0]) {
+			inet_pton(AF_INET, flow->src, &addr.v4);
+			rtnl_u32_add_key_in_addr(cls, &addr.v4, 32, 12, 0);
+		}
+		if (flow->dst[0]) {
+			inet_pton(AF_INET, flow->dst, &addr.v4);
+			rtnl_u32_add_key_in_addr(cls, &addr.v4, 32, 16, 0);
+		}
+		l4_off = 20;
+	} else {
+		rtnl_cls_set_protocol(cls, ETH_P_IPV6);
+		if (flow->proto) {
+			rtnl_u32_add_key_uint8(cls, flow->proto, 0xff, 6, 0);
+		}
+		if (flow->src[0]) {
+			inet_pton(AF_INET6, flow->src, &addr.v6);
+			rtnl_u32_add_key_in6_addr(cls, &addr.v6, 128, 8, 0);
+		}
+		if (flow->dst[0]) {
+			inet_pton(AF_INET6, flow->dst, &addr.v6);
+			rtnl_u32_add_key_in6_addr(cls, &addr.v6, 128, 24, 0);
+		}
+		l4_off = 40;
+	}
+
+	if (flow->sport) {
+		rtnl_u32_add_key_uint16(cls, flow->sport, 0xffff, l4_off, 0);
+	}
+	if (flow->dport) {
+		rtnl_u32_add_key_uint16(cls, flow->dport, 0xffff, l4_off + 2,
+		                        0);
+	}
+}
+
+/* Add the requests that replace the root of ifindex with a prio qdisc and
+ * (re)direct the flow to the band where netem will be attached. */
+static int flow_tree_setup(struct netem_txn *txn, int ifindex,
+                           const struct netem_flow *flow)
+{
+	uint8_t priomap[TC_PRIO_MAX + 1] = { 0 };
+	struct rtnl_qdisc *prio;
+	struct rtnl_cls *cls;
+	struct nl_msg *msg;
+	int err;
+
+	if (!(prio = rtnl_qdisc_alloc())) {
+		return -NLE_NOMEM;
 	}
+	rtnl_tc_set_ifindex(TC_CAST(prio), ifindex);
+	rtnl_tc_set_parent(TC_CAST(prio), TC_H_ROOT);
+	rtnl_tc_set_handle(TC_CAST(prio), FLOW_PRIO_HANDLE);
+	rtnl_tc_set_kind(TC_CAST(prio), "prio");
+	rtnl_qdisc_prio_set_bands(prio, FLOW_BANDS);
+	rtnl_qdisc_prio_set_priomap(prio, priomap, sizeof(priomap));
+	err = rtnl_qdisc_build_add_request(
+	    prio, NLM_F_CREATE | NLM_F_REPLACE, &msg);
+	rtnl_qdisc_put(prio);
+	if (err < 0 || (err = txn_add_msg(txn, msg, 0, "prio qdisc")) < 0) {
+		return err;
+	}
+
+	/* remove the previous flow filter, if any */
+	if (!(cls = rtnl_cls_alloc())) {
+		return -NLE_NOMEM;
+	}
+	rtnl_tc_set_ifindex(TC_CAST(cls), ifindex);
+	rtnl_tc_set_parent(TC_CAST(cls), FLOW_PRIO_HANDLE);
+	rtnl_tc_set_kind(TC_CAST(cls), "u32");
+	rtnl_cls_set_prio(cls, 1);
+	err = rtnl_cls_build_delete_request(cls, 0, &msg);
+	rtnl_cls_put(cls);
+	if (err < 0
+	    || (err = txn_add_msg(txn, msg, TXN_IGNORE_ANY, "flow filter"))
+	           < 0) {
+		return err;
+	}
+
+	if (!(cls = rtnl_cls_alloc())) {
+		return -NLE_NOMEM;
+	}
+	rtnl_tc_set_ifindex(TC_CAST(cls), ifindex);
+	rtnl_tc_set_parent(TC_CAST(cls), FLOW_PRIO_HANDLE);
+	rtnl_tc_set_kind(TC_CAST(cls), "u32");
+	rtnl_cls_set_prio(cls, 1);
+	flow_add_keys(cls, flow);
+	rtnl_u32_set_classid(cls, FLOW_CLASS);
+	rtnl_u32_set_cls_terminal(cls);
+	err = rtnl_cls_build_add_request(cls, NLM_F_CREATE | NLM_F_EXCL, &msg);
+	rtnl_cls_put(cls);
+	if (err < 0 || (err = txn_add_msg(txn, msg, 0, "flow filter")) < 0) {
+		return err;
+	}
+	return 0;
+}
+
+/* Find the netem qdisc impairing the given direction of iface, either at
+ * the root or under the flow tree.
+ * must hold cache_lock */
+static struct rtnl_qdisc *find_netem(const char *iface, uint32_t dir)
+{
+	char ifb_name[IFNAMSIZ];
+	struct rtnl_link *link;
+	struct rtnl_qdisc *filter_qdisc;
+	struct rtnl_qdisc *found_qdisc = NULL;
+	const uint32_t parents[] = { TC_H_ROOT, FLOW_CLASS };
 
 	/* filter link by name */
 	if ((link = rtnl_link_get_by_name(link_cache, iface)) == NULL) {
 		syslog(LOG_ERR, "unknown interface/link name: %s\n", iface);
-		goto cleanup;
+		return NULL;
+	}
+
+	if (NETEM_DIR_INGRESS == dir) {
+		snprintf(ifb_name, IFNAMSIZ, IFB_PREFIX "%d",
+		         rtnl_link_get_ifindex(link));
+		rtnl_link_put(link);
+		if ((link = rtnl_link_get_by_name(link_cache, ifb_name))
+		    == NULL) {
+			/* ingress has never been impaired */
+			return NULL;
+		}
 	}
 
 	if (!(filter_qdisc = rtnl_qdisc_alloc())) {
 		/* OOM error */
 		syslog(LOG_ERR, "couldn't alloc qdisc\n");
-		goto cleanup_link;
+		rtnl_link_put(link);
+		return NULL;
 	}
 
 	rtnl_tc_set_link(TC_CAST(filter_qdisc), link);
-	rtnl_tc_set_parent(TC_CAST(filter_qdisc), TC_H_ROOT);
 	rtnl_tc_set_kind(TC_CAST(filter_qdisc), "netem");
 
-	found_qdisc = (struct rtnl_qdisc *)nl_cache_find(
-	    qdisc_cache, OBJ_CAST(filter_qdisc));
+	for (size_t i = 0;
+	     !found_qdisc && i < sizeof(parents) / sizeof(parents[0]); i++) {
+		rtnl_tc_set_parent(TC_CAST(filter_qdisc), parents[i]);
+		found_qdisc = (struct rtnl_qdisc *)nl_cache_find(
+		    qdisc_cache, OBJ_CAST(filter_qdisc));
+	}
+
+	rtnl_qdisc_put(filter_qdisc);
+	rtnl_link_put(link);
+	return found_qdisc;
+}
+
+int netem_get_params(char *iface, struct netem_params *params)
+{
+	struct rtnl_qdisc *found_qdisc;
+	struct netem_params *shadow;
+	int delay, jitter;
+
+	pthread_rwlock_rdlock(&cache_lock);
+
+	found_qdisc = find_netem(iface, params->dir);
 	if (!found_qdisc) {
 		/* The iface probably doesn't have a netem qdisc at startup. */
-		goto cleanup_filter_qdisc;
+		goto cleanup;
 	}
 
 	if (0 > (delay = rtnl_netem_get_delay(found_qdisc))) {
@@ -214,81 +1085,319 @@ int netem_get_params(char *iface, struct netem_params *params)
 	}
 	params->jitter = (double)jitter / 1000;
 
-	if (0 > (loss = rtnl_netem_get_loss(found_qdisc))) {
-		syslog(LOG_ERR, "couldn't get loss for iface: %s\n", iface);
-		goto cleanup_qdisc;
+	params->delay_corr =
+	    prob_to_ppm(rtnl_netem_get_delay_correlation(found_qdisc));
+	params->loss = prob_to_ppm(rtnl_netem_get_loss(found_qdisc));
+	params->loss_corr =
+	    prob_to_ppm(rtnl_netem_get_loss_correlation(found_qdisc));
+	params->dup = prob_to_ppm(rtnl_netem_get_duplicate(found_qdisc));
+	params->dup_corr =
+	    prob_to_ppm(rtnl_netem_get_duplicate_correlation(found_qdisc));
+	params->reorder =
+	    prob_to_ppm(rtnl_netem_get_reorder_probability(found_qdisc));
+	params->reorder_corr =
+	    prob_to_ppm(rtnl_netem_get_reorder_correlation(found_qdisc));
+	params->corrupt =
+	    prob_to_ppm(rtnl_netem_get_corruption_probability(found_qdisc));
+	params->corrupt_corr =
+	    prob_to_ppm(rtnl_netem_get_corruption_correlation(found_qdisc));
+	params->gap = params->reorder ? rtnl_netem_get_gap(found_qdisc) : 0;
+	params->limit = rtnl_netem_get_limit(found_qdisc);
+
+	/* the rest is only known if we applied it */
+	pthread_mutex_lock(&shadow_mutex);
+	shadow = shadow_find(iface, params->dir, 0);
+	if (shadow) {
+		if (rtnl_netem_get_delay_distribution_size(found_qdisc) > 0) {
+			memcpy(params->dist, shadow->dist, NETEM_DIST_LEN);
+		} else {
+			params->dist[0] = '\0';
+		}
+		params->ge_p = shadow->ge_p;
+		params->ge_r = shadow->ge_r;
+		params->ge_loss_bad = shadow->ge_loss_bad;
+		params->ge_loss_good = shadow->ge_loss_good;
+		params->rate = shadow->rate;
+		params->rate_overhead = shadow->rate_overhead;
+		params->slot_min = shadow->slot_min;
+		params->slot_max = shadow->slot_max;
+		params->slot_packets = shadow->slot_packets;
+		params->slot_bytes = shadow->slot_bytes;
+		if (FLOW_CLASS == rtnl_tc_get_parent(TC_CAST(found_qdisc))) {
+			params->flow = shadow->flow;
+		}
 	}
-	/* loss is specified in 10ths of a percent, ie. 1 ==> 0.1% */
-	params->loss = (int)(loss / (UINT_MAX / 1000));
+	pthread_mutex_unlock(&shadow_mutex);
 
 	rtnl_qdisc_put(found_qdisc);
-	rtnl_qdisc_put(filter_qdisc);
-	rtnl_link_put(link);
-	pthread_mutex_unlock(&nl_sock_mutex);
+	pthread_rwlock_unlock(&cache_lock);
 	return 0;
 
 cleanup_qdisc:
 	rtnl_qdisc_put(found_qdisc);
-cleanup_filter_qdisc:
-	rtnl_qdisc_put(filter_qdisc);
-cleanup_link:
-	rtnl_link_put(link);
 cleanup:
-	pthread_mutex_unlock(&nl_sock_mutex);
+	pthread_rwlock_unlock(&cache_lock);
 	return -1;
 }
 
-int netem_set_params(const char *iface, struct netem_params *params)
+/* Append the netem options that libnl has no setters for.
+ *
+ * sch_netem expects its attributes to follow struct tc_netem_qopt inside
+ * TCA_OPTIONS, which libnl builds as the last attribute of the message (and
+ * pads beyond). Drop the padding, append, then extend TCA_OPTIONS to cover
+ * the new attributes. */
+static int netem_msg_append_opts(struct nl_msg *msg,
+                                 const struct netem_params *params)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct nlattr *opts;
+
+	opts = nlmsg_find_attr(nlh, sizeof(struct tcmsg), TCA_OPTIONS);
+	if (!opts) {
+		return -NLE_MISSING_ATTR;
+	}
+	nlh->nlmsg_len = ((char *)opts - (char *)nlh) + NLA_ALIGN(opts->nla_len);
+
+	if (params->rate) {
+		uint64_t bytes_per_sec = (uint64_t)params->rate * 1000 / 8;
+		struct tc_netem_rate rate = {
+			.rate = bytes_per_sec < UINT32_MAX ? bytes_per_sec
+			                                   : UINT32_MAX,
+			.packet_overhead = params->rate_overhead
+		};
+		NLA_PUT(msg, TCA_NETEM_RATE, sizeof(rate), &rate);
+		if (bytes_per_sec >= UINT32_MAX) {
+			NLA_PUT_U64(msg, TCA_NETEM_RATE64, bytes_per_sec);
+		}
+	}
+
+	if (params->slot_max) {
+		struct tc_netem_slot slot = {
+			.min_delay = (int64_t)params->slot_min * 1000,
+			.max_delay = (int64_t)params->slot_max * 1000,
+			/* zero means unlimited */
+			.max_packets = params->slot_packets,
+			.max_bytes = params->slot_bytes
+		};
+		NLA_PUT(msg, TCA_NETEM_SLOT, sizeof(slot), &slot);
+	}
+
+	if (params->ge_p) {
+		/* the kernel wants 1-h, where h is P(loss) in the bad state */
+		struct tc_netem_gemodel ge = {
+			.p = ppm_to_prob(params->ge_p),
+			.r = ppm_to_prob(params->ge_r),
+			.h = UINT32_MAX - ppm_to_prob(params->ge_loss_bad),
+			.k1 = ppm_to_prob(params->ge_loss_good)
+		};
+		struct nlattr *loss = nla_nest_start(msg, TCA_NETEM_LOSS);
+		if (!loss) {
+			goto nla_put_failure;
+		}
+		NLA_PUT(msg, NETEM_LOSS_GE, sizeof(ge), &ge);
+		nla_nest_end(msg, loss);
+	}
+
+	opts->nla_len = ((char *)nlh + NLMSG_ALIGN(nlh->nlmsg_len))
+	                - (char *)opts;
+	return 0;
+
+nla_put_failure:
+	return -NLE_NOMEM;
+}
+
+int netem_txn_add(struct netem_txn *txn, const char *iface,
+                  struct netem_params *params)
 {
 	struct rtnl_link *link;
 	struct rtnl_qdisc *qdisc;
-	int err;
+	struct nl_msg *msg;
+	const char *reason;
+	int first_req = txn->req_count;
+	int ifindex, err;
 
-	pthread_mutex_lock(&nl_sock_mutex);
+	if ((err = netem_validate_params(params, &reason))) {
+		syslog(LOG_ERR, "invalid netem params for %s: %s\n", iface,
+		       reason);
+		return err;
+	}
+
+	if (txn->param_count >= TXN_MAX_PARAMS) {
+		syslog(LOG_ERR, "netem transaction full\n");
+		return -NLE_RANGE;
+	}
 
 	/* filter link by name */
-	if ((link = rtnl_link_get_by_name(link_cache, iface)) == NULL) {
+	pthread_rwlock_rdlock(&cache_lock);
+	link = rtnl_link_get_by_name(link_cache, iface);
+	pthread_rwlock_unlock(&cache_lock);
+	if (!link) {
 		syslog(LOG_ERR, "unknown interface/link name.\n");
-		pthread_mutex_unlock(&nl_sock_mutex);
 		return -1;
 	}
+	ifindex = rtnl_link_get_ifindex(link);
+	rtnl_link_put(link);
+
+	/* clearing ingress impairment removes the ifb device and the
+	 * redirect along with it */
+	if (NETEM_DIR_INGRESS == params->dir && params_idle(params)) {
+		if ((err = ingress_teardown(txn, ifindex)) < 0) {
+			txn_truncate(txn, first_req);
+			return err;
+		}
+		goto add_params;
+	}
 
 	if (!(qdisc = rtnl_qdisc_alloc())) {
 		/* OOM error */
 		syslog(LOG_ERR, "couldn't alloc qdisc\n");
-		pthread_mutex_unlock(&nl_sock_mutex);
 		return -1;
 	}
 
-	rtnl_tc_set_link(TC_CAST(qdisc), link);
-	rtnl_tc_set_parent(TC_CAST(qdisc), TC_H_ROOT);
 	rtnl_tc_set_kind(TC_CAST(qdisc), "netem");
 
 	rtnl_netem_set_delay(qdisc,
 	                     params->delay * 1000); /* expects microseconds */
 	rtnl_netem_set_jitter(qdisc, params->jitter * 1000);
-	/* params->loss is given in 10ths of a percent */
-	rtnl_netem_set_loss(qdisc, (params->loss * (UINT_MAX / 1000)));
+	rtnl_netem_set_delay_correlation(qdisc,
+	                                 ppm_to_prob(params->delay_corr));
+	if (params->dist[0]) {
+		/* loads the table from the iproute2 tc library directory */
+		err = rtnl_netem_set_delay_distribution(qdisc, params->dist);
+		if (err < 0) {
+			syslog(LOG_ERR, "couldn't load delay distribution %s: "
+			       "%s\n", params->dist, nl_geterror(err));
+			rtnl_qdisc_put(qdisc);
+			return err;
+		}
+	}
 
-	/* Submit request to kernel and wait for response */
-	err = rtnl_qdisc_add(sock, qdisc, NLM_F_CREATE | NLM_F_REPLACE);
+	rtnl_netem_set_loss(qdisc, ppm_to_prob(params->loss));
+	rtnl_netem_set_loss_correlation(qdisc, ppm_to_prob(params->loss_corr));
+	rtnl_netem_set_duplicate(qdisc, ppm_to_prob(params->dup));
+	rtnl_netem_set_duplicate_correlation(qdisc,
+	                                     ppm_to_prob(params->dup_corr));
+	rtnl_netem_set_corruption_probability(qdisc,
+	                                      ppm_to_prob(params->corrupt));
+	rtnl_netem_set_corruption_correlation(
+	    qdisc, ppm_to_prob(params->corrupt_corr));
+	if (params->reorder) {
+		rtnl_netem_set_reorder_probability(
+		    qdisc, ppm_to_prob(params->reorder));
+		rtnl_netem_set_reorder_correlation(
+		    qdisc, ppm_to_prob(params->reorder_corr));
+		rtnl_netem_set_gap(qdisc, params->gap ? params->gap : 1);
+	}
+	if (params->limit) {
+		rtnl_netem_set_limit(qdisc, params->limit);
+	}
 
-	/* Return the qdisc object to free memory resources */
-	rtnl_qdisc_put(qdisc);
+	/* ingress is impaired on the egress of an ifb device, which has to
+	 * exist before any request can refer to it. */
+	if (NETEM_DIR_INGRESS == params->dir) {
+		pthread_mutex_lock(&netem_sock_mutex);
+		ifindex = ingress_setup(txn, ifindex);
+		pthread_mutex_unlock(&netem_sock_mutex);
+		if (ifindex < 0) {
+			err = ifindex;
+			goto cleanup;
+		}
+	}
+	rtnl_tc_set_ifindex(TC_CAST(qdisc), ifindex);
+
+	if (flow_is_set(&params->flow)) {
+		if ((err = flow_tree_setup(txn, ifindex, &params->flow)) < 0) {
+			goto cleanup;
+		}
+		rtnl_tc_set_parent(TC_CAST(qdisc), FLOW_CLASS);
+		rtnl_tc_set_handle(TC_CAST(qdisc), FLOW_NETEM_HANDLE);
+	} else {
+		/* replacing the root also removes any flow tree */
+		rtnl_tc_set_parent(TC_CAST(qdisc), TC_H_ROOT);
+	}
 
+	err = rtnl_qdisc_build_add_request(qdisc, NLM_F_CREATE | NLM_F_REPLACE,
+	                                   &msg);
 	if (err < 0) {
-		syslog(LOG_ERR, "Unable to add qdisc: %s\n", nl_geterror(err));
-		pthread_mutex_unlock(&nl_sock_mutex);
-		return err;
+		syslog(LOG_ERR, "Unable to build qdisc request: %s\n",
+		       nl_geterror(err));
+		goto cleanup;
 	}
 
-	if ((err = nl_cache_refill(sock, link_cache)) < 0) {
-		syslog(LOG_ERR, "Unable to resync link cache: %s\n",
+	if ((err = netem_msg_append_opts(msg, params)) < 0) {
+		syslog(LOG_ERR, "Unable to add netem options: %s\n",
 		       nl_geterror(err));
-		pthread_mutex_unlock(&nl_sock_mutex);
-		return -1;
+		nlmsg_free(msg);
+		goto cleanup;
 	}
 
-	pthread_mutex_unlock(&nl_sock_mutex);
+	if ((err = txn_add_msg(txn, msg, 0, "netem qdisc")) < 0) {
+		goto cleanup;
+	}
+
+	/* Return the qdisc object to free memory resources */
+	rtnl_qdisc_put(qdisc);
+
+add_params:
+	memcpy(&txn->params[txn->param_count], params, sizeof(*params));
+	snprintf(txn->params[txn->param_count].iface, MAX_IFACE_LEN, "%s",
+	         iface);
+	txn->param_count++;
 	return 0;
+
+cleanup:
+	txn_truncate(txn, first_req);
+	rtnl_qdisc_put(qdisc);
+	return err;
+}
+
+int netem_set_params(const char *iface, struct netem_params *params)
+{
+	struct netem_txn *txn;
+	int err;
+
+	if (!(txn = netem_txn_begin())) {
+		return -NLE_NOMEM;
+	}
+	if ((err = netem_txn_add(txn, iface, params))) {
+		netem_txn_abort(txn);
+		return err;
+	}
+	return netem_txn_commit(txn);
+}
+
+int netem_ingress_release(const char *iface)
+{
+	struct netem_params params;
+
+	memset(&params, 0, sizeof(params));
+	params.dir = NETEM_DIR_INGRESS;
+	snprintf(params.iface, MAX_IFACE_LEN, "%s", iface);
+	return netem_set_params(iface, &params);
+}
+
+void netem_cleanup(void)
+{
+	struct netem_txn *txn;
+	struct rtnl_link *link;
+
+	if (!link_cache || !(txn = netem_txn_begin())) {
+		return;
+	}
+
+	/* every ifb device of ours is named after the iface it serves */
+	pthread_rwlock_rdlock(&cache_lock);
+	link = (struct rtnl_link *)nl_cache_get_first(link_cache);
+	while (link) {
+		const char *name = rtnl_link_get_name(link);
+
+		if (0 == strncmp(IFB_PREFIX, name, strlen(IFB_PREFIX))) {
+			ingress_teardown(txn, atoi(name + strlen(IFB_PREFIX)));
+		}
+		link = (struct rtnl_link *)nl_cache_get_next(
+		    (struct nl_object *)link);
+	}
+	pthread_rwlock_unlock(&cache_lock);
+
+	netem_txn_commit(txn);
 }
@@ -1,17 +1,83 @@
 #ifndef NETEM_H
 #define NETEM_H
 
+#define NETEM_DIST_LEN 16
+#define NETEM_ADDR_LEN 46 /* INET6_ADDRSTRLEN */
+
+enum {
+	NETEM_DIR_EGRESS = 0,
+	NETEM_DIR_INGRESS = 1, /* via an ifb device */
+};
+
+/* Restricts an impairment to packets matching a flow tuple. With neither
+ * src nor dst set, all traffic is impaired. Zero ports/proto match any. */
+struct netem_flow {
+	char src[NETEM_ADDR_LEN];
+	char dst[NETEM_ADDR_LEN];
+	uint16_t sport;
+	uint16_t dport;
+	uint8_t proto; /* IPPROTO_* */
+};
+
+/* Probabilities and correlations are in parts per million (ppm), ie.
+ * 10000 ==> 1%. A value of zero leaves the feature disabled. */
 struct netem_params {
 	uint32_t delay;  /* milliseconds */
 	uint32_t jitter; /* milliseconds */
-	uint32_t loss;   /* percentage, [0-100] */
+	uint32_t delay_corr;
+	char dist[NETEM_DIST_LEN]; /* delay distribution, "" for uniform */
+	uint32_t loss;
+	uint32_t loss_corr;
+	uint32_t ge_p;         /* Gilbert-Elliott: P(good -> bad) */
+	uint32_t ge_r;         /* Gilbert-Elliott: P(bad -> good) */
+	uint32_t ge_loss_bad;  /* Gilbert-Elliott: loss in bad state */
+	uint32_t ge_loss_good; /* Gilbert-Elliott: loss in good state */
+	uint32_t dup;
+	uint32_t dup_corr;
+	uint32_t reorder;
+	uint32_t reorder_corr;
+	int32_t gap;           /* packets */
+	uint32_t corrupt;
+	uint32_t corrupt_corr;
+	uint32_t limit;        /* packets, 0 for the default */
+	uint32_t rate;         /* kbit/s */
+	int32_t rate_overhead; /* bytes per packet */
+	int32_t slot_min;      /* microseconds */
+	int32_t slot_max;      /* microseconds */
+	uint32_t slot_packets;
+	uint32_t slot_bytes;
+	uint32_t dir; /* NETEM_DIR_* */
+	struct netem_flow flow;
 	char iface[MAX_IFACE_LEN];
 };
 
 int netem_init(void);
 int is_iface_allowed(const char *needle);
 char **netem_list_ifaces(void);
+int netem_validate_params(const struct netem_params *params,
+                          const char **reason);
+/* params->dir selects the direction to configure or query. */
 int netem_set_params(const char *iface, struct netem_params *params);
 int netem_get_params(char *iface, struct netem_params *params);
 
+/* Clears iface's ingress impairment and removes the ifb device and the
+ * redirect that it needed. */
+int netem_ingress_release(const char *iface);
+
+/* Removes all the ingress plumbing, on the way out. Egress impairments are
+ * left as they are. */
+void netem_cleanup(void);
+
+/* A transaction applies several changes (eg. on several ifaces) with a
+ * single netlink send, so that they take effect together.
+ * netem_txn_commit() waits for the kernel's answers, frees the transaction
+ * and returns the first error. Changes that were rejected are logged; the
+ * others are still applied. */
+struct netem_txn;
+struct netem_txn *netem_txn_begin(void);
+int netem_txn_add(struct netem_txn *txn, const char *iface,
+                  struct netem_params *params);
+int netem_txn_commit(struct netem_txn *txn);
+void netem_txn_abort(struct netem_txn *txn);
+
 #endif
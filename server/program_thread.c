@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+#include <stdio.h>
+#include <sched.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <syslog.h>
+
+#include <jansson.h>
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jittertrap.h"
+#include "jt_server_message_handler.h"
+#include "netem.h"
+#include "timeywimey.h"
+#include "program_thread.h"
+
+static struct {
+	pthread_t thread_id;
+	pthread_attr_t thread_attr;
+	const char * const thread_name;
+	const int thread_prio;
+} thread_info = {
+	0,
+	.thread_name = "jt-program",
+	.thread_prio = 1
+};
+
+/* protects everything below, signalled when a program is (re)loaded. */
+static pthread_mutex_t program_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t program_cond;
+
+static struct jt_msg_program program;
+static struct jt_msg_program_status status = { .step = -1 };
+static struct timespec program_start;
+static int next_step;
+/* incremented on every load/stop, to detect a replaced program. */
+static unsigned long generation;
+
+/* local prototypes */
+static void *run(void *data);
+
+static struct timespec us_to_ts(uint64_t us)
+{
+	return (struct timespec){ .tv_sec = us / 1000000,
+		                  .tv_nsec = (us % 1000000) * 1000 };
+}
+
+static int64_t ts_diff_us(struct timespec t1, struct timespec t2)
+{
+	return (t1.tv_sec - t2.tv_sec) * 1000000LL
+	       + (t1.tv_nsec - t2.tv_nsec) / 1000;
+}
+
+int program_load(const struct jt_msg_program *prog)
+{
+	if (!is_iface_allowed(prog->iface)) {
+		syslog(LOG_WARNING, "program %s: iface [%s] not allowed\n",
+		       prog->name, prog->iface);
+		return -1;
+	}
+	for (int i = 0; i < prog->iface_count; i++) {
+		if (!is_iface_allowed(prog->ifaces[i])) {
+			syslog(LOG_WARNING,
+			       "program %s: iface [%s] not allowed\n",
+			       prog->name, prog->ifaces[i]);
+			return -1;
+		}
+	}
+
+	pthread_mutex_lock(&program_mutex);
+	memcpy(&program, prog, sizeof(program));
+	clock_gettime(CLOCK_MONOTONIC, &program_start);
+	next_step = 0;
+	generation++;
+
+	snprintf(status.iface, MAX_IFACE_LEN, "%s", program.iface);
+	snprintf(status.name, PROGRAM_NAME_LEN, "%s", program.name);
+	status.running = (program.count > 0);
+	status.step = -1;
+	status.count = program.count;
+	status.late_us = 0;
+	status.apply_us = 0;
+
+	pthread_cond_signal(&program_cond);
+	pthread_mutex_unlock(&program_mutex);
+
+	syslog(LOG_INFO, "program %s loaded: %d steps on iface %s (+%d)\n",
+	       prog->name, prog->count, prog->iface, prog->iface_count);
+	return 0;
+}
+
+int program_stop(void)
+{
+	pthread_mutex_lock(&program_mutex);
+	program.count = 0;
+	status.running = 0;
+	generation++;
+	pthread_cond_signal(&program_cond);
+	pthread_mutex_unlock(&program_mutex);
+	return 0;
+}
+
+void program_get_status(struct jt_msg_program_status *s)
+{
+	pthread_mutex_lock(&program_mutex);
+	memcpy(s, &status, sizeof(*s));
+	pthread_mutex_unlock(&program_mutex);
+}
+
+static int init_realtime(void)
+{
+	/* Not pinned to RT_CPU: a netlink round trip must not delay the
+	 * sampling thread. */
+	struct sched_param schedparm;
+	memset(&schedparm, 0, sizeof(schedparm));
+	schedparm.sched_priority = thread_info.thread_prio;
+	sched_setscheduler(0, SCHED_FIFO, &schedparm);
+	return 0;
+}
+
+/* Apply one step to all of the program's ifaces in one transaction, and
+ * record when it happened, relative to the schedule. */
+/* A step only sets the delay, jitter and loss of the egress impairment;
+ * the rest of what is in effect on the iface is kept. */
+static int add_step(struct netem_txn *txn, const char *iface,
+                    const struct netem_params *step)
+{
+	struct netem_params p = { 0 };
+	char name[MAX_IFACE_LEN];
+
+	snprintf(name, MAX_IFACE_LEN, "%s", iface);
+	p.dir = NETEM_DIR_EGRESS;
+	/* fails without a netem qdisc yet, and then there's nothing to keep */
+	netem_get_params(name, &p);
+	p.delay = step->delay;
+	p.jitter = step->jitter;
+	p.loss = step->loss;
+	return netem_txn_add(txn, iface, &p);
+}
+
+static void apply_step(const char *iface, int step_idx,
+                       char (*ifaces)[MAX_IFACE_LEN], int iface_count,
+                       struct netem_params *params, struct timespec deadline)
+{
+	struct timespec t_start, t_done;
+	struct netem_txn *txn;
+	int64_t late_us, apply_us;
+	int err;
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	if (!(txn = netem_txn_begin())) {
+		err = -1;
+	} else {
+		err = add_step(txn, iface, params);
+		for (int i = 0; i < iface_count; i++) {
+			/* a bad iface doesn't hold back the others */
+			int e = add_step(txn, ifaces[i], params);
+			err = err ? err : e;
+		}
+		int e = netem_txn_commit(txn);
+		err = err ? err : e;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_done);
+
+	late_us = ts_diff_us(t_start, deadline);
+	apply_us = ts_diff_us(t_done, t_start);
+
+	syslog(err ? LOG_ERR : LOG_INFO,
+	       "program step %d on %s: delay %" PRIu32 " jitter %" PRIu32
+	       " loss %" PRIu32 "ppm late %" PRId64 "us apply %" PRId64
+	       "us%s\n",
+	       step_idx, iface, params->delay, params->jitter, params->loss,
+	       late_us, apply_us, err ? " FAILED" : "");
+
+	pthread_mutex_lock(&program_mutex);
+	status.step = step_idx;
+	status.late_us = late_us;
+	status.apply_us = apply_us;
+	pthread_mutex_unlock(&program_mutex);
+}
+
+static void *run(void *data)
+{
+	(void)data; /* unused parameter. silence warning. */
+	init_realtime();
+
+	pthread_mutex_lock(&program_mutex);
+	for (;;) {
+		struct netem_params params = { 0 };
+		struct timespec deadline;
+		unsigned long gen;
+		char iface[MAX_IFACE_LEN];
+		char ifaces[PROGRAM_MAX_IFACES][MAX_IFACE_LEN];
+		int step_idx, iface_count, done;
+
+		while (next_step >= program.count) {
+			pthread_cond_wait(&program_cond, &program_mutex);
+		}
+
+		gen = generation;
+		step_idx = next_step;
+		deadline = ts_add(program_start,
+		                  us_to_ts(program.steps[step_idx].t_us));
+
+		/* sleep until the deadline, or until the program is replaced */
+		int err = 0;
+		while (gen == generation && ETIMEDOUT != err) {
+			err = pthread_cond_timedwait(&program_cond,
+			                             &program_mutex, &deadline);
+		}
+		if (gen != generation) {
+			continue;
+		}
+
+		snprintf(iface, MAX_IFACE_LEN, "%s", program.iface);
+		iface_count = program.iface_count;
+		memcpy(ifaces, program.ifaces, sizeof(ifaces));
+		params.delay = program.steps[step_idx].delay;
+		params.jitter = program.steps[step_idx].jitter;
+		params.loss = program.steps[step_idx].loss;
+		pthread_mutex_unlock(&program_mutex);
+
+		apply_step(iface, step_idx, ifaces, iface_count, &params,
+		           deadline);
+
+		pthread_mutex_lock(&program_mutex);
+		done = 0;
+		if (gen == generation) {
+			next_step = step_idx + 1;
+			if (next_step >= program.count) {
+				status.running = 0;
+				done = 1;
+			}
+		}
+		pthread_mutex_unlock(&program_mutex);
+
+		/* tell any connected clients; nobody needs to be listening. */
+		jt_srv_send_netem_params();
+		jt_srv_send_program_status();
+		if (done) {
+			syslog(LOG_INFO, "program finished on %s\n", iface);
+		}
+
+		pthread_mutex_lock(&program_mutex);
+	}
+	pthread_mutex_unlock(&program_mutex);
+	return NULL;
+}
+
+int program_thread_init(void)
+{
+	pthread_condattr_t attr;
+	int err;
+
+	/* deadlines are absolute CLOCK_MONOTONIC times */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&program_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	assert(!thread_info.thread_id);
+	err = pthread_attr_init(&thread_info.thread_attr);
+	assert(!err);
+
+	err = pthread_create(&thread_info.thread_id, &thread_info.thread_attr,
+	                     run, NULL);
+	assert(!err);
+	pthread_setname_np(thread_info.thread_id, thread_info.thread_name);
+
+	return 0;
+}
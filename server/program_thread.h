@@ -0,0 +1,15 @@
+#ifndef PROGRAM_THREAD_H
+#define PROGRAM_THREAD_H
+
+struct jt_msg_program;
+struct jt_msg_program_status;
+
+int program_thread_init(void);
+
+/* Replace the running program (if any) with prog, starting now.
+ * An empty program stops the running program. */
+int program_load(const struct jt_msg_program *prog);
+int program_stop(void);
+void program_get_status(struct jt_msg_program_status *status);
+
+#endif
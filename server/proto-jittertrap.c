@@ -1,6 +1,8 @@
 /* jittertrap protocol */
 
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 #include <assert.h>
 #include <syslog.h>
@@ -10,6 +12,7 @@
 #include "jt_server_message_handler.h"
 
 #include "mq_msg_ws.h"
+#include "latency.h"
 
 #include "proto-jittertrap.h"
 
@@ -18,22 +21,182 @@ static int consumer_count = 0;
 struct cb_data {
 	struct lws *wsi;
 	unsigned char *buf;
+	struct per_session_data__jittertrap *pss;
 };
 
+static int write_text(struct cb_data *d, const char *s, int len)
+{
+	unsigned char *big = NULL;
+	unsigned char *p = d->buf;
+	int n;
+
+	assert(len >= 0);
+	if (!len) {
+		return 0;
+	}
+	if (len > MQ_WS_MAX_MSG_LEN) {
+		/* only the backfill is this long, and only once per session */
+		big = malloc(LWS_SEND_BUFFER_PRE_PADDING + len +
+		             LWS_SEND_BUFFER_POST_PADDING);
+		if (!big) {
+			syslog(LOG_ERR, "no memory for a message of %d bytes\n",
+			       len);
+			return -1;
+		}
+		p = big + LWS_SEND_BUFFER_PRE_PADDING;
+	}
+	memcpy(p, s, len);
+	n = lws_write(d->wsi, p, len, LWS_WRITE_TEXT);
+	free(big);
+	if (n < len) {
+		/* short write :( */
+		fprintf(stderr, "Short write :(\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* Queue s, which is freed once written, or now if there's no room. */
+static struct pending_frame *pending_add(struct pending_frames *p, char *s,
+                                         int len)
+{
+	struct pending_frame *f;
+
+	if (PENDING_FRAMES_MAX == p->count) {
+		syslog(LOG_ERR, "no room for a pending frame.\n");
+		free(s);
+		return NULL;
+	}
+	f = &p->frame[p->count++];
+	f->s = s;
+	f->len = len;
+	f->sample_ns = 0;
+	f->queued_ns = 0;
+	return f;
+}
+
+static void pending_clear(struct pending_frames *p)
+{
+	for (int i = p->next; i < p->count; i++) {
+		free(p->frame[i].s);
+	}
+	p->next = 0;
+	p->count = 0;
+}
+
+static int pending_write(struct cb_data *d)
+{
+	struct pending_frames *p = &d->pss->pending;
+	struct pending_frame *f = &p->frame[p->next++];
+	int err;
+
+	err = write_text(d, f->s, f->len);
+	if (!err && f->sample_ns) {
+		latency_record_written(f->sample_ns, f->queued_ns);
+	}
+	free(f->s);
+	if (p->next == p->count) {
+		p->next = 0;
+		p->count = 0;
+	}
+	return err;
+}
+
+/* queue the dictionary of any of these flows that the session hasn't seen
+ * yet */
+static int announce_ids(struct cb_data *d, const uint16_t *ids, int count)
+{
+	uint16_t missing[WS_MSG_MAX_FLOW_IDS];
+	char *dict;
+	int n;
+
+	for (int i = 0; i < count; i += WS_MSG_MAX_FLOW_IDS) {
+		int chunk = (count - i < WS_MSG_MAX_FLOW_IDS)
+		                ? count - i
+		                : WS_MSG_MAX_FLOW_IDS;
+
+		n = flow_dict_session_missing(&d->pss->flows, ids + i, chunk,
+		                              missing);
+		if (!n) {
+			continue;
+		}
+		if (jt_srv_pack_flow_dict(missing, n, &dict)) {
+			return -1;
+		}
+		if (!pending_add(&d->pss->pending, dict, strlen(dict))) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int announce_flows(struct cb_data *d, struct mq_ws_msg *m)
+{
+	return announce_ids(d, m->flow_id, m->flow_id_count);
+}
+
+/* What the session missed before it joined, in one message, queued after
+ * the dictionaries of its flows. */
+static int send_backfill(struct cb_data *d)
+{
+	uint16_t ids[FLOW_DICT_SIZE];
+	char *b;
+	int id_count;
+
+	if (jt_srv_pack_backfill(&d->pss->backfill, &d->pss->rate, ids,
+	                         &id_count, &b)) {
+		return -1;
+	}
+	if (!b) {
+		return 0;
+	}
+	if (announce_ids(d, ids, id_count)) {
+		free(b);
+		return -1;
+	}
+	return pending_add(&d->pss->pending, b, strlen(b)) ? 0 : -1;
+}
+
 static int lws_writer(struct mq_ws_msg *m, void *data)
 {
-	int len, n;
 	struct cb_data *d = (struct cb_data *)data;
 	assert(d);
-	len = snprintf((char *)d->buf, MAX_JSON_MSG_LEN, "%s", m->m);
-	assert(len >= 0);
-	if (len > 0) {
-		n = lws_write(d->wsi, d->buf, len, LWS_WRITE_TEXT);
-		if (n < len) {
-			/* short write :( */
-			fprintf(stderr, "Short write :(\n");
+	if (m->backfill_for) {
+		/* only a place in the queue, for the session it is for */
+		return (m->backfill_for == d->pss->consumer_id) ? send_backfill(d)
+		                                                : 0;
+	}
+	if (!update_rate_pass(&d->pss->rate, m->update_kind, m->flow_ids,
+	                      m->interval_ns)) {
+		/* consumed, but this session doesn't want it */
+		return 0;
+	}
+	if (m->flow_ids && announce_flows(d, m)) {
+		return -1;
+	}
+	if (d->pss->pending.count) {
+		/* after the dictionaries, so it has to wait its turn too */
+		struct pending_frame *f;
+		char *s = malloc(m->len);
+
+		if (!s) {
+			syslog(LOG_ERR, "no memory for a pending frame.\n");
 			return -1;
 		}
+		memcpy(s, m->m, m->len);
+		f = pending_add(&d->pss->pending, s, m->len - 1);
+		if (!f) {
+			return -1;
+		}
+		f->sample_ns = m->sample_ns;
+		f->queued_ns = m->queued_ns;
+		return 0;
+	}
+	if (write_text(d, m->m, m->len - 1)) {
+		return -1;
+	}
+	if (m->sample_ns) {
+		latency_record_written(m->sample_ns, m->queued_ns);
 	}
 	return 0;
 }
@@ -41,14 +204,14 @@ static int lws_writer(struct mq_ws_msg *m, void *data)
 int callback_jittertrap(struct lws *wsi, enum lws_callback_reasons reason,
                         void *user, void *in, size_t len)
 {
-	unsigned char buf[LWS_SEND_BUFFER_PRE_PADDING + MAX_JSON_MSG_LEN +
+	unsigned char buf[LWS_SEND_BUFFER_PRE_PADDING + MQ_WS_MAX_MSG_LEN +
 	                  LWS_SEND_BUFFER_POST_PADDING];
 	unsigned char *p = &buf[LWS_SEND_BUFFER_PRE_PADDING];
 	struct per_session_data__jittertrap *pss =
 	    (struct per_session_data__jittertrap *)user;
 
 	int err, cb_err;
-	struct cb_data cbd = { wsi, p };
+	struct cb_data cbd = { wsi, p, pss };
 
 	/* run jt init, stats producer, etc. */
 	jt_server_tick();
@@ -63,6 +226,8 @@ int callback_jittertrap(struct lws *wsi, enum lws_callback_reasons reason,
 				syslog(LOG_ERR,
 				       "mq consumer unsubscribe failed.\n");
 			} else {
+				update_rate_release(&pss->rate);
+				pending_clear(&pss->pending);
 				consumer_count--;
 				if (0 == consumer_count)
 					jt_srv_pause();
@@ -77,18 +242,36 @@ int callback_jittertrap(struct lws *wsi, enum lws_callback_reasons reason,
 			syslog(LOG_ERR, "mq consumer subscription failed.\n");
 			return -1;
 		}
+		ws_deflate_tune(wsi);
+		update_rate_init(&pss->rate);
+		memset(&pss->flows, 0, sizeof(pss->flows));
+		memset(&pss->pending, 0, sizeof(pss->pending));
 		consumer_count++;
 		jt_srv_send_iface_list();
 		jt_srv_send_select_iface();
 		jt_srv_send_netem_params();
 		jt_srv_send_sample_period();
+		/* after the messages that reset the session's charts */
+		history_mark(&pss->backfill);
+		if (jt_srv_send_backfill_marker(pss->consumer_id)) {
+			syslog(LOG_ERR, "no room to queue the backfill.\n");
+		}
 		jt_srv_resume();
 		break;
 
 	case LWS_CALLBACK_SERVER_WRITEABLE:
 		do {
-			err = mq_ws_consume(pss->consumer_id, lws_writer, &cbd,
-			                    &cb_err);
+			/* a message's frames are all written before the next
+			 * one is consumed, one frame at a time */
+			if (pss->pending.count) {
+				if (pending_write(&cbd)) {
+					return -1;
+				}
+				err = 0;
+			} else {
+				err = mq_ws_consume(pss->consumer_id, lws_writer,
+				                    &cbd, &cb_err);
+			}
 			if (lws_partial_buffered(wsi) ||
 			    lws_send_pipe_choked(wsi)) {
 				lws_callback_on_writable(wsi);
@@ -102,7 +285,7 @@ int callback_jittertrap(struct lws *wsi, enum lws_callback_reasons reason,
 		break;
 
 	case LWS_CALLBACK_RECEIVE:
-		jt_server_msg_receive(in, len);
+		jt_server_msg_receive(in, len, &pss->rate);
 		break;
 
 	/*
@@ -1,8 +1,33 @@
 #ifndef PROTO_DINC_H
 #define PROTO_DINC_H
 
+#include "update_rate.h"
+#include "flow_dict.h"
+#include "history.h"
+#include "mq_msg_ws.h"
+
 /* jittertrap protocol */
 
+/* the most frames one message can need: a flow dictionary for each chunk
+ * of the flows of a backfill, then the message itself */
+#define PENDING_FRAMES_MAX \
+	((FLOW_DICT_SIZE + WS_MSG_MAX_FLOW_IDS - 1) / WS_MSG_MAX_FLOW_IDS + 1)
+
+struct pending_frame {
+	char *s;
+	int len;
+	int64_t sample_ns; /* for latency_record_written(), or 0 */
+	int64_t queued_ns;
+};
+
+/* The frames of a consumed message that are yet to be written. They go out
+ * one at a time, so that a choked pipe is noticed between them. */
+struct pending_frames {
+	struct pending_frame frame[PENDING_FRAMES_MAX];
+	int next;
+	int count;
+};
+
 /*
  * one of these is auto-created for each connection and a pointer to the
  * appropriate instance is passed to the callback in the user parameter
@@ -11,6 +36,10 @@
 
 struct per_session_data__jittertrap {
 	unsigned long consumer_id;
+	struct update_rate rate;
+	struct flow_dict_session flows;
+	struct history_mark backfill;
+	struct pending_frames pending;
 };
 
 int callback_jittertrap(struct lws *wsi, enum lws_callback_reasons reason,
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include <syslog.h>
 
 #include <libwebsockets.h>
@@ -33,3 +34,33 @@ void dump_handshake_info(struct lws *wsi)
 		n++;
 	} while (c);
 }
+
+#define xstr(s) str(s)
+#define str(s) #s
+
+/*
+ * Set our compression settings on a session that negotiated
+ * permessage-deflate, before anything is sent. The window is only made
+ * smaller than what the client allows, so if the client asked for a
+ * server_max_window_bits of its own, its choice stands.
+ */
+void ws_deflate_tune(struct lws *wsi)
+{
+	char ext[256] = "";
+
+	if (lws_set_extension_option(wsi, "permessage-deflate",
+	                             "compression_level",
+	                             xstr(WS_DEFLATE_LEVEL))) {
+		/* not negotiated, or turned off */
+		return;
+	}
+	lws_set_extension_option(wsi, "permessage-deflate", "mem_level",
+	                         xstr(WS_DEFLATE_MEM_LEVEL));
+
+	lws_hdr_copy(wsi, ext, sizeof ext, WSI_TOKEN_EXTENSIONS);
+	if (!strstr(ext, "server_max_window_bits")) {
+		lws_set_extension_option(wsi, "permessage-deflate",
+		                         "server_max_window_bits",
+		                         xstr(WS_DEFLATE_WINDOW_BITS));
+	}
+}
@@ -11,8 +11,19 @@ enum protocol_ids {
 	PROTOCOL_TERMINATOR
 };
 
+/* permessage-deflate, for the sessions that offer it. The messages are a
+ * few hundred bytes of much the same JSON, so a small window that is kept
+ * from one message to the next (context takeover) holds enough of them;
+ * see bench-deflate. */
+#define WS_DEFLATE_LEVEL 1
+#define WS_DEFLATE_WINDOW_BITS 13
+#define WS_DEFLATE_MEM_LEVEL 6
+
 extern char *resource_path;
 
+struct lws;
+
 void dump_handshake_info(struct lws *wsi);
+void ws_deflate_tune(struct lws *wsi);
 
 #endif
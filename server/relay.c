@@ -0,0 +1,666 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <signal.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include <syslog.h>
+#include <unistd.h>
+
+#include <libwebsockets.h>
+#include <jansson.h>
+
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "proto.h"
+#include "flow_dict.h"
+#include "relay_ring.h"
+#include "netem.h"
+#include "rollup.h"
+
+/*
+ * jt-relay connects to one jt-server as a single client and passes the
+ * messages on to any number of browsers. The probe does the same work for
+ * one viewer or a hundred; the relay pays for the audience instead.
+ *
+ * Upstream, the relay asks for everything a viewer could show: all the
+ * stats and toptalk intervals, toptalk by flow id and all the rollups.
+ *
+ * Frames are relayed as they were encoded by the probe. The relay only
+ * decodes them to keep what a viewer needs on joining: the latest
+ * interface list, interface selection, netem parameters of each direction,
+ * sample period and program status, and the flow dictionary, which the
+ * probe only announces once per connection.
+ *
+ * Viewers can't change the probe's settings; their messages are dropped.
+ */
+
+#define xstr(s) str(s)
+#define str(s) #s
+
+/* the largest message accepted from upstream, eg. a backfill */
+#define RELAY_MAX_MSG_LEN (8 * 1024 * 1024)
+
+/* seconds between attempts to connect upstream */
+#define RELAY_RETRY_S 2
+
+char *resource_path = xstr(WEB_SERVER_DOCUMENT_ROOT);
+
+static volatile int force_exit = 0;
+static struct lws_context *context;
+
+static char upstream_host[256];
+static int upstream_port = WEB_SERVER_PORT;
+static struct lws *upstream = NULL;
+static time_t upstream_retry = 0;
+
+/* a message from upstream, as its fragments arrive */
+static char *rx_buf = NULL;
+static int rx_len, rx_cap;
+static int rx_dropping = 0;
+
+/* the set_update_rate for upstream is yet to be sent */
+static int upstream_rate_pending = 0;
+
+static int viewers = 0;
+
+/* The latest of each, in the order that jt-server sends them to a new
+ * session. netem_params come once per direction. */
+static const struct {
+	int type;
+	int dir; /* of netem_params */
+} state_types[] = {
+	{ JT_MSG_IFACE_LIST_V1, 0 },
+	{ JT_MSG_SELECT_IFACE_V1, 0 },
+	{ JT_MSG_NETEM_PARAMS_V1, NETEM_DIR_EGRESS },
+	{ JT_MSG_NETEM_PARAMS_V1, NETEM_DIR_INGRESS },
+	{ JT_MSG_SAMPLE_PERIOD_V1, 0 },
+	{ JT_MSG_PROGRAM_STATUS_V1, 0 },
+};
+#define STATE_COUNT (int)(sizeof(state_types) / sizeof(state_types[0]))
+static struct relay_frame state[STATE_COUNT];
+
+/* The flows announced by upstream, by id: id n is flows[n % MAX_FLOWS] of
+ * dict[n / MAX_FLOWS]. */
+#define DICT_CHUNKS ((FLOW_DICT_SIZE + MAX_FLOWS - 1) / MAX_FLOWS)
+static struct jt_msg_flow_dict dict[DICT_CHUNKS];
+static uint8_t dict_known[FLOW_DICT_SIZE];
+static int dict_dirty = 1;
+
+/* the known flows as flow_dict messages, for joining viewers */
+static struct relay_frame dict_frames[DICT_CHUNKS];
+static int dict_frame_count = 0;
+
+struct per_session_data__relay {
+	uint64_t seq; /* the next frame of the ring to send */
+	int joining;  /* the next join frame to send, or -1 once joined */
+};
+
+static void learn_flows(json_t *root)
+{
+	struct jt_msg_flow_dict *m;
+	void *data;
+
+	if (jt_messages[JT_MSG_FLOW_DICT_V1].to_struct(root, &data)) {
+		syslog(LOG_ERR, "flow_dict unpack failed.\n");
+		return;
+	}
+	m = data;
+	for (int i = 0; i < m->count; i++) {
+		uint32_t id = m->flows[i].id;
+
+		if (id >= FLOW_DICT_SIZE) {
+			continue;
+		}
+		dict[id / MAX_FLOWS].flows[id % MAX_FLOWS] = m->flows[i];
+		dict_known[id] = 1;
+	}
+	dict_dirty = 1;
+	jt_messages[JT_MSG_FLOW_DICT_V1].free(data);
+}
+
+static void forget_flows(void)
+{
+	memset(dict_known, 0, sizeof(dict_known));
+	dict_dirty = 1;
+}
+
+static int pack_dict_frame(struct jt_msg_flow_dict *m)
+{
+	char *s;
+	int err;
+
+	if (jt_messages[JT_MSG_FLOW_DICT_V1].to_json_string(m, &s)) {
+		return -1;
+	}
+	err = relay_frame_set(&dict_frames[dict_frame_count], s, strlen(s));
+	free(s);
+	if (!err) {
+		dict_frame_count++;
+	}
+	m->count = 0;
+	return err;
+}
+
+static void update_dict_frames(void)
+{
+	static struct jt_msg_flow_dict m;
+
+	if (!dict_dirty) {
+		return;
+	}
+
+	dict_frame_count = 0;
+	m.count = 0;
+	for (int id = 0; id < FLOW_DICT_SIZE; id++) {
+		if (!dict_known[id]) {
+			continue;
+		}
+		m.flows[m.count++] = dict[id / MAX_FLOWS].flows[id % MAX_FLOWS];
+		if (MAX_FLOWS == m.count && pack_dict_frame(&m)) {
+			return;
+		}
+	}
+	if (m.count && pack_dict_frame(&m)) {
+		return;
+	}
+	dict_dirty = 0;
+}
+
+/* the state messages, then the flow dictionary */
+static struct relay_frame *join_frame(int i)
+{
+	if (i < STATE_COUNT) {
+		return &state[i];
+	}
+	i -= STATE_COUNT;
+	return (i < dict_frame_count) ? &dict_frames[i] : NULL;
+}
+
+/* the direction of a netem_params message, or -1 */
+static int netem_dir(json_t *root)
+{
+	void *data;
+	int dir;
+
+	if (jt_messages[JT_MSG_NETEM_PARAMS_V1].to_struct(root, &data)) {
+		syslog(LOG_ERR, "netem_params unpack failed.\n");
+		return -1;
+	}
+	dir = ((struct jt_msg_netem_params *)data)->dir;
+	jt_messages[JT_MSG_NETEM_PARAMS_V1].free(data);
+	return dir;
+}
+
+static void upstream_message(const char *s, int len)
+{
+	json_error_t error;
+	json_t *root;
+	int dir = -1;
+
+	root = json_loadb(s, len, 0, &error);
+	if (!root) {
+		syslog(LOG_ERR, "error: %s loading upstream message\n",
+		       error.text);
+		return;
+	}
+
+	if (!jt_msg_match_type(root, JT_MSG_FLOW_DICT_V1)) {
+		learn_flows(root);
+	} else {
+		if (!jt_msg_match_type(root, JT_MSG_NETEM_PARAMS_V1)) {
+			dir = netem_dir(root);
+		}
+		for (int i = 0; i < STATE_COUNT; i++) {
+			if (!jt_msg_match_type(root, state_types[i].type)
+			    && (JT_MSG_NETEM_PARAMS_V1 != state_types[i].type
+			        || dir == state_types[i].dir)) {
+				relay_frame_set(&state[i], s, len);
+				break;
+			}
+		}
+	}
+	json_decref(root);
+
+	if (relay_ring_push(s, len)) {
+		syslog(LOG_ERR, "no memory for a message of %d bytes\n", len);
+	}
+}
+
+/* Collect the fragments of a message, then relay it. */
+static void upstream_receive(struct lws *wsi, const char *in, int len)
+{
+	if (!rx_dropping && rx_len + len > RELAY_MAX_MSG_LEN) {
+		syslog(LOG_ERR, "upstream message too long, dropped.\n");
+		rx_dropping = 1;
+	}
+	if (!rx_dropping) {
+		if (rx_len + len > rx_cap) {
+			int cap = (rx_len + len) * 2;
+			char *b = realloc(rx_buf, cap);
+			assert(b);
+			rx_buf = b;
+			rx_cap = cap;
+		}
+		memcpy(rx_buf + rx_len, in, len);
+		rx_len += len;
+	}
+
+	if (lws_is_final_fragment(wsi) && !lws_remaining_packet_payload(wsi)) {
+		if (!rx_dropping) {
+			upstream_message(rx_buf, rx_len);
+		}
+		rx_len = 0;
+		rx_dropping = 0;
+	}
+}
+
+static void upstream_connect(void)
+{
+	struct lws_client_connect_info ci;
+
+	memset(&ci, 0, sizeof(ci));
+	ci.context = context;
+	ci.address = upstream_host;
+	ci.port = upstream_port;
+	ci.path = "/";
+	ci.host = upstream_host;
+	ci.origin = upstream_host;
+	ci.protocol = "jittertrap";
+
+	syslog(LOG_INFO, "connecting to %s:%d\n", upstream_host, upstream_port);
+	upstream = lws_client_connect_via_info(&ci);
+	if (!upstream) {
+		upstream_retry = time(NULL) + RELAY_RETRY_S;
+	}
+}
+
+/* Ask for everything that a viewer could show. Without flow_ids, upstream
+ * would send full toptalk messages and no flow dictionary, and without
+ * naming them, no rollups. */
+static int upstream_request_all(struct lws *wsi)
+{
+	static struct relay_frame f;
+	struct jt_msg_update_rate u;
+	char *s;
+	int err;
+
+	memset(&u, 0, sizeof(u));
+	u.stats_count = -1;
+	u.tt_count = -1;
+	u.flow_ids = 1;
+	for (int i = 0; i < tt_rollup_count && i < UPDATE_RATE_MAX_IVALS; i++) {
+		snprintf(u.rollups[u.rollup_count++], ROLLUP_NAME_LEN, "%s",
+		         tt_rollups[i].name);
+	}
+
+	if (jt_messages[JT_MSG_UPDATE_RATE_V1].to_json_string(&u, &s)) {
+		return -1;
+	}
+	err = relay_frame_set(&f, s, strlen(s));
+	free(s);
+	if (err) {
+		return -1;
+	}
+	if (lws_write(wsi, relay_frame_text(&f), f.len, LWS_WRITE_TEXT)
+	    < f.len) {
+		syslog(LOG_ERR, "short write to %s:%d\n", upstream_host,
+		       upstream_port);
+		return -1;
+	}
+	return 0;
+}
+
+static void upstream_lost(void)
+{
+	syslog(LOG_ERR, "lost %s:%d, retrying in %ds\n", upstream_host,
+	       upstream_port, RELAY_RETRY_S);
+	upstream = NULL;
+	upstream_retry = time(NULL) + RELAY_RETRY_S;
+}
+
+static int write_frame(struct lws *wsi, struct relay_frame *f)
+{
+	int n;
+
+	if (!f->len) {
+		return 0;
+	}
+	n = lws_write(wsi, relay_frame_text(f), f->len, LWS_WRITE_TEXT);
+	if (n < f->len) {
+		/* short write :( */
+		syslog(LOG_ERR, "short write to a viewer\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int choked(struct lws *wsi)
+{
+	if (lws_partial_buffered(wsi) || lws_send_pipe_choked(wsi)) {
+		lws_callback_on_writable(wsi);
+		return 1;
+	}
+	return 0;
+}
+
+static int viewer_writeable(struct lws *wsi,
+                            struct per_session_data__relay *pss)
+{
+	struct relay_frame *f;
+
+	if (0 == pss->joining) {
+		/* the ring from here on is news to the state and dictionary */
+		update_dict_frames();
+		pss->seq = relay_ring_head();
+	}
+
+	while (pss->joining >= 0) {
+		f = join_frame(pss->joining);
+		if (!f) {
+			pss->joining = -1;
+			break;
+		}
+		if (write_frame(wsi, f)) {
+			return -1;
+		}
+		pss->joining++;
+		if (choked(wsi)) {
+			return 0;
+		}
+	}
+
+	while (pss->seq < relay_ring_head()) {
+		f = relay_ring_get(pss->seq);
+		if (!f) {
+			/* overwritten: start over from the current state */
+			syslog(LOG_WARNING, "viewer fell behind, resyncing.\n");
+			pss->joining = 0;
+			lws_callback_on_writable(wsi);
+			return 0;
+		}
+		if (write_frame(wsi, f)) {
+			return -1;
+		}
+		pss->seq++;
+		if (choked(wsi)) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+static int callback_relay(struct lws *wsi, enum lws_callback_reasons reason,
+                          void *user, void *in, size_t len)
+{
+	struct per_session_data__relay *pss =
+	    (struct per_session_data__relay *)user;
+
+	switch (reason) {
+	/* upstream */
+	case LWS_CALLBACK_CLIENT_ESTABLISHED:
+		syslog(LOG_NOTICE, "connected to %s:%d\n", upstream_host,
+		       upstream_port);
+		/* flow ids belong to the connection */
+		forget_flows();
+		rx_len = 0;
+		rx_dropping = 0;
+		upstream_rate_pending = 1;
+		lws_callback_on_writable(wsi);
+		break;
+
+	case LWS_CALLBACK_CLIENT_WRITEABLE:
+		if (upstream_rate_pending) {
+			upstream_rate_pending = 0;
+			return upstream_request_all(wsi);
+		}
+		break;
+
+	case LWS_CALLBACK_CLIENT_RECEIVE:
+		upstream_receive(wsi, in, len);
+		break;
+
+	case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+#if LWS_LIBRARY_VERSION_MAJOR >= 3
+	case LWS_CALLBACK_CLIENT_CLOSED:
+#endif
+		upstream_lost();
+		break;
+
+	/* downstream */
+	case LWS_CALLBACK_ESTABLISHED:
+		ws_deflate_tune(wsi);
+		pss->joining = 0;
+		viewers++;
+		syslog(LOG_INFO, "viewer joined, %d viewers\n", viewers);
+		lws_callback_on_writable(wsi);
+		break;
+
+	case LWS_CALLBACK_CLOSED:
+		if (wsi == upstream) {
+			/* older libwebsockets don't have CLIENT_CLOSED */
+			upstream_lost();
+			break;
+		}
+		viewers--;
+		syslog(LOG_INFO, "viewer left, %d viewers\n", viewers);
+		break;
+
+	case LWS_CALLBACK_SERVER_WRITEABLE:
+		return viewer_writeable(wsi, pss);
+
+	case LWS_CALLBACK_RECEIVE:
+		syslog(LOG_DEBUG, "viewer message ignored\n");
+		break;
+
+	default:
+		break;
+	}
+	return 0;
+}
+
+/* list of supported protocols and callbacks */
+static struct lws_protocols protocols[] = {
+	    /* first protocol must always be HTTP handler */
+
+	    [PROTOCOL_HTTP] =
+	        {
+	            .name = "http-only",
+	            .callback = lws_callback_http_dummy
+	        },
+	    /* both the upstream connection and the viewers */
+	    [PROTOCOL_JITTERTRAP] =
+	        {
+	            .name = "jittertrap",
+	            .callback = callback_relay,
+	            .per_session_data_size =
+	                sizeof(struct per_session_data__relay),
+	            .rx_buffer_size = 0,
+	            .tx_packet_size = 4000,
+	        },
+
+	    /* terminator */
+	    [PROTOCOL_TERMINATOR] = {.name = NULL,
+	                             .callback = NULL,
+	                             .per_session_data_size = 0,
+	                             .rx_buffer_size = 0 }
+};
+
+/* permessage-deflate both ways: the link to the probe is often the slow one */
+static const struct lws_extension exts[] = {
+	{
+		"permessage-deflate",
+		lws_extension_callback_pm_deflate,
+		"permessage-deflate; client_max_window_bits"
+	},
+	{ NULL, NULL, NULL /* terminator */ }
+};
+
+void sighandler(int sig __attribute__((unused)))
+{
+	force_exit = 1;
+	lws_cancel_service(context);
+}
+
+static struct option options[] = {
+	{ "help", no_argument, NULL, 'h' },
+	{ "debug", required_argument, NULL, '1' },
+	{ "port", required_argument, NULL, 'p' },
+	{ "upstream", required_argument, NULL, 'u' },
+	{ "resource_path", required_argument, NULL, 'r' },
+	{ NULL, 0, 0, 0 }
+};
+
+static struct lws_http_mount mount = {
+        .mount_next             = NULL,             /* linked-list "next" */
+        .mountpoint             = "/",              /* mountpoint URL */
+        .origin                 = "./mount-origin", /* serve from dir */
+        .def                    = "index.html",     /* default filename */
+        .protocol               = NULL,
+        .cgienv                 = NULL,
+        .extra_mimetypes        = NULL,
+        .interpret              = NULL,
+        .cgi_timeout            = 0,
+        .cache_max_age          = 0,
+        .auth_mask              = 0,
+        .cache_reusable         = 0,
+        .cache_revalidate       = 0,
+        .cache_intermediaries   = 0,
+        .origin_protocol        = LWSMPRO_FILE,     /* files in a dir */
+        .mountpoint_len         = 1,                /* char count */
+        .basic_auth_login_file  = NULL
+};
+
+/* host[:port] */
+static int parse_upstream(const char *arg)
+{
+	char *colon;
+
+	snprintf(upstream_host, sizeof(upstream_host), "%s", arg);
+	colon = strrchr(upstream_host, ':');
+	if (colon) {
+		*colon = '\0';
+		upstream_port = atoi(colon + 1);
+	}
+	return (!upstream_host[0] || upstream_port <= 0
+	        || upstream_port > 65535);
+}
+
+int main(int argc, char **argv)
+{
+	int n = 0;
+	uint64_t woken = 0;
+	struct lws_context_creation_info info;
+	int debug_level = LOG_WARNING;
+
+	memset(&info, 0, sizeof info);
+	info.port = WEB_SERVER_PORT;
+
+	while (n >= 0) {
+		n = getopt_long(argc, argv, "hdp:u:r:", options, NULL);
+		if (n < 0)
+			continue;
+		switch (n) {
+		/* opt that wont be a short opt either - for long --debug */
+		case '1':
+			debug_level = atoi(optarg);
+			debug_level =
+			    (debug_level > LOG_DEBUG) ? LOG_DEBUG : debug_level;
+			debug_level =
+			    (debug_level < LOG_EMERG) ? LOG_DEBUG : debug_level;
+			break;
+		case 'd':
+			debug_level = LOG_DEBUG;
+			break;
+		case 'p':
+			info.port = atoi(optarg);
+			break;
+		case 'u':
+			if (parse_upstream(optarg)) {
+				fprintf(stderr, "Invalid upstream \"%s\"\n",
+				        optarg);
+				exit(1);
+			}
+			break;
+		case 'r':
+			resource_path = optarg;
+			mount.origin = resource_path;
+			break;
+		case 'h':
+			fprintf(stderr,
+			        "Usage: jt-relay --upstream <host>[:<port>] "
+			        "[--port=<p>] "
+			        "[-d <log level>]"
+			        "[--resource_path <path>]\n");
+			exit(1);
+		}
+	}
+
+	if (!upstream_host[0]) {
+		fprintf(stderr, "jt-relay needs --upstream <host>[:<port>]\n");
+		exit(1);
+	}
+
+	signal(SIGINT, sighandler);
+
+	setlogmask(LOG_UPTO(debug_level));
+	openlog("jt-relay", LOG_PID | LOG_PERROR, LOG_DAEMON);
+	lws_set_log_level(LOG_UPTO(debug_level), lwsl_emit_syslog);
+
+	syslog(LOG_NOTICE, "jittertrap relay for %s:%d\n", upstream_host,
+	       upstream_port);
+
+	if (relay_ring_init(LWS_SEND_BUFFER_PRE_PADDING,
+	                    LWS_SEND_BUFFER_POST_PADDING)) {
+		syslog(LOG_ERR, "relay ring init failed\n");
+		return -1;
+	}
+
+	info.protocols = protocols;
+	info.extensions = exts;
+	info.mounts = &mount;
+	info.gid = -1;
+	info.uid = -1;
+
+	context = lws_create_context(&info);
+	if (context == NULL) {
+		syslog(LOG_ERR, "libwebsocket init failed\n");
+		return -1;
+	}
+
+	n = 0;
+	while (n >= 0 && !force_exit) {
+		if (!upstream && time(NULL) >= upstream_retry) {
+			upstream_connect();
+		}
+
+		/* only wake the viewers when there is something new */
+		if (woken != relay_ring_head()) {
+			woken = relay_ring_head();
+			lws_callback_on_writable_all_protocol(
+			    context, &protocols[PROTOCOL_JITTERTRAP]);
+		}
+
+		n = lws_service(context, 50);
+	}
+
+	lws_context_destroy(context);
+
+	for (int i = 0; i < STATE_COUNT; i++) {
+		relay_frame_free(&state[i]);
+	}
+	for (int i = 0; i < DICT_CHUNKS; i++) {
+		relay_frame_free(&dict_frames[i]);
+	}
+	relay_ring_destroy();
+	free(rx_buf);
+
+	syslog(LOG_INFO, "jittertrap relay exited cleanly\n");
+	closelog();
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "relay_ring.h"
+
+static struct relay_frame *slots = NULL;
+static uint64_t head;
+static int pad_pre;
+static int pad_post;
+
+int relay_ring_init(int pre, int post)
+{
+	assert(!slots);
+	assert(pre >= 0 && post >= 0);
+
+	slots = calloc(RELAY_RING_SLOTS, sizeof(struct relay_frame));
+	if (!slots) {
+		return -1;
+	}
+	head = 0;
+	pad_pre = pre;
+	pad_post = post;
+	return 0;
+}
+
+void relay_ring_destroy(void)
+{
+	assert(slots);
+	for (int i = 0; i < RELAY_RING_SLOTS; i++) {
+		relay_frame_free(&slots[i]);
+	}
+	free(slots);
+	slots = NULL;
+}
+
+int relay_frame_set(struct relay_frame *f, const char *s, int len)
+{
+	assert(len >= 0);
+
+	if (len > f->cap || !f->buf) {
+		/* grow it, the frames of a stream are mostly the same size */
+		unsigned char *b = realloc(f->buf, pad_pre + len + pad_post);
+		if (!b) {
+			return -1;
+		}
+		f->buf = b;
+		f->cap = len;
+	}
+	memcpy(f->buf + pad_pre, s, len);
+	f->len = len;
+	return 0;
+}
+
+void relay_frame_free(struct relay_frame *f)
+{
+	free(f->buf);
+	f->buf = NULL;
+	f->len = 0;
+	f->cap = 0;
+}
+
+unsigned char *relay_frame_text(struct relay_frame *f)
+{
+	return f->buf + pad_pre;
+}
+
+int relay_ring_push(const char *s, int len)
+{
+	assert(slots);
+
+	if (relay_frame_set(&slots[head % RELAY_RING_SLOTS], s, len)) {
+		return -1;
+	}
+	head++;
+	return 0;
+}
+
+uint64_t relay_ring_head(void)
+{
+	return head;
+}
+
+struct relay_frame *relay_ring_get(uint64_t seq)
+{
+	assert(slots);
+
+	if (seq >= head || head - seq > RELAY_RING_SLOTS) {
+		return NULL;
+	}
+	return &slots[seq % RELAY_RING_SLOTS];
+}
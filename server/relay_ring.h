@@ -0,0 +1,44 @@
+#ifndef RELAY_RING_H
+#define RELAY_RING_H
+
+#include <stdint.h>
+
+/* The frames that jt-relay received from upstream, for its downstream
+ * sessions to send on at their own pace.
+ *
+ * Frames are numbered from 0 in the order they were pushed, and frame n is
+ * kept in slot n % RELAY_RING_SLOTS until it is overwritten. A session
+ * only has to remember the number of the next frame it will send.
+ *
+ * Each frame is stored with room for the websocket header in front of it
+ * and after it, so that every session can write it without a copy.
+ *
+ * Only used from the websocket service thread, so there is no locking. */
+
+#define RELAY_RING_SLOTS 4096
+
+struct relay_frame {
+	int len;
+	int cap; /* of the text, not counting the padding */
+	unsigned char *buf;
+};
+
+/* pre and post are the padding, LWS_PRE and LWS_SEND_BUFFER_POST_PADDING */
+int relay_ring_init(int pre, int post);
+void relay_ring_destroy(void);
+
+/* Copies len bytes of s into the next frame. */
+int relay_ring_push(const char *s, int len);
+
+/* The number of the next frame to be pushed. */
+uint64_t relay_ring_head(void);
+
+/* Frame seq, or NULL if it hasn't been pushed yet or was overwritten. */
+struct relay_frame *relay_ring_get(uint64_t seq);
+
+/* A frame outside the ring, with the same padding. */
+int relay_frame_set(struct relay_frame *f, const char *s, int len);
+void relay_frame_free(struct relay_frame *f);
+unsigned char *relay_frame_text(struct relay_frame *f);
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "jittertrap.h"
+#include "iface_stats.h"
+#include "sample_ring.h"
+
+#define MASK (SAMPLE_RING_LEN - 1)
+
+void sample_ring_init(struct sample_ring *r)
+{
+	memset(r, 0, sizeof(*r));
+}
+
+static inline void set_idle(uint64_t *bitmap, int i, int idle)
+{
+	uint64_t bit = 1ULL << (i % 64);
+
+	if (idle) {
+		bitmap[i / 64] |= bit;
+	} else {
+		bitmap[i / 64] &= ~bit;
+	}
+}
+
+void sample_ring_push(struct sample_ring *r, const struct sample *s)
+{
+	int i = r->head & MASK;
+
+	r->timestamp[i] = s->timestamp;
+	r->whoosh_error_ns[i] = s->whoosh_error_ns;
+	r->rx_bytes_delta[i] = s->rx_bytes_delta;
+	r->tx_bytes_delta[i] = s->tx_bytes_delta;
+	r->rx_packets_delta[i] = s->rx_packets_delta;
+	r->tx_packets_delta[i] = s->tx_packets_delta;
+	set_idle(r->idle[SAMPLE_RX], i, 0 == s->rx_packets_delta);
+	set_idle(r->idle[SAMPLE_TX], i, 0 == s->tx_packets_delta);
+
+	r->head++;
+	if (r->count < SAMPLE_RING_LEN) {
+		r->count++;
+	}
+}
+
+struct sample_span sample_ring_last(const struct sample_ring *r, int n)
+{
+	struct sample_span span;
+
+	assert(n > 0 && n <= r->count);
+
+	span.start = (r->head - n) & MASK;
+	span.len[0] = (span.start + n > SAMPLE_RING_LEN)
+	                  ? SAMPLE_RING_LEN - span.start
+	                  : n;
+	span.len[1] = n - span.len[0];
+	return span;
+}
+
+int sample_ring_newest(const struct sample_ring *r)
+{
+	assert(r->count);
+	return (r->head - 1) & MASK;
+}
+
+/* the 64 bits from bit pos on, wrapping around the end of the bitmap */
+static inline uint64_t bits_at(const uint64_t *bitmap, int pos)
+{
+	int w = pos / 64;
+	int o = pos % 64;
+	uint64_t bits = bitmap[w] >> o;
+
+	if (o) {
+		bits |= bitmap[(w + 1) % SAMPLE_RING_WORDS] << (64 - o);
+	}
+	return bits;
+}
+
+#define RECORD_GAP(len)                                                        \
+	do {                                                                   \
+		uint32_t l_ = (len);                                           \
+		sum += l_;                                                     \
+		min = (l_ < min) ? l_ : min;                                   \
+		max = (l_ > max) ? l_ : max;                                   \
+		closed++;                                                      \
+	} while (0)
+
+struct sample_gaps sample_ring_gaps(const struct sample_ring *r, int dir,
+                                    int n)
+{
+	const uint64_t *bitmap = r->idle[dir];
+	int pos = sample_ring_last(r, n).start;
+	int in_gap = 0;
+	uint32_t run = 0, closed = 0, sum = 0;
+	uint32_t min = UINT32_MAX, max = 0;
+
+	for (int left = n; left > 0; left -= 64, pos = (pos + 64) & MASK) {
+		int len = (left < 64) ? left : 64;
+		uint64_t bits = bits_at(bitmap, pos);
+		int i = 0, t;
+
+		if (in_gap) {
+			/* the gap that the last word ended in */
+			t = (~bits) ? __builtin_ctzll(~bits) : 64;
+			i = (t < len) ? t : len;
+			run += i;
+			if (i < len) {
+				RECORD_GAP(run);
+				run = 0;
+				in_gap = 0;
+			}
+		}
+
+		/* a busy run and then a gap at a time */
+		while (i < len) {
+			uint64_t rest = bits >> i;
+
+			t = rest ? __builtin_ctzll(rest) : 64 - i;
+			i += t;
+			if (i >= len) {
+				break;
+			}
+			rest = ~(bits >> i);
+			t = rest ? __builtin_ctzll(rest) : 64;
+			if (i + t >= len) {
+				run = len - i;
+				in_gap = 1;
+				break;
+			}
+			RECORD_GAP(t);
+			i += t;
+		}
+	}
+
+	/* the last gap runs to the end of the window, or is empty */
+	sum += run;
+	min = (run < min) ? run : min;
+	max = (run > max) ? run : max;
+
+	assert(max <= (uint32_t)n);
+	assert(sum <= (uint32_t)n);
+
+	return (struct sample_gaps){
+		min, max, (uint32_t)roundl((1000.0 * sum) / (closed + 1))
+	};
+}
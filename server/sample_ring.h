@@ -0,0 +1,72 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <time.h>
+
+struct sample;
+
+/*
+ * The compute thread's recent samples, kept as a column per field instead
+ * of a list of structs, so that each decimation reads only the fields it
+ * needs from contiguous arrays.
+ *
+ * For each direction there is also a bitmap of the samples in which no
+ * packets passed. The packet gaps are the runs of set bits, which are
+ * found a 64 bit word at a time by counting trailing zeros, so the cost
+ * goes with the number of gaps rather than the number of samples.
+ *
+ * Only used from the compute thread, so there is no locking.
+ */
+
+/* a power of two, and a multiple of the bitmap words */
+#define SAMPLE_RING_LEN 1024
+#define SAMPLE_RING_WORDS (SAMPLE_RING_LEN / 64)
+
+enum { SAMPLE_RX = 0, SAMPLE_TX = 1, SAMPLE_DIRS };
+
+struct sample_ring {
+	uint32_t head; /* where the next sample goes, unwrapped */
+	int count;     /* how many are held, up to SAMPLE_RING_LEN */
+
+	struct timespec timestamp[SAMPLE_RING_LEN];
+	uint64_t whoosh_error_ns[SAMPLE_RING_LEN];
+	uint64_t rx_bytes_delta[SAMPLE_RING_LEN];
+	uint64_t tx_bytes_delta[SAMPLE_RING_LEN];
+	uint64_t rx_packets_delta[SAMPLE_RING_LEN];
+	uint64_t tx_packets_delta[SAMPLE_RING_LEN];
+
+	/* bit i: no packets in sample i, by direction */
+	uint64_t idle[SAMPLE_DIRS][SAMPLE_RING_WORDS];
+};
+
+/* The last n samples are at [start, start + len[0]) and then, if they
+ * wrap, at [0, len[1]). */
+struct sample_span {
+	int start;
+	int len[2];
+};
+
+/* Packet gaps in samples, as calc_min_max_mean_gap() has always reported
+ * them: mean is in thousandths of a sample, and a window that doesn't end
+ * in a gap counts an empty one at its end. */
+struct sample_gaps {
+	uint32_t min;
+	uint32_t max;
+	uint32_t mean;
+};
+
+void sample_ring_init(struct sample_ring *r);
+void sample_ring_push(struct sample_ring *r, const struct sample *s);
+
+/* n must not be more than r->count */
+struct sample_span sample_ring_last(const struct sample_ring *r, int n);
+
+/* the newest sample */
+int sample_ring_newest(const struct sample_ring *r);
+
+/* The gaps in direction dir over the last n samples. */
+struct sample_gaps sample_ring_gaps(const struct sample_ring *r, int dir,
+                                    int n);
+
+#endif
@@ -15,6 +15,8 @@
 
 #include "proto.h"
 #include "proto-jittertrap.h"
+#include "ipfix_thread.h"
+#include "netem.h"
 
 #define xstr(s) str(s)
 #define str(s) #s
@@ -51,6 +53,18 @@ static struct lws_protocols protocols[] = {
 	                             .rx_buffer_size = 0 }
 };
 
+/* permessage-deflate (RFC 7692), if the browser offers it. Context takeover
+ * is left on: every message is compressed against the ones before it, which
+ * is where the savings are. See ws_deflate_tune() for the rest. */
+static const struct lws_extension exts[] = {
+	{
+		"permessage-deflate",
+		lws_extension_callback_pm_deflate,
+		"permessage-deflate; client_max_window_bits"
+	},
+	{ NULL, NULL, NULL /* terminator */ }
+};
+
 void sighandler(int sig __attribute__((unused)))
 {
 	force_exit = 1;
@@ -66,6 +80,9 @@ static struct option options[] = {
 	{ "daemonize", no_argument, NULL, 'D' },
 #endif
 	{ "resource_path", required_argument, NULL, 'r' },
+	{ "ipfix", required_argument, NULL, '2' },
+	{ "ipfix-active-timeout", required_argument, NULL, '3' },
+	{ "no-deflate", no_argument, NULL, '4' },
 	{ NULL, 0, 0, 0 }
 };
 
@@ -100,6 +117,9 @@ int main(int argc, char **argv)
 	struct lws_context_creation_info info;
 
 	int debug_level = LOG_WARNING;
+	const char *ipfix_collector = NULL;
+	int ipfix_active_timeout = 0;
+	int deflate = 1;
 #ifndef LWS_NO_DAEMONIZE
 	int daemonize = 0;
 #endif
@@ -129,6 +149,17 @@ int main(int argc, char **argv)
 		case 'd':
 			debug_level = LOG_DEBUG;
 			break;
+		/* long only: --ipfix and --ipfix-active-timeout */
+		case '2':
+			ipfix_collector = optarg;
+			break;
+		case '3':
+			ipfix_active_timeout = atoi(optarg);
+			break;
+		/* long only: --no-deflate, to save the CPU on small probes */
+		case '4':
+			deflate = 0;
+			break;
 		case 'p':
 			info.port = atoi(optarg);
 			break;
@@ -145,7 +176,10 @@ int main(int argc, char **argv)
 			fprintf(stderr,
 			        "Usage: " PROGNAME "[--port=<p>] "
 			        "[-d <log level>]"
-			        "[--resource_path <path>]\n");
+			        "[--resource_path <path>] "
+			        "[--ipfix <collector>[:<port>]] "
+			        "[--ipfix-active-timeout <s>] "
+			        "[--no-deflate]\n");
 			exit(1);
 		}
 	}
@@ -163,6 +197,7 @@ int main(int argc, char **argv)
 #endif
 
 	signal(SIGINT, sighandler);
+	signal(SIGTERM, sighandler);
 
 	/* we will only try to log things according to our debug_level */
 	setlogmask(LOG_UPTO(debug_level));
@@ -173,9 +208,18 @@ int main(int argc, char **argv)
 
 	syslog(LOG_NOTICE, "jittertrap server\n");
 	syslog(LOG_INFO, "Using resource path \"%s\"\n", resource_path);
+	syslog(LOG_INFO, "permessage-deflate %s\n", deflate ? "on" : "off");
+
+	if (ipfix_collector
+	    && ipfix_configure(ipfix_collector, ipfix_active_timeout)) {
+		syslog(LOG_ERR, "Invalid IPFIX collector \"%s\"\n",
+		       ipfix_collector);
+		return 1;
+	}
 
 	info.iface = iface;
 	info.protocols = protocols;
+	info.extensions = deflate ? exts : NULL;
 	info.mounts = &mount;
 	info.gid = -1;
 	info.uid = -1;
@@ -204,6 +248,7 @@ int main(int argc, char **argv)
 	}
 
 	lws_context_destroy(context);
+	netem_cleanup();
 
 	syslog(LOG_INFO, "jittertrap server exited cleanly\n");
 
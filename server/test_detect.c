@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+
+#include "detect.h"
+
+#define MS 1000000LL
+
+static uint32_t seed = 1;
+
+/* roughly normal, mean 0, sd 1 */
+static double noise(void)
+{
+	double sum = 0;
+
+	for (int i = 0; i < 12; i++) {
+		seed = seed * 1103515245 + 12345;
+		sum += (double)(seed >> 8) / (1 << 24);
+	}
+	return sum - 6;
+}
+
+/* Feeds n samples of level + sd noise from sample t on, and returns the
+ * number of changes found; the last is written to e. */
+static int feed(struct detector *d, int64_t *t, int n, double level,
+                double sd, struct detect_event *e)
+{
+	struct detect_event tmp;
+	int found = 0;
+
+	for (int i = 0; i < n; i++, (*t)++) {
+		if (detector_add(d, *t * MS, level + sd * noise(), &tmp)) {
+			*e = tmp;
+			found++;
+		}
+	}
+	return found;
+}
+
+int main(void)
+{
+	struct detector d;
+	struct detect_event e = { 0 };
+	int64_t t = 0;
+
+	/* a steady series doesn't change */
+	detector_init(&d, 1);
+	assert(0 == feed(&d, &t, 100000, 1000, 20, &e));
+
+	/* a step up is found once, soon after it starts */
+	assert(1 == feed(&d, &t, 1000, 1500, 20, &e));
+	assert(e.onset_ns >= 100000 * MS && e.onset_ns <= 100002 * MS);
+	assert(fabs(e.baseline - 1000) < 10);
+	assert(fabs(e.level - 1500) < 50);
+	assert(e.sd >= 1000 * DETECT_REL_SD);
+
+	/* and the new level becomes the baseline */
+	assert(0 == feed(&d, &t, 100000, 1500, 20, &e));
+
+	/* a step down as well */
+	assert(1 == feed(&d, &t, 1000, 300, 20, &e));
+	assert(e.onset_ns >= 201000 * MS && e.onset_ns <= 201002 * MS);
+	assert(e.level < e.baseline);
+
+	/* changes smaller than the allowance aren't */
+	detector_init(&d, 1);
+	t = 0;
+	assert(0 == feed(&d, &t, 1000, 1000, 5, &e));
+	assert(0 == feed(&d, &t, 100000, 1000 * (1 + DETECT_REL_SD / 2), 5,
+	                 &e));
+
+	/* an idle series keeps its floor */
+	detector_init(&d, 10);
+	t = 0;
+	assert(0 == feed(&d, &t, 1000, 0, 0, &e));
+	assert(0 == feed(&d, &t, 1000, 2, 1, &e));
+	assert(1 == feed(&d, &t, 100, 1000, 0, &e));
+
+	printf("detect OK\n");
+	return 0;
+}
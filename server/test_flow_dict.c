@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "flow_dict.h"
+
+static void make_key(struct flow_dict_key *k, int n)
+{
+	memset(k, 0, sizeof(*k));
+	snprintf(k->src, sizeof(k->src), "10.0.%d.%d", n / 256, n % 256);
+	snprintf(k->dst, sizeof(k->dst), "192.168.0.1");
+	k->sport = 1000 + n;
+	k->dport = 53;
+	snprintf(k->proto, sizeof(k->proto), "udp");
+	snprintf(k->tclass, sizeof(k->tclass), "BE");
+}
+
+int main(void)
+{
+	struct flow_dict_key k;
+	static struct flow_dict_session s1, s2;
+	uint16_t ids[4], missing[4];
+	int a, b;
+
+	/* the same flow gets the same id */
+	make_key(&k, 1);
+	a = flow_dict_id(&k);
+	assert(a >= 0);
+	assert(a == flow_dict_id(&k));
+	assert(0 == memcmp(flow_dict_get(a), &k, sizeof(k)));
+
+	make_key(&k, 2);
+	b = flow_dict_id(&k);
+	assert(b >= 0 && b != a);
+
+	/* sessions are told about each id once */
+	ids[0] = a;
+	ids[1] = b;
+	assert(2 == flow_dict_session_missing(&s1, ids, 2, missing));
+	assert(missing[0] == a && missing[1] == b);
+	assert(0 == flow_dict_session_missing(&s1, ids, 2, missing));
+	assert(1 == flow_dict_session_missing(&s2, ids, 1, missing));
+	assert(1 == flow_dict_session_missing(&s2, ids, 2, missing));
+	assert(missing[0] == b);
+
+	/* fill the dictionary with live flows; then it's full */
+	for (int n = 3; n < FLOW_DICT_SIZE + 1; n++) {
+		make_key(&k, n);
+		assert(flow_dict_id(&k) >= 0);
+	}
+	make_key(&k, FLOW_DICT_SIZE + 1);
+	assert(-1 == flow_dict_id(&k));
+
+	/* once everything is stale, ids are reused... */
+	for (int n = 0; n <= FLOW_DICT_STALE; n++) {
+		flow_dict_advance();
+	}
+	make_key(&k, 1);
+	assert(a == flow_dict_id(&k));
+	make_key(&k, FLOW_DICT_SIZE + 1);
+	ids[0] = flow_dict_id(&k);
+	assert(ids[0] < FLOW_DICT_SIZE && ids[0] != a);
+
+	/* ...and a reused id is announced again, even if it was known */
+	assert(1 == flow_dict_session_missing(&s1, ids, 1, missing));
+	assert(0 == flow_dict_session_missing(&s1, ids, 1, missing));
+	ids[0] = b;
+	assert(0 == flow_dict_session_missing(&s1, ids, 1, missing));
+
+	printf("flow dict OK\n");
+	return 0;
+}
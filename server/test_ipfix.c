@@ -0,0 +1,140 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "ipfix.h"
+
+#define RECORDS 100
+
+static struct tt_flow_export sent[RECORDS];
+static int received;
+
+static void make_record(struct tt_flow_export *r, int n)
+{
+	memset(r, 0, sizeof(*r));
+	if (n % 3) {
+		r->flow.ethertype = ETHERTYPE_IP;
+		r->flow.src_ip.s_addr = htonl(0x0a000000 + n);
+		r->flow.dst_ip.s_addr = htonl(0xc0a80001);
+	} else {
+		r->flow.ethertype = ETHERTYPE_IPV6;
+		inet_pton(AF_INET6, "2001:db8::1", &r->flow.src_ip6);
+		inet_pton(AF_INET6, "2001:db8::2", &r->flow.dst_ip6);
+		r->flow.src_ip6.s6_addr[15] = n;
+	}
+	r->flow.sport = 1000 + n;
+	r->flow.dport = 443;
+	r->flow.proto = IPPROTO_UDP;
+	r->flow.tclass = 0xb8; /* EF */
+	r->first = (struct timeval){ .tv_sec = 1700000000, .tv_usec = 1000 };
+	r->last = (struct timeval){ .tv_sec = 1700000003, .tv_usec = 5000 };
+	r->bytes = 5000000000LL + n;
+	r->packets = 1000 + n;
+	r->gap_min = 10;
+	r->gap_max = 20000 + n;
+	r->gap_mean = 3000;
+	r->jitter = 250;
+	r->end = (n % 2) ? TT_FLOW_END_IDLE : TT_FLOW_END_ACTIVE;
+}
+
+static void check_record(const struct tt_flow_export *r,
+                         void *data __attribute__((unused)))
+{
+	assert(received < RECORDS);
+	assert(0 == memcmp(&r->flow, &sent[received].flow, sizeof(r->flow)));
+	assert(r->first.tv_sec == sent[received].first.tv_sec);
+	assert(r->first.tv_usec == sent[received].first.tv_usec);
+	assert(r->last.tv_sec == sent[received].last.tv_sec);
+	assert(r->bytes == sent[received].bytes);
+	assert(r->packets == sent[received].packets);
+	assert(r->gap_min == sent[received].gap_min);
+	assert(r->gap_max == sent[received].gap_max);
+	assert(r->gap_mean == sent[received].gap_mean);
+	assert(r->jitter == sent[received].jitter);
+	assert(r->end == sent[received].end);
+	received++;
+}
+
+int main(void)
+{
+	static struct ipfix_msg m;
+	static struct ipfix_parser p;
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t addrlen = sizeof(addr);
+	struct tt_flow_export other = { .flow.ethertype = ETHERTYPE_ARP };
+	uint8_t buf[2048];
+	uint32_t seq = 0;
+	int tx, rx, n, messages = 0;
+
+	/* a collector on a loopback port */
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	rx = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(rx >= 0);
+	assert(0 == bind(rx, (struct sockaddr *)&addr, sizeof(addr)));
+	assert(0 == getsockname(rx, (struct sockaddr *)&addr, &addrlen));
+	tx = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(0 == connect(tx, (struct sockaddr *)&addr, sizeof(addr)));
+
+	/* data without a template is skipped */
+	make_record(&sent[0], 1);
+	ipfix_msg_begin(&m, 0);
+	assert(0 == ipfix_msg_add(&m, &sent[0]));
+	n = ipfix_msg_end(&m, 0, 0, 0);
+	assert(0 == ipfix_parse(&p, m.buf, n, check_record, NULL));
+
+	/* not IP: not exported */
+	ipfix_msg_begin(&m, 1);
+	assert(1 == ipfix_msg_add(&m, &other));
+
+	/* records are packed into datagrams until they are full */
+	for (int i = 0; i < RECORDS; i++) {
+		make_record(&sent[i], i);
+		if (ipfix_msg_add(&m, &sent[i]) < 0) {
+			n = ipfix_msg_end(&m, 1700000010, seq, 0);
+			assert(n <= IPFIX_MAX_MSG_LEN);
+			assert(n == send(tx, m.buf, n, 0));
+			seq += m.records;
+			messages++;
+			ipfix_msg_begin(&m, 0);
+			assert(0 == ipfix_msg_add(&m, &sent[i]));
+		}
+	}
+	n = ipfix_msg_end(&m, 1700000010, seq, 0);
+	assert(n == send(tx, m.buf, n, 0));
+	seq += m.records;
+	messages++;
+	assert(messages > 1 && messages < RECORDS / 10);
+
+	/* the collector gets them all, in order */
+	p.started = 0;
+	for (int i = 0; i < messages; i++) {
+		n = recv(rx, buf, sizeof(buf), 0);
+		assert(n > 0);
+		assert(ipfix_parse(&p, buf, n, check_record, NULL) > 0);
+	}
+	assert(RECORDS == received);
+	assert(0 == p.lost);
+
+	/* a missing message shows in the sequence numbers */
+	ipfix_msg_begin(&m, 0);
+	assert(0 == ipfix_msg_add(&m, &sent[1]));
+	n = ipfix_msg_end(&m, 1700000011, seq + 5, 0);
+	received = 1;
+	assert(1 == ipfix_parse(&p, m.buf, n, check_record, NULL));
+	assert(5 == p.lost);
+
+	/* truncated */
+	assert(-1 == ipfix_parse(&p, m.buf, n - 1, check_record, NULL));
+
+	close(tx);
+	close(rx);
+	printf("ipfix OK\n");
+	return 0;
+}
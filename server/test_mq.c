@@ -2,17 +2,26 @@
 #include <pthread.h>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include "mq_msg_ws.h"
 
 int message_producer(struct mq_ws_msg *m, void *data)
 {
-	int *d = (int *)data;
-	sprintf(m->m, "message %d", *d);
+	memcpy(m->m, data, m->len);
 	return 0;
 }
 
+/* queue the text "message <i>" */
+int produce_message(int i, int *cb_err)
+{
+	char s[32];
+	int len = snprintf(s, sizeof(s), "message %d", i) + 1;
+
+	return mq_ws_produce(len, message_producer, s, cb_err);
+}
+
 /* a callback for consuming messages. */
 int message_printer(struct mq_ws_msg *m, void *data __attribute__((unused)))
 {
@@ -116,13 +125,25 @@ int test_produce_overflow()
 	err = mq_ws_consumer_subscribe(&id);
 	assert(!err);
 
-	for (i = 0; i < mq_ws_maxlen() - 1; i++) {
-		err = mq_ws_produce(message_producer, &i, &cb_err);
+	/* short messages take up a small part of the arena each */
+	i = 0;
+	do {
+		err = produce_message(i, &cb_err);
+		if (!err) {
+			i++;
+		}
+	} while (!err);
+	assert(-JT_WS_MQ_FULL == err);
+	printf("queue full: %d messages\n", i);
+	assert(i > MQ_WS_ARENA_LEN / (int)(sizeof(struct mq_ws_msg) + 64));
+
+	/* consuming them makes room again */
+	for (; i > 0; i--) {
+		err = mq_ws_consume(id, message_printer, NULL, &cb_err);
 		assert(!err);
 	}
-	printf("queue full: %d messages\n", i + 1);
-	err = mq_ws_produce(message_producer, &i, &cb_err);
-	assert(-JT_WS_MQ_FULL == err);
+	err = produce_message(i, &cb_err);
+	assert(!err);
 
 	err = mq_ws_consumer_unsubscribe(id);
 	assert(!err);
@@ -151,7 +172,7 @@ int test_produce_consume()
 	/* fill up the queue */
 	i = 0;
 	do {
-		err = mq_ws_produce(message_producer, &i, &cb_err);
+		err = produce_message(i, &cb_err);
 		if (!err) {
 			i++;
 		}
@@ -194,11 +215,11 @@ int test_ppcc()
 	assert(!err);
 
 	msg_id = 1;
-	err = mq_ws_produce(message_producer, &msg_id, &cb_err);
+	err = produce_message(msg_id, &cb_err);
 	assert(!err);
 
 	msg_id = 2;
-	err = mq_ws_produce(message_producer, &msg_id, &cb_err);
+	err = produce_message(msg_id, &cb_err);
 	assert(!err);
 
 	err = mq_ws_consume(id, string_copier, s, &cb_err);
@@ -239,14 +260,14 @@ int test_pcpc()
 	assert(!err);
 
 	msg_id = 1;
-	err = mq_ws_produce(message_producer, &msg_id, &cb_err);
+	err = produce_message(msg_id, &cb_err);
 	assert(!err);
 
 	err = mq_ws_consume(id, message_printer, s, &cb_err);
 	assert(!err);
 
 	msg_id = 2;
-	err = mq_ws_produce(message_producer, &msg_id, &cb_err);
+	err = produce_message(msg_id, &cb_err);
 	assert(!err);
 
 	err = mq_ws_consume(id, message_printer, s, &cb_err);
@@ -281,7 +302,7 @@ int test_pccpcc()
 	err = mq_ws_consumer_subscribe(&id);
 
 	msg_id = 1;
-	err = mq_ws_produce(message_producer, &msg_id, &cb_err);
+	err = produce_message(msg_id, &cb_err);
 	assert(!err);
 
 	err = mq_ws_consume(id, message_printer, s, &cb_err);
@@ -292,7 +313,7 @@ int test_pccpcc()
 	assert(-JT_WS_MQ_EMPTY == err);
 
 	msg_id = 2;
-	err = mq_ws_produce(message_producer, &msg_id, &cb_err);
+	err = produce_message(msg_id, &cb_err);
 	assert(!err);
 
 	err = mq_ws_consume(id, message_printer, s, &cb_err);
@@ -312,6 +333,93 @@ int test_pccpcc()
 	return 0;
 }
 
+/* fill a message with text of its own length, so it can be checked */
+int pattern_producer(struct mq_ws_msg *m, void *data __attribute__((unused)))
+{
+	for (int i = 0; i < m->len - 1; i++) {
+		m->m[i] = 'a' + (m->len + i) % 26;
+	}
+	m->m[m->len - 1] = '\0';
+	return 0;
+}
+
+int pattern_checker(struct mq_ws_msg *m, void *data)
+{
+	int *len = (int *)data;
+
+	assert((int)strlen(m->m) == m->len - 1);
+	for (int i = 0; i < m->len - 1; i++) {
+		assert(m->m[i] == 'a' + (m->len + i) % 26);
+	}
+	*len = m->len;
+	return 0;
+}
+
+/* messages longer than the old fixed slots, and of many lengths, so that
+ * the records wrap around the end of the arena at every offset */
+int test_variable_length()
+{
+	int i, err, cb_err, len, got;
+	unsigned long id1, id2;
+
+	printf("Testing variable length messages\n");
+
+	err = mq_ws_init("variable length test");
+	assert(!err);
+
+	err = mq_ws_consumer_subscribe(&id1);
+	assert(!err);
+	err = mq_ws_consumer_subscribe(&id2);
+	assert(!err);
+
+	err = mq_ws_produce(MQ_WS_MAX_MSG_LEN + 1, pattern_producer, NULL,
+	                    &cb_err);
+	assert(-JT_WS_MQ_TOO_LONG == err);
+
+	err = mq_ws_produce(MQ_WS_MAX_MSG_LEN, pattern_producer, NULL,
+	                    &cb_err);
+	assert(!err);
+	err = mq_ws_consume(id1, pattern_checker, &got, &cb_err);
+	assert(!err && MQ_WS_MAX_MSG_LEN == got);
+	err = mq_ws_consume(id2, pattern_checker, &got, &cb_err);
+	assert(!err && MQ_WS_MAX_MSG_LEN == got);
+
+	/* the second consumer lags the first by a few messages */
+	for (i = 0; i < 10000; i++) {
+		len = 1 + (i * 7919) % 6000;
+		err = mq_ws_produce(len, pattern_producer, NULL, &cb_err);
+		assert(!err);
+
+		err = mq_ws_consume(id1, pattern_checker, &got, &cb_err);
+		assert(!err && len == got);
+
+		if (i % 4 == 3) {
+			int n = 0;
+			while (!mq_ws_consume(id2, pattern_checker, &got,
+			                      &cb_err)) {
+				n++;
+			}
+			assert(4 == n);
+		}
+	}
+
+	err = mq_ws_consume(id1, pattern_checker, &got, &cb_err);
+	assert(-JT_WS_MQ_EMPTY == err);
+	err = mq_ws_consume(id2, pattern_checker, &got, &cb_err);
+	assert(-JT_WS_MQ_EMPTY == err);
+
+	err = mq_ws_consumer_unsubscribe(id1);
+	assert(!err);
+	err = mq_ws_consumer_unsubscribe(id2);
+	assert(!err);
+
+	err = mq_ws_destroy();
+	assert(!err);
+
+	printf("OK.\n");
+	return 0;
+}
+
 int benchmark()
 {
 	int i, j, err, cb_err;
@@ -341,8 +449,8 @@ int benchmark()
 		i = 0;
 		do {
 			int msg_id = j * i;
-			err =
-			    mq_ws_produce(benchmark_produce, &msg_id, &cb_err);
+			err = mq_ws_produce(1, benchmark_produce, &msg_id,
+			                    &cb_err);
 			if (!err) {
 				i++;
 			}
@@ -384,6 +492,7 @@ int main()
 	assert(0 == test_ppcc());
 	assert(0 == test_pcpc());
 	assert(0 == test_pccpcc());
+	assert(0 == test_variable_length());
 	assert(0 == benchmark());
 
 	printf("message queue tests passed.\n");
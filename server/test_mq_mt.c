@@ -23,8 +23,7 @@
 
 int message_producer(struct mq_ws_msg *m, void *data)
 {
-	char *s = (char *)data;
-	snprintf(m->m, MAX_JSON_MSG_LEN, "%s", s);
+	memcpy(m->m, data, m->len);
 	return 0;
 }
 
@@ -116,7 +115,8 @@ void *produce(void *d __attribute__((unused)))
 
 		sprintf(msg, "%d", i);
 
-		err = mq_ws_produce(message_producer, msg, &cb_err);
+		err = mq_ws_produce(strlen(msg) + 1, message_producer, msg,
+		                    &cb_err);
 		if (!err) {
 #if PRINT_TAIL
 			if (i < PRINT_TAIL) {
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "relay_ring.h"
+
+#define PRE 16
+#define POST 4
+
+static void check_frame(uint64_t seq, const char *s)
+{
+	struct relay_frame *f = relay_ring_get(seq);
+
+	assert(f);
+	assert(f->len == (int)strlen(s));
+	assert(0 == memcmp(relay_frame_text(f), s, f->len));
+	assert(relay_frame_text(f) == f->buf + PRE);
+}
+
+int main(void)
+{
+	struct relay_frame state = { 0 };
+	char s[64];
+
+	assert(0 == relay_ring_init(PRE, POST));
+	assert(0 == relay_ring_head());
+	assert(NULL == relay_ring_get(0));
+
+	assert(0 == relay_ring_push("a", 1));
+	assert(0 == relay_ring_push("bcd", 3));
+	assert(2 == relay_ring_head());
+	check_frame(0, "a");
+	check_frame(1, "bcd");
+	assert(NULL == relay_ring_get(2));
+
+	/* a lap later, the first frames are gone and their slots reused */
+	for (int i = 2; i < RELAY_RING_SLOTS + 2; i++) {
+		snprintf(s, sizeof(s), "frame %d", i);
+		assert(0 == relay_ring_push(s, strlen(s)));
+	}
+	assert(RELAY_RING_SLOTS + 2 == relay_ring_head());
+	assert(NULL == relay_ring_get(0));
+	assert(NULL == relay_ring_get(1));
+	check_frame(2, "frame 2");
+	check_frame(RELAY_RING_SLOTS + 1, "frame 4097");
+
+	/* frames outside the ring have the same layout */
+	assert(0 == relay_frame_set(&state, "xyz", 3));
+	assert(state.len == 3);
+	assert(0 == memcmp(relay_frame_text(&state), "xyz", 3));
+	assert(0 == relay_frame_set(&state, "", 0));
+	assert(state.len == 0);
+	relay_frame_free(&state);
+
+	relay_ring_destroy();
+
+	printf("relay ring OK\n");
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "jittertrap.h"
+#include "iface_stats.h"
+#include "sample_ring.h"
+
+#define PUSHES 5000
+
+static struct sample_ring ring;
+static uint64_t rx_packets[PUSHES];
+
+/* the gaps as calc_min_max_mean_gap() found them, a sample at a time */
+static struct sample_gaps gaps_by_sample(const uint64_t *packets, int n)
+{
+	int32_t gap_lengths[SAMPLE_RING_LEN] = { 0 };
+	int32_t gap_idx = 0, found_gap = 0;
+	int32_t min_gap = n + 1, max_gap = 0, sum_gap = 0;
+
+	for (int i = 0; i < n; i++) {
+		if (0 == packets[i]) {
+			found_gap = 1;
+			gap_lengths[gap_idx]++;
+			if (max_gap < gap_lengths[gap_idx]) {
+				max_gap = gap_lengths[gap_idx];
+			}
+		} else if (found_gap) {
+			found_gap = 0;
+			gap_idx++;
+		}
+	}
+	for (int i = 0; i <= gap_idx; i++) {
+		sum_gap += gap_lengths[i];
+		if (min_gap > gap_lengths[i]) {
+			min_gap = gap_lengths[i];
+		}
+	}
+	return (struct sample_gaps){
+		min_gap, max_gap,
+		(uint32_t)roundl((1000.0 * sum_gap) / (gap_idx + 1))
+	};
+}
+
+static void check_gaps(int pushed, int n)
+{
+	struct sample_gaps want = gaps_by_sample(&rx_packets[pushed - n], n);
+	struct sample_gaps got = sample_ring_gaps(&ring, SAMPLE_RX, n);
+
+	if (want.min != got.min || want.max != got.max ||
+	    want.mean != got.mean) {
+		printf("after %d samples, last %d: want %u/%u/%u got %u/%u/%u\n",
+		       pushed, n, want.min, want.max, want.mean, got.min,
+		       got.max, got.mean);
+		assert(0);
+	}
+}
+
+int main(void)
+{
+	static const int decs[] = { 5, 10, 20, 50, 100, 200, 500, 1000 };
+	struct sample s;
+	struct sample_span span;
+
+	sample_ring_init(&ring);
+	srand(1);
+
+	for (int i = 0; i < PUSHES; i++) {
+		/* stretches of busy, sparse and idle traffic */
+		int idle_pct = (i / 300) % 3 ? ((i / 300) % 2 ? 95 : 50) : 5;
+
+		memset(&s, 0, sizeof(s));
+		s.rx_packets_delta = (rand() % 100 < idle_pct) ? 0 : 1 + i % 7;
+		s.tx_packets_delta = i % 3;
+		s.rx_bytes_delta = i;
+		rx_packets[i] = s.rx_packets_delta;
+		sample_ring_push(&ring, &s);
+
+		for (unsigned d = 0; d < sizeof(decs) / sizeof(decs[0]); d++) {
+			if (decs[d] <= i + 1) {
+				check_gaps(i + 1, decs[d]);
+			}
+		}
+		check_gaps(i + 1, 1 + rand() % (ring.count < 1000 ? ring.count
+		                                                    : 1000));
+	}
+
+	/* the columns follow the same order */
+	assert(SAMPLE_RING_LEN == ring.count);
+	span = sample_ring_last(&ring, 1000);
+	assert(span.len[0] + span.len[1] == 1000);
+	assert((uint64_t)(PUSHES - 1000) == ring.rx_bytes_delta[span.start]);
+	assert((uint64_t)(PUSHES - 1) ==
+	       ring.rx_bytes_delta[sample_ring_newest(&ring)]);
+
+	/* all idle and all busy */
+	sample_ring_init(&ring);
+	memset(&s, 0, sizeof(s));
+	for (int i = 0; i < 100; i++) {
+		sample_ring_push(&ring, &s);
+	}
+	struct sample_gaps g = sample_ring_gaps(&ring, SAMPLE_TX, 100);
+	assert(100 == g.min && 100 == g.max && 100000 == g.mean);
+	s.tx_packets_delta = 1;
+	for (int i = 0; i < 100; i++) {
+		sample_ring_push(&ring, &s);
+	}
+	g = sample_ring_gaps(&ring, SAMPLE_TX, 100);
+	assert(0 == g.min && 0 == g.max && 0 == g.mean);
+
+	printf("sample ring OK\n");
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "update_rate.h"
+
+#define MS 1000000LL
+
+static int count_passed(struct update_rate *u, enum update_kind k,
+                        int64_t ival, int n)
+{
+	int passed = 0;
+	for (int i = 0; i < n; i++) {
+		passed += update_rate_pass(u, k, 0, ival);
+	}
+	return passed;
+}
+
+int main(void)
+{
+	struct update_rate a, b;
+	int64_t stats[] = { 100 * MS };
+	int64_t tt[] = { 100 * MS, 1000 * MS };
+	int64_t rollups[] = { 0, 3 };
+	int64_t stats_ivals[] = { 5 * MS, 10 * MS, 100 * MS, 1000 * MS };
+	int64_t tt_ivals[] = { 5 * MS, 100 * MS, 1000 * MS };
+	int64_t rollup_ivals[] = { 0, 1, 2, 3 };
+	int64_t odd[] = { 7 * MS };
+
+	assert(0 == update_rate_configure(UPDATE_STATS, stats_ivals, 4));
+	assert(0 == update_rate_configure(UPDATE_TOPTALK, tt_ivals, 3));
+	assert(0 == update_rate_configure(UPDATE_ROLLUP, rollup_ivals, 4));
+
+	/* new sessions get everything */
+	update_rate_init(&a);
+	assert(100 == count_passed(&a, UPDATE_STATS, 5 * MS, 100));
+	assert(100 == count_passed(&a, UPDATE_TOPTALK, 1000 * MS, 100));
+	assert(update_rate_wanted(UPDATE_STATS, 0, 5 * MS));
+	assert(update_rate_pass(&a, UPDATE_NONE, 0, 0));
+
+	/* only the visible intervals, at most 2 per second */
+	assert(0 == update_rate_set(&a, 2, stats, 1, tt, 2, 0, NULL, 0));
+	assert(update_rate_shows(&a, UPDATE_STATS, 100 * MS));
+	assert(!update_rate_shows(&a, UPDATE_STATS, 5 * MS));
+	assert(update_rate_shows(&a, UPDATE_TOPTALK, 1000 * MS));
+	assert(0 == count_passed(&a, UPDATE_STATS, 5 * MS, 100));
+	assert(20 == count_passed(&a, UPDATE_STATS, 100 * MS, 100));
+	assert(20 == count_passed(&a, UPDATE_TOPTALK, 100 * MS, 100));
+	/* slower than the limit, so nothing is skipped */
+	assert(10 == count_passed(&a, UPDATE_TOPTALK, 1000 * MS, 10));
+	assert(update_rate_pass(&a, UPDATE_NONE, 0, 0));
+
+	/* nobody else is left to want the 5ms stats */
+	assert(!update_rate_wanted(UPDATE_STATS, 0, 5 * MS));
+	assert(update_rate_wanted(UPDATE_STATS, 0, 100 * MS));
+	assert(!update_rate_wanted(UPDATE_TOPTALK, 0, 5 * MS));
+	assert(update_rate_wanted(UPDATE_TOPTALK, 0, 1000 * MS));
+
+	/* a second session: the wanted set is the union */
+	update_rate_init(&b);
+	assert(update_rate_wanted(UPDATE_STATS, 0, 5 * MS));
+	assert(0 == update_rate_set(&b, 0, NULL, 0, NULL, -1, 0, NULL, 0));
+	assert(!update_rate_wanted(UPDATE_STATS, 0, 5 * MS));
+	assert(update_rate_wanted(UPDATE_TOPTALK, 0, 5 * MS));
+	assert(0 == count_passed(&b, UPDATE_STATS, 100 * MS, 10));
+	assert(10 == count_passed(&b, UPDATE_TOPTALK, 5 * MS, 10));
+
+	/* an invalid request leaves the settings alone */
+	assert(0 != update_rate_set(&a, -1, NULL, -1, NULL, -1, 0, NULL, 0));
+	assert(0 == count_passed(&a, UPDATE_STATS, 5 * MS, 10));
+
+	/* as does one for an interval that isn't produced */
+	assert(0 != update_rate_set(&a, 0, odd, 1, tt, 2, 0, NULL, 0));
+	assert(0 != update_rate_set(&a, 0, stats, 1, odd, 1, 0, NULL, 0));
+	assert(0 != update_rate_set(&a, 0, stats, 1, tt, 2, 0, odd, 1));
+	assert(!update_rate_wanted(UPDATE_STATS, 0, 7 * MS));
+	assert(update_rate_shows(&a, UPDATE_STATS, 100 * MS));
+
+	update_rate_release(&b);
+	assert(!update_rate_wanted(UPDATE_TOPTALK, 0, 5 * MS));
+	assert(update_rate_wanted(UPDATE_TOPTALK, 0, 100 * MS));
+
+	/* toptalk by flow id: only that form is sent to the session */
+	assert(0 == update_rate_set(&a, 0, stats, 1, tt, 2, 1, NULL, 0));
+	assert(0 == count_passed(&a, UPDATE_TOPTALK, 100 * MS, 10));
+	assert(10 == count_passed(&a, UPDATE_STATS, 100 * MS, 10));
+	assert(update_rate_pass(&a, UPDATE_TOPTALK, 1, 100 * MS));
+	assert(update_rate_wanted(UPDATE_TOPTALK, 1, 100 * MS));
+	assert(!update_rate_wanted(UPDATE_TOPTALK, 0, 100 * MS));
+	assert(update_rate_wanted(UPDATE_STATS, 0, 100 * MS));
+
+	/* rollups only go to the sessions that ask for them, unlimited */
+	assert(!update_rate_wanted(UPDATE_ROLLUP, 0, 0));
+	assert(0 == count_passed(&a, UPDATE_ROLLUP, 0, 10));
+	assert(0 == update_rate_set(&a, 2, stats, 1, tt, 2, 1, rollups, 2));
+	assert(update_rate_wanted(UPDATE_ROLLUP, 0, 0));
+	assert(update_rate_wanted(UPDATE_ROLLUP, 0, 3));
+	assert(!update_rate_wanted(UPDATE_ROLLUP, 0, 1));
+	assert(10 == count_passed(&a, UPDATE_ROLLUP, 0, 10));
+	assert(0 == count_passed(&a, UPDATE_ROLLUP, 1, 10));
+
+	update_rate_release(&a);
+	assert(!update_rate_wanted(UPDATE_ROLLUP, 0, 0));
+	assert(!update_rate_wanted(UPDATE_STATS, 0, 100 * MS));
+	assert(!update_rate_wanted(UPDATE_TOPTALK, 0, 100 * MS));
+
+	printf("update rate OK\n");
+	return 0;
+}
@@ -15,8 +15,10 @@
 
 #include "flow.h"
 #include "intervals.h"
+#include "rollup.h"
 
 #include "tt_thread.h"
+#include "update_rate.h"
 
 struct tt_thread_info ti = {
 	0,
@@ -97,12 +99,27 @@ int tt_thread_restart(char * iface)
 	return 0;
 }
 
+void tt_thread_set_flow_export(tt_flow_export_fn fn, void *data,
+                               struct timeval active_timeout)
+{
+	tt_set_flow_export(&ti, fn, data, active_timeout);
+}
+
+_Static_assert(ADDR_LEN == FLOW_ADDR_STRLEN,
+               "toptalk addresses are copied as they were formatted");
+_Static_assert(JT_PGAP_BUCKETS == TT_PGAP_BUCKETS,
+               "packet gap histograms are copied bucket for bucket");
+_Static_assert(JT_PSIZE_BUCKETS == TT_PSIZE_BUCKETS
+               && JT_PSIZE_SHIFT == TT_PSIZE_SHIFT,
+               "packet length histograms are copied bucket for bucket");
+
 /* Convert from a struct tt_top_flows to a struct mq_tt_msg */
 static int
 m2m(struct tt_top_flows *ttf, struct mq_tt_msg *msg, int interval)
 {
 	struct jt_msg_toptalk *m = &msg->m;
 
+	msg->type = JT_MSG_TOPTALK_V1;
 	m->timestamp.tv_sec = ttf->timestamp.tv_sec;
 	m->timestamp.tv_nsec = ttf->timestamp.tv_usec * 1000;
 
@@ -113,23 +130,118 @@ m2m(struct tt_top_flows *ttf, struct mq_tt_msg *msg, int interval)
 	m->tbytes = ttf->total_bytes;
 	m->tpackets = ttf->total_packets;
 
+	m->distinct.flows = ttf->distinct[interval].flows;
+	m->distinct.sources = ttf->distinct[interval].sources;
+	m->distinct.destinations = ttf->distinct[interval].destinations;
+	m->distinct.dports = ttf->distinct[interval].dports;
+
+	for (int d = 0; d < JT_PGAP_DIRS; d++) {
+		/* enum tt_dir and the message have rx and tx the same way */
+		struct tt_pgaps *g = &ttf->pgaps[interval][d];
+
+		m->pgaps[d].count = g->count;
+		m->pgaps[d].min_ns = g->min_ns;
+		m->pgaps[d].max_ns = g->max_ns;
+		m->pgaps[d].mean_ns = g->mean_ns;
+		memcpy(m->pgaps[d].hist, g->hist, sizeof(m->pgaps[d].hist));
+		memcpy(m->psizes[d], ttf->psizes[interval][d],
+		       sizeof(m->psizes[d]));
+	}
+
+	/* the interval's own top flows, so that short bursts are attributed
+	 * to the flow that caused them */
 	for (int f = 0; f < MAX_FLOWS; f++) {
-		m->flows[f].bytes = ttf->flow[f][interval].bytes;
-		m->flows[f].packets = ttf->flow[f][interval].packets;
-		m->flows[f].sport = ttf->flow[f][interval].flow.sport;
-		m->flows[f].dport = ttf->flow[f][interval].flow.dport;
+		struct flow_record *fr = &ttf->top[interval][f];
+		struct flow_addr_str *fa = &ttf->top_addr[interval][f];
+
+		if (f >= ttf->top_count[interval] || f >= MAX_FLOW_COUNT) {
+			memset(&m->flows[f], 0, sizeof(m->flows[f]));
+			continue;
+		}
+		m->flows[f].bytes = fr->bytes;
+		m->flows[f].packets = fr->packets;
+		memcpy(m->flows[f].sizes, ttf->top_sizes[interval][f],
+		       sizeof(m->flows[f].sizes));
+		m->flows[f].sport = fr->flow.sport;
+		m->flows[f].dport = fr->flow.dport;
 		snprintf(m->flows[f].proto, PROTO_LEN, "%s",
-				protos[ttf->flow[f][interval].flow.proto]);
-		snprintf(m->flows[f].src, ADDR_LEN, "%s",
-				inet_ntoa(ttf->flow[f][interval].flow.src_ip));
-		snprintf(m->flows[f].dst, ADDR_LEN, "%s",
-				inet_ntoa(ttf->flow[f][interval].flow.dst_ip));
+				protos[fr->flow.proto]);
+		memcpy(m->flows[f].src, fa->src, ADDR_LEN);
+		memcpy(m->flows[f].dst, fa->dst, ADDR_LEN);
 		snprintf(m->flows[f].tclass, TCLASS_LEN, "%s",
-		         dscpvalues[ttf->flow[f][interval].flow.tclass]);
+		         dscpvalues[fr->flow.tclass]);
 	}
 	return 0;
 }
 
+/* Format a rollup key for display, eg. "10.0.1.0/24" or "443" */
+static void rollup_key_print(const struct tt_rollup *r,
+                             const struct tt_rollup_key *key, char *out,
+                             int len)
+{
+	char addr[ADDR_LEN];
+	int af;
+
+	switch (r->field) {
+	case TT_ROLLUP_SRC:
+	case TT_ROLLUP_DST:
+		af = (ETHERTYPE_IPV6 == key->ethertype) ? AF_INET6 : AF_INET;
+		if (ETHERTYPE_IP != key->ethertype
+		    && ETHERTYPE_IPV6 != key->ethertype) {
+			snprintf(out, len, "other");
+		} else if (inet_ntop(af, key->addr, addr, sizeof(addr))) {
+			snprintf(out, len, "%s/%d", addr, key->plen);
+		} else {
+			snprintf(out, len, "?");
+		}
+		break;
+	case TT_ROLLUP_PROTO:
+		if (key->value < IPPROTO_MAX && protos[key->value]) {
+			snprintf(out, len, "%s", protos[key->value]);
+		} else {
+			snprintf(out, len, "%d", key->value);
+		}
+		break;
+	case TT_ROLLUP_TCLASS:
+		if (key->value < (int)(sizeof(dscpvalues)
+		                       / sizeof(dscpvalues[0]))
+		    && dscpvalues[key->value]) {
+			snprintf(out, len, "%s", dscpvalues[key->value]);
+		} else {
+			snprintf(out, len, "0x%02x", key->value);
+		}
+		break;
+	default:
+		snprintf(out, len, "%d", key->value);
+	}
+}
+
+/* Convert one rollup of a struct tt_top_flows to a struct mq_tt_msg */
+static void
+r2m(struct tt_top_flows *ttf, struct mq_tt_msg *msg, int rollup)
+{
+	struct jt_msg_rollup *m = &msg->r;
+	struct tt_rollup_top *t = &ttf->rollup[rollup];
+	struct timeval window = tt_intervals[INTERVAL_COUNT - 1];
+
+	msg->type = JT_MSG_ROLLUP_V1;
+	m->timestamp.tv_sec = ttf->timestamp.tv_sec;
+	m->timestamp.tv_nsec = ttf->timestamp.tv_usec * 1000;
+	m->interval_ns = window.tv_sec * 1E9 + window.tv_usec * 1E3;
+	snprintf(m->name, ROLLUP_NAME_LEN, "%s", tt_rollups[rollup].name);
+	m->tbytes = t->total_bytes;
+	m->tpackets = t->total_packets;
+	m->count = (t->count < MAX_FLOWS) ? t->count : MAX_FLOWS;
+
+	for (int i = 0; i < m->count; i++) {
+		rollup_key_print(&tt_rollups[rollup], &t->entry[i].key,
+		                 m->entries[i].key, ROLLUP_KEY_LEN);
+		m->entries[i].bytes = t->entry[i].bytes;
+		m->entries[i].packets = t->entry[i].packets;
+		m->entries[i].error = t->entry[i].error;
+	}
+}
+
 inline static int message_producer(struct mq_tt_msg *m, void *data)
 {
 
@@ -152,6 +264,24 @@ int queue_tt_msg(int interval)
 	return 0;
 }
 
+/* The rollups cover the longest interval, so they follow its messages. */
+static int queue_rollup_msgs(void)
+{
+	struct mq_tt_msg msg;
+	struct tt_top_flows *t5 = ti.t5;
+	int cb_err;
+
+	for (int r = 0; r < tt_rollup_count; r++) {
+		pthread_mutex_lock(&ti.t5_mutex);
+		{
+			r2m(t5, &msg, r);
+			mq_tt_produce(message_producer, &msg, &cb_err);
+		}
+		pthread_mutex_unlock(&ti.t5_mutex);
+	}
+	return 0;
+}
+
 
 /* TODO: calculate the GCD of tt_intervals
  * updates output var intervals
@@ -237,6 +367,9 @@ static void *intervals_run(void *data)
 				queue_tt_msg(i);
 			}
 		}
+		if (0 == (tick % imuls[INTERVAL_COUNT - 1])) {
+			queue_rollup_msgs();
+		}
 
 		/* increment / wrap tick */
 		tick = (imuls[INTERVAL_COUNT-1] == tick) ? 1 : tick + 1;
@@ -255,11 +388,33 @@ static void *intervals_run(void *data)
 	return NULL;
 }
 
+/* the toptalk intervals and rollups that sessions can ask for */
+static void configure_update_rate(void)
+{
+	int64_t ivals[UPDATE_MAX_IVALS];
+	int err;
+
+	for (int i = 0; i < INTERVAL_COUNT; i++) {
+		ivals[i] = tt_intervals[i].tv_sec * 1E9
+		           + tt_intervals[i].tv_usec * 1E3;
+	}
+	err = update_rate_configure(UPDATE_TOPTALK, ivals, INTERVAL_COUNT);
+	assert(!err);
+
+	for (int i = 0; i < tt_rollup_count; i++) {
+		ivals[i] = i;
+	}
+	err = update_rate_configure(UPDATE_ROLLUP, ivals, tt_rollup_count);
+	assert(!err);
+}
+
 int intervals_thread_init(void)
 {
 	int err;
 	void *res;
 
+	configure_update_rate();
+
 	if (iti.thread_id) {
 		pthread_cancel(iti.thread_id);
 		pthread_join(iti.thread_id, &res);
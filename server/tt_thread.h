@@ -1,8 +1,16 @@
 #ifndef TT_THREAD_H
 #define TT_THREAD_H
 
+#include <sys/time.h>
+
+#include "flow_export.h"
+
 int tt_thread_restart(char * iface);
 int intervals_thread_init(void);
 
+/* Hand the toptalk flow records to fn (see flow_export.h). */
+void tt_thread_set_flow_export(tt_flow_export_fn fn, void *data,
+                               struct timeval active_timeout);
+
 
 #endif
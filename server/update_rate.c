@@ -0,0 +1,233 @@
+#include <string.h>
+#include <assert.h>
+#include <syslog.h>
+
+#include "update_rate.h"
+
+/* The intervals produced, see update_rate_configure(). */
+static struct {
+	int count;
+	int64_t ival[UPDATE_MAX_IVALS];
+} configured[UPDATE_KINDS];
+
+/* How many sessions want each kind and interval, with or without flow
+ * ids, so that messages nobody wants needn't be encoded at all. refs[] is
+ * indexed like configured[].ival[]; the intervals themselves are kept by
+ * each session. */
+struct wanted {
+	int all;
+	int refs[UPDATE_MAX_IVALS];
+};
+
+static struct wanted wanted_by_form[2][UPDATE_KINDS];
+
+/* index in configured[kind], or -1 */
+static int configured_slot(enum update_kind kind, int64_t ival)
+{
+	for (int i = 0; i < configured[kind].count; i++) {
+		if (configured[kind].ival[i] == ival) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void wanted_add(struct wanted *w, enum update_kind kind,
+                       int64_t ival, int delta)
+{
+	int i = configured_slot(kind, ival);
+
+	/* sessions only hold configured intervals */
+	assert(i >= 0);
+	w->refs[i] += delta;
+}
+
+static int wanted_has(const struct wanted *w, enum update_kind kind,
+                      int64_t ival)
+{
+	int i;
+
+	if (w->all) {
+		return 1;
+	}
+	i = configured_slot(kind, ival);
+	return i >= 0 && w->refs[i] > 0;
+}
+
+static int update_rate_wanted_any(enum update_kind kind, int64_t ival)
+{
+	return wanted_has(&wanted_by_form[0][kind], kind, ival)
+	       || wanted_has(&wanted_by_form[1][kind], kind, ival);
+}
+
+static void wanted_update(const struct update_rate *u, int delta)
+{
+	struct wanted *wanted = wanted_by_form[!!u->flow_ids];
+
+	for (int k = 0; k < UPDATE_KINDS; k++) {
+		if (u->kind[k].all) {
+			wanted[k].all += delta;
+			continue;
+		}
+		for (int i = 0; i < u->kind[k].count; i++) {
+			wanted_add(&wanted[k], k, u->kind[k].ival[i], delta);
+		}
+	}
+}
+
+int update_rate_configure(enum update_kind kind, const int64_t *ivals,
+                          int count)
+{
+	if (kind < 0 || kind >= UPDATE_KINDS || count < 0
+	    || count > UPDATE_MAX_IVALS) {
+		return -1;
+	}
+	memcpy(configured[kind].ival, ivals, count * sizeof(ivals[0]));
+	configured[kind].count = count;
+	return 0;
+}
+
+void update_rate_init(struct update_rate *u)
+{
+	memset(u, 0, sizeof(*u));
+	for (int k = 0; k < UPDATE_KINDS; k++) {
+		u->kind[k].all = (UPDATE_ROLLUP != k);
+	}
+	wanted_update(u, 1);
+}
+
+void update_rate_release(struct update_rate *u)
+{
+	wanted_update(u, -1);
+	memset(u, 0, sizeof(*u));
+}
+
+static int set_kind(struct update_rate *u, enum update_kind k,
+                    const int64_t *ivals, int count)
+{
+	if (count > UPDATE_MAX_IVALS) {
+		return -1;
+	}
+	u->kind[k].all = (count < 0);
+	u->kind[k].count = 0;
+	for (int i = 0; i < count; i++) {
+		if (configured_slot(k, ivals[i]) < 0) {
+			return -1;
+		}
+		u->kind[k].ival[i] = ivals[i];
+		u->kind[k].seq[i] = 0;
+		u->kind[k].count++;
+	}
+	return 0;
+}
+
+int update_rate_set(struct update_rate *u, int max_rate,
+                    const int64_t *stats, int stats_count,
+                    const int64_t *tt, int tt_count, int flow_ids,
+                    const int64_t *rollups, int rollup_count)
+{
+	struct update_rate n;
+
+	if (max_rate < 0) {
+		return -1;
+	}
+
+	memset(&n, 0, sizeof(n));
+	n.max_rate = max_rate;
+	n.flow_ids = !!flow_ids;
+	n.skipped = u->skipped;
+	if (set_kind(&n, UPDATE_STATS, stats, stats_count)
+	    || set_kind(&n, UPDATE_TOPTALK, tt, tt_count)
+	    || set_kind(&n, UPDATE_ROLLUP, rollups, rollup_count)) {
+		syslog(LOG_WARNING, "invalid update rate request ignored\n");
+		return -1;
+	}
+
+	wanted_update(u, -1);
+	*u = n;
+	wanted_update(u, 1);
+	return 0;
+}
+
+int update_rate_pass(struct update_rate *u, enum update_kind kind,
+                     int flow_ids, int64_t interval_ns)
+{
+	int64_t period, every;
+	int i;
+
+	if (kind < 0 || kind >= UPDATE_KINDS) {
+		return 1;
+	}
+	if (UPDATE_TOPTALK == kind && !!flow_ids != u->flow_ids) {
+		/* the other form of the same message */
+		return 0;
+	}
+
+	for (i = 0; i < u->kind[kind].count; i++) {
+		if (u->kind[kind].ival[i] == interval_ns) {
+			break;
+		}
+	}
+	if (i == u->kind[kind].count) {
+		if (!u->kind[kind].all) {
+			u->skipped++;
+			return 0;
+		}
+		if (i == UPDATE_MAX_IVALS) {
+			/* can't count it, so can't limit it */
+			return 1;
+		}
+		/* first of this interval; start counting it */
+		u->kind[kind].ival[i] = interval_ns;
+		u->kind[kind].seq[i] = 0;
+		u->kind[kind].count++;
+	}
+
+	if (!u->max_rate || UPDATE_ROLLUP == kind) {
+		return 1;
+	}
+
+	/* Send every n'th message, so that they stay evenly spaced in data
+	 * time however bursty the socket is. */
+	period = (int64_t)u->max_rate * interval_ns;
+	every = (1000000000LL + period - 1) / period;
+	if (every <= 1) {
+		return 1;
+	}
+	if (u->kind[kind].seq[i]++ % every) {
+		u->skipped++;
+		return 0;
+	}
+	return 1;
+}
+
+int update_rate_shows(const struct update_rate *u, enum update_kind kind,
+                      int64_t interval_ns)
+{
+	if (kind < 0 || kind >= UPDATE_KINDS) {
+		return 1;
+	}
+	if (u->kind[kind].all) {
+		return 1;
+	}
+	for (int i = 0; i < u->kind[kind].count; i++) {
+		if (u->kind[kind].ival[i] == interval_ns) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int update_rate_wanted(enum update_kind kind, int flow_ids,
+                       int64_t interval_ns)
+{
+	if (kind < 0 || kind >= UPDATE_KINDS) {
+		return 1;
+	}
+	if (UPDATE_TOPTALK != kind) {
+		/* there's only one form */
+		return update_rate_wanted_any(kind, interval_ns);
+	}
+	return wanted_has(&wanted_by_form[!!flow_ids][kind], kind,
+	                  interval_ns);
+}
@@ -0,0 +1,71 @@
+#ifndef UPDATE_RATE_H
+#define UPDATE_RATE_H
+
+#include <stdint.h>
+
+/* Per session flow control of the periodic messages. Each client says
+ * which stats and toptalk intervals it shows and how many updates per
+ * second it can use; everything else is skipped for that session.
+ * Rollups are only sent to the sessions that ask for them, and are
+ * identified by their index in tt_rollups[] instead of an interval.
+ * Sessions can only ask for the intervals the server produces.
+ *
+ * Only used from the websocket service thread, so there is no locking. */
+
+#define UPDATE_MAX_IVALS 16
+
+enum update_kind {
+	UPDATE_NONE = -1, /* not a periodic message, always sent */
+	UPDATE_STATS = 0,
+	UPDATE_TOPTALK,
+	UPDATE_ROLLUP,
+	UPDATE_KINDS
+};
+
+struct update_rate {
+	int max_rate; /* per interval, per second; 0 for no limit */
+	int flow_ids; /* toptalk as flow ids, see flow_dict.h */
+	struct {
+		int all; /* every interval is wanted */
+		int count;
+		int64_t ival[UPDATE_MAX_IVALS]; /* ns, or rollup index */
+		uint32_t seq[UPDATE_MAX_IVALS];
+	} kind[UPDATE_KINDS];
+	uint64_t skipped;
+};
+
+/* The intervals of this kind that the server produces; requests for any
+ * other interval are rejected. Called by the producers before the first
+ * request is accepted. */
+int update_rate_configure(enum update_kind kind, const int64_t *ivals,
+                          int count);
+
+/* A new session wants everything but rollups, as fast as it comes. */
+void update_rate_init(struct update_rate *u);
+
+/* A count of -1 means all intervals of that kind. */
+int update_rate_set(struct update_rate *u, int max_rate,
+                    const int64_t *stats, int stats_count,
+                    const int64_t *tt, int tt_count, int flow_ids,
+                    const int64_t *rollups, int rollup_count);
+
+/* The session is closing. */
+void update_rate_release(struct update_rate *u);
+
+/* Account for a message of this kind and interval and return 1 if it
+ * should be sent to the session, 0 to skip it. Toptalk messages come in
+ * two forms, and flow_ids says which this one is. Rollups are not rate
+ * limited: they come once per longest toptalk interval. */
+int update_rate_pass(struct update_rate *u, enum update_kind kind,
+                     int flow_ids, int64_t interval_ns);
+
+/* Does the session show this kind and interval at all, whatever the
+ * rate? */
+int update_rate_shows(const struct update_rate *u, enum update_kind kind,
+                      int64_t interval_ns);
+
+/* Is any session interested in this kind and interval, in this form? */
+int update_rate_wanted(enum update_kind kind, int flow_ids,
+                       int64_t interval_ns);
+
+#endif
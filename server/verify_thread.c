@@ -0,0 +1,603 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+#include <stdio.h>
+#include <sched.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/route/tc.h>
+#include <netlink/route/qdisc.h>
+
+#include <jansson.h>
+#include "jt_message_types.h"
+#include "jt_messages.h"
+
+#include "jittertrap.h"
+#include "jt_server_message_handler.h"
+#include "netem.h"
+#include "timeywimey.h"
+#include "verify_thread.h"
+
+/*
+ * Closed-loop verification of the configured impairment.
+ *
+ * Ten times per report, the netem qdisc statistics of the iface are read
+ * over netlink, so that drops and queueing by the qdisc itself are visible.
+ * Optionally, timestamped UDP probes are sent towards a target that either
+ * is local or echoes them back; their one-way (or round-trip) delay and
+ * loss are compared against the configured netem parameters.
+ * Results are reported once per REPORT_PERIOD_US.
+ */
+
+#define REPORT_PERIOD_US 1000000
+/* The counters are cumulative, so only the backlog and queue length maxima
+ * depend on this; a dump per sample period would cost more than it shows. */
+#define QDISC_PERIOD_US (REPORT_PERIOD_US / 10)
+#define PROBE_MAGIC 0x4a545652 /* "JTVR" */
+#define PROBE_MAX_RATE 1000
+/* probes not received after this long are counted as lost */
+#define PROBE_GRACE_US 2000000
+/* enough slots for PROBE_MAX_RATE * (REPORT_PERIOD_US + PROBE_GRACE_US) */
+#define PROBE_WINDOW 4096
+#define SAMPLE_MAX PROBE_WINDOW
+
+static struct {
+	pthread_t thread_id;
+	pthread_attr_t thread_attr;
+	const char * const thread_name;
+	const int thread_prio;
+} thread_info = {
+	0,
+	.thread_name = "jt-verify",
+	.thread_prio = 1
+};
+
+struct probe {
+	uint32_t magic;
+	uint32_t seq;
+	int64_t tx_sec;
+	int64_t tx_nsec;
+};
+
+/* netem qdisc counters, summed over all netem qdiscs on the iface */
+struct qd_sample {
+	int ifindex;
+	uint64_t packets;
+	uint64_t drops;
+	uint64_t requeues;
+	uint64_t overlimits;
+	uint64_t backlog;
+	uint64_t qlen;
+	int found;
+};
+
+/* protects config, generation and result. */
+static pthread_mutex_t verify_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t verify_cond = PTHREAD_COND_INITIALIZER;
+static struct jt_msg_verify config;
+/* incremented on every (re)configuration */
+static unsigned long generation;
+static struct jt_msg_verify_result result;
+
+/* owned by the verify thread */
+static struct nl_sock *sock;
+static int probe_fd = -1;
+static struct sockaddr_in probe_dst;
+static uint32_t probe_seq;
+static struct {
+	int64_t tx_us; /* 0 when the slot is free */
+	int rcvd;
+} window[PROBE_WINDOW];
+static int64_t samples[SAMPLE_MAX];
+static int sample_count;
+
+/* local prototypes */
+static void *run(void *data);
+
+static unsigned long current_generation(void)
+{
+	unsigned long gen;
+
+	pthread_mutex_lock(&verify_mutex);
+	gen = generation;
+	pthread_mutex_unlock(&verify_mutex);
+	return gen;
+}
+
+static int64_t ts_to_us(struct timespec t)
+{
+	return t.tv_sec * 1000000LL + t.tv_nsec / 1000;
+}
+
+int verify_configure(const struct jt_msg_verify *v)
+{
+	if (!v->enable) {
+		return verify_stop();
+	}
+
+	if (!is_iface_allowed(v->iface)) {
+		syslog(LOG_WARNING, "verify: iface [%s] not allowed\n",
+		       v->iface);
+		return -1;
+	}
+
+	if (v->probe_dst[0]) {
+		struct in_addr a;
+		if (1 != inet_pton(AF_INET, v->probe_dst, &a)) {
+			syslog(LOG_WARNING,
+			       "verify: probe destination [%s] is not an "
+			       "IPv4 address\n",
+			       v->probe_dst);
+			return -1;
+		}
+		if (v->probe_port <= 0 || v->probe_port > 65535) {
+			syslog(LOG_WARNING, "verify: bad probe port %d\n",
+			       v->probe_port);
+			return -1;
+		}
+		if (v->probe_rate <= 0 || v->probe_rate > PROBE_MAX_RATE) {
+			syslog(LOG_WARNING,
+			       "verify: probe rate %d not in 1..%d\n",
+			       v->probe_rate, PROBE_MAX_RATE);
+			return -1;
+		}
+	}
+
+	pthread_mutex_lock(&verify_mutex);
+	memcpy(&config, v, sizeof(config));
+	generation++;
+	pthread_cond_signal(&verify_cond);
+	pthread_mutex_unlock(&verify_mutex);
+
+	syslog(LOG_INFO, "verify: enabled on %s, probes to %s:%d at %d/s\n",
+	       v->iface, v->probe_dst[0] ? v->probe_dst : "(none)",
+	       v->probe_port, v->probe_rate);
+	return 0;
+}
+
+int verify_stop(void)
+{
+	pthread_mutex_lock(&verify_mutex);
+	config.enable = 0;
+	generation++;
+	pthread_cond_signal(&verify_cond);
+	pthread_mutex_unlock(&verify_mutex);
+	return 0;
+}
+
+void verify_get_result(struct jt_msg_verify_result *r)
+{
+	pthread_mutex_lock(&verify_mutex);
+	memcpy(r, &result, sizeof(*r));
+	pthread_mutex_unlock(&verify_mutex);
+}
+
+static int init_realtime(void)
+{
+	/* Not pinned to RT_CPU: the probes and the netlink dump must not
+	 * delay the sampling thread. */
+	struct sched_param schedparm;
+	memset(&schedparm, 0, sizeof(schedparm));
+	schedparm.sched_priority = thread_info.thread_prio;
+	sched_setscheduler(0, SCHED_FIFO, &schedparm);
+	return 0;
+}
+
+static void qdisc_parse_cb(struct nl_object *obj, void *arg)
+{
+	struct qd_sample *s = arg;
+	struct rtnl_tc *tc = (struct rtnl_tc *)obj;
+	const char *kind;
+
+	if (rtnl_tc_get_ifindex(tc) != s->ifindex) {
+		return;
+	}
+	kind = rtnl_tc_get_kind(tc);
+	if (!kind || strcmp(kind, "netem")) {
+		return;
+	}
+
+	s->packets += rtnl_tc_get_stat(tc, RTNL_TC_PACKETS);
+	s->drops += rtnl_tc_get_stat(tc, RTNL_TC_DROPS);
+	s->requeues += rtnl_tc_get_stat(tc, RTNL_TC_REQUEUES);
+	s->overlimits += rtnl_tc_get_stat(tc, RTNL_TC_OVERLIMITS);
+	s->backlog += rtnl_tc_get_stat(tc, RTNL_TC_BACKLOG);
+	s->qlen += rtnl_tc_get_stat(tc, RTNL_TC_QLEN);
+	s->found = 1;
+}
+
+static int qdisc_valid_cb(struct nl_msg *msg, void *arg)
+{
+	nl_msg_parse(msg, qdisc_parse_cb, arg);
+	return NL_OK;
+}
+
+/* Dump the qdiscs of one iface. The qdisc cache of netem.c only follows
+ * change events, which don't carry statistics updates. */
+static int qdisc_sample(int ifindex, struct qd_sample *s)
+{
+	struct tcmsg tchdr = {.tcm_family = AF_UNSPEC,
+		              .tcm_ifindex = ifindex };
+	int err;
+
+	memset(s, 0, sizeof(*s));
+	s->ifindex = ifindex;
+
+	nl_socket_modify_cb(sock, NL_CB_VALID, NL_CB_CUSTOM, qdisc_valid_cb,
+	                    s);
+	err = nl_send_simple(sock, RTM_GETQDISC, NLM_F_DUMP, &tchdr,
+	                     sizeof(tchdr));
+	if (err < 0) {
+		return err;
+	}
+	err = nl_recvmsgs_default(sock);
+	return (err < 0) ? err : 0;
+}
+
+/* counters reset when the qdisc is replaced */
+static int64_t counter_delta(uint64_t now, uint64_t prev)
+{
+	return (now >= prev) ? (int64_t)(now - prev) : (int64_t)now;
+}
+
+static int probe_open(const struct jt_msg_verify *v)
+{
+	struct sockaddr_in local = {.sin_family = AF_INET,
+		                    .sin_port = htons(v->probe_port),
+		                    .sin_addr.s_addr = htonl(INADDR_ANY) };
+	int one = 1;
+
+	probe_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	if (probe_fd < 0) {
+		syslog(LOG_ERR, "verify: probe socket: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (setsockopt(probe_fd, SOL_SOCKET, SO_TIMESTAMPNS, &one,
+	               sizeof(one))) {
+		syslog(LOG_ERR, "verify: SO_TIMESTAMPNS: %s\n",
+		       strerror(errno));
+		goto fail;
+	}
+
+	if (bind(probe_fd, (struct sockaddr *)&local, sizeof(local))) {
+		syslog(LOG_ERR, "verify: bind to port %d: %s\n",
+		       v->probe_port, strerror(errno));
+		goto fail;
+	}
+
+	memset(&probe_dst, 0, sizeof(probe_dst));
+	probe_dst.sin_family = AF_INET;
+	probe_dst.sin_port = htons(v->probe_port);
+	inet_pton(AF_INET, v->probe_dst, &probe_dst.sin_addr);
+	return 0;
+
+fail:
+	close(probe_fd);
+	probe_fd = -1;
+	return -1;
+}
+
+static void probe_close(void)
+{
+	if (probe_fd >= 0) {
+		close(probe_fd);
+		probe_fd = -1;
+	}
+	memset(window, 0, sizeof(window));
+	sample_count = 0;
+}
+
+/* returns 1 if a probe was sent */
+static int probe_send(void)
+{
+	struct timespec now;
+	struct probe p;
+	uint32_t seq = probe_seq;
+	int slot = seq % PROBE_WINDOW;
+
+	if (window[slot].tx_us) {
+		/* not settled yet: the window is too small for the rate */
+		return 0;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	p.magic = htonl(PROBE_MAGIC);
+	p.seq = htonl(seq);
+	p.tx_sec = now.tv_sec;
+	p.tx_nsec = now.tv_nsec;
+
+	if (sendto(probe_fd, &p, sizeof(p), 0, (struct sockaddr *)&probe_dst,
+	           sizeof(probe_dst)) != sizeof(p)) {
+		return 0;
+	}
+	window[slot].tx_us = ts_to_us(now);
+	window[slot].rcvd = 0;
+	probe_seq++;
+	return 1;
+}
+
+static void probe_receive(void)
+{
+	struct probe p;
+	char cbuf[CMSG_SPACE(sizeof(struct timespec))];
+	struct iovec iov = {.iov_base = &p, .iov_len = sizeof(p) };
+	struct msghdr mh = {.msg_iov = &iov,
+		            .msg_iovlen = 1,
+		            .msg_control = cbuf,
+		            .msg_controllen = sizeof(cbuf) };
+
+	while (recvmsg(probe_fd, &mh, 0) == sizeof(p)) {
+		struct timespec rx = { 0 };
+		struct cmsghdr *c;
+		int64_t tx_us;
+		int slot;
+
+		for (c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+			if (SOL_SOCKET == c->cmsg_level
+			    && SCM_TIMESTAMPNS == c->cmsg_type) {
+				memcpy(&rx, CMSG_DATA(c), sizeof(rx));
+			}
+		}
+		mh.msg_controllen = sizeof(cbuf);
+
+		if (PROBE_MAGIC != ntohl(p.magic) || 0 == rx.tv_sec) {
+			continue;
+		}
+
+		slot = ntohl(p.seq) % PROBE_WINDOW;
+		tx_us = p.tx_sec * 1000000LL + p.tx_nsec / 1000;
+		if (window[slot].tx_us != tx_us || window[slot].rcvd) {
+			/* stale, duplicated or already counted as lost */
+			continue;
+		}
+		window[slot].rcvd = 1;
+
+		if (sample_count < SAMPLE_MAX) {
+			samples[sample_count++] = ts_to_us(rx) - tx_us;
+		}
+	}
+}
+
+/* count probes older than the grace period as received or lost. */
+static void probe_settle(int64_t now_us, int64_t *settled, int64_t *lost)
+{
+	for (int i = 0; i < PROBE_WINDOW; i++) {
+		if (window[i].tx_us && now_us - window[i].tx_us > PROBE_GRACE_US) {
+			(*settled)++;
+			if (!window[i].rcvd) {
+				(*lost)++;
+			}
+			window[i].tx_us = 0;
+		}
+	}
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a;
+	int64_t y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void delay_stats(struct jt_msg_verify_result *r)
+{
+	static const int pctl[VERIFY_PCTL_COUNT] = { 1, 5, 25, 50, 75, 95, 99 };
+	double sum = 0, sumsq = 0, mean;
+
+	if (!sample_count) {
+		return;
+	}
+
+	qsort(samples, sample_count, sizeof(samples[0]), cmp_int64);
+	for (int i = 0; i < sample_count; i++) {
+		sum += samples[i];
+		sumsq += (double)samples[i] * samples[i];
+	}
+	mean = sum / sample_count;
+
+	r->delay_min_us = samples[0];
+	r->delay_max_us = samples[sample_count - 1];
+	r->delay_mean_us = mean;
+	r->jitter_us = sqrt(fmax(0, sumsq / sample_count - mean * mean));
+	for (int i = 0; i < VERIFY_PCTL_COUNT; i++) {
+		r->delay_pctl_us[i] = samples[(sample_count - 1) * pctl[i] / 100];
+	}
+}
+
+static void *run(void *data)
+{
+	(void)data; /* unused parameter. silence warning. */
+	init_realtime();
+
+	for (;;) {
+		struct jt_msg_verify cfg;
+		struct jt_msg_verify_result r;
+		struct timespec deadline, report_deadline, probe_deadline;
+		struct timespec qdisc_deadline;
+		struct timespec sample_period = {.tv_sec = 0,
+			                         .tv_nsec = SAMPLE_PERIOD_US
+			                                    * 1000 };
+		struct timespec report_period = {.tv_sec = REPORT_PERIOD_US
+			                                   / 1000000 };
+		struct timespec qdisc_period = {.tv_sec = 0,
+			                        .tv_nsec = QDISC_PERIOD_US
+			                                   * 1000 };
+		struct timespec probe_period = { 0 };
+		struct qd_sample prev, cur;
+		unsigned long gen;
+		int ifindex;
+
+		pthread_mutex_lock(&verify_mutex);
+		while (!config.enable) {
+			pthread_cond_wait(&verify_cond, &verify_mutex);
+		}
+		memcpy(&cfg, &config, sizeof(cfg));
+		gen = generation;
+		pthread_mutex_unlock(&verify_mutex);
+
+		ifindex = if_nametoindex(cfg.iface);
+		if (!ifindex) {
+			syslog(LOG_ERR, "verify: no such iface %s\n", cfg.iface);
+			goto disable;
+		}
+
+		if (cfg.probe_dst[0]) {
+			if (probe_open(&cfg)) {
+				goto disable;
+			}
+			probe_period.tv_sec = 1 / cfg.probe_rate;
+			probe_period.tv_nsec =
+			    (1000000000L / cfg.probe_rate) % 1000000000L;
+		}
+
+		if (qdisc_sample(ifindex, &prev)) {
+			syslog(LOG_ERR, "verify: can't read qdisc stats of %s\n",
+			       cfg.iface);
+		}
+
+		memset(&r, 0, sizeof(r));
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		report_deadline = ts_add(deadline, report_period);
+		qdisc_deadline = ts_add(deadline, qdisc_period);
+		probe_deadline = deadline;
+
+		while (gen == current_generation()) {
+			struct timespec now;
+
+			/* without probes, only the qdisc needs waking for */
+			if (probe_fd >= 0) {
+				deadline = ts_add(deadline, sample_period);
+			} else {
+				deadline = qdisc_deadline;
+			}
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+			                &deadline, NULL);
+			clock_gettime(CLOCK_MONOTONIC, &now);
+
+			if (ts_cmp(now, qdisc_deadline) >= 0
+			    && !qdisc_sample(ifindex, &cur)) {
+				r.qd_packets += counter_delta(cur.packets,
+				                              prev.packets);
+				r.qd_drops += counter_delta(cur.drops, prev.drops);
+				r.qd_requeues += counter_delta(cur.requeues,
+				                               prev.requeues);
+				r.qd_overlimits += counter_delta(
+				    cur.overlimits, prev.overlimits);
+				if ((int64_t)cur.backlog > r.qd_backlog_max) {
+					r.qd_backlog_max = cur.backlog;
+				}
+				if ((int64_t)cur.qlen > r.qd_qlen_max) {
+					r.qd_qlen_max = cur.qlen;
+				}
+				prev = cur;
+			}
+			if (ts_cmp(now, qdisc_deadline) >= 0) {
+				qdisc_deadline = ts_add(qdisc_deadline,
+				                        qdisc_period);
+			}
+
+			if (probe_fd >= 0) {
+				while (ts_cmp(now, probe_deadline) >= 0) {
+					probe_send();
+					probe_deadline = ts_add(probe_deadline,
+					                        probe_period);
+				}
+				probe_receive();
+			}
+
+			if (ts_cmp(now, report_deadline) < 0) {
+				continue;
+			}
+
+			if (probe_fd >= 0) {
+				struct timespec rt;
+				clock_gettime(CLOCK_REALTIME, &rt);
+				probe_settle(ts_to_us(rt), &r.probes_sent,
+				             &r.probes_lost);
+				if (r.probes_sent) {
+					r.loss_ppm = r.probes_lost * 1000000
+					             / r.probes_sent;
+				}
+				delay_stats(&r);
+				sample_count = 0;
+			}
+
+			struct netem_params np = {.dir = NETEM_DIR_EGRESS };
+			if (!netem_get_params(cfg.iface, &np)) {
+				r.cfg_delay_us = np.delay * 1000LL;
+				r.cfg_jitter_us = np.jitter * 1000LL;
+				r.cfg_loss_ppm = np.loss;
+			}
+			snprintf(r.iface, MAX_IFACE_LEN, "%s", cfg.iface);
+			r.interval_ms = REPORT_PERIOD_US / 1000;
+
+			pthread_mutex_lock(&verify_mutex);
+			if (gen == generation) {
+				memcpy(&result, &r, sizeof(result));
+			}
+			pthread_mutex_unlock(&verify_mutex);
+			jt_srv_send_verify_result();
+
+			memset(&r, 0, sizeof(r));
+			report_deadline = ts_add(report_deadline,
+			                         report_period);
+		}
+		probe_close();
+		continue;
+
+disable:
+		pthread_mutex_lock(&verify_mutex);
+		if (gen == generation) {
+			config.enable = 0;
+		}
+		pthread_mutex_unlock(&verify_mutex);
+	}
+	return NULL;
+}
+
+int verify_thread_init(void)
+{
+	int err;
+
+	sock = nl_socket_alloc();
+	if (!sock) {
+		syslog(LOG_ERR, "verify: can't allocate netlink socket\n");
+		return -1;
+	}
+	err = nl_connect(sock, NETLINK_ROUTE);
+	if (err < 0) {
+		syslog(LOG_ERR, "verify: netlink connect: %s\n",
+		       nl_geterror(err));
+		nl_socket_free(sock);
+		sock = NULL;
+		return -1;
+	}
+
+	assert(!thread_info.thread_id);
+	err = pthread_attr_init(&thread_info.thread_attr);
+	assert(!err);
+
+	err = pthread_create(&thread_info.thread_id, &thread_info.thread_attr,
+	                     run, NULL);
+	assert(!err);
+	pthread_setname_np(thread_info.thread_id, thread_info.thread_name);
+
+	return 0;
+}
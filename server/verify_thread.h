@@ -0,0 +1,17 @@
+#ifndef VERIFY_THREAD_H
+#define VERIFY_THREAD_H
+
+struct jt_msg_verify;
+struct jt_msg_verify_result;
+
+int verify_thread_init(void);
+
+/* Start (or reconfigure) verification of the egress impairment on
+ * v->iface. v->enable == 0 stops it. */
+int verify_configure(const struct jt_msg_verify *v);
+int verify_stop(void);
+
+/* The most recent completed reporting interval. */
+void verify_get_result(struct jt_msg_verify_result *r);
+
+#endif